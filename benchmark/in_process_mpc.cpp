@@ -0,0 +1,234 @@
+#include <SemiHoRGod/in_process.h>
+#include <utils/circuit.h>
+
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "utils.h"
+
+using namespace SemiHoRGod;
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+template <class R>
+utils::Circuit<R> generateCircuit(size_t gates_per_level, size_t depth,
+                                  utils::GateType gate_type) {
+  utils::Circuit<R> circ;
+
+  std::vector<utils::wire_t> level_inputs(gates_per_level);
+  std::generate(level_inputs.begin(), level_inputs.end(),
+                [&]() { return circ.newInputWire(); });
+
+  for (size_t d = 0; d < depth; ++d) {
+    std::vector<utils::wire_t> level_outputs(gates_per_level);
+
+    for (size_t i = 0; i < gates_per_level; ++i) {
+      if (gate_type == utils::GateType::kRelu) {
+        level_outputs[i] = circ.addGate(utils::GateType::kRelu, level_inputs[i]);
+      } else {
+        level_outputs[i] = circ.addGate(utils::GateType::kMul, level_inputs[i],
+                                        level_inputs[(i + 1) % gates_per_level]);
+      }
+    }
+
+    level_inputs = std::move(level_outputs);
+  }
+
+  for (auto i : level_inputs) {
+    circ.setAsOutput(i);
+  }
+
+  return circ;
+}
+
+template <class R>
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto gates_per_level = opts["gates-per-level"].as<size_t>();
+  auto depth = opts["depth"].as<size_t>();
+  auto security_param = opts["security-param"].as<size_t>();
+  auto threads = opts["threads"].as<size_t>();
+  auto seed = opts["seed"].as<size_t>();
+  auto repeat = opts["repeat"].as<size_t>();
+  auto gate_type = opts["gate-type"].as<std::string>();
+  auto dummy_preproc = opts["dummy-preproc"].as<bool>();
+
+  if (gate_type != "kMul" && gate_type != "kRelu") {
+    throw std::invalid_argument("Expected gate type 'kMul' or 'kRelu'");
+  }
+
+  json output_data;
+  output_data["details"] = {{"gates_per_level", gates_per_level},
+                            {"depth", depth},
+                            {"security_param", security_param},
+                            {"threads", threads},
+                            {"seed", seed},
+                            {"gate_type", gate_type},
+                            {"dummy_preproc", dummy_preproc},
+                            {"ring_bits", FixedPoint<R>::kBits},
+                            {"repeat", repeat}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  auto circ = generateCircuit<R>(gates_per_level, depth,
+                              gate_type == "kRelu" ? utils::GateType::kRelu
+                                                   : utils::GateType::kMul)
+                  .orderGatesByLevel();
+  std::cout << "--- Circuit ---\n";
+  std::cout << circ << std::endl;
+
+  std::unordered_map<utils::wire_t, int> input_pid_map;
+  std::unordered_map<utils::wire_t, R> inputs;
+  for (const auto& g : circ.gates_by_level[0]) {
+    if (g->type == utils::GateType::kInp) {
+      input_pid_map[g->out] = g->out % NUM_PARTIES;
+      inputs[g->out] = g->out % 7 + 1;
+    }
+  }
+
+  InProcessOptions options;
+  options.security_param = static_cast<int>(security_param);
+  options.offline_threads = static_cast<int>(threads);
+  options.online_threads = static_cast<int>(threads);
+  options.dummy_preproc = dummy_preproc;
+  options.seed = seed;
+  options.wan.delay_ms = opts["rtt-ms"].as<double>() / 2;
+  options.wan.jitter_ms = opts["jitter-ms"].as<double>();
+  options.wan.mbps = opts["mbps"].as<double>();
+  options.wan.burst_bytes = opts["burst-bytes"].as<size_t>();
+  options.wan_seed = opts["wan-seed"].as<uint64_t>();
+
+  for (size_t r = 0; r < repeat; ++r) {
+    auto result = runInProcess(circ, input_pid_map, inputs, options);
+
+    json rbench = json::array();
+    for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+      const auto& stats = result.stats[pid];
+      rbench.push_back({{"pid", pid},
+                        {"offline_time", stats.offline_ms},
+                        {"online_time", stats.online_ms},
+                        {"offline_sent", stats.offline_bytes},
+                        {"online_sent", stats.online_bytes}});
+    }
+    output_data["benchmarks"].push_back(rbench);
+
+    std::cout << "--- Repetition " << r + 1 << " ---\n";
+    for (const auto& party : rbench) {
+      std::cout << "party " << party["pid"] << ": offline " << party["offline_time"]
+                << " ms, " << party["offline_sent"] << " bytes; online "
+                << party["online_time"] << " ms, " << party["online_sent"] << " bytes\n";
+    }
+
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+    std::cout << std::endl;
+  }
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("gates-per-level,g", bpo::value<size_t>()->required(), "Number of gates at each level.")
+    ("depth,d", bpo::value<size_t>()->required(), "Multiplicative depth of circuit.")
+    ("security-param", bpo::value<size_t>()->default_value(128), "Security parameter in bits.")
+    ("threads,t", bpo::value<size_t>()->default_value(25), "Number of threads per party (recommended 25).")
+    ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("gate-type", bpo::value<std::string>()->default_value("kMul"), "Type of gates (kMul or kRelu).")
+    ("dummy-preproc", bpo::bool_switch(), "Skip the offline protocol and use dummy preprocessing.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
+
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark offline and online phase with all parties as threads of this process.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
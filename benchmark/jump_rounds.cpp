@@ -0,0 +1,345 @@
+#include <io/netmp.h>
+#include <io/shm_transport.h>
+#include <SemiHoRGod/helpers.h>
+#include <SemiHoRGod/ijmp.h>
+
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "utils.h"
+
+using namespace SemiHoRGod;
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+// One round of the reconstruct pattern: every party receives `nbytes` from the
+// three parties following it and from the three parties preceding it.
+void runRound(ImprovedJmp& jump, io::NetIOMP<NUM_PARTIES>& network,
+              ThreadPool& tpool, int pid, const std::vector<uint8_t>& payload) {
+  for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+    for (int offset = 1; offset <= 4; offset += 3) {
+      int sender1 = pidFromOffset(receiver, offset);
+      int sender2 = pidFromOffset(receiver, offset + 1);
+      int sender3 = pidFromOffset(receiver, offset + 2);
+      jump.jumpUpdate(sender1, sender2, sender3, receiver, payload.size(),
+                      receiver == pid ? nullptr : payload.data());
+    }
+  }
+  jump.communicate(network, tpool);
+  jump.reset();
+}
+
+// Returns average time per round in milliseconds. With `per_round_instance`
+// a fresh jump instance is created every round, so the communication threads
+// are spawned and joined once per round.
+double timeRounds(io::NetIOMP<NUM_PARTIES>& network, ThreadPool& tpool, int pid,
+                  size_t nbytes, size_t rounds, bool per_round_instance) {
+  std::vector<uint8_t> payload(nbytes, 0xAB);
+  auto jump = std::make_unique<ImprovedJmp>(pid);
+  // Warm-up round so that the persistent variant has its workers running.
+  runRound(*jump, network, tpool, pid, payload);
+
+  network.sync();
+  TimePoint start;
+  for (size_t r = 0; r < rounds; ++r) {
+    if (per_round_instance) {
+      jump = std::make_unique<ImprovedJmp>(pid);
+    }
+    runRound(*jump, network, tpool, pid, payload);
+  }
+  TimePoint end;
+  return (end - start) / rounds;
+}
+
+// Average time per round when one party per round (rotating) starts its send
+// `straggler_ms` late and every party spends `compute_ms` on local work
+// between rounds.
+double timeStraggler(io::NetIOMP<NUM_PARTIES>& network, ThreadPool& tpool, int pid,
+                     size_t nbytes, size_t rounds, double straggler_ms,
+                     double compute_ms, bool first_arrival) {
+  std::vector<uint8_t> payload(nbytes, 0xAB);
+  ImprovedJmp jump(pid);
+  jump.setFirstArrival(first_arrival);
+  runRound(jump, network, tpool, pid, payload);
+  jump.drain();
+
+  network.sync();
+  TimePoint start;
+  for (size_t r = 0; r < rounds; ++r) {
+    if (static_cast<int>(r % NUM_PARTIES) == pid) {
+      std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(straggler_ms));
+    }
+    runRound(jump, network, tpool, pid, payload);
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(compute_ms));
+  }
+  jump.drain();
+  TimePoint end;
+  return (end - start) / rounds;
+}
+
+// Runs `rounds` rounds with the given role policy and returns the bytes sent
+// on each of the 21 links (both directions added), gathered from all parties.
+std::vector<uint64_t> linkBytes(io::NetIOMP<NUM_PARTIES>& network, ThreadPool& tpool,
+                                int pid, size_t nbytes, size_t rounds,
+                                JumpRolePolicy policy) {
+  std::vector<uint8_t> payload(nbytes, 0xAB);
+  ImprovedJmp jump(pid);
+  jump.setRolePolicy(policy);
+  if (policy == JumpRolePolicy::kBandwidthAware) {
+    jump.probeLinks(network);
+  }
+  for (size_t r = 0; r < rounds; ++r) {
+    runRound(jump, network, tpool, pid, payload);
+  }
+
+  std::array<std::array<uint64_t, NUM_PARTIES>, NUM_PARTIES> sent{};
+  sent[pid] = jump.linkBytesSent();
+  for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+    if (peer == pid) continue;
+    network.send(peer, sent[pid].data(), sizeof(sent[pid]));
+    network.flush(peer);
+  }
+  for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+    if (peer == pid) continue;
+    network.recv(peer, sent[peer].data(), sizeof(sent[peer]));
+  }
+
+  std::vector<uint64_t> links;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    for (int j = i + 1; j < NUM_PARTIES; ++j) {
+      links.push_back(sent[i][j] + sent[j][i]);
+    }
+  }
+  return links;
+}
+
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto pid = opts["pid"].as<size_t>();
+  auto port = opts["port"].as<int>();
+  auto rounds = opts["rounds"].as<size_t>();
+  auto large_bytes = opts["large-bytes"].as<size_t>();
+  auto repeat = opts["repeat"].as<size_t>();
+  auto straggler_ms = opts["straggler-ms"].as<double>();
+  auto compute_ms = opts["compute-ms"].as<double>();
+
+  io::TcpOptions tcp_options;
+  tcp_options.event_loop = opts["event-loop"].as<bool>();
+
+  std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network = nullptr;
+  if (opts["shm"].as<bool>()) {
+    network = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  } else if (opts["localhost"].as<bool>()) {
+    network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true, tcp_options);
+  } else {
+    std::ifstream fnet(opts["net-config"].as<std::string>());
+    if (!fnet.good()) {
+      fnet.close();
+      throw std::runtime_error("Could not open network config file");
+    }
+    json netdata;
+    fnet >> netdata;
+    fnet.close();
+
+    std::vector<std::string> ipaddress(NUM_PARTIES);
+    std::array<char*, NUM_PARTIES> ip{};
+    for (size_t i = 0; i < NUM_PARTIES; ++i) {
+      ipaddress[i] = netdata[i].get<std::string>();
+      ip[i] = ipaddress[i].data();
+    }
+
+    network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false, tcp_options);
+  }
+  emulateWan(opts, *network);
+
+  json output_data;
+  output_data["details"] = {{"pid", pid},
+                            {"rounds", rounds},
+                            {"large_bytes", large_bytes},
+                            {"repeat", repeat},
+                            {"straggler_ms", straggler_ms},
+                            {"compute_ms", compute_ms},
+                            {"event_loop", tcp_options.event_loop}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  ThreadPool tpool(1);
+  std::vector<size_t> sizes = {8, large_bytes};
+
+  // 旧实现每次 communicate 都创建线程，现在已无法直接测量；这里用每轮新建一个
+  // jump 实例来近似，其中还包括实例本身的构造与析构
+  std::cout << "'fresh instance per round' builds a new jump instance every round, so its\n"
+            << "workers are spawned and joined once per round. It approximates the old\n"
+            << "per-call threads and also includes constructing the instance.\n"
+            << std::endl;
+
+  for (size_t r = 0; r < repeat; ++r) {
+    json rbench;
+    std::cout << "--- Repetition " << r + 1 << " ---\n";
+    for (auto nbytes : sizes) {
+      auto per_round = timeRounds(*network, tpool, pid, nbytes, rounds, true);
+      auto persistent = timeRounds(*network, tpool, pid, nbytes, rounds, false);
+      auto lbl = std::to_string(nbytes) + "B";
+      rbench[lbl] = {{"fresh_instance_per_round_ms", per_round},
+                     {"persistent_workers_ms", persistent}};
+      std::cout << lbl << ": " << per_round << " ms/round (fresh instance per round), "
+                << persistent << " ms/round (persistent workers)\n";
+    }
+    std::cout << std::endl;
+
+    output_data["benchmarks"].push_back(std::move(rbench));
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+  }
+
+  if (straggler_ms > 0) {
+    std::cout << "--- Straggler (" << straggler_ms << " ms late, " << compute_ms
+              << " ms local work per round) ---\n";
+    auto all = timeStraggler(*network, tpool, pid, 8, rounds, straggler_ms, compute_ms, false);
+    auto first = timeStraggler(*network, tpool, pid, 8, rounds, straggler_ms, compute_ms, true);
+    output_data["straggler"] = {{"wait_all_ms", all}, {"first_arrival_ms", first}};
+    std::cout << "wait for all senders: " << all << " ms/round\n"
+              << "first arrival: " << first << " ms/round\n"
+              << std::endl;
+  }
+
+  // Per-link byte report: the slowest link sets the pace, so the max/min
+  // ratio over the 21 links is what matters on uneven networks.
+  std::cout << "--- Link balance (" << rounds << " rounds of " << large_bytes << "B) ---\n";
+  json balance;
+  for (auto policy : {JumpRolePolicy::kFixed, JumpRolePolicy::kRotating,
+                      JumpRolePolicy::kBandwidthAware}) {
+    auto links = linkBytes(*network, tpool, pid, large_bytes, rounds, policy);
+    std::string lbl = policy == JumpRolePolicy::kFixed      ? "fixed"
+                      : policy == JumpRolePolicy::kRotating ? "rotating"
+                                                            : "bandwidth_aware";
+    auto [lo, hi] = std::minmax_element(links.begin(), links.end());
+    balance[lbl] = {{"link_bytes", links}, {"max_over_min", double(*hi) / double(*lo)}};
+
+    std::cout << lbl << ":";
+    size_t idx = 0;
+    for (int i = 0; i < NUM_PARTIES; ++i) {
+      for (int j = i + 1; j < NUM_PARTIES; ++j) {
+        std::cout << " " << i << "-" << j << "=" << links[idx++];
+      }
+    }
+    std::cout << "\n  max/min: " << double(*hi) / double(*lo) << "\n";
+  }
+  std::cout << std::endl;
+  output_data["link_balance"] = balance;
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("pid,p", bpo::value<size_t>()->required(), "Party ID.")
+    ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
+    ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
+    ("event-loop", bpo::bool_switch(), "Drive all TCP sockets from one epoll thread instead of blocking calls.")
+    ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("rounds", bpo::value<size_t>()->default_value(100), "Number of communication rounds to average over.")
+    ("large-bytes", bpo::value<size_t>()->default_value(1 << 20), "Payload size in bytes for the large-message run.")
+    ("straggler-ms", bpo::value<double>()->default_value(0), "Delay of the straggling party per round (0: skip the straggler run).")
+    ("compute-ms", bpo::value<double>()->default_value(0), "Simulated local work between rounds in the straggler run.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
+
+  desc.add(wanOptions());
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark per-round overhead of ImprovedJmp::communicate.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    benchmark(opts);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
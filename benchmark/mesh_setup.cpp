@@ -0,0 +1,191 @@
+#include <io/netmp.h>
+#include <io/shm_transport.h>
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "utils.h"
+
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+// Builds the mesh of one repetition. Every repetition uses its own session id,
+// so a party that is still tearing down the previous mesh cannot be mistaken
+// for a peer of the next one.
+std::unique_ptr<io::NetIOMP<NUM_PARTIES>> connect(const bpo::variables_map& opts,
+                                                  int pid, int port, char* ip[],
+                                                  uint64_t session) {
+  if (opts["shm"].as<bool>()) {
+    return io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  }
+  io::TcpOptions options;
+  options.session = session;
+  options.timeout = std::chrono::milliseconds(opts["timeout-ms"].as<size_t>());
+  return std::make_unique<io::NetIOMP<NUM_PARTIES>>(pid, port, ip, ip == nullptr, options);
+}
+
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto pid = opts["pid"].as<size_t>();
+  auto port = opts["port"].as<int>();
+  auto repeat = opts["repeat"].as<size_t>();
+  auto start_delay_ms = opts["start-delay-ms"].as<size_t>();
+
+  std::vector<std::string> ipaddress(NUM_PARTIES);
+  std::array<char*, NUM_PARTIES> ip{};
+  bool remote = !opts["shm"].as<bool>() && !opts["localhost"].as<bool>();
+  if (remote) {
+    std::ifstream fnet(opts["net-config"].as<std::string>());
+    if (!fnet.good()) {
+      fnet.close();
+      throw std::runtime_error("Could not open network config file");
+    }
+    json netdata;
+    fnet >> netdata;
+    fnet.close();
+
+    for (size_t i = 0; i < NUM_PARTIES; ++i) {
+      ipaddress[i] = netdata[i].get<std::string>();
+      ip[i] = ipaddress[i].data();
+    }
+  }
+
+  json output_data;
+  output_data["details"] = {{"pid", pid},
+                            {"port", port},
+                            {"repeat", repeat},
+                            {"start_delay_ms", start_delay_ms},
+                            {"transport", opts["shm"].as<bool>() ? "shm" : "tcp"}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  for (size_t r = 0; r < repeat; ++r) {
+    // 模拟参与方先后启动：编号越大启动越晚
+    std::this_thread::sleep_for(std::chrono::milliseconds(start_delay_ms * pid));
+
+    TimePoint start;
+    auto network = connect(opts, pid, port, remote ? ip.data() : nullptr, r);
+    TimePoint connected;
+    network->sync();
+    TimePoint end;
+
+    json rbench = {{"setup_ms", connected - start}, {"first_sync_ms", end - connected}};
+    std::cout << "--- Repetition " << r + 1 << " ---\n"
+              << "setup: " << connected - start << " ms\n"
+              << "first sync: " << end - connected << " ms\n"
+              << std::endl;
+
+    output_data["benchmarks"].push_back(std::move(rbench));
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+  }
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("pid,p", bpo::value<size_t>()->required(), "Party ID.")
+    ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
+    ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
+    ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("timeout-ms", bpo::value<size_t>()->default_value(60000), "Give up if the mesh is not complete after this long.")
+    ("start-delay-ms", bpo::value<size_t>()->default_value(0), "Party i waits i times this long before connecting, to emulate a staggered launch.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of meshes to set up.");
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark NetIOMP mesh setup time.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    benchmark(opts);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <utils/circuit.h>
 
@@ -32,8 +33,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> level_inputs(gates_per_level);
   std::generate(level_inputs.begin(), level_inputs.end(),
@@ -61,8 +63,9 @@ utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
 }
 
 
-utils::Circuit<Ring> generateTrdotpCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateTrdotpCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   // 初始化输入向量
   std::vector<utils::wire_t> vwa(gates_per_level);
@@ -90,8 +93,9 @@ utils::Circuit<Ring> generateTrdotpCircuit(size_t gates_per_level, size_t depth)
   return circ;
 }
 
-utils::Circuit<Ring> generateReluCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateReluCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> level_inputs(gates_per_level);
   std::generate(level_inputs.begin(), level_inputs.end(),
@@ -115,6 +119,7 @@ utils::Circuit<Ring> generateReluCircuit(size_t gates_per_level, size_t depth) {
   return circ;
 }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -133,10 +138,19 @@ void benchmark(const bpo::variables_map& opts) {
   auto port = opts["port"].as<int>();
   auto depth = opts["depth"].as<size_t>();
   auto gate_type = opts["gate-type"].as<std::string>();
+  auto const_round = opts["const-round"].as<bool>();
+  auto single_sender = opts["single-sender"].as<bool>();
+  auto rotate_roles = opts["rotate-roles"].as<bool>();
+  auto bandwidth_aware = opts["bandwidth-aware"].as<bool>();
+  auto replan_interval = opts["replan-interval"].as<size_t>();
+  auto first_arrival = opts["first-arrival"].as<bool>();
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1 = nullptr;
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2 = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network1 = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+    network2 = io::makeShmNetwork<NUM_PARTIES>(pid, port + 100);
+  } else if (opts["localhost"].as<bool>()) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, nullptr, true);
   } else {
@@ -159,6 +173,8 @@ void benchmark(const bpo::variables_map& opts) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, ip.data(), false);
   }
+  emulateWan(opts, *network1);
+  emulateWan(opts, *network2);
 
   json output_data;
   output_data["details"] = {{"gates", gates},
@@ -169,6 +185,13 @@ void benchmark(const bpo::variables_map& opts) {
                             {"seed", seed},
                             {"depth", depth},
                             {"gate_type", gate_type},
+                            {"const_round", const_round},
+                            {"single_sender", single_sender},
+                            {"rotate_roles", rotate_roles},
+                            {"bandwidth_aware", bandwidth_aware},
+                            {"replan_interval", replan_interval},
+                            {"first_arrival", first_arrival},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -180,17 +203,17 @@ void benchmark(const bpo::variables_map& opts) {
 
   SemiHoRGod::utils::LevelOrderedCircuit circ;
   if(gate_type == "kMul") {
-    circ = generateCircuit(gates, depth).orderGatesByLevel();
+    circ = generateCircuit<R>(gates, depth).orderGatesByLevel();
   }
   else if (gate_type == "kRelu")
   {
-    circ = generateReluCircuit(gates, depth).orderGatesByLevel();
+    circ = generateReluCircuit<R>(gates, depth).orderGatesByLevel();
   }
   else if (gate_type == "kTrdotp") {
-    circ = generateTrdotpCircuit(gates, depth).orderGatesByLevel();
+    circ = generateTrdotpCircuit<R>(gates, depth).orderGatesByLevel();
   }
   else {
-    circ = generateCircuit(gates, depth).orderGatesByLevel();
+    circ = generateCircuit<R>(gates, depth).orderGatesByLevel();
   }
 
   std::unordered_map<utils::wire_t, int> input_pid_map;
@@ -201,8 +224,16 @@ void benchmark(const bpo::variables_map& opts) {
   }
 
   for (size_t r = 0; r < repeat; ++r) {
-    OfflineEvaluator eval(pid, network1, network2, circ, security_param,
-                          cm_threads, seed);
+    OfflineEvaluator<R> eval(pid, network1, network2, circ, security_param,
+                             cm_threads, seed);
+    eval.setSingleValueSender(single_sender);
+    eval.setFirstArrival(first_arrival);
+    if (bandwidth_aware) {
+      eval.setJumpRolePolicy(JumpRolePolicy::kBandwidthAware, replan_interval);
+      eval.probeJumpLinks();
+    } else {
+      eval.setJumpRolePolicy(rotate_roles ? JumpRolePolicy::kRotating : JumpRolePolicy::kFixed);
+    }
 
     network1->sync();
     network2->sync();
@@ -212,13 +243,17 @@ void benchmark(const bpo::variables_map& opts) {
 
     nlohmann::json rbench;
     emp::PRG prg(&seed, 0);
-    BENCHMARK(rbench, "offline_setwire", eval.offline_setwire, circ, input_pid_map, security_param, pid, prg);
+    if (const_round) {
+      BENCHMARK(rbench, "offline_setwire_const_round", eval.offline_setwire_const_round, circ, input_pid_map, security_param, pid, prg);
+    } else {
+      BENCHMARK(rbench, "offline_setwire", eval.offline_setwire, circ, input_pid_map, security_param, pid, prg);
+    }
 
     std::cout << "--- Repetition " << r + 1 << " ---\n";
     for (const auto& [key, value] : rbench.items()) {
       size_t bytes_sent = 0;
       for (const auto& i : value["communication"]) {
-        bytes_sent += i.get<size_t>();
+        bytes_sent += i.template get<size_t>();
       }
       std::cout << key << ": " << value["time"] << " ms, " << bytes_sent
                 << " bytes\n";
@@ -259,12 +294,22 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("depth,d", bpo::value<size_t>()->required(), "Multiplicative depth of circuit.")
     ("gate-type", bpo::value<std::string>()->default_value("kMul"), "Type of gates.")
+    ("const-round", bpo::bool_switch(), "Use preprocessing whose round count does not depend on circuit depth.")
+    ("single-sender", bpo::bool_switch(), "Only one sender per jump sends the value, the others send digests.")
+    ("rotate-roles", bpo::bool_switch(), "Rotate value/digest duties among jump senders every round.")
+    ("bandwidth-aware", bpo::bool_switch(), "Send jump values over the fastest measured links (probes links first).")
+    ("replan-interval", bpo::value<size_t>()->default_value(16), "Rounds between link measurement exchanges with --bandwidth-aware (0: probe only).")
+    ("first-arrival", bpo::bool_switch(), "Finish jump rounds on the first consistent value instead of waiting for all senders.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -314,8 +359,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -323,7 +369,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <utils/circuit.h>
 
@@ -14,8 +15,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-utils::Circuit<Ring> generateCircuit(size_t num_mult_gates) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateCircuit(size_t num_mult_gates) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> inputs(num_mult_gates);
   std::generate(inputs.begin(), inputs.end(),
@@ -31,6 +33,7 @@ utils::Circuit<Ring> generateCircuit(size_t num_mult_gates) {
   return circ;
 }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -50,7 +53,10 @@ void benchmark(const bpo::variables_map& opts) {
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1 = nullptr;
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2 = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network1 = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+    network2 = io::makeShmNetwork<NUM_PARTIES>(pid, port + 100);
+  } else if (opts["localhost"].as<bool>()) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, nullptr, true);
   } else {
@@ -74,6 +80,8 @@ void benchmark(const bpo::variables_map& opts) {
     network2 =
         std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, ip.data(), false);
   }
+  emulateWan(opts, *network1);
+  emulateWan(opts, *network2);
 
   json output_data;
   output_data["details"] = {{"gates", gates},
@@ -82,6 +90,7 @@ void benchmark(const bpo::variables_map& opts) {
                             {"cm_threads", cm_threads},
                             {"cp_threads", cp_threads},
                             {"seed", seed},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -91,7 +100,7 @@ void benchmark(const bpo::variables_map& opts) {
   }
   std::cout << std::endl;
 
-  auto circ = generateCircuit(gates).orderGatesByLevel();
+  auto circ = generateCircuit<R>(gates).orderGatesByLevel();
 
   std::unordered_map<utils::wire_t, int> input_pid_map;
   for (const auto& g : circ.gates_by_level[0]) {
@@ -101,8 +110,8 @@ void benchmark(const bpo::variables_map& opts) {
   }
 
   for (size_t r = 0; r < repeat; ++r) {
-    OfflineEvaluator eval(pid, network1, network2, circ, security_param,
-                          cm_threads, seed);
+    OfflineEvaluator<R> eval(pid, network1, network2, circ, security_param,
+                             cm_threads, seed);
     emp::PRG prg(&seed, 0);
     network1->sync();
     network2->sync();
@@ -171,10 +180,14 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -224,8 +237,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -233,7 +247,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <utils/circuit.h>
@@ -16,6 +17,7 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -34,7 +36,9 @@ void benchmark(const bpo::variables_map& opts) {
   auto batch_size = opts["batch-size"].as<size_t>();
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  } else if (opts["localhost"].as<bool>()) {
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
   } else {
     std::ifstream fnet(opts["net-config"].as<std::string>());
@@ -54,6 +58,7 @@ void benchmark(const bpo::variables_map& opts) {
     }
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
   }
+  emulateWan(opts, *network);
 
   json output_data;
   output_data["details"] = {{"pid", pid},
@@ -62,7 +67,8 @@ void benchmark(const bpo::variables_map& opts) {
                             {"seed", seed},
                             {"neural_network", neural_network},
                             {"repeat", repeat},
-                            {"batch_size", batch_size}};
+                            {"batch_size", batch_size},
+                            {"ring_bits", FixedPoint<R>::kBits}};
   output_data["benchmarks"] = json::array();
 
   std::cout << "--- Details ---\n";
@@ -73,11 +79,11 @@ void benchmark(const bpo::variables_map& opts) {
 
   utils::LevelOrderedCircuit circ;
   if (neural_network == "fcn") {
-    circ = utils::NeuralNetwork<Ring>::fcnMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::fcnMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   } else {
-    circ = utils::NeuralNetwork<Ring>::lenetMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::lenetMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   }
@@ -96,11 +102,11 @@ void benchmark(const bpo::variables_map& opts) {
 
   for (size_t r = 0; r < repeat; ++r) {
     std::cout << "--- Repetition " << r + 1 << " ---\n";
-    OfflineEvaluator offline_eval(pid, network, nullptr, circ, security_param, threads);
+    OfflineEvaluator<R> offline_eval(pid, network, nullptr, circ, security_param, threads);
     // auto preproc =
-    //     OfflineEvaluator::dummy(circ, iNUM_PARTIES>ut_pid_map, security_param, pid, prg);
+    //     OfflineEvaluator<R>::dummy(circ, iNUM_PARTIES>ut_pid_map, security_param, pid, prg);
 
-    // OnlineEvaluator eval(pid, network, std::move(preproc), circ, security_param,
+    // OnlineEvaluator<R> eval(pid, network, std::move(preproc), circ, security_param,
     //                      threads, seed);
 
     network->sync();
@@ -160,10 +166,14 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -213,8 +223,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
 
     auto neural_network = opts["neural-network"].as<std::string>();
@@ -228,7 +239,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
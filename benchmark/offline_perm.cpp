@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <utils/circuit.h>
 
@@ -33,8 +34,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_length) {
-    std::vector<Ring> permutation;
+template <class R>
+std::vector<R> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_length) {
+    std::vector<R> permutation;
     
     // 创建初始序列 [0, 1, 2, ..., n-1]
     for (int i = 0; i < permutation_length; ++i) {
@@ -44,8 +46,8 @@ std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_
     // 使用 Fisher-Yates 洗牌算法
     for (int i = permutation_length - 1; i > 0; --i) {
         // 生成 [0, i] 范围内的随机数
-        Ring rand_val;
-        prg.random_data(&rand_val, sizeof(Ring));
+        R rand_val;
+        prg.random_data(&rand_val, sizeof(R));
         int j = rand_val % (i + 1);
         
         // 交换元素
@@ -54,6 +56,7 @@ std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_
     return permutation;
   }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -73,7 +76,10 @@ void benchmark(const bpo::variables_map& opts) {
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1 = nullptr;
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2 = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network1 = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+    network2 = io::makeShmNetwork<NUM_PARTIES>(pid, port + 100);
+  } else if (opts["localhost"].as<bool>()) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, nullptr, true);
   } else {
@@ -97,6 +103,8 @@ void benchmark(const bpo::variables_map& opts) {
     network2 =
         std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, ip.data(), false);
   }
+  emulateWan(opts, *network1);
+  emulateWan(opts, *network2);
 
   json output_data;
   output_data["details"] = {{"gates", gates},
@@ -105,6 +113,7 @@ void benchmark(const bpo::variables_map& opts) {
                             {"cm_threads", cm_threads},
                             {"cp_threads", cp_threads},
                             {"seed", seed},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -120,8 +129,8 @@ void benchmark(const bpo::variables_map& opts) {
 
   for (size_t r = 0; r < repeat; ++r) {
     
-    OfflineEvaluator eval(pid, network1, network2, circ, security_param,
-                          cm_threads, seed);
+    OfflineEvaluator<R> eval(pid, network1, network2, circ, security_param,
+                             cm_threads, seed);
 
     
     network1->sync();
@@ -132,8 +141,8 @@ void benchmark(const bpo::variables_map& opts) {
 
     nlohmann::json rbench;
     emp::PRG prg(&seed, 0);
-    vector<Ring> data_vector = generateRandomPermutation(prg, gates);
-    vector<Ring> permutation_vector = generateRandomPermutation(prg, gates);
+    vector<R> data_vector = generateRandomPermutation<R>(prg, gates);
+    vector<R> permutation_vector = generateRandomPermutation<R>(prg, gates);
     BENCHMARK(rbench, "offline_setwire", eval.dummy_permutation, circ, input_pid_map, security_param, pid, prg, data_vector, permutation_vector);
     // BENCHMARK(rbench, "set_wire_masks", eval.setWireMasks, input_pid_map);
     // BENCHMARK(rbench, "ab_terms", eval.computeABCrossTerms);
@@ -145,7 +154,7 @@ void benchmark(const bpo::variables_map& opts) {
     for (const auto& [key, value] : rbench.items()) {
       size_t bytes_sent = 0;
       for (const auto& i : value["communication"]) {
-        bytes_sent += i.get<size_t>();
+        bytes_sent += i.template get<size_t>();
       }
       std::cout << key << ": " << value["time"] << " ms, " << bytes_sent
                 << " bytes\n";
@@ -186,10 +195,14 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -239,8 +252,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -248,7 +262,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
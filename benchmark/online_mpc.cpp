@@ -1,4 +1,6 @@
 #include <io/netmp.h>
+#include <io/replay_transport.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <utils/circuit.h>
@@ -15,8 +17,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> level_inputs(gates_per_level);
   std::generate(level_inputs.begin(), level_inputs.end(),
@@ -44,8 +47,9 @@ utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
 }
 
 
-utils::Circuit<Ring> generateTrdotpCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateTrdotpCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   // 初始化输入向量
   std::vector<utils::wire_t> vwa(gates_per_level);
@@ -73,8 +77,9 @@ utils::Circuit<Ring> generateTrdotpCircuit(size_t gates_per_level, size_t depth)
   return circ;
 }
 
-utils::Circuit<Ring> generateReluCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateReluCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> level_inputs(gates_per_level);
   std::generate(level_inputs.begin(), level_inputs.end(),
@@ -98,6 +103,7 @@ utils::Circuit<Ring> generateReluCircuit(size_t gates_per_level, size_t depth) {
   return circ;
 }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -115,9 +121,20 @@ void benchmark(const bpo::variables_map& opts) {
   auto repeat = opts["repeat"].as<size_t>();
   auto port = opts["port"].as<int>();
   auto gate_type = opts["gate-type"].as<std::string>();
+  auto deferred_verify = opts["deferred-verify"].as<bool>();
+  auto verify_interval = opts["verify-interval"].as<size_t>();
+  auto single_sender = opts["single-sender"].as<bool>();
+  auto rotate_roles = opts["rotate-roles"].as<bool>();
+  auto bandwidth_aware = opts["bandwidth-aware"].as<bool>();
+  auto replan_interval = opts["replan-interval"].as<size_t>();
+  auto first_arrival = opts["first-arrival"].as<bool>();
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts.count("replay-transcript") != 0) {
+    network = io::makeReplayNetwork<NUM_PARTIES>(pid, opts["replay-transcript"].as<std::string>());
+  } else if (opts["shm"].as<bool>()) {
+    network = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  } else if (opts["localhost"].as<bool>()) {
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
   } else {
     std::ifstream fnet(opts["net-config"].as<std::string>());
@@ -138,6 +155,8 @@ void benchmark(const bpo::variables_map& opts) {
 
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
   }
+  emulateWan(opts, *network);
+  recordTranscript(opts, *network);
 
   json output_data;
   output_data["details"] = {{"gates_per_level", gates_per_level},
@@ -147,6 +166,14 @@ void benchmark(const bpo::variables_map& opts) {
                             {"threads", threads},
                             {"seed", seed},
                             {"gate_type", gate_type},
+                            {"deferred_verify", deferred_verify},
+                            {"verify_interval", verify_interval},
+                            {"single_sender", single_sender},
+                            {"rotate_roles", rotate_roles},
+                            {"bandwidth_aware", bandwidth_aware},
+                            {"replan_interval", replan_interval},
+                            {"first_arrival", first_arrival},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -156,7 +183,7 @@ void benchmark(const bpo::variables_map& opts) {
   }
   std::cout << std::endl;
 
-  auto circ = generateCircuit(gates_per_level, depth).orderGatesByLevel();
+  auto circ = generateCircuit<R>(gates_per_level, depth).orderGatesByLevel();
   std::cout << "--- Circuit ---\n";
   std::cout << circ << std::endl;
 
@@ -171,11 +198,20 @@ void benchmark(const bpo::variables_map& opts) {
 
   for (size_t r = 0; r < repeat; ++r) {
     auto preproc =
-        OfflineEvaluator::dummy(circ, input_pid_map, security_param, pid, prg);
-
-    OnlineEvaluator eval(pid, network, std::move(preproc), circ, security_param,
-                         threads, seed);
-
+        OfflineEvaluator<R>::dummy(circ, input_pid_map, security_param, pid, prg);
+
+    OnlineEvaluator<R> eval(pid, network, std::move(preproc), circ, security_param,
+                            threads, seed);
+
+    eval.setDeferredVerification(deferred_verify, verify_interval);
+    eval.setSingleValueSender(single_sender);
+    eval.setFirstArrival(first_arrival);
+    if (bandwidth_aware) {
+      eval.setJumpRolePolicy(JumpRolePolicy::kBandwidthAware, replan_interval);
+      eval.probeJumpLinks();
+    } else {
+      eval.setJumpRolePolicy(rotate_roles ? JumpRolePolicy::kRotating : JumpRolePolicy::kFixed);
+    }
     network->sync();
 
     eval.setRandomInputs();
@@ -183,6 +219,7 @@ void benchmark(const bpo::variables_map& opts) {
     for (size_t i = 0; i < circ.gates_by_level.size(); ++i) {
       eval.evaluateGatesAtDepth(i);
     }
+    eval.verify();
     StatsPoint end(*network);
 
     auto rbench = end - start;
@@ -203,6 +240,7 @@ void benchmark(const bpo::variables_map& opts) {
     std::cout << std::endl;
   }
 
+  reportReplay(*network);
   output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
                           {"peak_resident_set_size", peakResidentSetSize()}};
 
@@ -229,11 +267,23 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("gate-type", bpo::value<std::string>()->default_value("kMul"), "Type of gates.")
+    ("deferred-verify", bpo::bool_switch(), "Check jump hashes at checkpoints instead of every round.")
+    ("verify-interval", bpo::value<size_t>()->default_value(0), "Rounds between checkpoints in deferred mode (0: only at the end).")
+    ("single-sender", bpo::bool_switch(), "Only one sender per jump sends the value, the others send digests.")
+    ("rotate-roles", bpo::bool_switch(), "Rotate value/digest duties among jump senders every round.")
+    ("bandwidth-aware", bpo::bool_switch(), "Send jump values over the fastest measured links (probes links first).")
+    ("replan-interval", bpo::value<size_t>()->default_value(16), "Rounds between link measurement exchanges with --bandwidth-aware (0: probe only).")
+    ("first-arrival", bpo::bool_switch(), "Finish jump rounds on the first consistent value instead of waiting for all senders.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+  desc.add(transcriptOptions());
+
   return desc;
 }
 // clang-format on
@@ -283,8 +333,14 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0) && (opts.count("replay-transcript") == 0)) {
+      throw std::runtime_error(
+          "Expected one of 'localhost', 'shm', 'net-config' or 'replay-transcript'");
+    }
+
+    if (opts.count("record-transcript") != 0 && opts.count("replay-transcript") != 0) {
+      throw std::runtime_error("Cannot record and replay a transcript at once");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -292,7 +348,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
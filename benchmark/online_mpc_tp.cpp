@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <utils/circuit.h>
 #include <SemiHoRGod/online_evaluator.h>
@@ -14,8 +15,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateCircuit(size_t gates_per_level, size_t depth) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> level_inputs(gates_per_level);
   std::generate(level_inputs.begin(), level_inputs.end(),
@@ -42,6 +44,7 @@ utils::Circuit<Ring> generateCircuit(size_t gates_per_level, size_t depth) {
   return circ;
 }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -61,7 +64,10 @@ void benchmark(const bpo::variables_map& opts) {
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1 = nullptr;
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2 = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network1 = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+    network2 = io::makeShmNetwork<NUM_PARTIES>(pid, port + 100);
+  } else if (opts["localhost"].as<bool>()) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, nullptr, true);
   } else {
@@ -85,6 +91,8 @@ void benchmark(const bpo::variables_map& opts) {
     network2 =
         std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, ip.data(), false);
   }
+  emulateWan(opts, *network1);
+  emulateWan(opts, *network2);
 
   json output_data;
   output_data["details"] = {{"gates", gates},
@@ -92,6 +100,7 @@ void benchmark(const bpo::variables_map& opts) {
                             {"security_param", security_param},
                             {"threads", threads},
                             {"seed", seed},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -101,7 +110,7 @@ void benchmark(const bpo::variables_map& opts) {
   }
   std::cout << std::endl;
 
-  auto circ = generateCircuit(gates, depth).orderGatesByLevel();
+  auto circ = generateCircuit<R>(gates, depth).orderGatesByLevel();
 
   std::unordered_map<utils::wire_t, int> input_pid_map;
   for (const auto& g : circ.gates_by_level[0]) {
@@ -113,10 +122,10 @@ void benchmark(const bpo::variables_map& opts) {
   for (size_t r = 0; r < repeat; ++r) {
     emp::PRG prg(&seed, 0);
     auto preproc =
-        OfflineEvaluator::dummy(circ, input_pid_map, security_param, pid, prg);
+        OfflineEvaluator<R>::dummy(circ, input_pid_map, security_param, pid, prg);
 
-    OnlineEvaluator eval(pid, network1, std::move(preproc), circ, security_param,
-                         threads, seed);
+    OnlineEvaluator<R> eval(pid, network1, std::move(preproc), circ, security_param,
+                            threads, seed);
 
     eval.setRandomInputs();
     
@@ -190,10 +199,14 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -243,8 +256,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -252,7 +266,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
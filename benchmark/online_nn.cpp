@@ -1,4 +1,6 @@
 #include <io/netmp.h>
+#include <io/replay_transport.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <utils/circuit.h>
@@ -16,6 +18,7 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -34,7 +37,11 @@ void benchmark(const bpo::variables_map& opts) {
   auto batch_size = opts["batch-size"].as<size_t>();
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts.count("replay-transcript") != 0) {
+    network = io::makeReplayNetwork<NUM_PARTIES>(pid, opts["replay-transcript"].as<std::string>());
+  } else if (opts["shm"].as<bool>()) {
+    network = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  } else if (opts["localhost"].as<bool>()) {
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
   } else {
     std::ifstream fnet(opts["net-config"].as<std::string>());
@@ -55,6 +62,8 @@ void benchmark(const bpo::variables_map& opts) {
 
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
   }
+  emulateWan(opts, *network);
+  recordTranscript(opts, *network);
 
   json output_data;
   output_data["details"] = {{"pid", pid},
@@ -63,7 +72,8 @@ void benchmark(const bpo::variables_map& opts) {
                             {"seed", seed},
                             {"neural_network", neural_network},
                             {"repeat", repeat},
-                            {"batch_size", batch_size}};
+                            {"batch_size", batch_size},
+                            {"ring_bits", FixedPoint<R>::kBits}};
   output_data["benchmarks"] = json::array();
 
   std::cout << "--- Details ---\n";
@@ -74,11 +84,11 @@ void benchmark(const bpo::variables_map& opts) {
 
   utils::LevelOrderedCircuit circ;
   if (neural_network == "fcn") {
-    circ = utils::NeuralNetwork<Ring>::fcnMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::fcnMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   } else {
-    circ = utils::NeuralNetwork<Ring>::lenetMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::lenetMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   }
@@ -98,10 +108,10 @@ void benchmark(const bpo::variables_map& opts) {
   for (size_t r = 0; r < repeat; ++r) {
     std::cout << "--- Repetition " << r + 1 << " ---\n";
     auto preproc =
-        OfflineEvaluator::dummy(circ, input_pid_map, security_param, pid, prg);
+        OfflineEvaluator<R>::dummy(circ, input_pid_map, security_param, pid, prg);
 
-    OnlineEvaluator eval(pid, network, std::move(preproc), circ, security_param,
-                         threads, seed);
+    OnlineEvaluator<R> eval(pid, network, std::move(preproc), circ, security_param,
+                            threads, seed);
 
     network->sync();
 
@@ -130,6 +140,7 @@ void benchmark(const bpo::variables_map& opts) {
     }
     std::cout << std::endl;
   }
+  reportReplay(*network);
   std::cout << "Following is the memory: " << "\n";
   output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
                           {"peak_resident_set_size", peakResidentSetSize()}};
@@ -159,10 +170,15 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+  desc.add(transcriptOptions());
+
   return desc;
 }
 // clang-format on
@@ -212,8 +228,14 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0) && (opts.count("replay-transcript") == 0)) {
+      throw std::runtime_error(
+          "Expected one of 'localhost', 'shm', 'net-config' or 'replay-transcript'");
+    }
+
+    if (opts.count("record-transcript") != 0 && opts.count("replay-transcript") != 0) {
+      throw std::runtime_error("Cannot record and replay a transcript at once");
     }
 
     auto neural_network = opts["neural-network"].as<std::string>();
@@ -227,7 +249,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <utils/circuit.h>
@@ -16,6 +17,7 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -36,7 +38,9 @@ void benchmark(const bpo::variables_map& opts) {
 
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+  } else if (opts["localhost"].as<bool>()) {
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
   } else {
     std::ifstream fnet(opts["net-config"].as<std::string>());
@@ -57,6 +61,7 @@ void benchmark(const bpo::variables_map& opts) {
 
     network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
   }
+  emulateWan(opts, *network);
 
   json output_data;
   output_data["details"] = {{"pid", pid},
@@ -65,7 +70,8 @@ void benchmark(const bpo::variables_map& opts) {
                             {"seed", seed},
                             {"neural_network", neural_network},
                             {"repeat", repeat},
-                            {"batch_size", batch_size}};
+                            {"batch_size", batch_size},
+                            {"ring_bits", FixedPoint<R>::kBits}};
   output_data["benchmarks"] = json::array();
 
   std::cout << "--- Details ---\n";
@@ -76,11 +82,11 @@ void benchmark(const bpo::variables_map& opts) {
 
   utils::LevelOrderedCircuit circ;
   if (neural_network == "fcn") {
-    circ = utils::NeuralNetwork<Ring>::fcnMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::fcnMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   } else {
-    circ = utils::NeuralNetwork<Ring>::lenetMNIST(batch_size)
+    circ = utils::NeuralNetwork<R>::lenetMNIST(batch_size)
                .getCircuit()
                .orderGatesByLevel();
   }
@@ -100,10 +106,10 @@ void benchmark(const bpo::variables_map& opts) {
   for (size_t r = 0; r < repeat; ++r) {
     std::cout << "--- Repetition " << r + 1 << " ---\n";
     auto preproc =
-        OfflineEvaluator::dummy(circ, input_pid_map, security_param, pid, prg);
+        OfflineEvaluator<R>::dummy(circ, input_pid_map, security_param, pid, prg);
 
-    OnlineEvaluator eval(pid, network, std::move(preproc), circ, security_param,
-                         threads, seed);
+    OnlineEvaluator<R> eval(pid, network, std::move(preproc), circ, security_param,
+                            threads, seed);
 
     network->sync();
 
@@ -171,11 +177,15 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("num-queries", bpo::value<size_t>()->default_value(1), "Number of queries (recommended 1).")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -225,8 +235,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
 
     auto neural_network = opts["neural-network"].as<std::string>();
@@ -240,7 +251,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
@@ -1,4 +1,5 @@
 #include <io/netmp.h>
+#include <io/shm_transport.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <utils/circuit.h>
 #include <SemiHoRGod/online_evaluator.h>
@@ -32,8 +33,9 @@ using namespace SemiHoRGod;
 using json = nlohmann::json;
 namespace bpo = boost::program_options;
 
-utils::Circuit<Ring> generateCircuit(size_t num_mult_gates) {
-  utils::Circuit<Ring> circ;
+template <class R>
+utils::Circuit<R> generateCircuit(size_t num_mult_gates) {
+  utils::Circuit<R> circ;
 
   std::vector<utils::wire_t> inputs(num_mult_gates);
   std::generate(inputs.begin(), inputs.end(),
@@ -49,8 +51,9 @@ utils::Circuit<Ring> generateCircuit(size_t num_mult_gates) {
   return circ;
 }
 
-std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_length) {
-    std::vector<Ring> permutation;
+template <class R>
+std::vector<R> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_length) {
+    std::vector<R> permutation;
     
     // 创建初始序列 [0, 1, 2, ..., n-1]
     for (int i = 0; i < permutation_length; ++i) {
@@ -60,8 +63,8 @@ std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_
     // 使用 Fisher-Yates 洗牌算法
     for (int i = permutation_length - 1; i > 0; --i) {
         // 生成 [0, i] 范围内的随机数
-        Ring rand_val;
-        prg.random_data(&rand_val, sizeof(Ring));
+        R rand_val;
+        prg.random_data(&rand_val, sizeof(R));
         int j = rand_val % (i + 1);
         
         // 交换元素
@@ -70,6 +73,7 @@ std::vector<Ring> generateRandomPermutation(emp::PRG& prg, uint64_t permutation_
     return permutation;
   }
 
+template <class R>
 void benchmark(const bpo::variables_map& opts) {
   bool save_output = false;
   std::string save_file;
@@ -89,7 +93,10 @@ void benchmark(const bpo::variables_map& opts) {
 
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1 = nullptr;
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2 = nullptr;
-  if (opts["localhost"].as<bool>()) {
+  if (opts["shm"].as<bool>()) {
+    network1 = io::makeShmNetwork<NUM_PARTIES>(pid, port);
+    network2 = io::makeShmNetwork<NUM_PARTIES>(pid, port + 100);
+  } else if (opts["localhost"].as<bool>()) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, nullptr, true);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, nullptr, true);
   } else {
@@ -112,6 +119,8 @@ void benchmark(const bpo::variables_map& opts) {
     network1 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port, ip.data(), false);
     network2 = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, port + 100, ip.data(), false);
   }
+  emulateWan(opts, *network1);
+  emulateWan(opts, *network2);
 
   json output_data;
   output_data["details"] = {{"gates", gates},
@@ -120,6 +129,7 @@ void benchmark(const bpo::variables_map& opts) {
                             {"cm_threads", cm_threads},
                             {"cp_threads", cp_threads},
                             {"seed", seed},
+                            {"ring_bits", FixedPoint<R>::kBits},
                             {"repeat", repeat}};
   output_data["benchmarks"] = json::array();
 
@@ -129,18 +139,18 @@ void benchmark(const bpo::variables_map& opts) {
   }
   std::cout << std::endl;
 
-  utils::LevelOrderedCircuit circ = generateCircuit(gates).orderGatesByLevel();;
+  utils::LevelOrderedCircuit circ = generateCircuit<R>(gates).orderGatesByLevel();;
 
   for (size_t r = 0; r < repeat; ++r) {
 
     emp::PRG prg(&seed, 0);
-    vector<Ring> data_vector = generateRandomPermutation(prg, gates);
-    vector<Ring> permutation_vector = generateRandomPermutation(prg, gates);
+    vector<R> data_vector = generateRandomPermutation<R>(prg, gates);
+    vector<R> permutation_vector = generateRandomPermutation<R>(prg, gates);
     std::unordered_map<utils::wire_t, int> input_pid_map;
     
-    OfflineEvaluator offline_eval(pid, network1, network2, circ, security_param, cm_threads, seed);
+    OfflineEvaluator<R> offline_eval(pid, network1, network2, circ, security_param, cm_threads, seed);
     auto preproc =  offline_eval.dummy_permutation(circ, input_pid_map, security_param, pid, prg, data_vector, permutation_vector);
-    OnlineEvaluator online_eval(pid, network1, std::move(preproc), circ, security_param, 1);
+    OnlineEvaluator<R> online_eval(pid, network1, std::move(preproc), circ, security_param, 1);
     // network1->sync();
 
     network1->sync();
@@ -149,7 +159,7 @@ void benchmark(const bpo::variables_map& opts) {
     online_eval.evaluateCircuit_perm(data_vector, permutation_vector);
     StatsPoint end(*network1);
 
-    // OnlineEvaluator online_eval1(pid, network2, std::move(preproc), circ, security_param, 1);
+    // OnlineEvaluator<R> online_eval1(pid, network2, std::move(preproc), circ, security_param, 1);
     // StatsPoint start1(*network2);
     // online_eval1.setInputs_perm(data_vector, permutation_vector);
     // StatsPoint end1(*network2);
@@ -200,10 +210,14 @@ bpo::options_description programOptions() {
     ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
     ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
     ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("shm", bpo::bool_switch(), "All parties are on same machine and communicate through shared memory instead of TCP.")
     ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
     ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
     ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
 
+  desc.add(ringOptions());
+  desc.add(wanOptions());
+
   return desc;
 }
 // clang-format on
@@ -253,8 +267,9 @@ int main(int argc, char* argv[]) {
       ftemp.close();
     }
 
-    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
-      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    if (!opts["localhost"].as<bool>() && !opts["shm"].as<bool>() &&
+        (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost', 'shm' or 'net-config'");
     }
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << std::endl;
@@ -262,7 +277,7 @@ int main(int argc, char* argv[]) {
   }
 
   try {
-    benchmark(opts);
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << "\nFatal error" << std::endl;
     return 1;
@@ -0,0 +1,256 @@
+#include <io/mem_transport.h>
+#include <SemiHoRGod/ijmp.h>
+#include <SemiHoRGod/online_evaluator.h>
+#include <utils/circuit.h>
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+
+#include "utils.h"
+
+using namespace SemiHoRGod;
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+// Dummy preprocessing of `num_instances` copies of the boolean circuit, as
+// OfflineEvaluator::dummy generates it for MSB gates. Returns the input masks
+// of every instance in `input_masks`.
+std::vector<std::vector<preprocg_ptr_t<BoolRing>>> dummyBoolPreproc(
+    const utils::LevelOrderedCircuit& circ, size_t num_instances, int pid, emp::PRG& prg,
+    std::vector<std::vector<BoolRing>>& input_masks) {
+  std::vector<std::vector<preprocg_ptr_t<BoolRing>>> preproc(num_instances);
+  input_masks.assign(num_instances, std::vector<BoolRing>(circ.num_gates));
+  for (size_t i = 0; i < num_instances; ++i) {
+    preproc[i].resize(circ.num_gates);
+    std::vector<DummyShare<BoolRing>> masks(circ.num_gates);
+    for (const auto& level : circ.gates_by_level) {
+      for (const auto& gate : level) {
+        auto& mask = masks[gate->out];
+        switch (gate->type) {
+          case utils::GateType::kInp: {
+            mask.randomize(prg);
+            input_masks[i][gate->out] = mask.secret();
+            preproc[i][gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getCompact(pid));
+            break;
+          }
+
+          case utils::GateType::kAdd: {
+            auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+            mask = masks[g->in1] + masks[g->in2];
+            preproc[i][gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getCompact(pid));
+            break;
+          }
+
+          case utils::GateType::kMul: {
+            auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+            mask.randomize(prg);
+            DummyShare<BoolRing> prod(masks[g->in1].secret() * masks[g->in2].secret(), prg);
+            preproc[i][gate->out] = std::make_unique<PreprocMultGate<BoolRing>>(
+                mask.getCompact(pid), prod.getCompact(pid));
+            break;
+          }
+
+          default:
+            break;
+        }
+      }
+    }
+  }
+  return preproc;
+}
+
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto instances = opts["instances"].as<size_t>();
+  auto threads = opts["threads"].as<size_t>();
+  auto seed = opts["seed"].as<size_t>();
+  auto repeat = opts["repeat"].as<size_t>();
+
+  auto circ = utils::Circuit<BoolRing>::generatePPAMSB().orderGatesByLevel();
+
+  json output_data;
+  output_data["details"] = {{"instances", instances},
+                            {"threads", threads},
+                            {"seed", seed},
+                            {"repeat", repeat}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+  std::cout << "--- Circuit ---\n";
+  std::cout << circ << std::endl;
+
+  for (size_t r = 0; r < repeat; ++r) {
+    auto mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+    auto networks = io::makeInMemoryNetworks<NUM_PARTIES>(mesh);
+
+    // 生成预处理不计时。slice_time 是把各实例的掩码转置为按位切片的时间，
+    // online_time 包括设置输入、逐层求值和输出重构
+    std::vector<std::future<std::pair<double, double>>> parties;
+    for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+      parties.push_back(std::async(std::launch::async, [&, pid]() {
+        auto prg_seed = emp::makeBlock(seed, r);
+        emp::PRG prg(&prg_seed, 0);
+        std::vector<std::vector<BoolRing>> input_masks;
+        auto preproc = dummyBoolPreproc(circ, instances, pid, prg, input_masks);
+        std::vector<preprocg_ptr_t<BoolRing>*> vpreproc(instances);
+        for (size_t i = 0; i < instances; ++i) {
+          vpreproc[i] = preproc[i].data();
+        }
+        ImprovedJmp jump(pid);
+        ThreadPool tpool(threads);
+        networks[pid]->sync();
+
+        TimePoint start;
+        auto sliced = BoolEvaluator::slice(vpreproc, circ);
+        TimePoint online_start;
+        BoolEvaluator bool_eval(pid, std::move(sliced), circ);
+        for (size_t i = 0; i < instances; ++i) {
+          for (const auto& gate : circ.gates_by_level[0]) {
+            // 输入为 0，β 即输入掩码
+            if (gate->type == utils::GateType::kInp) {
+              bool_eval.setWire(i, gate->out, input_masks[i][gate->out]);
+            }
+          }
+        }
+        bool_eval.evaluateAllLevels(*networks[pid], jump, tpool);
+        auto outputs = bool_eval.getOutputShares(*networks[pid], jump, tpool);
+        TimePoint end;
+
+        for (const auto& out : outputs) {
+          if (out[0].val()) {
+            throw std::runtime_error("Wrong MSB output");
+          }
+        }
+        return std::make_pair(online_start - start, end - online_start);
+      }));
+    }
+
+    json rbench = json::array();
+    double max_slice_time = 0;
+    double max_online_time = 0;
+    double max_total_time = 0;
+    for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+      auto [slice_time, online_time] = parties[pid].get();
+      max_slice_time = std::max(max_slice_time, slice_time);
+      max_online_time = std::max(max_online_time, online_time);
+      max_total_time = std::max(max_total_time, slice_time + online_time);
+      rbench.push_back({{"pid", pid}, {"slice_time", slice_time}, {"online_time", online_time}});
+    }
+    // 预处理按实例生成，转置不可省：端到端吞吐量要把它算进去
+    double throughput = static_cast<double>(instances) * 1e3 / max_online_time;
+    double e2e_throughput = static_cast<double>(instances) * 1e3 / max_total_time;
+    output_data["benchmarks"].push_back({{"parties", rbench},
+                                         {"msb_per_second", throughput},
+                                         {"msb_per_second_end_to_end", e2e_throughput}});
+
+    std::cout << "--- Repetition " << r + 1 << " ---\n";
+    std::cout << "slice time: " << max_slice_time << " ms\n";
+    std::cout << "online time: " << max_online_time << " ms\n";
+    std::cout << "online throughput: " << throughput << " MSB/s\n";
+    std::cout << "end-to-end throughput (slice + online): " << e2e_throughput << " MSB/s\n";
+
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+    std::cout << std::endl;
+  }
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("instances,n", bpo::value<size_t>()->default_value(1024), "Number of MSB circuits evaluated together.")
+    ("threads,t", bpo::value<size_t>()->default_value(4), "Number of threads per party.")
+    ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark the boolean evaluator on the PPA circuit of MSB gates, all parties as threads of this process.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    benchmark(opts);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,322 @@
+#include <SemiHoRGod/sharing.h>
+
+#include <array>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "utils.h"
+
+using namespace SemiHoRGod;
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+// Keeps the compiler from dropping results that are never read.
+template <class T>
+void keep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Average time of `op` in nanoseconds per gate.
+double nsPerGate(size_t gates, size_t iterations, const std::function<void()>& op) {
+  op();  // 预热
+  TimePoint start;
+  for (size_t i = 0; i < iterations; ++i) {
+    op();
+  }
+  TimePoint end;
+  return (end - start) * 1e6 / static_cast<double>(iterations * gates);
+}
+
+template <class R>
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto gates = opts["gates"].as<size_t>();
+  auto iterations = opts["iterations"].as<size_t>();
+  auto seed = opts["seed"].as<size_t>();
+  auto repeat = opts["repeat"].as<size_t>();
+
+  json output_data;
+  output_data["details"] = {{"gates", gates},
+                            {"iterations", iterations},
+                            {"seed", seed},
+                            {"ring_bits", FixedPoint<R>::kBits},
+                            {"repeat", repeat}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  // 同一组随机数据分别按三种布局存放：vector<ReplicatedShare>（每个门 21 个元素），
+  // vector<CompactShare>（每个门只存本方持有的 15 个元素）和 ShareMatrix（每个元素一列）
+  const int pid = 0;
+  emp::PRG prg(&emp::zero_block, seed);
+  std::vector<ReplicatedShare<R>> mask(gates), mask_prod(gates), m_in1(gates), m_in2(gates);
+  std::vector<CompactShare<R>> cmask(gates), cmask_prod(gates), cm_in1(gates), cm_in2(gates);
+  std::vector<R> beta1(gates), beta2(gates);
+  ShareMatrix<R> mmask(gates, pid), mmask_prod(gates, pid), mm_in1(gates, pid), mm_in2(gates, pid);
+  auto fill = [&](ReplicatedShare<R>& share, CompactShare<R>& cshare, ShareMatrix<R>& m,
+                  size_t row) {
+    DummyShare<R> dshare;
+    dshare.randomize(prg);
+    share = dshare.getRSS(pid);
+    cshare = dshare.getCompact(pid);
+    m.setRow(row, cshare);
+  };
+  for (size_t g = 0; g < gates; ++g) {
+    fill(mask[g], cmask[g], mmask, g);
+    fill(mask_prod[g], cmask_prod[g], mmask_prod, g);
+    fill(m_in1[g], cm_in1[g], mm_in1, g);
+    fill(m_in2[g], cm_in2[g], mm_in2, g);
+    prg.random_data(&beta1[g], sizeof(R));
+    prg.random_data(&beta2[g], sizeof(R));
+  }
+
+  std::vector<ReplicatedShare<R>> out(gates);
+  std::vector<CompactShare<R>> compact_out(gates);
+  ShareMatrix<R> mout(gates, pid);
+  std::vector<R> sums(gates);
+
+  using Op = std::function<void()>;
+  // name -> {ReplicatedShare 运算符, CompactShare 运算符, ShareMatrix 内核}
+  std::vector<std::tuple<std::string, Op, Op, Op>> ops = {
+      {"add",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) out[g] = mask[g] + m_in1[g];
+         keep(out);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) compact_out[g] = cmask[g] + cm_in1[g];
+         keep(compact_out);
+       },
+       [&]() {
+         mout = mmask;
+         mout += mm_in1;
+         keep(mout);
+       }},
+      {"sub",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) out[g] = mask[g] - m_in1[g];
+         keep(out);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) compact_out[g] = cmask[g] - cm_in1[g];
+         keep(compact_out);
+       },
+       [&]() {
+         mout = mmask;
+         mout -= mm_in1;
+         keep(mout);
+       }},
+      {"mul_public",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) out[g] = m_in1[g] * beta2[g];
+         keep(out);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) compact_out[g] = cm_in1[g] * beta2[g];
+         keep(compact_out);
+       },
+       [&]() {
+         mout = mm_in1;
+         mout.mulPublic(beta2);
+         keep(mout);
+       }},
+      {"fma",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) out[g] = mask[g] - m_in1[g] * beta2[g];
+         keep(out);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) compact_out[g] = cmask[g] - cm_in1[g] * beta2[g];
+         keep(compact_out);
+       },
+       [&]() {
+         mout = mmask;
+         mout.fms(mm_in1, beta2);
+         keep(mout);
+       }},
+      {"column_sum",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) sums[g] = mask[g].sum();
+         keep(sums);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) sums[g] = cmask[g].sum();
+         keep(sums);
+       },
+       [&]() {
+         sums = mmask.rowSums();
+         keep(sums);
+       }},
+      // 乘法门的重构份额 [α_z] + [α_xy] - β_y[α_x] - β_x[α_y]，只计算表达式本身
+      {"mul_expr",
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) {
+           out[g] = mask[g] + mask_prod[g] - m_in1[g] * beta2[g] - m_in2[g] * beta1[g];
+         }
+         keep(out);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) {
+           compact_out[g] = cmask[g] + cmask_prod[g] - cm_in1[g] * beta2[g] - cm_in2[g] * beta1[g];
+         }
+         keep(compact_out);
+       },
+       [&]() {
+         mout = mmask;
+         mout += mmask_prod;
+         mout.fms(mm_in1, beta2);
+         mout.fms(mm_in2, beta1);
+         keep(mout);
+       }},
+      // 同上，并存入待重构的份额：旧写法逐元素 push_back 到 21 个 vector 中
+      {"mul_gate",
+       [&]() {
+         std::array<std::vector<R>, NUM_RSS> recon_shares;
+         for (size_t g = 0; g < gates; ++g) {
+           auto rec_share = mask[g] + mask_prod[g] - m_in1[g] * beta2[g] - m_in2[g] * beta1[g];
+           for (int i = 0; i < NUM_RSS; ++i) {
+             recon_shares[i].push_back(rec_share[i]);
+           }
+         }
+         keep(recon_shares);
+       },
+       [&]() {
+         for (size_t g = 0; g < gates; ++g) {
+           mout.setRow(g, cmask[g] + cmask_prod[g] - cm_in1[g] * beta2[g] - cm_in2[g] * beta1[g]);
+         }
+         keep(mout);
+       },
+       [&]() {
+         mout = mmask;
+         mout += mmask_prod;
+         mout.fms(mm_in1, beta2);
+         mout.fms(mm_in2, beta1);
+         keep(mout);
+       }},
+  };
+
+  for (size_t r = 0; r < repeat; ++r) {
+    json rbench;
+    std::cout << "--- Repetition " << r + 1 << " ---\n";
+    for (const auto& [name, replicated, compact, matrix] : ops) {
+      auto replicated_ns = nsPerGate(gates, iterations, replicated);
+      auto compact_ns = nsPerGate(gates, iterations, compact);
+      auto matrix_ns = nsPerGate(gates, iterations, matrix);
+      rbench[name] = {{"replicated_share_ns", replicated_ns},
+                      {"compact_share_ns", compact_ns},
+                      {"share_matrix_ns", matrix_ns}};
+      std::cout << name << ": " << replicated_ns << " ns/gate (ReplicatedShare), " << compact_ns
+                << " ns/gate (CompactShare, " << replicated_ns / compact_ns << "x), " << matrix_ns
+                << " ns/gate (ShareMatrix, " << replicated_ns / matrix_ns << "x)\n";
+    }
+    std::cout << std::endl;
+
+    output_data["benchmarks"].push_back(std::move(rbench));
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+  }
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("gates,g", bpo::value<size_t>()->default_value(100000), "Number of gates (shares) per batch.")
+    ("iterations,i", bpo::value<size_t>()->default_value(20), "Number of times each kernel runs per measurement.")
+    ("seed", bpo::value<size_t>()->default_value(200), "Value of the random seed.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
+
+  desc.add(ringOptions());
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark share arithmetic: ReplicatedShare and CompactShare operators against ShareMatrix kernels.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    withRing(opts, [&](auto ring) { benchmark<decltype(ring)>(opts); });
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
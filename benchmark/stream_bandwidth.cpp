@@ -0,0 +1,209 @@
+#include <io/netmp.h>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "utils.h"
+
+using json = nlohmann::json;
+namespace bpo = boost::program_options;
+
+// Every party streams `nbytes` to the next party in 1 MiB sends while
+// receiving the same amount from the previous one, so each link in the ring
+// carries one direction of bulk traffic. Returns the receive throughput in
+// MB/s.
+double ringThroughput(io::NetIOMP<NUM_PARTIES>& network, int pid, size_t nbytes) {
+  constexpr size_t chunk = 1 << 20;
+  int next = (pid + 1) % NUM_PARTIES;
+  int prev = (pid + NUM_PARTIES - 1) % NUM_PARTIES;
+  std::vector<char> out(chunk, static_cast<char>(pid));
+  std::vector<char> in(chunk);
+
+  network.sync();
+  TimePoint start;
+  std::thread sender([&]() {
+    for (size_t sent = 0; sent < nbytes; sent += chunk) {
+      network.send(next, out.data(), std::min(chunk, nbytes - sent));
+    }
+    network.flush(next);
+  });
+  for (size_t received = 0; received < nbytes; received += chunk) {
+    network.recv(prev, in.data(), std::min(chunk, nbytes - received));
+  }
+  TimePoint end;
+  sender.join();
+  return static_cast<double>(nbytes) / 1e3 / (end - start);
+}
+
+void benchmark(const bpo::variables_map& opts) {
+  bool save_output = false;
+  std::string save_file;
+  if (opts.count("output") != 0) {
+    save_output = true;
+    save_file = opts["output"].as<std::string>();
+  }
+
+  auto pid = opts["pid"].as<size_t>();
+  auto port = opts["port"].as<int>();
+  auto repeat = opts["repeat"].as<size_t>();
+  auto max_streams = opts["max-streams"].as<int>();
+  auto nbytes = opts["bytes"].as<size_t>();
+  auto stripe_bytes = opts["stripe-bytes"].as<size_t>();
+
+  std::vector<std::string> ipaddress(NUM_PARTIES);
+  std::array<char*, NUM_PARTIES> ip{};
+  bool localhost = opts["localhost"].as<bool>();
+  if (!localhost) {
+    std::ifstream fnet(opts["net-config"].as<std::string>());
+    if (!fnet.good()) {
+      fnet.close();
+      throw std::runtime_error("Could not open network config file");
+    }
+    json netdata;
+    fnet >> netdata;
+    fnet.close();
+
+    for (size_t i = 0; i < NUM_PARTIES; ++i) {
+      ipaddress[i] = netdata[i].get<std::string>();
+      ip[i] = ipaddress[i].data();
+    }
+  }
+
+  json output_data;
+  output_data["details"] = {{"pid", pid},
+                            {"port", port},
+                            {"repeat", repeat},
+                            {"max_streams", max_streams},
+                            {"bytes", nbytes},
+                            {"stripe_bytes", stripe_bytes}};
+  output_data["benchmarks"] = json::array();
+
+  std::cout << "--- Details ---\n";
+  for (const auto& [key, value] : output_data["details"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  for (size_t r = 0; r < repeat; ++r) {
+    json rbench;
+    std::cout << "--- Repetition " << r + 1 << " ---\n";
+    for (int streams = 1; streams <= max_streams; streams *= 2) {
+      io::TcpOptions options;
+      options.streams = streams;
+      options.stripe_bytes = stripe_bytes;
+      // 每次建网用不同的会话号，不会连到上一次还没关闭的网络
+      options.session = r * 64 + streams;
+      io::NetIOMP<NUM_PARTIES> network(pid, port, localhost ? nullptr : ip.data(), localhost,
+                                       options);
+      emulateWan(opts, network);
+      auto mbps = ringThroughput(network, pid, nbytes);
+      network.sync();
+
+      rbench[std::to_string(streams)] = {{"throughput_MBps", mbps}};
+      std::cout << streams << " stream(s): " << mbps << " MB/s\n";
+    }
+    std::cout << std::endl;
+
+    output_data["benchmarks"].push_back(std::move(rbench));
+    if (save_output) {
+      saveJson(output_data, save_file);
+    }
+  }
+
+  output_data["stats"] = {{"peak_virtual_memory", peakVirtualMemory()},
+                          {"peak_resident_set_size", peakResidentSetSize()}};
+
+  std::cout << "--- Statistics ---\n";
+  for (const auto& [key, value] : output_data["stats"].items()) {
+    std::cout << key << ": " << value << "\n";
+  }
+  std::cout << std::endl;
+
+  if (save_output) {
+    saveJson(output_data, save_file);
+  }
+}
+
+// clang-format off
+bpo::options_description programOptions() {
+  bpo::options_description desc("Following options are supported by config file too.");
+  desc.add_options()
+    ("pid,p", bpo::value<size_t>()->required(), "Party ID.")
+    ("net-config", bpo::value<std::string>(), "Path to JSON file containing network details of all parties.")
+    ("localhost", bpo::bool_switch(), "All parties are on same machine.")
+    ("port", bpo::value<int>()->default_value(10000), "Base port for networking.")
+    ("output,o", bpo::value<std::string>(), "File to save benchmarks.")
+    ("max-streams", bpo::value<int>()->default_value(8), "Measure 1, 2, 4, ... up to this many streams per pair of parties.")
+    ("bytes", bpo::value<size_t>()->default_value(size_t(1) << 28), "Bytes sent over every link per measurement.")
+    ("stripe-bytes", bpo::value<size_t>()->default_value(size_t(1) << 16), "Size of the blocks striped over the streams.")
+    ("repeat,r", bpo::value<size_t>()->default_value(1), "Number of times to run benchmarks.");
+
+  desc.add(wanOptions());
+
+  return desc;
+}
+// clang-format on
+
+int main(int argc, char* argv[]) {
+  auto prog_opts(programOptions());
+
+  bpo::options_description cmdline(
+      "Benchmark link throughput versus the number of TCP streams per pair of parties.");
+  cmdline.add(prog_opts);
+  cmdline.add_options()(
+      "config,c", bpo::value<std::string>(),
+      "configuration file for easy specification of cmd line arguments")(
+      "help,h", "produce help message");
+
+  bpo::variables_map opts;
+  bpo::store(bpo::command_line_parser(argc, argv).options(cmdline).run(), opts);
+
+  if (opts.count("help") != 0) {
+    std::cout << cmdline << std::endl;
+    return 0;
+  }
+
+  if (opts.count("config") > 0) {
+    std::string cpath(opts["config"].as<std::string>());
+    std::ifstream fin(cpath.c_str());
+
+    if (fin.fail()) {
+      std::cerr << "Could not open configuration file at " << cpath << "\n";
+      return 1;
+    }
+
+    bpo::store(bpo::parse_config_file(fin, prog_opts), opts);
+  }
+
+  // Validate program options.
+  try {
+    bpo::notify(opts);
+
+    // Check if output file already exists.
+    if (opts.count("output") != 0) {
+      std::ifstream ftemp(opts["output"].as<std::string>());
+      if (ftemp.good()) {
+        ftemp.close();
+        throw std::runtime_error("Output file aready exists.");
+      }
+      ftemp.close();
+    }
+
+    if (!opts["localhost"].as<bool>() && (opts.count("net-config") == 0)) {
+      throw std::runtime_error("Expected one of 'localhost' or 'net-config'");
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  try {
+    benchmark(opts);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << "\nFatal error" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -5,6 +5,8 @@
 #include <NTL/ZZ_pE.h>
 
 #include <fstream>
+#include <io/replay_transport.h>
+#include <io/wan_transport.h>
 #include <iostream>
 
 TimePoint::TimePoint() : time(timepoint_t::clock::now()) {}
@@ -16,7 +18,7 @@ double TimePoint::operator-(const TimePoint& rhs) const {
 CommPoint::CommPoint(io::NetIOMP<NUM_PARTIES>& network) : stats{} {
   for (size_t i = 0; i < NUM_PARTIES; ++i) {
     if (i != network.party) {
-      stats[i] = network.get(i, false)->counter + network.get(i, true)->counter;
+      stats[i] = network.count(i);
     }
   }
 }
@@ -108,3 +110,66 @@ int64_t peakVirtualMemory() { return -1; }
 
 int64_t peakResidentSetSize() { return -1; }
 #endif
+
+// clang-format off
+boost::program_options::options_description wanOptions() {
+  namespace bpo = boost::program_options;
+  bpo::options_description desc("WAN emulation (applied by every party to the links it sends on).");
+  desc.add_options()
+    ("rtt-ms", bpo::value<double>()->default_value(0), "Round-trip time of every link in milliseconds.")
+    ("jitter-ms", bpo::value<double>()->default_value(0), "Random extra one-way delay per message, up to this many milliseconds.")
+    ("mbps", bpo::value<double>()->default_value(0), "Rate of every link in Mbit/s (0: unlimited).")
+    ("burst-bytes", bpo::value<size_t>()->default_value(64 * 1024), "Bytes that may leave back to back before the rate applies.")
+    ("wan-seed", bpo::value<uint64_t>()->default_value(0), "Seed for the jitter.");
+  return desc;
+}
+// clang-format on
+
+void emulateWan(const boost::program_options::variables_map& opts,
+                io::NetIOMP<NUM_PARTIES>& network) {
+  io::WanLink link;
+  link.delay_ms = opts["rtt-ms"].as<double>() / 2;
+  link.jitter_ms = opts["jitter-ms"].as<double>();
+  link.mbps = opts["mbps"].as<double>();
+  link.burst_bytes = opts["burst-bytes"].as<size_t>();
+  if (link.active()) {
+    io::emulateWan(network, link, opts["wan-seed"].as<uint64_t>());
+  }
+}
+
+// clang-format off
+boost::program_options::options_description transcriptOptions() {
+  namespace bpo = boost::program_options;
+  bpo::options_description desc("Transcripts (profile one party without running the others).");
+  desc.add_options()
+    ("record-transcript", bpo::value<std::string>(), "Write everything this party receives to this file.")
+    ("replay-transcript", bpo::value<std::string>(), "Run only this party, receiving from a recorded transcript; sends are discarded. Use the same options as when recording.");
+  return desc;
+}
+// clang-format on
+
+void recordTranscript(const boost::program_options::variables_map& opts,
+                      io::NetIOMP<NUM_PARTIES>& network) {
+  if (opts.count("record-transcript") != 0) {
+    io::recordTranscript(network, opts["record-transcript"].as<std::string>());
+  }
+}
+
+void reportReplay(io::NetIOMP<NUM_PARTIES>& network) {
+  const auto* replay = dynamic_cast<const io::ReplayTransport<NUM_PARTIES>*>(&network.transport());
+  if (replay == nullptr) {
+    return;
+  }
+  std::cout << "transcript: " << replay->rounds() << " rounds, " << replay->remaining()
+            << " bytes left unread\n";
+}
+
+// clang-format off
+boost::program_options::options_description ringOptions() {
+  namespace bpo = boost::program_options;
+  bpo::options_description desc("Ring.");
+  desc.add_options()
+    ("ring-bits", bpo::value<size_t>()->default_value(64), "Width of the ring Z_{2^k} in bits: 32, 64 or 128.");
+  return desc;
+}
+// clang-format on
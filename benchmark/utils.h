@@ -2,7 +2,9 @@
 
 #include <io/netmp.h>
 #include <array>
+#include <boost/program_options.hpp>
 #include <chrono>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <SemiHoRGod/types.h>
@@ -36,3 +38,38 @@ bool saveJson(const nlohmann::json& data, const std::string& fpath);
 int64_t peakVirtualMemory();
 int64_t peakResidentSetSize();
 
+
+// Options of the WAN emulator (io::WanTransport), shared by all benchmarks.
+boost::program_options::options_description wanOptions();
+// Shapes the links of `network` as given by the WAN options, if any is set.
+void emulateWan(const boost::program_options::variables_map& opts,
+                io::NetIOMP<NUM_PARTIES>& network);
+
+// Options to record what a party receives (io::RecordingTransport) or to run
+// a party alone from such a transcript (io::ReplayTransport).
+boost::program_options::options_description transcriptOptions();
+// Records what `network` receives if --record-transcript is set.
+void recordTranscript(const boost::program_options::variables_map& opts,
+                      io::NetIOMP<NUM_PARTIES>& network);
+// Prints how much of the transcript was used if `network` replays one.
+void reportReplay(io::NetIOMP<NUM_PARTIES>& network);
+
+// Option to pick the ring width (--ring-bits), shared by the MPC benchmarks.
+boost::program_options::options_description ringOptions();
+// Calls f(R{}) with R the ring type selected by --ring-bits.
+template <class F>
+void withRing(const boost::program_options::variables_map& opts, F&& f) {
+  switch (opts["ring-bits"].as<size_t>()) {
+    case 32:
+      f(SemiHoRGod::Ring32{});
+      break;
+    case 64:
+      f(SemiHoRGod::Ring64{});
+      break;
+    case 128:
+      f(SemiHoRGod::Ring128{});
+      break;
+    default:
+      throw std::invalid_argument("Expected --ring-bits to be 32, 64 or 128");
+  }
+}
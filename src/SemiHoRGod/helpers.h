@@ -14,8 +14,9 @@
 
 #define CMP_GREATER_RESULT 1
 #define CMP_lESS_RESULT 0
-#define BITS_BETA 4
-#define BITS_GAMMA 20
+// Comparison parameters of the default ring; see FixedPoint in types.h.
+#define BITS_BETA (SemiHoRGod::FixedPoint<SemiHoRGod::Ring>::kBitsBeta)
+#define BITS_GAMMA (SemiHoRGod::FixedPoint<SemiHoRGod::Ring>::kBitsGamma)
 
 namespace SemiHoRGod {
 int pidFromOffset_N(int id, int offset, int Np);
@@ -88,7 +89,8 @@ std::vector<T> composePermutations(const std::vector<T>& p1, const std::vector<T
 
 template<typename T>
 std::vector<T> inversePermutation(const std::vector<T>& perm) {
-    static_assert(std::is_integral<T>::value, "T must be an integral type for indexing");
+    static_assert(std::is_integral<T>::value || std::is_same<T, Ring128>::value,
+                  "T must be an integral type for indexing");
     
     int n = perm.size();
     std::vector<T> inv(n);
@@ -2,22 +2,65 @@
 
 #include <emp-tool/emp-tool.h>
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <mutex> // 新增: 用于互斥锁
 #include "../io/netmp.h"
 #include "types.h"
 namespace SemiHoRGod {
 
+// How value and digest duties are assigned within a sender triple.
+enum class JumpRolePolicy {
+  kFixed,     // the largest id always sends the digest
+  kRotating,  // duties rotate per channel and per round
+  kBandwidthAware,  // the fastest links to the receiver carry the values
+};
+
+class ImprovedJmp;
+
+// Handle for a round started with ImprovedJmp::asyncCommunicate. While the
+// round is open, getValues blocks only until the requested channel has been
+// received and checked. wait() finishes the round: remaining channels, sends,
+// fallbacks and checkpoints. It is idempotent and also called by reset().
+class JumpRound {
+ public:
+  JumpRound() = default;
+  void wait();
+  bool valid() const { return jump_ != nullptr; }
+
+ private:
+  friend class ImprovedJmp;
+  explicit JumpRound(ImprovedJmp* jump) : jump_(jump) {}
+  ImprovedJmp* jump_ = nullptr;
+};
+
 // Manages instances of jump.
 class ImprovedJmp {
   int id_;
   
-  // 互斥锁，用于保护 jumpUpdate 中的数据写入
+  // 互斥锁，用于保护 jumpUpdate 中的数据写入。加锁时只记录片段，
+  // 哈希由各对端的发送线程在 sendTo 中并行计算。
   std::mutex mtx_;
 
   std::array<std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> send_;
   std::array<std::array<std::array<emp::Hash, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> send_hash_;
+  // 一个发送片段：ext 非空时指向调用者注册的外部内存（零拷贝），
+  // 否则指向本通道暂存区 send_values_ 中 [offset, offset + len) 的数据。
+  struct SendSegment {
+    const uint8_t* ext;
+    size_t offset;
+    size_t len;
+  };
+  // 暂存区在 reset 时只清空不释放，容量在轮与轮之间复用
   std::array<std::array<std::array<std::vector<uint8_t>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> send_values_;
+  std::array<std::array<std::array<std::vector<SendSegment>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> send_segments_;
+  // 在锁外拷贝的大块负载，片段以 ext 指向这里；reset 时释放
+  std::vector<std::unique_ptr<uint8_t[]>> send_chunks_;
   
   std::array<std::array<std::array<size_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_lengths_;
   
@@ -29,24 +72,300 @@ class ImprovedJmp {
   std::array<std::array<std::array<std::vector<uint8_t>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_values2_;
   std::array<std::array<std::array<std::vector<uint8_t>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_values3_;
   
-  std::array<std::array<std::array<std::vector<uint8_t>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> final_recv_values_;
+  // 指向 recv_values1_ 或 recv_values2_ 中通过校验的那一份，不再额外拷贝
+  std::array<std::array<std::array<const std::vector<uint8_t>*, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> final_recv_values_{};
+  
+  std::array<std::array<std::array<std::array<char, emp::Hash::DIGEST_SIZE>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_hash_{};
   
   uint64_t counter = 0;
+  uint64_t value_rounds_ = 0;
+
+  // 常驻通信线程：每个对端一个接收线程、一个发送线程，第一次 communicate 时创建，
+  // 之后每轮只需向各线程的队列投递任务并等待完成计数归零，不再反复创建/销毁线程。
+  std::vector<std::thread> workers_;
+  // 已发布的轮次数；每发布一轮，每个线程的任务队列中各多一个任务
+  std::atomic<uint64_t> round_{0};
+  // 所有线程中尚未完成的任务数，包括首达即完成模式下仍在后台接收的旧轮次
+  std::atomic<int> pending_{0};
+  std::atomic<bool> stop_{false};
+  std::mutex error_mtx_;
+  std::exception_ptr error_;
+
+  // 延迟校验（乐观）模式：哈希发送方不再每轮发送摘要，而是对整个检查点周期的数据
+  // 维护滚动哈希；接收方直接使用第一份数据，由后台线程把它累积进通道的滚动哈希，
+  // 到检查点 (verify) 时统一交换摘要并比较。
+  bool deferred_verify_ = false;
+  size_t verify_interval_ = 0;
+  size_t rounds_since_verify_ = 0;
+  std::array<std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> transcript_send_{};
+  std::array<std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> transcript_recv_{};
+  std::array<std::array<std::array<size_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> hashed_bytes_{};
+  // 只由后台哈希线程访问
+  std::array<std::array<std::array<emp::Hash, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_transcript_;
+
+  struct HashJob {
+    int min, mid, max;
+    std::vector<uint8_t> data;
+  };
+  std::thread hasher_;
+  std::deque<HashJob> hash_jobs_;
+  bool hash_busy_ = false;
+  bool hash_stop_ = false;
+  std::mutex hash_mtx_;
+  std::condition_variable hash_cv_;
+  std::condition_variable hash_idle_cv_;
+
+  // 单数据发送方模式：三元组中只有 min 发送数据，mid 和 max 都只发送摘要；
+  // 任一摘要与数据不符时，再向 mid 索要完整数据。
+  bool single_sender_ = false;
+  std::array<std::array<std::array<std::array<char, emp::Hash::DIGEST_SIZE>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> recv_hash2_{};
+  // 接收方视角 [min][mid][max]：需要 mid 补发数据的通道
+  std::array<std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> need_fallback_{};
+  // mid 发送方视角 [other_sender1][other_sender2][receiver]：需要补发数据的通道
+  std::array<std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> serve_fallback_{};
+
+  // 常驻线程每次被唤醒时要做的事情
+  enum class Phase { kValues, kFallback, kProbe };
+
+  // 三元组内的分工：value1 发第一份数据，value2 发第二份数据（单数据发送方模式下改发摘要，
+  // 必要时补发数据；延迟校验模式下也只在检查点发摘要），hash 发摘要。kRotating 策略下分工随通道和轮次轮换，
+  // 延迟校验模式下只在检查点处轮换，保证同一周期的摘要由同一方维护。
+  struct Roles {
+    int value1, value2, hash;
+  };
+  JumpRolePolicy role_policy_ = JumpRolePolicy::kFixed;
+  uint64_t role_epoch_ = 0;
+  Roles roles(int min, int mid, int max, int receiver) const;
+
+  // kBandwidthAware 策略：接收线程对每个发送方的数据吞吐做 EWMA 估计 (字节/秒)，
+  // 各方定期交换估计值，所有人据同一张 agreed_rates_[sender][receiver] 表确定分工。
+  // 接收线程可能在 communicate 返回后仍在后台接收，因此用原子变量
+  std::array<std::atomic<double>, NUM_PARTIES> recv_rate_{};
+  // 每条入链路上一次采样之后经过的重新分工次数。只发摘要的链路收不到足够的数据，
+  // 不会被采样；超过 kMaxRateAge 次未更新的估计作废，并重新探测该链路。
+  std::array<std::atomic<size_t>, NUM_PARTIES> rate_age_{};
+  static constexpr size_t kMaxRateAge = 4;
+  std::array<std::array<uint64_t, NUM_PARTIES>, NUM_PARTIES> agreed_rates_{};
+  size_t replan_interval_ = 0;
+  size_t epochs_since_plan_ = 0;
+  size_t probe_bytes_ = 0;
+  // 本次探测的链路 [sender][receiver]
+  std::array<std::array<bool, NUM_PARTIES>, NUM_PARTIES> probe_links_{};
+  void sampleRate(int sender, size_t nbytes, double seconds);
+  void exchangeLinkRates(io::NetIOMP<NUM_PARTIES>& network);
+  // 吞吐表中估计值为 0 的链路重新探测一次，再交换一次
+  void reprobeStaleLinks(io::NetIOMP<NUM_PARTIES>& network);
+  // 一轮结束（延迟校验模式下为一个检查点周期结束）后推进分工
+  void advanceRoles(io::NetIOMP<NUM_PARTIES>& network);
+
+  // 本方经 jump 发往每个对端的字节数，只由对应的发送线程或协调线程在轮次之间写入
+  std::array<uint64_t, NUM_PARTIES> link_bytes_sent_{};
+
+  // 该发送方在本通道上是否只发送摘要
+  bool sendsDigest(int sender, int other_sender1, int other_sender2, int receiver) const;
+
+  // 首达即完成：通道只要有一份数据与摘要一致（或两份数据相同）就算完成，communicate
+  // 不再等待落后的发送方。落后的数据由接收线程在后台收完，下一次使用网络前再等它结束。
+  bool first_arrival_ = false;
+  static constexpr uint8_t kGotValue1 = 1;
+  static constexpr uint8_t kGotValue2 = 2;
+  static constexpr uint8_t kGotHash = 4;
+  std::array<std::array<std::array<std::atomic<uint8_t>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> arrived_{};
+  // 每收到一个通道的数据或有线程完成本轮任务时加一，协调线程据此醒来检查；
+  // 没有进展时协调线程在它上面 futex 等待，progress_waiters_ 为 0 时完成方不必唤醒
+  std::atomic<uint32_t> progress_{0};
+  std::atomic<int> progress_waiters_{0};
+  void notifyProgress();
+  // 在 progress_ 仍等于 seen 时睡眠，可能提前返回
+  void waitProgressChange(uint32_t seen);
+  std::atomic<int> sends_pending_{0};
+  // 接收线程本轮使用的快照：调用者可能在后台接收尚未结束时就开始下一轮的 jumpUpdate
+  // 或修改模式，甚至发布下一轮，接收线程只读自己任务里的这份数据。
+  struct RecvPlan {
+    uint64_t seq = 0;  // 发布该轮时的轮次号
+    std::array<std::array<std::array<size_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> lengths{};
+    std::array<std::array<std::array<Roles, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> roles{};
+    bool single = false;
+    bool deferred = false;
+    bool track = false;  // 是否逐通道报告到达情况
+    bool first = false;  // 通道确定后是否不再等待落后的数据
+    bool sample = false;  // 是否采样吞吐
+  };
+  // 最近发布的一轮数据的快照，只由协调线程读写
+  std::shared_ptr<const RecvPlan> plan_ = std::make_shared<RecvPlan>();
+  // 每个线程一个任务队列。首达即完成模式下下一轮不等落后的接收：
+  // 对端的接收线程收完旧轮次的数据后按顺序接着处理新任务，数据流因此保持对齐。
+  struct Job {
+    Phase phase;
+    io::NetIOMP<NUM_PARTIES>* network;
+    std::shared_ptr<const RecvPlan> plan;  // 只有 kValues 任务有
+  };
+  // 单生产者/单消费者链表队列：只有协调线程入队、只有所属线程出队，两端都不加锁。
+  // posted 每入队一个任务 (或停止时) 加一，线程没有任务时在它上面 futex 等待。
+  class JobQueue {
+   public:
+    JobQueue();
+    ~JobQueue();
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+    void push(Job job);
+    bool pop(Job& job);
+    std::atomic<uint32_t> posted{0};
 
-  static bool isHashSender(int sender, int other_sender1, int other_sender2, int receiver);
+   private:
+    struct Node {
+      Job job;
+      std::atomic<Node*> next{nullptr};
+    };
+    Node* head_;  // 消费者端的哑结点，head_->next 是下一个任务
+    Node* tail_;  // 生产者端
+  };
+  std::unique_ptr<JobQueue[]> jobs_;
+  // 首达即完成模式下，接收线程先收进自己的暂存区，再在 recv_mtx_ 下交换进接收缓冲区；
+  // 只接受 accept_seq_ 这一轮的数据，已被下一轮取代的落后数据直接丢弃，
+  // 不会覆盖新一轮正在使用的缓冲区
+  std::mutex recv_mtx_;
+  uint64_t accept_seq_ = 0;
+  std::array<std::vector<uint8_t>, NUM_PARTIES> recv_scratch_;
+  void markArrived(const RecvPlan& plan, int min, int mid, int max, uint8_t what);
+  // 根据已到达的数据尝试确定通道结果；tested 记录已经比较过的组合，避免重复哈希
+  bool decideChannel(int min, int mid, int max, uint8_t arrived, uint8_t& tested);
+  // 已确定或本轮无数据的通道直接返回 true，否则调用 decideChannel
+  bool tryDecide(int min, int mid, int max);
+  // 等待直到 done 返回 true 或本轮所有线程结束；有线程出错时抛出异常
+  template <class Done>
+  void waitProgress(Done done);
+  void waitAllChannels();
+
+  // 异步轮次：asyncCommunicate 发布任务后立即返回，getValues 逐通道等待，
+  // finishRound 完成其余工作。communicate 等价于 startRound + finishRound。
+  bool round_open_ = false;
+  bool async_round_ = false;
+  io::NetIOMP<NUM_PARTIES>* open_network_ = nullptr;
+  std::array<std::array<std::array<uint8_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> tested_{};
+  void startRound(io::NetIOMP<NUM_PARTIES>& network, bool async);
+  void finishRound();
+  friend class JumpRound;
+
+  void runWorkers(io::NetIOMP<NUM_PARTIES>& network, Phase phase);
+  void exchangeFallbackStatus(io::NetIOMP<NUM_PARTIES>& network);
+  void sendFallbackTo(io::NetIOMP<NUM_PARTIES>& network, int receiver);
+  void recvFallbackFrom(io::NetIOMP<NUM_PARTIES>& network, int sender);
+
+  void hasherLoop();
+  // 把 recv_values1_ 中尚未哈希的部分交给后台线程；move 为 true 时直接移走缓冲区
+  void enqueueTranscript(bool move);
+
+  void startWorkers();
+  void workerLoop(size_t index, int peer, bool is_sender);
+  void recvFrom(io::NetIOMP<NUM_PARTIES>& network, int sender, const RecvPlan& plan);
+  void appendSend(int sender1, int sender2, int sender3, int receiver,
+                  size_t nbytes, const void* data, bool copy);
+  // 调用者已持有 mtx_
+  void appendLocked(int sender1, int sender2, int sender3, int receiver,
+                    size_t nbytes, const void* data, bool copy);
+  void sendTo(io::NetIOMP<NUM_PARTIES>& network, int receiver);
 
  public:
   explicit ImprovedJmp(int my_id);
+  ~ImprovedJmp();
+
+  ImprovedJmp(const ImprovedJmp&) = delete;
+  ImprovedJmp& operator=(const ImprovedJmp&) = delete;
+
+  int id() const { return id_; }
 
   void reset();
 
+  // Safe to call from several threads, but every call takes the jump's lock,
+  // so concurrent callers are serialised; payloads of 4 KiB or more are copied
+  // before the lock is taken. Updates to one channel are sent in call order.
   void jumpUpdate(int sender1, int sender2, int sender3, int receiver, size_t nbytes,
                   const void* data = nullptr);
+  // Same as jumpUpdate but the payload is not copied: `data` is sent straight
+  // from the caller's memory and must stay valid until communicate returns.
+  void jumpUpdateSpan(int sender1, int sender2, int sender3, int receiver, size_t nbytes,
+                      const void* data = nullptr);
   
-  // 注意：虽然签名保留了 ThreadPool 以兼容旧代码，但在内部我们不再使用它来避免死锁
+  // 注意：虽然签名保留了 ThreadPool 以兼容旧代码，但在内部我们不再使用它来避免死锁。
+  // 收发由常驻的每对端线程完成，见 startWorkers。
   void communicate(io::NetIOMP<NUM_PARTIES>& network, ThreadPool& tpool);
-  
+  // Starts a round and returns without waiting for it, so local work can
+  // overlap the transfer. jumpUpdate and direct use of `network` are not
+  // allowed until the round is finished; zero-copy payloads must stay valid
+  // until then. In single-value-sender mode the first getValues finishes the
+  // whole round, since fallbacks are only known after all digests arrived.
+  JumpRound asyncCommunicate(io::NetIOMP<NUM_PARTIES>& network);
+
+  // The returned buffer is owned by the jump instance and stays valid until
+  // the next reset. During an asynchronous round it blocks until the channel
+  // is ready; it must then be called from the thread that owns the round.
   const std::vector<uint8_t>& getValues(int sender1, int sender2, int sender3);
+
+  // Optimistic mode: receivers use the first value stream right away and the
+  // per-channel digests are only exchanged and compared in verify(). Only the
+  // first value sender sends data; the other two keep a rolling digest of the
+  // channel and send it at the checkpoint, so a round carries one copy. When
+  // `interval` is non-zero, verify() also runs after every `interval` calls to
+  // communicate. All parties must switch modes at the same point.
+  void setDeferredVerification(bool enable, size_t interval = 0);
+
+  bool deferredVerification() const { return deferred_verify_; }
+  // Checkpoint for deferred mode. Throws std::runtime_error if any channel's
+  // transcript does not match its hash sender's digest.
+  void verify(io::NetIOMP<NUM_PARTIES>& network);
+
+  // Single-value-sender mode: only the smallest id of each sender triple sends
+  // the payload; the other two send digests. On a digest mismatch the
+  // receiver fetches the full copy from the middle sender in an extra step.
+  // Roughly halves the bytes sent per jump at the cost of a small status
+  // message per round. All parties must switch modes at the same point.
+  void setSingleValueSender(bool enable) { single_sender_ = enable; }
+  bool singleValueSender() const { return single_sender_; }
+
+  // Selects who sends values and who sends digests in each triple. With
+  // kRotating the duties move every round (every checkpoint in deferred
+  // mode), spreading the value bytes evenly over all links. With
+  // kBandwidthAware the two senders with the highest measured throughput to
+  // the receiver send the values; the measurements are exchanged and the plan
+  // rebuilt every `replan_interval` rounds (checkpoints in deferred mode), or
+  // only through probeLinks() when it is 0. Links that have not been sampled
+  // for a few plans (digest links carry too little data to be measured) are
+  // probed again at the next plan with the size of the last probeLinks().
+  // All parties must use the same policy and switch between rounds.
+  void setRolePolicy(JumpRolePolicy policy, size_t replan_interval = 0);
+  JumpRolePolicy rolePolicy() const { return role_policy_; }
+  // Measures every incoming link by receiving `nbytes` from each peer, then
+  // agrees on the bandwidth-aware plan with all parties. Must be called by
+  // all parties between rounds; in deferred mode right after verify().
+  void probeLinks(io::NetIOMP<NUM_PARTIES>& network, size_t nbytes = 1 << 20);
+  // First-arrival completion: communicate returns as soon as every channel has
+  // one value matching its digest, or two matching values, while the late
+  // copy is received in the background. The next round does not wait for it:
+  // each peer's receive worker finishes the old round and then takes the new
+  // one, and copies that arrive after the next round started are discarded.
+  // Only applies when neither deferred verification nor single-value-sender
+  // mode is on. Code that uses the network directly between rounds must call
+  // drain() first.
+  void setFirstArrival(bool enable) { first_arrival_ = enable; }
+  bool firstArrival() const { return first_arrival_; }
+  // Blocks until background receives of earlier rounds have finished.
+  void drain();
+
+  // Agreed throughput estimates in bytes per second, indexed [sender][receiver].
+  const std::array<std::array<uint64_t, NUM_PARTIES>, NUM_PARTIES>& linkRates() const {
+    return agreed_rates_;
+  }
+
+  // Bytes this party has sent to each peer through the jump since the last
+  // resetLinkStats(), including digests and fallback traffic.
+  const std::array<uint64_t, NUM_PARTIES>& linkBytesSent() const { return link_bytes_sent_; }
+  void resetLinkStats() { link_bytes_sent_.fill(0); }
+
+  // Number of rounds started with communicate/asyncCommunicate on this
+  // instance; fallback, probe and checkpoint exchanges are not counted.
+  uint64_t rounds() const { return value_rounds_; }
+
   void checkConsistency(io::NetIOMP<NUM_PARTIES>& network);
   size_t calculate_total_communication() 
   {
@@ -0,0 +1,103 @@
+#include "in_process.h"
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../io/mem_transport.h"
+#include "offline_evaluator.h"
+#include "online_evaluator.h"
+
+namespace SemiHoRGod {
+
+template <class R>
+InProcessResult<R> runInProcess(const utils::LevelOrderedCircuit& circ,
+                                const std::unordered_map<utils::wire_t, int>& input_pid_map,
+                                const std::unordered_map<utils::wire_t, R>& inputs,
+                                const InProcessOptions& options) {
+  // 离线和在线阶段各用一套网络，与分进程运行时一样
+  auto offline_mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+  auto online_mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+  auto offline_networks = io::makeInMemoryNetworks<NUM_PARTIES>(offline_mesh);
+  auto online_networks = io::makeInMemoryNetworks<NUM_PARTIES>(online_mesh);
+  if (options.wan.active()) {
+    for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+      io::emulateWan(*offline_networks[pid], options.wan, options.wan_seed);
+      io::emulateWan(*online_networks[pid], options.wan, options.wan_seed);
+    }
+  }
+
+  InProcessResult<R> result;
+  result.outputs.resize(NUM_PARTIES);
+  result.stats.resize(NUM_PARTIES);
+
+  std::mutex error_mtx;
+  std::exception_ptr error;
+
+  std::vector<std::thread> parties;
+  for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+    parties.emplace_back([&, pid]() {
+      try {
+        using clock = std::chrono::steady_clock;
+        auto& stats = result.stats[pid];
+        auto seed = emp::makeBlock(options.seed, options.seed);
+        emp::PRG prg(&seed, 0);
+
+        auto start = clock::now();
+        PreprocCircuit<R> preproc;
+        if (options.dummy_preproc) {
+          preproc = OfflineEvaluator<R>::dummy(circ, input_pid_map, options.security_param, pid, prg);
+        } else {
+          OfflineEvaluator<R> offline_eval(pid, offline_networks[pid], nullptr, circ,
+                                           options.security_param, options.offline_threads,
+                                           static_cast<int>(options.seed));
+          preproc = offline_eval.offline_setwire(circ, input_pid_map, options.security_param,
+                                                 pid, prg);
+        }
+        stats.offline_ms =
+            std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        stats.offline_bytes = offline_networks[pid]->count();
+
+        start = clock::now();
+        OnlineEvaluator<R> online_eval(pid, online_networks[pid], std::move(preproc), circ,
+                                       options.security_param, options.online_threads,
+                                       static_cast<int>(options.seed));
+        result.outputs[pid] = online_eval.evaluateCircuit(inputs);
+        stats.online_ms =
+            std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        stats.online_bytes = online_networks[pid]->count();
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(error_mtx);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+        // 其他参与方可能正在等这一方的数据
+        offline_mesh->abort();
+        online_mesh->abort();
+      }
+    });
+  }
+  for (auto& t : parties) {
+    t.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return result;
+}
+
+#define INSTANTIATE_RUN_IN_PROCESS(R)                                                     \
+  template InProcessResult<R> runInProcess<R>(                                            \
+      const utils::LevelOrderedCircuit&, const std::unordered_map<utils::wire_t, int>&,  \
+      const std::unordered_map<utils::wire_t, R>&, const InProcessOptions&);
+INSTANTIATE_RUN_IN_PROCESS(Ring32)
+INSTANTIATE_RUN_IN_PROCESS(Ring64)
+INSTANTIATE_RUN_IN_PROCESS(Ring128)
+#undef INSTANTIATE_RUN_IN_PROCESS
+
+};  // namespace SemiHoRGod
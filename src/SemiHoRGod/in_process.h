@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../io/wan_transport.h"
+#include "../utils/circuit.h"
+#include "types.h"
+
+namespace SemiHoRGod {
+
+struct InProcessOptions {
+  int security_param = 128;
+  int offline_threads = 25;
+  int online_threads = 21;
+  // 使用 OfflineEvaluator<R>::dummy 代替真实的离线阶段，只测在线阶段
+  bool dummy_preproc = false;
+  uint64_t seed = 200;
+  // 非空时每条链路都按它模拟广域网的延迟和带宽
+  io::WanLink wan;
+  uint64_t wan_seed = 0;
+};
+
+struct InProcessStats {
+  double offline_ms = 0;
+  double online_ms = 0;
+  int64_t offline_bytes = 0;
+  int64_t online_bytes = 0;
+};
+
+template <class R>
+struct InProcessResult {
+  // Indexed by party.
+  std::vector<std::vector<R>> outputs;
+  std::vector<InProcessStats> stats;
+};
+
+// Runs the offline and online phase of `circ` for all NUM_PARTIES parties as
+// threads of this process, connected through in-memory transports: no
+// sockets, ports or run.sh, and a single process to profile. If any party
+// throws, the transports are aborted so the other parties return as well, and
+// the first exception is rethrown. The ring is the type of the inputs
+// (Ring32, Ring64 or Ring128).
+template <class R>
+InProcessResult<R> runInProcess(const utils::LevelOrderedCircuit& circ,
+                                const std::unordered_map<utils::wire_t, int>& input_pid_map,
+                                const std::unordered_map<utils::wire_t, R>& inputs,
+                                const InProcessOptions& options = {});
+
+};  // namespace SemiHoRGod
@@ -0,0 +1,113 @@
+#include "jump_scheduler.h"
+
+#include <boost/format.hpp>
+#include <stdexcept>
+#include <tuple>
+
+#include "helpers.h"
+
+namespace SemiHoRGod {
+
+struct JumpChannel {
+  // 本轮结束时仍有 future 引用这个通道，收到的数据复制到这里
+  std::vector<uint8_t> values;
+};
+
+struct JumpBatch {
+  bool sent = false;
+  bool retired = false;
+  // [min][mid][max]：本轮接收方 future 引用的通道；过期表示已没有 future
+  std::array<std::array<std::array<std::weak_ptr<JumpChannel>, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> channels;
+};
+
+JumpScheduler::JumpScheduler(ImprovedJmp& jump, io::NetIOMP<NUM_PARTIES>& network)
+    : jump_(jump), network_(network), batch_(std::make_shared<JumpBatch>()) {}
+
+void JumpScheduler::append(int sender1, int sender2, int sender3, int receiver,
+                           size_t nbytes, const void* data, int& min, int& mid,
+                           int& max, size_t& offset) {
+  if (batch_->sent) {
+    // 上一轮已经发出，新的更新属于下一轮
+    retire();
+  }
+  bool is_receiver = receiver == jump_.id();
+  jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, is_receiver ? nullptr : data);
+  has_updates_ = true;
+
+  std::tie(min, mid, max) = sortThreeNumbers(sender1, sender2, sender3);
+  if (is_receiver) {
+    offset = offsets_[min][mid][max];
+    offsets_[min][mid][max] += nbytes;
+  }
+}
+
+std::shared_ptr<JumpChannel> JumpScheduler::channel(int min, int mid, int max) {
+  auto& slot = batch_->channels[min][mid][max];
+  auto channel = slot.lock();
+  if (!channel) {
+    channel = std::make_shared<JumpChannel>();
+    slot = channel;
+  }
+  return channel;
+}
+
+void JumpScheduler::flush() {
+  if (batch_->sent) {
+    return;
+  }
+  round_ = jump_.asyncCommunicate(network_);
+  batch_->sent = true;
+  ++rounds_;
+}
+
+void JumpScheduler::finish() {
+  if (has_updates_ && !batch_->sent) {
+    flush();
+  }
+  if (batch_->sent) {
+    retire();
+  }
+}
+
+void JumpScheduler::retire() {
+  round_.wait();
+  // jump 清空前，只保存还有 future 引用的通道
+  for (int i = 0; i < NUM_PARTIES; ++i)
+    for (int j = i + 1; j < NUM_PARTIES; ++j)
+      for (int k = j + 1; k < NUM_PARTIES; ++k) {
+        if (offsets_[i][j][k] == 0) continue;
+        if (auto channel = batch_->channels[i][j][k].lock()) {
+          channel->values = jump_.getValues(i, j, k);
+        }
+      }
+  batch_->retired = true;
+  jump_.reset();
+
+  batch_ = std::make_shared<JumpBatch>();
+  round_ = JumpRound();
+  offsets_ = {};
+  has_updates_ = false;
+}
+
+const uint8_t* JumpScheduler::slice(const std::shared_ptr<JumpBatch>& batch,
+                                    const JumpChannel* channel, int min, int mid, int max,
+                                    size_t offset, size_t nbytes) {
+  if (!batch->sent) {
+    // 未发送的只可能是当前轮
+    flush();
+  }
+  if (nbytes == 0) {
+    return nullptr;
+  }
+
+  const auto& values = batch->retired ? channel->values : jump_.getValues(min, mid, max);
+  if (offset + nbytes > values.size()) {
+    throw std::runtime_error(boost::str(
+        boost::format("JumpFuture: slice [%1%, %2%) of channel (%3%, %4%, %5%) exceeds "
+                      "the %6% bytes received") %
+        offset % (offset + nbytes) % min % mid % max % values.size()));
+  }
+  return values.data() + offset;
+}
+
+};  // namespace SemiHoRGod
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../io/netmp.h"
+#include "ijmp.h"
+#include "types.h"
+
+namespace SemiHoRGod {
+
+class JumpScheduler;
+// State of one scheduled round and the received data of one of its channels
+// kept for futures that outlive the round; defined in jump_scheduler.cpp.
+struct JumpBatch;
+struct JumpChannel;
+
+// Slice of a jump round issued through JumpScheduler::jumpUpdate. Reading it
+// sends the pending round first if needed, then waits for its channel only.
+// Futures stay readable after the scheduler has moved on to later rounds.
+template <class T>
+class JumpFuture {
+ public:
+  JumpFuture() = default;
+
+  // Received elements; empty on parties that are not the receiver.
+  std::vector<T> get() const;
+  // First received element, for updates of a single value.
+  T value() const;
+  size_t size() const { return count_; }
+
+ private:
+  friend class JumpScheduler;
+  JumpFuture(JumpScheduler* sched, std::shared_ptr<JumpBatch> batch,
+             std::shared_ptr<JumpChannel> channel, int min, int mid, int max,
+             size_t offset, size_t count)
+      : sched_(sched), batch_(std::move(batch)), channel_(std::move(channel)), min_(min),
+        mid_(mid), max_(max), offset_(offset), count_(count) {}
+
+  JumpScheduler* sched_ = nullptr;
+  std::shared_ptr<JumpBatch> batch_;
+  // 只有接收方的 future 持有；轮次结束时只为仍被持有的通道保存数据
+  std::shared_ptr<JumpChannel> channel_;
+  int min_ = 0, mid_ = 0, max_ = 0;
+  size_t offset_ = 0;
+  size_t count_ = 0;
+};
+
+// Coalesces jump updates into rounds without manual offset bookkeeping: every
+// jumpUpdate is appended to the pending round and returns a future for its
+// slice; the round is sent when the first of its futures is read or on
+// flush(). All parties must issue the same updates and reach the same
+// flush points. A party that only sends in a round has no future to read, so
+// protocols with several rounds call flush() at every round boundary.
+//
+// The scheduler owns the jump between its first update and finish(); do not
+// call jumpUpdate/communicate/reset on it directly in that window.
+class JumpScheduler {
+ public:
+  // `jump` must be reset. Futures must not be read after the scheduler is gone.
+  JumpScheduler(ImprovedJmp& jump, io::NetIOMP<NUM_PARTIES>& network);
+
+  JumpScheduler(const JumpScheduler&) = delete;
+  JumpScheduler& operator=(const JumpScheduler&) = delete;
+
+  // `data` is copied and may be nullptr on the receiver.
+  template <class T>
+  JumpFuture<T> jumpUpdate(int sender1, int sender2, int sender3, int receiver,
+                           const T* data, size_t count = 1);
+
+  // Sends the pending round, even if it is empty, unless it was already sent.
+  void flush();
+  // Completes the last round and hands the jump back to the caller, reset.
+  // Outstanding futures remain readable.
+  void finish();
+
+  // Number of rounds sent so far.
+  size_t rounds() const { return rounds_; }
+
+ private:
+  template <class T>
+  friend class JumpFuture;
+
+  ImprovedJmp& jump_;
+  io::NetIOMP<NUM_PARTIES>& network_;
+  std::shared_ptr<JumpBatch> batch_;
+  JumpRound round_;
+  // 接收方视角 [min][mid][max]：本轮各通道已登记的字节数
+  std::array<std::array<std::array<size_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> offsets_{};
+  size_t rounds_ = 0;
+  bool has_updates_ = false;
+
+  void append(int sender1, int sender2, int sender3, int receiver, size_t nbytes,
+              const void* data, int& min, int& mid, int& max, size_t& offset);
+  // 当前轮通道 (min, mid, max) 的共享状态，首次登记时创建
+  std::shared_ptr<JumpChannel> channel(int min, int mid, int max);
+  // 结束已发送的一轮：等待完成、为仍被 future 引用的通道保存数据、清空 jump
+  void retire();
+  const uint8_t* slice(const std::shared_ptr<JumpBatch>& batch, const JumpChannel* channel,
+                       int min, int mid, int max, size_t offset, size_t nbytes);
+};
+
+template <class T>
+JumpFuture<T> JumpScheduler::jumpUpdate(int sender1, int sender2, int sender3,
+                                        int receiver, const T* data, size_t count) {
+  int min = 0, mid = 0, max = 0;
+  size_t offset = 0;
+  append(sender1, sender2, sender3, receiver, sizeof(T) * count, data, min, mid, max, offset);
+  if (receiver != jump_.id()) {
+    return JumpFuture<T>(this, batch_, nullptr, min, mid, max, 0, 0);
+  }
+  return JumpFuture<T>(this, batch_, channel(min, mid, max), min, mid, max, offset, count);
+}
+
+template <class T>
+std::vector<T> JumpFuture<T>::get() const {
+  if (sched_ == nullptr) {
+    return {};
+  }
+  const auto* data = sched_->slice(batch_, channel_.get(), min_, mid_, max_, offset_,
+                                   sizeof(T) * count_);
+  std::vector<T> result(count_);
+  if (count_ != 0) {
+    std::memcpy(result.data(), data, sizeof(T) * count_);
+  }
+  return result;
+}
+
+template <class T>
+T JumpFuture<T>::value() const {
+  T result{};
+  if (sched_ == nullptr) {
+    return result;
+  }
+  const auto* data = sched_->slice(batch_, channel_.get(), min_, mid_, max_, offset_,
+                                   sizeof(T) * count_);
+  if (count_ != 0) {
+    std::memcpy(&result, data, sizeof(T));
+  }
+  return result;
+}
+
+};  // namespace SemiHoRGod
@@ -9,11 +9,12 @@
 #include "online_evaluator.h"
 int global_counter = 0;
 namespace SemiHoRGod{
-OfflineEvaluator::OfflineEvaluator(int my_id,
-                                   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1,
-                                   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2,
-                                   utils::LevelOrderedCircuit circ,
-                                   int security_param, int threads, int seed)
+template <class R>
+OfflineEvaluator<R>::OfflineEvaluator(int my_id,
+                                      std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network1,
+                                      std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network2,
+                                      utils::LevelOrderedCircuit circ,
+                                      int security_param, int threads, int seed)
     : id_(my_id),
       security_param_(security_param),
       rgen_(my_id, seed),
@@ -25,32 +26,18 @@ OfflineEvaluator::OfflineEvaluator(int my_id,
   tpool_ = std::make_shared<ThreadPool>(threads);
 }
 
-std::vector<Ring> OfflineEvaluator::elementwise_sum(const std::array<std::vector<Ring>, NUM_RSS>& recon_shares, int i, int j, int k) {
-    // 检查向量是否非空且大小一致
-    if (recon_shares[i].empty()) return {};
-    size_t size = recon_shares[i].size();
-    assert(recon_shares[j].size() == size && recon_shares[k].size() == size);
-    
-    std::vector<Ring> result(size);
-    for (size_t index = 0; index < size; ++index) {
-        result[index] = recon_shares[i][index] + recon_shares[j][index] + recon_shares[k][index];
-    }
-    return result;
-}
-
-std::vector<Ring> OfflineEvaluator::reconstruct(
-    const std::array<std::vector<Ring>, NUM_RSS>& recon_shares) {
-  // All vectors in recon_shares should have same size.
-  size_t num = recon_shares[0].size();
-  size_t nbytes = sizeof(Ring) * num;
+template <class R>
+std::vector<R> OfflineEvaluator<R>::reconstruct(const ShareMatrix<R>& recon_shares) {
+  size_t num = recon_shares.rows();
+  size_t nbytes = sizeof(R) * num;
 
   if (nbytes == 0) {
     return {};
   }
 
-  std::vector<Ring> vres1(num);
-  std::vector<Ring> vres2(num);
-  std::vector<Ring> result(num);
+  // 发送数据以 span 形式交给 jump，通信结束前必须保持有效
+  std::vector<std::vector<R>> outgoing;
+  outgoing.reserve(2 * NUM_PARTIES);
 
   for(int i = 0; i<NUM_PARTIES; i++) {
     int sender1 = pidFromOffset(i, 1);
@@ -65,10 +52,10 @@ std::vector<Ring> OfflineEvaluator::reconstruct(
         jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, nullptr);
       }
       else {
-        auto z_1 = elementwise_sum(recon_shares, upperTriangularToArray(receiver, other1), 
-                                                 upperTriangularToArray(receiver, other2),
-                                                 upperTriangularToArray(receiver, other3));
-        jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, z_1.data());
+        auto& z_1 = outgoing.emplace_back(recon_shares.sumColumns(upperTriangularToArray(receiver, other1),
+                                                                          upperTriangularToArray(receiver, other2),
+                                                                          upperTriangularToArray(receiver, other3)));
+        jump_.jumpUpdateSpan(sender1, sender2, sender3, receiver, nbytes, z_1.data());
       }
     }
 
@@ -83,106 +70,104 @@ std::vector<Ring> OfflineEvaluator::reconstruct(
         jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, nullptr);
       }
       else {
-        auto z_2 = elementwise_sum(recon_shares, upperTriangularToArray(receiver, other1), 
-                                                 upperTriangularToArray(receiver, other2),
-                                                 upperTriangularToArray(receiver, other3));
-        jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, z_2.data());
+        auto& z_2 = outgoing.emplace_back(recon_shares.sumColumns(upperTriangularToArray(receiver, other1),
+                                                                          upperTriangularToArray(receiver, other2),
+                                                                          upperTriangularToArray(receiver, other3)));
+        jump_.jumpUpdateSpan(sender1, sender2, sender3, receiver, nbytes, z_2.data());
       }
     }
   }
   jump_.communicate(*network_, *tpool_);
 
-  //reinterpret_cast 的作用是 对指针类型进行低级别的重新解释，即将原始指针类型强制转换为另一种不相关的指针类型（这里是 const Ring*），而无需修改底层数据。
-  const auto* miss_values1 = reinterpret_cast<const Ring*>(jump_.getValues(pidFromOffset(id_, 1), pidFromOffset(id_, 2), pidFromOffset(id_, 3)).data());
-  const auto* miss_values2 = reinterpret_cast<const Ring*>(jump_.getValues(pidFromOffset(id_, 4), pidFromOffset(id_, 5), pidFromOffset(id_, 6)).data());     
-  std::copy(miss_values1, miss_values1 + num, vres1.begin());
-  std::copy(miss_values2, miss_values2 + num, vres2.begin());
+  //reinterpret_cast 的作用是 对指针类型进行低级别的重新解释，即将原始指针类型强制转换为另一种不相关的指针类型（这里是 const R*），而无需修改底层数据。
+  const auto* miss_values1 = reinterpret_cast<const R*>(jump_.getValues(pidFromOffset(id_, 1), pidFromOffset(id_, 2), pidFromOffset(id_, 3)).data());
+  const auto* miss_values2 = reinterpret_cast<const R*>(jump_.getValues(pidFromOffset(id_, 4), pidFromOffset(id_, 5), pidFromOffset(id_, 6)).data());     
+  std::vector<R> result = recon_shares.rowSums();
   for (size_t i = 0; i<num; i++) {
-    Ring temp = 0;
-    for(size_t j = 0; j<NUM_RSS; j++) {
-      temp += recon_shares[j][i];
-    }
-    result[i] = vres1[i] + vres2[i] + temp;
+    result[i] += miss_values1[i] + miss_values2[i];
   }
   jump_.reset();
   return result;
 }
 
-void OfflineEvaluator::randomShare(RandGenPool& rgen,
-                                   ReplicatedShare<Ring>& share) {
-  rgen.getRelative(1).random_data(&share[0], sizeof(Ring));
-  rgen.getRelative(2).random_data(&share[1], sizeof(Ring));
-  rgen.getRelative(3).random_data(&share[2], sizeof(Ring));
+template <class R>
+void OfflineEvaluator<R>::randomShare(RandGenPool& rgen,
+                                   ReplicatedShare<R>& share) {
+  rgen.getRelative(1).random_data(&share[0], sizeof(R));
+  rgen.getRelative(2).random_data(&share[1], sizeof(R));
+  rgen.getRelative(3).random_data(&share[2], sizeof(R));
 }
 
-ReplicatedShare<Ring> OfflineEvaluator::jshShare(int id, RandGenPool& rgen, int i, int j, int k) {
-  ReplicatedShare<Ring> result;
+template <class R>
+ReplicatedShare<R> OfflineEvaluator<R>::jshShare(int id, RandGenPool& rgen, int i, int j, int k) {
+  ReplicatedShare<R> result;
   result.init_zero();
   // id是当前执行这个函数的参与方i，他需要获取{0,1,2,3,4}\{i}
   int idx = 0;
-  Ring temp;
+  R temp;
   for (size_t pid1 = 0; pid1 < NUM_PARTIES; ++pid1) {
     for (size_t pid2 = pid1+1; pid2 < NUM_PARTIES; ++pid2) {
       if (pid1 == id || pid2 == id) { //他无法获取共享x_{id}这个数据
-        rgen.self().random_data(&temp, sizeof(Ring));
+        rgen.self().random_data(&temp, sizeof(R));
       }
       else {
         //直接使用公共的随机数种子生成数据，可能不安全，但效率是一样的
-        rgen.self().random_data(&temp, sizeof(Ring));
+        rgen.self().random_data(&temp, sizeof(R));
       }
     }
   }
   return result;
 }
 
-std::vector<Ring> OfflineEvaluator::reconstruct(
-    const std::vector<ReplicatedShare<Ring>>& shares) {
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares;
-  for (const auto& s : shares) {
-    for (size_t i = 0; i < NUM_RSS; ++i) {
-      recon_shares[i].push_back(s[i]);
-    }
+template <class R>
+std::vector<R> OfflineEvaluator<R>::reconstruct(
+    const std::vector<ReplicatedShare<R>>& shares) {
+  ShareMatrix<R> recon_shares(shares.size(), id_);
+  for (size_t i = 0; i < shares.size(); ++i) {
+    recon_shares.setRow(i, shares[i]);
   }
   return reconstruct(recon_shares);
 }
 
 
-ReplicatedShare<Ring> OfflineEvaluator::randomShareWithParty(int id, RandGenPool& rgen) {
-  ReplicatedShare<Ring> result;
+template <class R>
+ReplicatedShare<R> OfflineEvaluator<R>::randomShareWithParty(int id, RandGenPool& rgen) {
+  ReplicatedShare<R> result;
   int idx = 0;
-  Ring temp;
+  R temp;
   for (size_t pid1 = 0; pid1 < NUM_PARTIES; ++pid1) {
     for (size_t pid2 = pid1+1; pid2 < NUM_PARTIES; ++pid2) {
       if (pid1 == id || pid2 == id) { //他无法获取共享x_{id}这个数据
-        rgen.all().random_data(&temp, sizeof(Ring));
+        rgen.all().random_data(&temp, sizeof(R));
         result[upperTriangularToArray(pid1, pid2)] = 0;
       }
       else {
         //直接使用公共的随机数种子生成数据，可能不安全，但效率是一样的
-        rgen.all().random_data(&result[upperTriangularToArray(pid1, pid2)], sizeof(Ring));
+        rgen.all().random_data(&result[upperTriangularToArray(pid1, pid2)], sizeof(R));
       }
     }
   }
   return result;
 }
 
-void OfflineEvaluator::randomShareWithParty(int id, int dealer,
+template <class R>
+void OfflineEvaluator<R>::randomShareWithParty(int id, int dealer,
                                             RandGenPool& rgen,
-                                            ReplicatedShare<Ring>& share) {
-  Ring temp;
+                                            ReplicatedShare<R>& share) {
+  R temp;
   for (int pid1 = 0; pid1 < NUM_PARTIES; ++pid1) {
     for (int pid2 = pid1+1; pid2 < NUM_PARTIES; ++pid2) {
       if (pid1 == id || pid2 == id) { //他无法获取共享x_{id}这个数据
-        rgen.all().random_data(&temp, sizeof(Ring));
+        rgen.all().random_data(&temp, sizeof(R));
         share[upperTriangularToArray(pid1, pid2)] = 0;
       }
       else {
         //如果碰到数据x_{dealer}，dealer是需要知道x_{dealer}的，所以用公共的随机数种子生成数据
         if (pid1 == dealer || pid2 == dealer) {
-          rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(Ring));
+          rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(R));
         }
         else {
-          rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(Ring));
+          rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(R));
         }
       }
     }
@@ -190,39 +175,59 @@ void OfflineEvaluator::randomShareWithParty(int id, int dealer,
 }
 
 //如果是秘密的持有者，那么执行共享，除了得到秘密的共享，还会得到真实的秘密
-void OfflineEvaluator::randomShareWithParty(int id, RandGenPool& rgen,
-                                            ReplicatedShare<Ring>& share,
-                                            Ring& secret) {
-  Ring temp = 0;
+template <class R>
+void OfflineEvaluator<R>::randomShareWithParty(int id, RandGenPool& rgen,
+                                            ReplicatedShare<R>& share,
+                                            R& secret) {
+  R temp = 0;
   secret = 0;
   for (int pid1 = 0; pid1 < NUM_PARTIES; ++pid1) {
     for (int pid2 = pid1+1; pid2 < NUM_PARTIES; ++pid2) {
       if (pid1 == id || pid2 == id) { //他无法获取共享x_{id}这个数据
-        rgen.all().random_data(&temp, sizeof(Ring));
+        rgen.all().random_data(&temp, sizeof(R));
         secret += temp;
       }
       else {
-        rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(Ring));
+        rgen.all().random_data(&share[upperTriangularToArray(pid1, pid2)], sizeof(R));
         secret += share[upperTriangularToArray(pid1, pid2)];
       }
     }
   }
 }
 
-std::vector<ReplicatedShare<Ring>> OfflineEvaluator::randomShareWithParty_for_trun(int id, RandGenPool& rgen, std::vector<std::pair<int, int>> indices) {
-  std::vector<ReplicatedShare<Ring>> result;
+template <class R>
+void OfflineEvaluator<R>::randomShareWithParty(int id, int dealer,
+                                            RandGenPool& rgen,
+                                            CompactShare<R>& share) {
+  ReplicatedShare<R> full{};
+  randomShareWithParty(id, dealer, rgen, full);
+  share = CompactShare<R>(full, id);
+}
+
+template <class R>
+void OfflineEvaluator<R>::randomShareWithParty(int id, RandGenPool& rgen,
+                                            CompactShare<R>& share,
+                                            R& secret) {
+  ReplicatedShare<R> full{};
+  randomShareWithParty(id, rgen, full, secret);
+  share = CompactShare<R>(full, id);
+}
+
+template <class R>
+std::vector<ReplicatedShare<R>> OfflineEvaluator<R>::randomShareWithParty_for_trun(int id, RandGenPool& rgen, std::vector<std::pair<int, int>> indices) {
+  std::vector<ReplicatedShare<R>> result;
   for(auto pair : indices) {
-    ReplicatedShare<Ring> result_temp;
-    Ring temp;
+    ReplicatedShare<R> result_temp;
+    R temp;
     result_temp.init_zero();
     auto index1 = std::get<0>(pair);
     auto index2 = std::get<1>(pair);
 
     if(index1 == id || index2 == id) { //如果是id是{u,v}，那么共享被设置为0
-      rgen.all().random_data(&temp, sizeof(Ring));
+      rgen.all().random_data(&temp, sizeof(R));
     }
     else {
-      rgen.all().random_data(&result_temp[upperTriangularToArray(index1, index2)], sizeof(Ring));
+      rgen.all().random_data(&result_temp[upperTriangularToArray(index1, index2)], sizeof(R));
     }
     result.push_back(result_temp);
   }
@@ -238,9 +243,11 @@ struct TupleHash {
     }
 };
 
-ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask(ReplicatedShare<Ring> mask_in1, ReplicatedShare<Ring> mask_in2) {
-  std::unordered_map<std::tuple<Ring, Ring, Ring>, Ring, TupleHash> Gamma_i_j_k_2_mapping;
-  ReplicatedShare<Ring> mask_prod;
+template <class R>
+ReplicatedShare<R> OfflineEvaluator<R>::compute_prod_mask_part1(ReplicatedShare<R> mask_in1, ReplicatedShare<R> mask_in2,
+                                                                JumpScheduler& sched, RingFutures<R>& incoming) {
+  std::unordered_map<std::tuple<R, R, R>, R, TupleHash> Gamma_i_j_k_2_mapping;
+  ReplicatedShare<R> mask_prod;
   mask_prod.init_zero();
   for(int i = 0; i < NUM_PARTIES; i++) {
     for (int j = i+1; j < NUM_PARTIES; j++) {
@@ -329,190 +336,29 @@ ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask(ReplicatedShare<Ring>
           mask_prod += Gamma_i_j_k_mask;
 
           //按顺序排序，这样其他发送者的发送参数是一样的，接收者也用一样的接受参数接受数据
-          jump_.jumpUpdate(i, j, k, n, (size_t) sizeof(Ring), &x_l_m);
-          jump_.jumpUpdate(i, j, k, o, (size_t) sizeof(Ring), &x_l_m);
+          sched.jumpUpdate(i, j, k, n, &x_l_m);
+          sched.jumpUpdate(i, j, k, o, &x_l_m);
           if(id_ == 0) {
           }
         }
         else {
           //接收消息, id_不属于i，j，k中的一个
           if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            jump_.jumpUpdate(i, j, k, id_, (size_t) sizeof(Ring), nullptr);
+            incoming.push_back(sched.jumpUpdate<R>(i, j, k, id_, nullptr));
           }
         }
       }
     }
   }
   
-  //通信得到数据
-  jump_.communicate(*network_, *tpool_);
-
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) { //确保是接收方
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            // Ring x_m;
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            const Ring *x_l_m = reinterpret_cast<const Ring*>(jump_.getValues(i, j, k).data());
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = *x_l_m; //j就对应x_m中的m
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-          else if(l == id_ || m == id_) { //如果是参与方l，m，那么直接把x_l_m设置为0即可
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = 0;
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-        }
-      }
-    }
-  }
-  jump_.reset();
   return mask_prod;
 }
 
-ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask_part1(ReplicatedShare<Ring> mask_in1, ReplicatedShare<Ring> mask_in2) {
-  std::unordered_map<std::tuple<Ring, Ring, Ring>, Ring, TupleHash> Gamma_i_j_k_2_mapping;
-  ReplicatedShare<Ring> mask_prod;
-  mask_prod.init_zero();
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) {
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          auto key = std::make_tuple(l,m,n);
-          if(id_ != o) {
-            if (Gamma_i_j_k_2_mapping.find(key) != Gamma_i_j_k_2_mapping.end()) {//如果这个key存在
-              Gamma_i_j_k_2_mapping[{l,m,n}] += mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(i, k)] + 
-                                                mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, k)];
-            }
-            else {
-              Gamma_i_j_k_2_mapping[{l,m,n}] = mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(i, k)] + 
-                                              mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                              mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                              mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                              mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                              mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, k)];
-            }
-          }
-        }
-      }
-    }
-  }
-  //①计算α_xy = α_x * α_y的共享，除了要接受消息，还要发送消息
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-        if(i == id_ || j == id_ || k == id_) {
-          auto Gamma_i_j_k_1 = mask_in1[upperTriangularToArray(l, m)] * mask_in2[upperTriangularToArray(n, o)] + 
-                               mask_in1[upperTriangularToArray(l, n)] * mask_in2[upperTriangularToArray(m, o)] + 
-                               mask_in1[upperTriangularToArray(l, o)] * mask_in2[upperTriangularToArray(m, n)] + 
-                               mask_in1[upperTriangularToArray(m, n)] * mask_in2[upperTriangularToArray(l, o)] + 
-                               mask_in1[upperTriangularToArray(m, o)] * mask_in2[upperTriangularToArray(l, n)] + 
-                               mask_in1[upperTriangularToArray(n, o)] * mask_in2[upperTriangularToArray(l, m)];
-
-          auto Gamma_i_j_k = Gamma_i_j_k_1;
-          if (Gamma_i_j_k_2_mapping.find({i,j,k}) != Gamma_i_j_k_2_mapping.end()) {
-            Gamma_i_j_k += Gamma_i_j_k_2_mapping[{i,j,k}];
-          }
-
-          if (i == 0 && j == 1 && k == 2) {
-            Gamma_i_j_k += mask_in1[upperTriangularToArray(3, 4)] * mask_in2[upperTriangularToArray(3, 4)] + 
-                          mask_in1[upperTriangularToArray(3, 5)] * mask_in2[upperTriangularToArray(3, 5)] +
-                          mask_in1[upperTriangularToArray(3, 6)] * mask_in2[upperTriangularToArray(3, 6)] +
-                          mask_in1[upperTriangularToArray(4, 5)] * mask_in2[upperTriangularToArray(4, 5)] +
-                          mask_in1[upperTriangularToArray(4, 6)] * mask_in2[upperTriangularToArray(4, 6)] +
-                          mask_in1[upperTriangularToArray(5, 6)] * mask_in2[upperTriangularToArray(5, 6)];
-          }
-          else if (i == 4 && j == 5 && k == 6) {
-            Gamma_i_j_k += mask_in1[upperTriangularToArray(0, 1)] * mask_in2[upperTriangularToArray(0, 1)] + 
-                          mask_in1[upperTriangularToArray(0, 2)] * mask_in2[upperTriangularToArray(0, 2)] +
-                          mask_in1[upperTriangularToArray(0, 3)] * mask_in2[upperTriangularToArray(0, 3)] +
-                          mask_in1[upperTriangularToArray(1, 2)] * mask_in2[upperTriangularToArray(1, 2)] +
-                          mask_in1[upperTriangularToArray(1, 3)] * mask_in2[upperTriangularToArray(1, 3)] +
-                          mask_in1[upperTriangularToArray(2, 3)] * mask_in2[upperTriangularToArray(2, 3)];
-          }
-          else if (i == 0 && j == 1 && k == 3) {
-            Gamma_i_j_k += mask_in1[upperTriangularToArray(2, 4)] * mask_in2[upperTriangularToArray(2, 4)] + 
-                          mask_in1[upperTriangularToArray(2, 5)] * mask_in2[upperTriangularToArray(2, 5)] +
-                          mask_in1[upperTriangularToArray(2, 6)] * mask_in2[upperTriangularToArray(2, 6)];
-          }
-          else if (i == 0 && j == 2 && k == 3) {
-            Gamma_i_j_k += mask_in1[upperTriangularToArray(1, 4)] * mask_in2[upperTriangularToArray(1, 4)] + 
-                          mask_in1[upperTriangularToArray(1, 5)] * mask_in2[upperTriangularToArray(1, 5)] +
-                          mask_in1[upperTriangularToArray(1, 6)] * mask_in2[upperTriangularToArray(1, 6)];
-          }
-          else if (i == 1 && j == 2 && k == 3) {
-            Gamma_i_j_k += mask_in1[upperTriangularToArray(0, 4)] * mask_in2[upperTriangularToArray(0, 4)] + 
-                          mask_in1[upperTriangularToArray(0, 5)] * mask_in2[upperTriangularToArray(0, 5)] +
-                          mask_in1[upperTriangularToArray(0, 6)] * mask_in2[upperTriangularToArray(0, 6)];
-          }
-
-          //然后把数据share出去
-          auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-          auto x_l_m = Gamma_i_j_k - Gamma_i_j_k_mask.sum();
-          Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = x_l_m; //i,j,k本地设置，而n,o需要接收消息设置，l,m不用设置
-
-          //自己把最终结果加上
-          mask_prod += Gamma_i_j_k_mask;
-
-          //按顺序排序，这样其他发送者的发送参数是一样的，接收者也用一样的接受参数接受数据
-          jump_.jumpUpdate(i, j, k, n, (size_t) sizeof(Ring), &x_l_m);
-          jump_.jumpUpdate(i, j, k, o, (size_t) sizeof(Ring), &x_l_m);
-          if(id_ == 0) {
-          }
-        }
-        else {
-          //接收消息, id_不属于i，j，k中的一个
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            jump_.jumpUpdate(i, j, k, id_, (size_t) sizeof(Ring), nullptr);
-          }
-        }
-      }
-    }
-  }
-  
-  return mask_prod;
-}
-
-void OfflineEvaluator::compute_prod_mask_part2(ReplicatedShare<Ring>& mask_prod, size_t idx) {
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) { //确保是接收方
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            // Ring x_m;
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            const Ring *x_l_m_vec = reinterpret_cast<const Ring*>(jump_.getValues(i, j, k).data());
-            Ring x_l_m = x_l_m_vec[idx];
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = x_l_m; //j就对应x_m中的m
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-          else if(l == id_ || m == id_) { //如果是参与方l，m，那么直接把x_l_m设置为0即可
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = 0;
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-        }
-      }
-    }
-  }
-}
-
-ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask_dot(vector<ReplicatedShare<Ring>> mask_in1_vec, vector<ReplicatedShare<Ring>> mask_in2_vec) {
-  std::unordered_map<std::tuple<Ring, Ring, Ring>, Ring, TupleHash> Gamma_i_j_k_2_mapping;
-  ReplicatedShare<Ring> mask_prod;
+template <class R>
+ReplicatedShare<R> OfflineEvaluator<R>::compute_prod_mask_dot_part1(vector<ReplicatedShare<R>> mask_in1_vec, vector<ReplicatedShare<R>> mask_in2_vec,
+                                                                    JumpScheduler& sched, RingFutures<R>& incoming) {
+  std::unordered_map<std::tuple<R, R, R>, R, TupleHash> Gamma_i_j_k_2_mapping;
+  ReplicatedShare<R> mask_prod;
   mask_prod.init_zero();
   for(int i = 0; i < NUM_PARTIES; i++) {
     for (int j = i+1; j < NUM_PARTIES; j++) {
@@ -555,7 +401,7 @@ ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask_dot(vector<ReplicatedS
       for (int k = j+1; k < NUM_PARTIES; k++) {
         auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
         if(i == id_ || j == id_ || k == id_) {
-          Ring Gamma_i_j_k = 0;
+          R Gamma_i_j_k = 0;
           for(int t = 0; t<mask_in1_vec.size(); t++) {
             auto &mask_in1 = mask_in1_vec[t];
             auto &mask_in2 = mask_in2_vec[t];
@@ -612,226 +458,59 @@ ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask_dot(vector<ReplicatedS
           mask_prod += Gamma_i_j_k_mask;
 
           //按顺序排序，这样其他发送者的发送参数是一样的，接收者也用一样的接受参数接受数据
-          jump_.jumpUpdate(i, j, k, n, (size_t) sizeof(Ring), &x_l_m);
-          jump_.jumpUpdate(i, j, k, o, (size_t) sizeof(Ring), &x_l_m);
+          sched.jumpUpdate(i, j, k, n, &x_l_m);
+          sched.jumpUpdate(i, j, k, o, &x_l_m);
           if(id_ == 0) {
           }
         }
         else {
           //接收消息, id_不属于i，j，k中的一个
           if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            jump_.jumpUpdate(i, j, k, id_, (size_t) sizeof(Ring), nullptr);
-          }
-        }
-      }
-    }
-  }
-  
-  //通信得到数据
-  jump_.communicate(*network_, *tpool_);
-
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) { //确保是接收方
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            // Ring x_m;
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            const Ring *x_l_m = reinterpret_cast<const Ring*>(jump_.getValues(i, j, k).data());
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = *x_l_m; //j就对应x_m中的m
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-          else if(l == id_ || m == id_) { //如果是参与方l，m，那么直接把x_l_m设置为0即可
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = 0;
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
+            incoming.push_back(sched.jumpUpdate<R>(i, j, k, id_, nullptr));
           }
         }
       }
     }
   }
-  jump_.reset();
   return mask_prod;
 }
 
-void OfflineEvaluator::compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_prod, size_t idx) {
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) { //确保是接收方
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            // Ring x_m;
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            const Ring *x_l_m_vec = reinterpret_cast<const Ring*>(jump_.getValues(i, j, k).data());
-            Ring x_l_m = x_l_m_vec[idx];
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = x_l_m; //j就对应x_m中的m
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-          else if(l == id_ || m == id_) { //如果是参与方l，m，那么直接把x_l_m设置为0即可
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = 0;
-            //自己吧最终结果加上
-            mask_prod += Gamma_i_j_k_mask;
-          }
-        }
-      }
-    }
-  }
-}
-ReplicatedShare<Ring> OfflineEvaluator::compute_prod_mask_dot_part1(vector<ReplicatedShare<Ring>> mask_in1_vec, vector<ReplicatedShare<Ring>> mask_in2_vec) {
-  std::unordered_map<std::tuple<Ring, Ring, Ring>, Ring, TupleHash> Gamma_i_j_k_2_mapping;
-  ReplicatedShare<Ring> mask_prod;
-  mask_prod.init_zero();
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) {
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          auto key = std::make_tuple(l,m,n);
-          if(id_ != o) {
-            for(int t = 0; t<mask_in1_vec.size(); t++) {
-            auto &mask_in1 = mask_in1_vec[t];
-            auto &mask_in2 = mask_in2_vec[t];
-              if (Gamma_i_j_k_2_mapping.find(key) != Gamma_i_j_k_2_mapping.end()) {//如果这个key存在
-                
-                Gamma_i_j_k_2_mapping[{l,m,n}] += mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(i, k)] + 
-                                                  mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                  mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                  mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                  mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                  mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, k)];
-              }
-              else {
-                Gamma_i_j_k_2_mapping[{l,m,n}] = mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(i, k)] + 
-                                                mask_in1[upperTriangularToArray(i, j)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                mask_in1[upperTriangularToArray(i, k)] * mask_in2[upperTriangularToArray(j, k)] + 
-                                                mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, j)] + 
-                                                mask_in1[upperTriangularToArray(j, k)] * mask_in2[upperTriangularToArray(i, k)];
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-  // sleep(id_);
-  // std::cout<<"##############################id="<<id_<<"##############################"<<endl;
-  //①计算α_xy = α_x * α_y的共享，除了要接受消息，还要发送消息
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-        if(i == id_ || j == id_ || k == id_) {
-          Ring Gamma_i_j_k = 0;
-          for(int t = 0; t<mask_in1_vec.size(); t++) {
-            auto &mask_in1 = mask_in1_vec[t];
-            auto &mask_in2 = mask_in2_vec[t];
-            auto Gamma_i_j_k_1 = mask_in1[upperTriangularToArray(l, m)] * mask_in2[upperTriangularToArray(n, o)] + 
-                                mask_in1[upperTriangularToArray(l, n)] * mask_in2[upperTriangularToArray(m, o)] + 
-                                mask_in1[upperTriangularToArray(l, o)] * mask_in2[upperTriangularToArray(m, n)] + 
-                                mask_in1[upperTriangularToArray(m, n)] * mask_in2[upperTriangularToArray(l, o)] + 
-                                mask_in1[upperTriangularToArray(m, o)] * mask_in2[upperTriangularToArray(l, n)] + 
-                                mask_in1[upperTriangularToArray(n, o)] * mask_in2[upperTriangularToArray(l, m)];
-
-            Gamma_i_j_k += Gamma_i_j_k_1;
-
-            if (i == 0 && j == 1 && k == 2) {
-              Gamma_i_j_k += mask_in1[upperTriangularToArray(3, 4)] * mask_in2[upperTriangularToArray(3, 4)] + 
-                            mask_in1[upperTriangularToArray(3, 5)] * mask_in2[upperTriangularToArray(3, 5)] +
-                            mask_in1[upperTriangularToArray(3, 6)] * mask_in2[upperTriangularToArray(3, 6)] +
-                            mask_in1[upperTriangularToArray(4, 5)] * mask_in2[upperTriangularToArray(4, 5)] +
-                            mask_in1[upperTriangularToArray(4, 6)] * mask_in2[upperTriangularToArray(4, 6)] +
-                            mask_in1[upperTriangularToArray(5, 6)] * mask_in2[upperTriangularToArray(5, 6)];
-            }
-            else if (i == 4 && j == 5 && k == 6) {
-              Gamma_i_j_k += mask_in1[upperTriangularToArray(0, 1)] * mask_in2[upperTriangularToArray(0, 1)] + 
-                            mask_in1[upperTriangularToArray(0, 2)] * mask_in2[upperTriangularToArray(0, 2)] +
-                            mask_in1[upperTriangularToArray(0, 3)] * mask_in2[upperTriangularToArray(0, 3)] +
-                            mask_in1[upperTriangularToArray(1, 2)] * mask_in2[upperTriangularToArray(1, 2)] +
-                            mask_in1[upperTriangularToArray(1, 3)] * mask_in2[upperTriangularToArray(1, 3)] +
-                            mask_in1[upperTriangularToArray(2, 3)] * mask_in2[upperTriangularToArray(2, 3)];
-            }
-            else if (i == 0 && j == 1 && k == 3) {
-              Gamma_i_j_k += mask_in1[upperTriangularToArray(2, 4)] * mask_in2[upperTriangularToArray(2, 4)] + 
-                            mask_in1[upperTriangularToArray(2, 5)] * mask_in2[upperTriangularToArray(2, 5)] +
-                            mask_in1[upperTriangularToArray(2, 6)] * mask_in2[upperTriangularToArray(2, 6)];
-            }
-            else if (i == 0 && j == 2 && k == 3) {
-              Gamma_i_j_k += mask_in1[upperTriangularToArray(1, 4)] * mask_in2[upperTriangularToArray(1, 4)] + 
-                            mask_in1[upperTriangularToArray(1, 5)] * mask_in2[upperTriangularToArray(1, 5)] +
-                            mask_in1[upperTriangularToArray(1, 6)] * mask_in2[upperTriangularToArray(1, 6)];
-            }
-            else if (i == 1 && j == 2 && k == 3) {
-              Gamma_i_j_k += mask_in1[upperTriangularToArray(0, 4)] * mask_in2[upperTriangularToArray(0, 4)] + 
-                            mask_in1[upperTriangularToArray(0, 5)] * mask_in2[upperTriangularToArray(0, 5)] +
-                            mask_in1[upperTriangularToArray(0, 6)] * mask_in2[upperTriangularToArray(0, 6)];
-            }
-          }
-          if (Gamma_i_j_k_2_mapping.find({i,j,k}) != Gamma_i_j_k_2_mapping.end()) {
-            Gamma_i_j_k += Gamma_i_j_k_2_mapping[{i,j,k}];
-          }
-          //然后把数据share出去
-          auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-          auto x_l_m = Gamma_i_j_k - Gamma_i_j_k_mask.sum();
-          Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = x_l_m; //i,j,k本地设置，而n,o需要接收消息设置，l,m不用设置
-
-          //自己把最终结果加上
-          mask_prod += Gamma_i_j_k_mask;
 
-          //按顺序排序，这样其他发送者的发送参数是一样的，接收者也用一样的接受参数接受数据
-          jump_.jumpUpdate(i, j, k, n, (size_t) sizeof(Ring), &x_l_m);
-          jump_.jumpUpdate(i, j, k, o, (size_t) sizeof(Ring), &x_l_m);
-          if(id_ == 0) {
-          }
-        }
-        else {
-          //接收消息, id_不属于i，j，k中的一个
-          if(n == id_ || o == id_) { //如果是参与方n, o，那么需要用通信协议来更新x_l_m
-            jump_.jumpUpdate(i, j, k, id_, (size_t) sizeof(Ring), nullptr);
-          }
-        }
-      }
-    }
+template <class R>
+void OfflineEvaluator<R>::bool_mul(const std::vector<std::pair<ReplicatedShare<R>*, ReplicatedShare<R>>>& ops,
+                                   JumpScheduler& sched) {
+  // 先把所有乘法的 part1 入队，再一起发出
+  RingFutures<R> incoming;
+  std::vector<ReplicatedShare<R>> prods;
+  prods.reserve(ops.size());
+  for (const auto& [a, b] : ops) {
+    prods.push_back(compute_prod_mask_part1(*a, b, sched, incoming));
   }
-  return mask_prod;
-}
-
-
-ReplicatedShare<Ring> OfflineEvaluator::bool_mul(ReplicatedShare<Ring> a, ReplicatedShare<Ring> b){
-  ReplicatedShare<Ring> temp = a + b;
-  auto temp2 = compute_prod_mask(a, b);
-  global_counter++;
-  temp -= temp2.cosnt_mul(2);
-  return temp;
-}
-
-ReplicatedShare<Ring> OfflineEvaluator::bool_mul_by_indices(vector<ReplicatedShare<Ring>> r_mask_vec, vector<int> indices) {
-  ReplicatedShare<Ring> result = r_mask_vec[indices[0]];
-  for(int i = 1; i < indices.size(); i++) {
-    result = bool_mul(result, r_mask_vec[indices[i]]);
+  // 不是每一方都有要读的 future (P0、P1 从不做接收方)，轮次边界必须显式 flush
+  sched.flush();
+  for (size_t t = 0; t < ops.size(); ++t) {
+    compute_prod_mask_part2(prods[t], incoming);
+    auto& [a, b] = ops[t];
+    *a = *a + b - prods[t].cosnt_mul(2);
   }
-  return result;
+  global_counter += ops.size();
 }
 
-std::tuple<vector<ReplicatedShare<Ring>>, vector<ReplicatedShare<Ring>>> OfflineEvaluator::comute_random_r_every_bit_sharing(int id, vector<ReplicatedShare<Ring>> r_mask_vec,
-                                                                                          std::vector<std::pair<int, int>> indices) {
+template <class R>
+std::tuple<vector<ReplicatedShare<R>>, vector<ReplicatedShare<R>>> OfflineEvaluator<R>::comute_random_r_every_bit_sharing(int id, vector<ReplicatedShare<R>> r_mask_vec,
+                                                                                          std::vector<std::pair<int, int>> indices,
+                                                                                          JumpScheduler& sched) {
   //首先计算17个随机数的每一比特的共享
-  std::array<std::array<ReplicatedShare<Ring>, 17>, N> r_mask_vec_every_bit;
-  vector<ReplicatedShare<Ring>> r_1_mask_vec_every_bit;
-  vector<ReplicatedShare<Ring>> r_2_mask_vec_every_bit;
-  for(int i = 0; i<N; i++) {
-    for(int j = 0; j<indices.size(); j++) {
-      //计算第i个随机数r的第j个比特
-      ReplicatedShare<Ring> r_i_for_j_bit_mask;
+  std::array<std::array<ReplicatedShare<R>, 17>, kBits> r_mask_vec_every_bit;
+  vector<ReplicatedShare<R>> r_1_mask_vec_every_bit;
+  vector<ReplicatedShare<R>> r_2_mask_vec_every_bit;
+  for(size_t i = 0; i<kBits; i++) {
+    for(size_t j = 0; j<indices.size(); j++) {
+      //计算第j个随机数r的第i个比特
+      ReplicatedShare<R> r_i_for_j_bit_mask;
       r_i_for_j_bit_mask.init_zero();
 
-      Ring r_i;
+      R r_i;
       auto pair = indices[j];
       auto index1 = std::get<0>(pair);
       auto index2 = std::get<1>(pair);
@@ -841,7 +520,7 @@ std::tuple<vector<ReplicatedShare<Ring>>, vector<ReplicatedShare<Ring>>> Offline
         r_i = 0;
       }
       else {
-        r_i = r_mask_vec[i][upperTriangularToArray(index1, index2)];
+        r_i = r_mask_vec[j][upperTriangularToArray(index1, index2)];
       }
       if(((r_i >> i) & 1ULL) == 1 && id != index1 && id != index2) { //计算r1的第i比特的共享，要确保五个人的共享值复原后等于r的第i比特
         r_i_for_j_bit_mask[upperTriangularToArray(index1, index2)] = 1;
@@ -850,53 +529,82 @@ std::tuple<vector<ReplicatedShare<Ring>>, vector<ReplicatedShare<Ring>>> Offline
     }
   }
 
-  for(int i = 0; i<N; i++) {
-    //首先把17个随机数的第j比特存在一个vector中
-    std::vector<ReplicatedShare<Ring>> r_j_bit_mask_vec;
-    r_j_bit_mask_vec.reserve(r_mask_vec_every_bit[i].size());
-    std::copy(r_mask_vec_every_bit[i].begin(), r_mask_vec_every_bit[i].end(), std::back_inserter(r_j_bit_mask_vec));
-
-    std::vector<int>  indices1 = {0, 1, 2};
-    auto r = bool_mul_by_indices(r_j_bit_mask_vec, indices1);
+  // r = b0^b1^b2，r_1 = b5^b8^b6^b9^b7^b10^b3^r，r_2 = b11^b14^b12^b15^b13^b16^b4^r。
+  // 所有比特、三条链的同一步异或放进同一轮：链上 6 步加最后异或 r 共 7 轮，
+  // 而不是每个比特串行 16 轮
+  const std::array<std::vector<int>, 3> chains = {{{0, 1, 2},
+                                                   {5, 8, 6, 9, 7, 10, 3},
+                                                   {11, 14, 12, 15, 13, 16, 4}}};
+  std::vector<std::array<ReplicatedShare<R>, 3>> acc(kBits);
+  for (size_t i = 0; i < kBits; ++i) {
+    for (size_t c = 0; c < chains.size(); ++c) {
+      acc[i][c] = r_mask_vec_every_bit[i][chains[c][0]];
+    }
+  }
 
-    std::vector<int>  indices2 = {5, 8, 6, 9, 7, 10, 3};
-    auto r_1 = bool_mul_by_indices(r_j_bit_mask_vec, indices2);
-    r_1 = bool_mul(r_1, r);
+  std::vector<std::pair<ReplicatedShare<R>*, ReplicatedShare<R>>> ops;
+  for (size_t step = 1; step < chains[1].size(); ++step) {
+    ops.clear();
+    for (size_t i = 0; i < kBits; ++i) {
+      for (size_t c = 0; c < chains.size(); ++c) {
+        if (step < chains[c].size()) {
+          ops.emplace_back(&acc[i][c], r_mask_vec_every_bit[i][chains[c][step]]);
+        }
+      }
+    }
+    bool_mul(ops, sched);
+  }
 
-    std::vector<int>  indices3 = {11, 14, 12, 15, 13, 16, 4};
-    auto r_2 = bool_mul_by_indices(r_j_bit_mask_vec, indices3);
-    r_2 = bool_mul(r_2, r);
+  ops.clear();
+  for (size_t i = 0; i < kBits; ++i) {
+    ops.emplace_back(&acc[i][1], acc[i][0]);
+    ops.emplace_back(&acc[i][2], acc[i][0]);
+  }
+  bool_mul(ops, sched);
 
-    r_1_mask_vec_every_bit.push_back(r_1);
-    r_2_mask_vec_every_bit.push_back(r_2);
+  for (size_t i = 0; i < kBits; ++i) {
+    r_1_mask_vec_every_bit.push_back(acc[i][1]);
+    r_2_mask_vec_every_bit.push_back(acc[i][2]);
   }
 
   return {r_1_mask_vec_every_bit, r_2_mask_vec_every_bit};
 }
 
-PreprocCircuit<Ring> OfflineEvaluator::getPreproc() {
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::getPreproc() {
   return std::move(preproc_);
 }
 
-PreprocCircuit<Ring> OfflineEvaluator::run(const utils::LevelOrderedCircuit& circ,
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::run(const utils::LevelOrderedCircuit& circ,
     const std::unordered_map<utils::wire_t, int>& input_pid_map,
     size_t security_param, int pid, emp::PRG& prg) {
   preproc_ = offline_setwire(circ, input_pid_map, security_param, id_, prg);
   return std::move(preproc_);
 }
 
-PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::offline_setwire_no_batch(
     const utils::LevelOrderedCircuit& circ,
     const std::unordered_map<utils::wire_t, int>& input_pid_map,
     size_t security_param, int pid, emp::PRG& prg) {
-  PreprocCircuit<Ring> preproc(circ.num_gates, circ.outputs.size());
+  PreprocCircuit<R> preproc(circ.num_gates, circ.outputs.size());
   jump_.reset();
-  std::vector<DummyShare<Ring>> wires(circ.num_gates);
+  std::vector<DummyShare<R>> wires(circ.num_gates);
+  // 门仍然逐个处理，但 α_xy 的 part1 都交给调度器入队，本层结束时再按入队顺序补全，
+  // 同一层的乘法因此共用一轮通信
+  JumpScheduler sched(jump_, *network_);
+  RingFutures<R> incoming;
+  struct PendingProd {
+    ReplicatedShare<R> mask_prod;
+    CompactShare<R>* out;
+  };
+  std::vector<PendingProd> pending;
   for (const auto& level : circ.gates_by_level) {
     for (const auto& gate : level) {
       switch (gate->type) {
         case utils::GateType::kInp: {
-          auto pregate = std::make_unique<PreprocInput<Ring>>();
+          auto pregate = std::make_unique<PreprocInput<R>>();
           auto pid = input_pid_map.at(gate->out); //input pid
           pregate->pid = pid;
           if (pid == id_) {
@@ -915,7 +623,7 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
           const auto& mask_in1 = preproc.gates[g->in1]->mask;
           const auto& mask_in2 = preproc.gates[g->in2]->mask;
           preproc.gates[gate->out] =
-              std::make_unique<PreprocGate<Ring>>(mask_in1 + mask_in2);
+              std::make_unique<PreprocGate<R>>(mask_in1 + mask_in2);
           break;
         }
 
@@ -924,24 +632,24 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
           const auto& mask_in1 = preproc.gates[g->in1]->mask;
           const auto& mask_in2 = preproc.gates[g->in2]->mask;
           preproc.gates[gate->out] =
-              std::make_unique<PreprocGate<Ring>>(mask_in1 - mask_in2);
+              std::make_unique<PreprocGate<R>>(mask_in1 - mask_in2);
           break;
         }
 
         case utils::GateType::kConstAdd: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
           // const auto& mask_in = preproc.gates[g->in]->mask;
           preproc.gates[gate->out] =
-              std::make_unique<PreprocGate<Ring>>(preproc.gates[g->in]->mask);//mask_in的值不会改变
+              std::make_unique<PreprocGate<R>>(preproc.gates[g->in]->mask);//mask_in的值不会改变
           break;
         }
 
         case utils::GateType::kConstMul: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
           const auto& mask_in = preproc.gates[g->in]->mask;
           // wires[g->out] = wires[g->in] * g->cval;
           preproc.gates[g->out] =
-              std::make_unique<PreprocGate<Ring>>(mask_in*g->cval);
+              std::make_unique<PreprocGate<R>>(mask_in*g->cval);
           break;
         }
         
@@ -951,68 +659,74 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
           const auto& mask_in1 = preproc.gates[g->in1]->mask;
           const auto& mask_in2 = preproc.gates[g->in2]->mask;
 
-          ReplicatedShare<Ring> mask_prod = compute_prod_mask(mask_in1, mask_in2);
-          preproc.gates[gate->out] = std::make_unique<PreprocMultGate<Ring>>(
-              randomShareWithParty(id_, rgen_), mask_prod);
+          ReplicatedShare<R> mask_prod = compute_prod_mask_part1(expand(mask_in1), expand(mask_in2), sched, incoming);
+          auto pregate = std::make_unique<PreprocMultGate<R>>(
+              compact(randomShareWithParty(id_, rgen_)), CompactShare<R>{});
+          pending.push_back({mask_prod, &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
           break;
         }
 
         case utils::GateType::kDotprod: {
           const auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-          vector<ReplicatedShare<Ring>> mask_in1_vec;
-          vector<ReplicatedShare<Ring>> mask_in2_vec;
+          vector<ReplicatedShare<R>> mask_in1_vec;
+          vector<ReplicatedShare<R>> mask_in2_vec;
           for (size_t i = 0; i < g->in1.size(); i++) {
-            mask_in1_vec.push_back(preproc.gates[g->in1[i]]->mask);
-            mask_in2_vec.push_back(preproc.gates[g->in2[i]]->mask);
+            mask_in1_vec.push_back(expand(preproc.gates[g->in1[i]]->mask));
+            mask_in2_vec.push_back(expand(preproc.gates[g->in2[i]]->mask));
           }
-          ReplicatedShare<Ring> mask_prod_dot = compute_prod_mask_dot(mask_in1_vec, mask_in2_vec);
+          ReplicatedShare<R> mask_prod_dot = compute_prod_mask_dot_part1(mask_in1_vec, mask_in2_vec, sched, incoming);
 
-          preproc.gates[g->out] = std::make_unique<PreprocDotpGate<Ring>>(
-              randomShareWithParty(id_, rgen_), mask_prod_dot);
+          auto pregate = std::make_unique<PreprocDotpGate<R>>(
+              compact(randomShareWithParty(id_, rgen_)), CompactShare<R>{});
+          pending.push_back({mask_prod_dot, &pregate->mask_prod});
+          preproc.gates[g->out] = std::move(pregate);
           break;
         }
 
         case utils::GateType::kTrdotp: {
           const auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-          ReplicatedShare<Ring> r_1, r_2;
-          ReplicatedShare<Ring> r_1_trunted_d, r_2_trunted_d;
+          ReplicatedShare<R> r_1, r_2;
+          ReplicatedShare<R> r_1_trunted_d, r_2_trunted_d;
           r_1.init_zero(); r_2.init_zero(); 
           r_1_trunted_d.init_zero(); r_2_trunted_d.init_zero();
           //首先生成r1,r2,r3的共享，按照表格的内容生成
           std::vector<std::pair<int, int>> indices = { {0,1}, {0,2}, {1,2}, {3,4}, {5,6}, {0,3},
                                                       {1,3}, {2,3}, {0,4}, {1,4}, {2,4}, {0,5},
                                                       {1,5}, {2,5}, {0,6}, {1,6}, {2,6}};
-          vector<ReplicatedShare<Ring>> r_mask_vec = randomShareWithParty_for_trun(id_, rgen_, indices);
+          vector<ReplicatedShare<R>> r_mask_vec = randomShareWithParty_for_trun(id_, rgen_, indices);
         
           //生成r的每一比特共享
-          auto [r_1_every_bit, r_2_every_bit] = comute_random_r_every_bit_sharing(id_, r_mask_vec, indices);
-
-          for(int i = 0; i<N; i++) {
-            r_1 += r_1_every_bit[i].cosnt_mul((1ULL << i));
-            r_2 += r_2_every_bit[i].cosnt_mul((1ULL << i));
-            if(i>=FRACTION) {
-              r_1_trunted_d += r_1_every_bit[i].cosnt_mul((1ULL << (i-FRACTION)));
-              r_2_trunted_d += r_2_every_bit[i].cosnt_mul((1ULL << (i-FRACTION)));
+          auto [r_1_every_bit, r_2_every_bit] = comute_random_r_every_bit_sharing(id_, r_mask_vec, indices, sched);
+
+          for(size_t i = 0; i<kBits; i++) {
+            r_1 += r_1_every_bit[i].cosnt_mul((R(1) << i));
+            r_2 += r_2_every_bit[i].cosnt_mul((R(1) << i));
+            if(i>=kFraction) {
+              r_1_trunted_d += r_1_every_bit[i].cosnt_mul((R(1) << (i-kFraction)));
+              r_2_trunted_d += r_2_every_bit[i].cosnt_mul((R(1) << (i-kFraction)));
             }
           }
           
-          vector<ReplicatedShare<Ring>> mask_in1_vec;
-          vector<ReplicatedShare<Ring>> mask_in2_vec;
+          vector<ReplicatedShare<R>> mask_in1_vec;
+          vector<ReplicatedShare<R>> mask_in2_vec;
           for (size_t i = 0; i < g->in1.size(); i++) {
-            mask_in1_vec.push_back(preproc.gates[g->in1[i]]->mask);
-            mask_in2_vec.push_back(preproc.gates[g->in2[i]]->mask);
+            mask_in1_vec.push_back(expand(preproc.gates[g->in1[i]]->mask));
+            mask_in2_vec.push_back(expand(preproc.gates[g->in2[i]]->mask));
           }
-          ReplicatedShare<Ring> mask_prod_dot = compute_prod_mask_dot(mask_in1_vec, mask_in2_vec);
+          ReplicatedShare<R> mask_prod_dot = compute_prod_mask_dot_part1(mask_in1_vec, mask_in2_vec, sched, incoming);
 
           //生成三个共享，一个是mask，代表[r^d]，即最终的结果r^d的[·]-sharing部分
           //一个是mask_prod，代表[z]，即计算结果的共享[·]-sharing
           //最后一个是mask_d，代表随机数[r]的共享[·]-sharing
-          ReplicatedShare<Ring> r = r_1 + r_2;
-          ReplicatedShare<Ring> r_trunted_d = r_1_trunted_d + r_2_trunted_d;
-          preproc.gates[g->out] = std::make_unique<PreprocTrDotpGate<Ring>>( 
-              r_trunted_d, mask_prod_dot, r);
+          ReplicatedShare<R> r = r_1 + r_2;
+          ReplicatedShare<R> r_trunted_d = r_1_trunted_d + r_2_trunted_d;
+          auto pregate = std::make_unique<PreprocTrDotpGate<R>>(
+              compact(r_trunted_d), CompactShare<R>{}, compact(r));
+          pending.push_back({mask_prod_dot, &pregate->mask_prod});
+          preproc.gates[g->out] = std::move(pregate);
           break;
         }
 
@@ -1025,31 +739,34 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
           const auto* cmp_g = static_cast<utils::FIn1Gate*>(gate.get()); //一个输入的门
           auto mask_output_alpha = randomShareWithParty(id_, rgen_); //随机化输出值的α
 
-          DummyShare<Ring> mask_mu_1; //随机化mu_1
+          DummyShare<R> mask_mu_1; //随机化mu_1
           mask_mu_1.randomize(prg);
           auto mask_mu_1_share = mask_mu_1.getRSS(pid);
-          auto mask_in = preproc.gates[cmp_g->in]->mask;
+          auto mask_in = expand(preproc.gates[cmp_g->in]->mask);
 
-          auto mask_prod = compute_prod_mask(mask_mu_1_share, mask_in); //直接把关键的prod=(Σα1) x (Σα2)的共享计算出来
+          auto mask_prod = compute_prod_mask_part1(mask_mu_1_share, mask_in, sched, incoming); //直接把关键的prod=(Σα1) x (Σα2)的共享计算出来
 
-          DummyShare<Ring> mask_mu_2; //随机化mu_2
+          DummyShare<R> mask_mu_2; //随机化mu_2
           mask_mu_2.randomize(prg);
           auto mask_mu_2_share = mask_mu_2.getRSS(pid);
 
-          Ring beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_1.secret();
-          Ring beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_2.secret();
+          R beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_1.secret();
+          R beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_2.secret();
 
-          ReplicatedShare<Ring> prev_mask = mask_output_alpha;
+          ReplicatedShare<R> prev_mask = mask_output_alpha;
           mask_output_alpha +=  mask_mu_2_share;  //alpha提前加好，后续不用加了
           
-          ReplicatedShare<Ring> mask_for_mul = randomShareWithParty(id_, rgen_); //随机化mu_2
+          ReplicatedShare<R> mask_for_mul = randomShareWithParty(id_, rgen_); //随机化mu_2
 
           //前面做了一次乘法，得到的结果是(x-y)大于0或者小于0，分别代表1和0，这里再做一次乘法，输入(x-y)，则输出relu的结果
-          auto mask_prod2 = compute_prod_mask(mask_output_alpha, mask_in); //(x-y)和比较结果z的α做乘法
+          auto mask_prod2 = compute_prod_mask_part1(mask_output_alpha, mask_in, sched, incoming); //(x-y)和比较结果z的α做乘法
 
-          preproc.gates[gate->out] = std::make_unique<PreprocReluGate<Ring>>(
-              mask_output_alpha, mask_prod, mask_mu_1_share, mask_mu_2_share, 
-              beta_mu_1, beta_mu_2, prev_mask, mask_prod2, mask_for_mul); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          auto pregate = std::make_unique<PreprocReluGate<R>>(
+              compact(mask_output_alpha), CompactShare<R>{}, compact(mask_mu_1_share), compact(mask_mu_2_share), 
+              beta_mu_1, beta_mu_2, compact(prev_mask), CompactShare<R>{}, compact(mask_for_mul)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          pending.push_back({mask_prod, &pregate->mask_prod});
+          pending.push_back({mask_prod2, &pregate->mask_prod2});
+          preproc.gates[gate->out] = std::move(pregate);
           break;
         }
 
@@ -1059,26 +776,28 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
           const auto* cmp_g = static_cast<utils::FIn1Gate*>(gate.get()); //一个输入的门
           auto mask_output_alpha = randomShareWithParty(id_, rgen_); //随机化输出值的α
 
-          DummyShare<Ring> mask_mu_1; //随机化mu_1
+          DummyShare<R> mask_mu_1; //随机化mu_1
           mask_mu_1.randomize(prg); //
           auto mask_mu_1_share = mask_mu_1.getRSS(pid);
-          auto mask_in = preproc.gates[cmp_g->in]->mask;
+          auto mask_in = expand(preproc.gates[cmp_g->in]->mask);
 
-          auto mask_prod = compute_prod_mask(mask_mu_1_share, mask_in); //直接把关键的prod=(Σα1) x (Σα2)的共享计算出来
+          auto mask_prod = compute_prod_mask_part1(mask_mu_1_share, mask_in, sched, incoming); //直接把关键的prod=(Σα1) x (Σα2)的共享计算出来
 
-          DummyShare<Ring> mask_mu_2; //随机化mu_2
+          DummyShare<R> mask_mu_2; //随机化mu_2
           mask_mu_2.randomize(prg);
           auto mask_mu_2_share = mask_mu_2.getRSS(pid);
 
-          Ring beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_1.secret();
-          Ring beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_2.secret();
+          R beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_1.secret();
+          R beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_2.secret();
 
-          ReplicatedShare<Ring> prev_mask = mask_output_alpha;
+          ReplicatedShare<R> prev_mask = mask_output_alpha;
           mask_output_alpha +=  mask_mu_2_share;  //alpha提前加好，后续不用加了
           //除此之外，还有一个重要的操作，如果(x-y)>0，那么最终需要的α已经有了，但是β无法计算，所以我们需要预先计算好最终结果的β，否则计算不了。
 
-          preproc.gates[gate->out] = std::make_unique<PreprocCmpGate<Ring>>(mask_output_alpha, mask_prod,
-              mask_mu_1_share, mask_mu_2_share, beta_mu_1, beta_mu_2, prev_mask); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          auto pregate = std::make_unique<PreprocCmpGate<R>>(compact(mask_output_alpha), CompactShare<R>{},
+              compact(mask_mu_1_share), compact(mask_mu_2_share), beta_mu_1, beta_mu_2, compact(prev_mask)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          pending.push_back({mask_prod, &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
           break;
         }
 
@@ -1088,45 +807,23 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire_no_batch(
         }
       }
     }
-  }
-  return preproc;
-}
-
-// === 插入这两个新函数的实现 ===
 
-void OfflineEvaluator::compute_prod_mask_part2(ReplicatedShare<Ring>& mask_prod, ChannelOffsets& offsets) {
-  for(int i = 0; i < NUM_PARTIES; i++) {
-    for (int j = i+1; j < NUM_PARTIES; j++) {
-      for (int k = j+1; k < NUM_PARTIES; k++) {
-        if(i != id_ && j != id_ && k != id_) { 
-          auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
-          if(n == id_ || o == id_) {
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            
-            // 使用 offsets 获取正确的偏移量
-            const auto& buffer = jump_.getValues(i, j, k);
-            size_t offset = offsets.getAndIncrement(i, j, k);
-            // 安全检查：确保 buffer 足够大
-            if (offset + sizeof(Ring) > buffer.size()) {
-                throw std::runtime_error("Buffer overflow in compute_prod_mask_part2");
-            }
-            const Ring* x_l_m = reinterpret_cast<const Ring*>(buffer.data() + offset);
-            
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = *x_l_m; 
-            mask_prod += Gamma_i_j_k_mask;
-          }
-          else if(l == id_ || m == id_) {
-            auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = 0;
-            mask_prod += Gamma_i_j_k_mask;
-          }
-        }
-      }
+    // 本层入队的更新一起发出；P0、P1 没有要读的 future，所以必须显式 flush
+    if (!pending.empty()) {
+      sched.flush();
+    }
+    for (auto& p : pending) {
+      compute_prod_mask_part2(p.mask_prod, incoming);
+      *p.out = compact(p.mask_prod);
     }
+    pending.clear();
   }
+  sched.finish();
+  return preproc;
 }
 
-void OfflineEvaluator::compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_prod, ChannelOffsets& offsets) {
+template <class R>
+void OfflineEvaluator<R>::compute_prod_mask_part2(ReplicatedShare<R>& mask_prod, RingFutures<R>& incoming) {
   for(int i = 0; i < NUM_PARTIES; i++) {
     for (int j = i+1; j < NUM_PARTIES; j++) {
       for (int k = j+1; k < NUM_PARTIES; k++) {
@@ -1134,15 +831,12 @@ void OfflineEvaluator::compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_p
           auto [l, m, n, o] = findRemainingNumbers_7PC(i, j, k);
           if(n == id_ || o == id_) {
             auto Gamma_i_j_k_mask = jshShare(id_, rgen_, i, j, k);
-            
-            const auto& buffer = jump_.getValues(i, j, k);
-            size_t offset = offsets.getAndIncrement(i, j, k);
-            if (offset + sizeof(Ring) > buffer.size()) {
-                throw std::runtime_error("Buffer overflow in compute_prod_mask_dot_part2");
+            if (incoming.empty()) {
+              throw std::runtime_error("compute_prod_mask_part2: no pending slice for this gate");
             }
-            const Ring* x_l_m = reinterpret_cast<const Ring*>(buffer.data() + offset);
-            
-            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = *x_l_m;
+            // 第一次读取时调度器才发出本轮，之后只等待本通道
+            Gamma_i_j_k_mask[upperTriangularToArray(l, m)] = incoming.front().value();
+            incoming.pop_front();
             mask_prod += Gamma_i_j_k_mask;
           }
           else if(l == id_ || m == id_) {
@@ -1156,14 +850,14 @@ void OfflineEvaluator::compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_p
   }
 }
 
-
 // 替换整个 offline_setwire 函数
-PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::offline_setwire(
     const utils::LevelOrderedCircuit& circ,
     const std::unordered_map<utils::wire_t, int>& input_pid_map,
     size_t security_param, int pid, emp::PRG& prg) {
   
-  PreprocCircuit<Ring> preproc(circ.num_gates, circ.outputs.size());
+  PreprocCircuit<R> preproc(circ.num_gates, circ.outputs.size());
   jump_.reset();
   
   // 使用类型别名解决 wire_t 报错
@@ -1171,29 +865,29 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
 
   // 定义中间状态结构体
   struct ReluState {
-    ReplicatedShare<Ring> mask_output_alpha;
-    ReplicatedShare<Ring> mask_mu_1, mask_mu_2;
-    Ring beta_mu_1, beta_mu_2;
-    ReplicatedShare<Ring> prev_mask, mask_for_mul;
-    ReplicatedShare<Ring> mask_prod, mask_prod2;
+    ReplicatedShare<R> mask_output_alpha;
+    ReplicatedShare<R> mask_mu_1, mask_mu_2;
+    R beta_mu_1, beta_mu_2;
+    ReplicatedShare<R> prev_mask, mask_for_mul;
+    ReplicatedShare<R> mask_prod, mask_prod2;
   };
 
   struct CmpState {
-    ReplicatedShare<Ring> mask_output_alpha;
-    ReplicatedShare<Ring> mask_mu_1, mask_mu_2;
-    Ring beta_mu_1, beta_mu_2;
-    ReplicatedShare<Ring> prev_mask, mask_prod;
+    ReplicatedShare<R> mask_output_alpha;
+    ReplicatedShare<R> mask_mu_1, mask_mu_2;
+    R beta_mu_1, beta_mu_2;
+    ReplicatedShare<R> prev_mask, mask_prod;
   };
 
   struct TrdotpState {
-    ReplicatedShare<Ring> r, r_trunted_d;
-    std::vector<ReplicatedShare<Ring>> r_bits; 
-    std::array<std::array<ReplicatedShare<Ring>, N>, 17> bits_matrix; 
-    std::vector<ReplicatedShare<Ring>> A_chain[2]; 
-    std::vector<ReplicatedShare<Ring>> B_chain[6];
-    std::vector<ReplicatedShare<Ring>> C_chain[6];
-    std::vector<ReplicatedShare<Ring>> R_final[2]; 
-    ReplicatedShare<Ring> main_dot_mask;
+    ReplicatedShare<R> r, r_trunted_d;
+    std::vector<ReplicatedShare<R>> r_bits; 
+    std::array<std::array<ReplicatedShare<R>, kBits>, 17> bits_matrix; 
+    std::vector<ReplicatedShare<R>> A_chain[2]; 
+    std::vector<ReplicatedShare<R>> B_chain[6];
+    std::vector<ReplicatedShare<R>> C_chain[6];
+    std::vector<ReplicatedShare<R>> R_final[2]; 
+    ReplicatedShare<R> main_dot_mask;
   };
 
   // 随机数索引
@@ -1205,10 +899,12 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
   // 按层遍历
   for (const auto& level : circ.gates_by_level) {
     jump_.reset();
-    ChannelOffsets offsets; // 这里使用新定义的结构体
+    // 各门的更新由调度器合并成轮次，收到的数据按登记顺序从 incoming 取出，不需要手工维护偏移
+    JumpScheduler sched(jump_, *network_);
+    RingFutures<R> incoming;
 
-    std::unordered_map<wire_t, ReplicatedShare<Ring>> mul_states;
-    std::unordered_map<wire_t, ReplicatedShare<Ring>> dot_states;
+    std::unordered_map<wire_t, ReplicatedShare<R>> mul_states;
+    std::unordered_map<wire_t, ReplicatedShare<R>> dot_states;
     std::unordered_map<wire_t, ReluState> relu_states;
     std::unordered_map<wire_t, CmpState> cmp_states;
     std::unordered_map<wire_t, TrdotpState> trdotp_states;
@@ -1218,7 +914,7 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
     for (const auto& gate : level) {
       switch (gate->type) {
         case utils::GateType::kInp: {
-          auto pregate = std::make_unique<PreprocInput<Ring>>();
+          auto pregate = std::make_unique<PreprocInput<R>>();
           auto input_pid = input_pid_map.at(gate->out);
           pregate->pid = input_pid;
           if (pid == input_pid) {
@@ -1232,17 +928,17 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
         // 本地门（Add, Sub等）推迟到 Pass 3 处理
         case utils::GateType::kMul: {
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-          mul_states[gate->out] = compute_prod_mask_part1(preproc.gates[g->in1]->mask, preproc.gates[g->in2]->mask);
+          mul_states[gate->out] = compute_prod_mask_part1(expand(preproc.gates[g->in1]->mask), expand(preproc.gates[g->in2]->mask), sched, incoming);
           break;
         }
         case utils::GateType::kDotprod: {
           const auto* g = static_cast<utils::SIMDGate*>(gate.get());
-          std::vector<ReplicatedShare<Ring>> in1, in2;
+          std::vector<ReplicatedShare<R>> in1, in2;
           for(size_t i=0; i<g->in1.size(); ++i) {
-             in1.push_back(preproc.gates[g->in1[i]]->mask);
-             in2.push_back(preproc.gates[g->in2[i]]->mask);
+             in1.push_back(expand(preproc.gates[g->in1[i]]->mask));
+             in2.push_back(expand(preproc.gates[g->in2[i]]->mask));
           }
-          dot_states[gate->out] = compute_prod_mask_dot_part1(in1, in2);
+          dot_states[gate->out] = compute_prod_mask_dot_part1(in1, in2, sched, incoming);
           break;
         }
         case utils::GateType::kRelu: {
@@ -1250,17 +946,17 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
           ReluState s;
           s.mask_output_alpha = randomShareWithParty(id_, rgen_);
           
-          DummyShare<Ring> m1; m1.randomize(prg); s.mask_mu_1 = m1.getRSS(pid);
-          DummyShare<Ring> m2; m2.randomize(prg); s.mask_mu_2 = m2.getRSS(pid);
-          s.beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + m1.secret();
-          s.beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + m2.secret();
+          DummyShare<R> m1; m1.randomize(prg); s.mask_mu_1 = m1.getRSS(pid);
+          DummyShare<R> m2; m2.randomize(prg); s.mask_mu_2 = m2.getRSS(pid);
+          s.beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + m1.secret();
+          s.beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + m2.secret();
           
           s.prev_mask = s.mask_output_alpha;
           s.mask_output_alpha += s.mask_mu_2;
           s.mask_for_mul = randomShareWithParty(id_, rgen_);
           
-          s.mask_prod = compute_prod_mask_part1(s.mask_mu_1, preproc.gates[g->in]->mask);
-          s.mask_prod2 = compute_prod_mask_part1(s.mask_output_alpha, preproc.gates[g->in]->mask);
+          s.mask_prod = compute_prod_mask_part1(s.mask_mu_1, expand(preproc.gates[g->in]->mask), sched, incoming);
+          s.mask_prod2 = compute_prod_mask_part1(s.mask_output_alpha, expand(preproc.gates[g->in]->mask), sched, incoming);
           
           relu_states[gate->out] = s;
           break;
@@ -1270,14 +966,14 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
           CmpState s;
           s.mask_output_alpha = randomShareWithParty(id_, rgen_);
           
-          DummyShare<Ring> m1; m1.randomize(prg); s.mask_mu_1 = m1.getRSS(pid);
-          DummyShare<Ring> m2; m2.randomize(prg); s.mask_mu_2 = m2.getRSS(pid);
-          s.beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + m1.secret();
-          s.beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + m2.secret();
+          DummyShare<R> m1; m1.randomize(prg); s.mask_mu_1 = m1.getRSS(pid);
+          DummyShare<R> m2; m2.randomize(prg); s.mask_mu_2 = m2.getRSS(pid);
+          s.beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + m1.secret();
+          s.beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + m2.secret();
           
           s.prev_mask = s.mask_output_alpha;
           s.mask_output_alpha += s.mask_mu_2;
-          s.mask_prod = compute_prod_mask_part1(s.mask_mu_1, preproc.gates[g->in]->mask);
+          s.mask_prod = compute_prod_mask_part1(s.mask_mu_1, expand(preproc.gates[g->in]->mask), sched, incoming);
           
           cmp_states[gate->out] = s;
           break;
@@ -1289,9 +985,9 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
           
           s.r_bits = randomShareWithParty_for_trun(id_, rgen_, tr_indices);
           
-          for(int i=0; i<N; ++i) {
+          for(int i=0; i<kBits; ++i) {
              for(int j=0; j<17; ++j) {
-                Ring val;
+                R val;
                 int idx1 = tr_indices[j].first;
                 int idx2 = tr_indices[j].second;
                 if (id_ == idx1 || id_ == idx2) val = 0;
@@ -1304,23 +1000,23 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
              }
           }
           
-          for(int k=0; k<2; ++k) s.A_chain[k].resize(N);
-          for(int k=0; k<6; ++k) s.B_chain[k].resize(N);
-          for(int k=0; k<6; ++k) s.C_chain[k].resize(N);
-          for(int k=0; k<2; ++k) s.R_final[k].resize(N);
-
-          for(int i=0; i<N; ++i) {
-             s.A_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[0][i], s.bits_matrix[1][i]);
-             s.B_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[5][i], s.bits_matrix[8][i]);
-             s.C_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[11][i], s.bits_matrix[14][i]);
+          for(int k=0; k<2; ++k) s.A_chain[k].resize(kBits);
+          for(int k=0; k<6; ++k) s.B_chain[k].resize(kBits);
+          for(int k=0; k<6; ++k) s.C_chain[k].resize(kBits);
+          for(int k=0; k<2; ++k) s.R_final[k].resize(kBits);
+
+          for(int i=0; i<kBits; ++i) {
+             s.A_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[0][i], s.bits_matrix[1][i], sched, incoming);
+             s.B_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[5][i], s.bits_matrix[8][i], sched, incoming);
+             s.C_chain[0][i] = compute_prod_mask_part1(s.bits_matrix[11][i], s.bits_matrix[14][i], sched, incoming);
           }
           
-          std::vector<ReplicatedShare<Ring>> in1, in2;
+          std::vector<ReplicatedShare<R>> in1, in2;
           for(size_t i=0; i<g->in1.size(); ++i) {
-             in1.push_back(preproc.gates[g->in1[i]]->mask);
-             in2.push_back(preproc.gates[g->in2[i]]->mask);
+             in1.push_back(expand(preproc.gates[g->in1[i]]->mask));
+             in2.push_back(expand(preproc.gates[g->in2[i]]->mask));
           }
-          s.main_dot_mask = compute_prod_mask_dot_part1(in1, in2);
+          s.main_dot_mask = compute_prod_mask_dot_part1(in1, in2, sched, incoming);
           
           trdotp_states[gate->out] = s;
           break;
@@ -1329,234 +1025,489 @@ PreprocCircuit<Ring> OfflineEvaluator::offline_setwire(
       }
     }
 
-    // 通信：第一轮
-    jump_.communicate(*network_, *tpool_);
-    
+    // 通信：第一轮。P0、P1 在这里没有要读的 future，所以每一轮都显式 flush，
+    // 各方的轮次边界才能一致；之后只等待各自需要的三元组通道
+    if (!mul_states.empty() || !dot_states.empty() || !relu_states.empty() ||
+        !cmp_states.empty() || has_trdotp) {
+      sched.flush();
+    }
+
     // ================= Pass 2: 处理阶段 (Process) =================
     for (const auto& gate : level) {
       if (gate->type == utils::GateType::kMul) {
-         compute_prod_mask_part2(mul_states[gate->out], offsets);
-         preproc.gates[gate->out] = std::make_unique<PreprocMultGate<Ring>>(randomShareWithParty(id_, rgen_), mul_states[gate->out]);
+         compute_prod_mask_part2(mul_states[gate->out], incoming);
+         preproc.gates[gate->out] = std::make_unique<PreprocMultGate<R>>(compact(randomShareWithParty(id_, rgen_)), compact(mul_states[gate->out]));
       } else if (gate->type == utils::GateType::kDotprod) {
-         compute_prod_mask_dot_part2(dot_states[gate->out], offsets);
-         preproc.gates[gate->out] = std::make_unique<PreprocDotpGate<Ring>>(randomShareWithParty(id_, rgen_), dot_states[gate->out]);
+         compute_prod_mask_part2(dot_states[gate->out], incoming);
+         preproc.gates[gate->out] = std::make_unique<PreprocDotpGate<R>>(compact(randomShareWithParty(id_, rgen_)), compact(dot_states[gate->out]));
       } else if (gate->type == utils::GateType::kRelu) {
          auto& s = relu_states[gate->out];
-         compute_prod_mask_part2(s.mask_prod, offsets);
-         compute_prod_mask_part2(s.mask_prod2, offsets);
-         preproc.gates[gate->out] = std::make_unique<PreprocReluGate<Ring>>(
-             s.mask_output_alpha, s.mask_prod, s.mask_mu_1, s.mask_mu_2, 
-             s.beta_mu_1, s.beta_mu_2, s.prev_mask, s.mask_prod2, s.mask_for_mul);
+         compute_prod_mask_part2(s.mask_prod, incoming);
+         compute_prod_mask_part2(s.mask_prod2, incoming);
+         preproc.gates[gate->out] = std::make_unique<PreprocReluGate<R>>(
+             compact(s.mask_output_alpha), compact(s.mask_prod), compact(s.mask_mu_1), compact(s.mask_mu_2), 
+             s.beta_mu_1, s.beta_mu_2, compact(s.prev_mask), compact(s.mask_prod2), compact(s.mask_for_mul));
       } else if (gate->type == utils::GateType::kCmp) {
          auto& s = cmp_states[gate->out];
-         compute_prod_mask_part2(s.mask_prod, offsets);
-         preproc.gates[gate->out] = std::make_unique<PreprocCmpGate<Ring>>(
-             s.mask_output_alpha, s.mask_prod, s.mask_mu_1, s.mask_mu_2,
-             s.beta_mu_1, s.beta_mu_2, s.prev_mask);
+         compute_prod_mask_part2(s.mask_prod, incoming);
+         preproc.gates[gate->out] = std::make_unique<PreprocCmpGate<R>>(
+             compact(s.mask_output_alpha), compact(s.mask_prod), compact(s.mask_mu_1), compact(s.mask_mu_2),
+             s.beta_mu_1, s.beta_mu_2, compact(s.prev_mask));
       } else if (gate->type == utils::GateType::kTrdotp) {
          auto& s = trdotp_states[gate->out];
-         for(int i=0; i<N; ++i) {
-            compute_prod_mask_part2(s.A_chain[0][i], offsets);
-            compute_prod_mask_part2(s.B_chain[0][i], offsets);
-            compute_prod_mask_part2(s.C_chain[0][i], offsets);
+         for(int i=0; i<kBits; ++i) {
+            compute_prod_mask_part2(s.A_chain[0][i], incoming);
+            compute_prod_mask_part2(s.B_chain[0][i], incoming);
+            compute_prod_mask_part2(s.C_chain[0][i], incoming);
             
             s.A_chain[0][i] = s.bits_matrix[0][i] + s.bits_matrix[1][i] - s.A_chain[0][i].cosnt_mul(2);
             s.B_chain[0][i] = s.bits_matrix[5][i] + s.bits_matrix[8][i] - s.B_chain[0][i].cosnt_mul(2);
             s.C_chain[0][i] = s.bits_matrix[11][i] + s.bits_matrix[14][i] - s.C_chain[0][i].cosnt_mul(2);
          }
-         compute_prod_mask_dot_part2(s.main_dot_mask, offsets);
+         compute_prod_mask_part2(s.main_dot_mask, incoming);
       }
     }
 
     // 截断操作的后续轮次（流水线处理）
     if (has_trdotp) {
         // Round 1
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.A_chain[1][i] = compute_prod_mask_part1(s.A_chain[0][i], s.bits_matrix[2][i]);
-                    s.B_chain[1][i] = compute_prod_mask_part1(s.B_chain[0][i], s.bits_matrix[6][i]);
-                    s.C_chain[1][i] = compute_prod_mask_part1(s.C_chain[0][i], s.bits_matrix[12][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.A_chain[1][i] = compute_prod_mask_part1(s.A_chain[0][i], s.bits_matrix[2][i], sched, incoming);
+                    s.B_chain[1][i] = compute_prod_mask_part1(s.B_chain[0][i], s.bits_matrix[6][i], sched, incoming);
+                    s.C_chain[1][i] = compute_prod_mask_part1(s.C_chain[0][i], s.bits_matrix[12][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.A_chain[1][i], offsets); s.A_chain[1][i] = s.A_chain[0][i] + s.bits_matrix[2][i] - s.A_chain[1][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.B_chain[1][i], offsets); s.B_chain[1][i] = s.B_chain[0][i] + s.bits_matrix[6][i] - s.B_chain[1][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.C_chain[1][i], offsets); s.C_chain[1][i] = s.C_chain[0][i] + s.bits_matrix[12][i] - s.C_chain[1][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.A_chain[1][i], incoming); s.A_chain[1][i] = s.A_chain[0][i] + s.bits_matrix[2][i] - s.A_chain[1][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.B_chain[1][i], incoming); s.B_chain[1][i] = s.B_chain[0][i] + s.bits_matrix[6][i] - s.B_chain[1][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.C_chain[1][i], incoming); s.C_chain[1][i] = s.C_chain[0][i] + s.bits_matrix[12][i] - s.C_chain[1][i].cosnt_mul(2);
                 }
             }
         }
 
         // Round 2
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.B_chain[2][i] = compute_prod_mask_part1(s.B_chain[1][i], s.bits_matrix[9][i]);
-                    s.C_chain[2][i] = compute_prod_mask_part1(s.C_chain[1][i], s.bits_matrix[15][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.B_chain[2][i] = compute_prod_mask_part1(s.B_chain[1][i], s.bits_matrix[9][i], sched, incoming);
+                    s.C_chain[2][i] = compute_prod_mask_part1(s.C_chain[1][i], s.bits_matrix[15][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.B_chain[2][i], offsets); s.B_chain[2][i] = s.B_chain[1][i] + s.bits_matrix[9][i] - s.B_chain[2][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.C_chain[2][i], offsets); s.C_chain[2][i] = s.C_chain[1][i] + s.bits_matrix[15][i] - s.C_chain[2][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.B_chain[2][i], incoming); s.B_chain[2][i] = s.B_chain[1][i] + s.bits_matrix[9][i] - s.B_chain[2][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.C_chain[2][i], incoming); s.C_chain[2][i] = s.C_chain[1][i] + s.bits_matrix[15][i] - s.C_chain[2][i].cosnt_mul(2);
                 }
             }
         }
 
         // Round 3
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.B_chain[3][i] = compute_prod_mask_part1(s.B_chain[2][i], s.bits_matrix[7][i]);
-                    s.C_chain[3][i] = compute_prod_mask_part1(s.C_chain[2][i], s.bits_matrix[13][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.B_chain[3][i] = compute_prod_mask_part1(s.B_chain[2][i], s.bits_matrix[7][i], sched, incoming);
+                    s.C_chain[3][i] = compute_prod_mask_part1(s.C_chain[2][i], s.bits_matrix[13][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.B_chain[3][i], offsets); s.B_chain[3][i] = s.B_chain[2][i] + s.bits_matrix[7][i] - s.B_chain[3][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.C_chain[3][i], offsets); s.C_chain[3][i] = s.C_chain[2][i] + s.bits_matrix[13][i] - s.C_chain[3][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.B_chain[3][i], incoming); s.B_chain[3][i] = s.B_chain[2][i] + s.bits_matrix[7][i] - s.B_chain[3][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.C_chain[3][i], incoming); s.C_chain[3][i] = s.C_chain[2][i] + s.bits_matrix[13][i] - s.C_chain[3][i].cosnt_mul(2);
                 }
             }
         }
 
         // Round 4
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.B_chain[4][i] = compute_prod_mask_part1(s.B_chain[3][i], s.bits_matrix[10][i]);
-                    s.C_chain[4][i] = compute_prod_mask_part1(s.C_chain[3][i], s.bits_matrix[16][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.B_chain[4][i] = compute_prod_mask_part1(s.B_chain[3][i], s.bits_matrix[10][i], sched, incoming);
+                    s.C_chain[4][i] = compute_prod_mask_part1(s.C_chain[3][i], s.bits_matrix[16][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.B_chain[4][i], offsets); s.B_chain[4][i] = s.B_chain[3][i] + s.bits_matrix[10][i] - s.B_chain[4][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.C_chain[4][i], offsets); s.C_chain[4][i] = s.C_chain[3][i] + s.bits_matrix[16][i] - s.C_chain[4][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.B_chain[4][i], incoming); s.B_chain[4][i] = s.B_chain[3][i] + s.bits_matrix[10][i] - s.B_chain[4][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.C_chain[4][i], incoming); s.C_chain[4][i] = s.C_chain[3][i] + s.bits_matrix[16][i] - s.C_chain[4][i].cosnt_mul(2);
                 }
             }
         }
 
         // Round 5
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.B_chain[5][i] = compute_prod_mask_part1(s.B_chain[4][i], s.bits_matrix[3][i]);
-                    s.C_chain[5][i] = compute_prod_mask_part1(s.C_chain[4][i], s.bits_matrix[4][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.B_chain[5][i] = compute_prod_mask_part1(s.B_chain[4][i], s.bits_matrix[3][i], sched, incoming);
+                    s.C_chain[5][i] = compute_prod_mask_part1(s.C_chain[4][i], s.bits_matrix[4][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.B_chain[5][i], offsets); s.B_chain[5][i] = s.B_chain[4][i] + s.bits_matrix[3][i] - s.B_chain[5][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.C_chain[5][i], offsets); s.C_chain[5][i] = s.C_chain[4][i] + s.bits_matrix[4][i] - s.C_chain[5][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.B_chain[5][i], incoming); s.B_chain[5][i] = s.B_chain[4][i] + s.bits_matrix[3][i] - s.B_chain[5][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.C_chain[5][i], incoming); s.C_chain[5][i] = s.C_chain[4][i] + s.bits_matrix[4][i] - s.C_chain[5][i].cosnt_mul(2);
                 }
             }
         }
 
         // Round 6
-        jump_.reset(); offsets.reset();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
-                for(int i=0; i<N; ++i) {
-                    s.R_final[0][i] = compute_prod_mask_part1(s.B_chain[5][i], s.A_chain[1][i]);
-                    s.R_final[1][i] = compute_prod_mask_part1(s.C_chain[5][i], s.A_chain[1][i]);
+                for(int i=0; i<kBits; ++i) {
+                    s.R_final[0][i] = compute_prod_mask_part1(s.B_chain[5][i], s.A_chain[1][i], sched, incoming);
+                    s.R_final[1][i] = compute_prod_mask_part1(s.C_chain[5][i], s.A_chain[1][i], sched, incoming);
                 }
             }
         }
-        jump_.communicate(*network_, *tpool_);
+        sched.flush();
         for (const auto& gate : level) {
             if (gate->type == utils::GateType::kTrdotp) {
                 auto& s = trdotp_states[gate->out];
                 s.r.init_zero();
                 s.r_trunted_d.init_zero();
-                for(int i=0; i<N; ++i) {
-                    compute_prod_mask_part2(s.R_final[0][i], offsets); s.R_final[0][i] = s.B_chain[5][i] + s.A_chain[1][i] - s.R_final[0][i].cosnt_mul(2);
-                    compute_prod_mask_part2(s.R_final[1][i], offsets); s.R_final[1][i] = s.C_chain[5][i] + s.A_chain[1][i] - s.R_final[1][i].cosnt_mul(2);
+                for(int i=0; i<kBits; ++i) {
+                    compute_prod_mask_part2(s.R_final[0][i], incoming); s.R_final[0][i] = s.B_chain[5][i] + s.A_chain[1][i] - s.R_final[0][i].cosnt_mul(2);
+                    compute_prod_mask_part2(s.R_final[1][i], incoming); s.R_final[1][i] = s.C_chain[5][i] + s.A_chain[1][i] - s.R_final[1][i].cosnt_mul(2);
                     
-                    auto r_sum = s.R_final[0][i] + s.R_final[1][i];
-                    s.r += r_sum.cosnt_mul(1ULL << i);
-                    if (i >= FRACTION) {
-                        s.r_trunted_d += r_sum.cosnt_mul(1ULL << (i - FRACTION));
+                    ReplicatedShare<R> r_sum = s.R_final[0][i] + s.R_final[1][i];
+                    s.r += r_sum.cosnt_mul(R(1) << i);
+                    if (i >= kFraction) {
+                        s.r_trunted_d += r_sum.cosnt_mul(R(1) << (i - kFraction));
                     }
                 }
-                preproc.gates[gate->out] = std::make_unique<PreprocTrDotpGate<Ring>>(
-                    s.r_trunted_d, s.main_dot_mask, s.r);
+                preproc.gates[gate->out] = std::make_unique<PreprocTrDotpGate<R>>(
+                    compact(s.r_trunted_d), compact(s.main_dot_mask), compact(s.r));
             }
         }
-        jump_.reset();
     }
+    sched.finish();
 
     // ================= Pass 3: 本地计算门 (Add, Sub 等) =================
     for (const auto& gate : level) {
       switch (gate->type) {
         case utils::GateType::kAdd: {
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-          preproc.gates[gate->out] = std::make_unique<PreprocGate<Ring>>(
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(
+              preproc.gates[g->in1]->mask + preproc.gates[g->in2]->mask);
+          break;
+        }
+        case utils::GateType::kSub: {
+          const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(
+              preproc.gates[g->in1]->mask - preproc.gates[g->in2]->mask);
+          break;
+        }
+        case utils::GateType::kConstAdd: {
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(preproc.gates[g->in]->mask);
+          break;
+        }
+        case utils::GateType::kConstMul: {
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(preproc.gates[g->in]->mask * g->cval);
+          break;
+        }
+        default: break;
+      }
+    }
+  }
+  return preproc;
+}
+
+// 常数轮预处理：所有乘法类门的 α_xy 只依赖输入 mask，而输出 mask 来自公共随机数，
+// 与通信结果无关，因此整个电路的 compute_prod_mask_part1 可以先全部入队，
+// 再用一次 communicate 统一刷出。截断对 (r, r^d) 与电路输入无关，所有 kTrdotp
+// 门的比特链一起跑固定的 7 轮。总轮数最多 8 轮，与电路深度无关。
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::offline_setwire_const_round(
+    const utils::LevelOrderedCircuit& circ,
+    const std::unordered_map<utils::wire_t, int>& input_pid_map,
+    size_t security_param, int pid, emp::PRG& prg) {
+
+  PreprocCircuit<R> preproc(circ.num_gates, circ.outputs.size());
+  jump_.reset();
+  JumpScheduler sched(jump_, *network_);
+
+  using utils::wire_t;
+
+  std::vector<std::pair<int, int>> tr_indices = {
+      {0,1}, {0,2}, {1,2}, {3,4}, {5,6}, {0,3}, {1,3}, {2,3}, {0,4},
+      {1,4}, {2,4}, {0,5}, {1,5}, {2,5}, {0,6}, {1,6}, {2,6}
+  };
+
+  // ================= Phase A: 截断对，所有 kTrdotp 门一起计算 =================
+  // 每个门每一比特位占用 kNumSlots 个共享：0-16 为 17 个随机比特，
+  // 17-18 为 A 链，19-24 为 B 链，25-30 为 C 链，31-32 为两个最终结果。
+  constexpr int kNumSlots = 33;
+  struct XorStep {
+    int dst, lhs, rhs;
+  };
+  // 与 offline_setwire 中 Round 0 ~ Round 6 的调度一致
+  const std::vector<std::vector<XorStep>> xor_rounds = {
+      {{17, 0, 1}, {19, 5, 8}, {25, 11, 14}},
+      {{18, 17, 2}, {20, 19, 6}, {26, 25, 12}},
+      {{21, 20, 9}, {27, 26, 15}},
+      {{22, 21, 7}, {28, 27, 13}},
+      {{23, 22, 10}, {29, 28, 16}},
+      {{24, 23, 3}, {30, 29, 4}},
+      {{31, 24, 18}, {32, 30, 18}}
+  };
+
+  std::vector<wire_t> trdotp_wires;
+  for (const auto& level : circ.gates_by_level) {
+    for (const auto& gate : level) {
+      if (gate->type == utils::GateType::kTrdotp) {
+        trdotp_wires.push_back(gate->out);
+      }
+    }
+  }
+
+  std::unordered_map<wire_t, std::pair<ReplicatedShare<R>, ReplicatedShare<R>>> trunc_pairs;
+  if (!trdotp_wires.empty()) {
+    std::vector<std::vector<ReplicatedShare<R>>> slots(trdotp_wires.size());
+    for (auto& s : slots) {
+      s.resize(kNumSlots * kBits);
+      auto r_bits = randomShareWithParty_for_trun(id_, rgen_, tr_indices);
+      for (size_t i = 0; i < kBits; ++i) {
+        for (int j = 0; j < 17; ++j) {
+          int idx1 = tr_indices[j].first;
+          int idx2 = tr_indices[j].second;
+          auto& bit = s[j * kBits + i];
+          bit.init_zero();
+          if (id_ == idx1 || id_ == idx2) continue;
+          R val = r_bits[j][upperTriangularToArray(idx1, idx2)];
+          if ((val >> i) & 1ULL) {
+            bit[upperTriangularToArray(idx1, idx2)] = 1;
+          }
+        }
+      }
+    }
+
+    for (const auto& round : xor_rounds) {
+      RingFutures<R> incoming;
+      for (auto& s : slots) {
+        for (size_t i = 0; i < kBits; ++i) {
+          for (const auto& op : round) {
+            s[op.dst * kBits + i] = compute_prod_mask_part1(s[op.lhs * kBits + i], s[op.rhs * kBits + i],
+                                                            sched, incoming);
+          }
+        }
+      }
+      sched.flush();
+      for (auto& s : slots) {
+        for (size_t i = 0; i < kBits; ++i) {
+          for (const auto& op : round) {
+            auto& prod = s[op.dst * kBits + i];
+            compute_prod_mask_part2(prod, incoming);
+            // a xor b = a + b - 2ab
+            prod = s[op.lhs * kBits + i] + s[op.rhs * kBits + i] - prod.cosnt_mul(2);
+          }
+        }
+      }
+    }
+
+    for (size_t g = 0; g < trdotp_wires.size(); ++g) {
+      const auto& s = slots[g];
+      ReplicatedShare<R> r, r_trunted_d;
+      r.init_zero();
+      r_trunted_d.init_zero();
+      for (size_t i = 0; i < kBits; ++i) {
+        ReplicatedShare<R> r_sum = s[31 * kBits + i] + s[32 * kBits + i];
+        r += r_sum.cosnt_mul(R(1) << i);
+        if (i >= kFraction) {
+          r_trunted_d += r_sum.cosnt_mul(R(1) << (i - kFraction));
+        }
+      }
+      trunc_pairs[trdotp_wires[g]] = {r_trunted_d, r};
+    }
+  }
+
+  // ================= Phase B: 按层本地生成 mask，乘法的 part1 全部入队 =================
+  // 门对象提前创建，part1 的本地结果先存在 PendingProd 中，Phase C 补全后写回门的 mask_prod。
+  struct PendingProd {
+    ReplicatedShare<R> mask_prod;
+    CompactShare<R>* out;
+  };
+  std::vector<PendingProd> pending;
+  RingFutures<R> incoming;
+
+  for (const auto& level : circ.gates_by_level) {
+    for (const auto& gate : level) {
+      switch (gate->type) {
+        case utils::GateType::kInp: {
+          auto pregate = std::make_unique<PreprocInput<R>>();
+          auto input_pid = input_pid_map.at(gate->out);
+          pregate->pid = input_pid;
+          if (pid == input_pid) {
+            randomShareWithParty(id_, rgen_, pregate->mask, pregate->mask_value);
+          } else {
+            randomShareWithParty(id_, input_pid, rgen_, pregate->mask);
+          }
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        case utils::GateType::kMul: {
+          const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+          auto pregate = std::make_unique<PreprocMultGate<R>>();
+          pregate->mask = compact(randomShareWithParty(id_, rgen_));
+          pending.push_back({compute_prod_mask_part1(expand(preproc.gates[g->in1]->mask),
+                                                     expand(preproc.gates[g->in2]->mask), sched, incoming),
+                             &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        case utils::GateType::kDotprod: {
+          const auto* g = static_cast<utils::SIMDGate*>(gate.get());
+          std::vector<ReplicatedShare<R>> in1, in2;
+          for (size_t i = 0; i < g->in1.size(); ++i) {
+            in1.push_back(expand(preproc.gates[g->in1[i]]->mask));
+            in2.push_back(expand(preproc.gates[g->in2[i]]->mask));
+          }
+          auto pregate = std::make_unique<PreprocDotpGate<R>>();
+          pregate->mask = compact(randomShareWithParty(id_, rgen_));
+          pending.push_back({compute_prod_mask_dot_part1(in1, in2, sched, incoming), &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        case utils::GateType::kRelu: {
+          const auto* g = static_cast<utils::FIn1Gate*>(gate.get());
+          auto pregate = std::make_unique<PreprocReluGate<R>>();
+          auto mask = randomShareWithParty(id_, rgen_);
+
+          DummyShare<R> m1; m1.randomize(prg); auto mask_mu_1 = m1.getRSS(pid);
+          DummyShare<R> m2; m2.randomize(prg); auto mask_mu_2 = m2.getRSS(pid);
+          pregate->beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + m1.secret();
+          pregate->beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + m2.secret();
+
+          pregate->prev_mask = compact(mask);
+          mask += mask_mu_2;
+          pregate->mask = compact(mask);
+          pregate->mask_mu_1 = compact(mask_mu_1);
+          pregate->mask_mu_2 = compact(mask_mu_2);
+          pregate->mask_for_mul = compact(randomShareWithParty(id_, rgen_));
+
+          auto mask_in = expand(preproc.gates[g->in]->mask);
+          pending.push_back({compute_prod_mask_part1(mask_mu_1, mask_in, sched, incoming), &pregate->mask_prod});
+          pending.push_back({compute_prod_mask_part1(mask, mask_in, sched, incoming), &pregate->mask_prod2});
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        case utils::GateType::kCmp: {
+          const auto* g = static_cast<utils::FIn1Gate*>(gate.get());
+          auto pregate = std::make_unique<PreprocCmpGate<R>>();
+          auto mask = randomShareWithParty(id_, rgen_);
+
+          DummyShare<R> m1; m1.randomize(prg); auto mask_mu_1 = m1.getRSS(pid);
+          DummyShare<R> m2; m2.randomize(prg); auto mask_mu_2 = m2.getRSS(pid);
+          pregate->beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + m1.secret();
+          pregate->beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + m2.secret();
+
+          pregate->prev_mask = compact(mask);
+          mask += mask_mu_2;
+          pregate->mask = compact(mask);
+          pregate->mask_mu_1 = compact(mask_mu_1);
+          pregate->mask_mu_2 = compact(mask_mu_2);
+          pending.push_back({compute_prod_mask_part1(mask_mu_1, expand(preproc.gates[g->in]->mask), sched, incoming),
+                             &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        case utils::GateType::kTrdotp: {
+          const auto* g = static_cast<utils::SIMDGate*>(gate.get());
+          std::vector<ReplicatedShare<R>> in1, in2;
+          for (size_t i = 0; i < g->in1.size(); ++i) {
+            in1.push_back(expand(preproc.gates[g->in1[i]]->mask));
+            in2.push_back(expand(preproc.gates[g->in2[i]]->mask));
+          }
+          const auto& tp = trunc_pairs.at(gate->out);
+          auto pregate = std::make_unique<PreprocTrDotpGate<R>>();
+          pregate->mask = compact(tp.first);
+          pregate->mask_d = compact(tp.second);
+          pending.push_back({compute_prod_mask_dot_part1(in1, in2, sched, incoming), &pregate->mask_prod});
+          preproc.gates[gate->out] = std::move(pregate);
+          break;
+        }
+        default: break;
+      }
+    }
+
+    // 本地门可能依赖同一层乘法门的输出 mask，所以放在乘法门之后处理
+    for (const auto& gate : level) {
+      switch (gate->type) {
+        case utils::GateType::kAdd: {
+          const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(
               preproc.gates[g->in1]->mask + preproc.gates[g->in2]->mask);
           break;
         }
         case utils::GateType::kSub: {
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-          preproc.gates[gate->out] = std::make_unique<PreprocGate<Ring>>(
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(
               preproc.gates[g->in1]->mask - preproc.gates[g->in2]->mask);
           break;
         }
         case utils::GateType::kConstAdd: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
-          preproc.gates[gate->out] = std::make_unique<PreprocGate<Ring>>(preproc.gates[g->in]->mask);
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(preproc.gates[g->in]->mask);
           break;
         }
         case utils::GateType::kConstMul: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
-          preproc.gates[gate->out] = std::make_unique<PreprocGate<Ring>>(preproc.gates[g->in]->mask * g->cval);
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+          preproc.gates[gate->out] = std::make_unique<PreprocGate<R>>(preproc.gates[g->in]->mask * g->cval);
           break;
         }
         default: break;
       }
     }
   }
+
+  // ================= Phase C: 一轮通信，按入队顺序补全 α_xy =================
+  for (auto& p : pending) {
+    compute_prod_mask_part2(p.mask_prod, incoming);
+    *p.out = compact(p.mask_prod);
+  }
+  sched.finish();
   return preproc;
 }
 
-PreprocCircuit<Ring> OfflineEvaluator::dummy(
+template <class R>
+PreprocCircuit<R> OfflineEvaluator<R>::dummy(
     const utils::LevelOrderedCircuit& circ,
     const std::unordered_map<utils::wire_t, int>& input_pid_map,
     size_t security_param, int pid, emp::PRG& prg) {
-  PreprocCircuit<Ring> preproc(circ.num_gates, circ.outputs.size());
+  PreprocCircuit<R> preproc(circ.num_gates, circ.outputs.size());
   auto msb_circ =
       utils::Circuit<BoolRing>::generatePPAMSB().orderGatesByLevel();
 
-  std::vector<DummyShare<Ring>> wires(circ.num_gates);
+  std::vector<DummyShare<R>> wires(circ.num_gates);
   for (const auto& level : circ.gates_by_level) {
     for (const auto& gate : level) {
       switch (gate->type) {
@@ -1564,13 +1515,13 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           wires[gate->out].randomize(prg); //inputGate只有out，随机出5个随机数，存在wires里面
 
           auto input_pid = input_pid_map.at(gate->out); //根据wire_id找输入的pid
-          Ring mask_value = 0; //存的是五个随机数的和
+          R mask_value = 0; //存的是五个随机数的和
           if (pid == input_pid) { //input_pid标记了谁输入，现在轮到标记的pid进行预处理了，他能知道5个随机数的和！
             mask_value = wires[gate->out].secret(); //mask_value = 5个随机数的和
           }
 
-          preproc.gates[gate->out] = std::make_unique<PreprocInput<Ring>>( //预处理门保存RSS，即4个随机值，放在mask成员里面
-              wires[gate->out].getRSS(pid), input_pid, mask_value);
+          preproc.gates[gate->out] = std::make_unique<PreprocInput<R>>( //预处理门保存RSS，即4个随机值，放在mask成员里面
+              wires[gate->out].getCompact(pid), input_pid, mask_value);
           break;
         }
 
@@ -1578,7 +1529,7 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
           wires[g->out] = wires[g->in1] + wires[g->in2]; //wires[g->in1]是其中一个输入，是5个随机值。输入相加，就是随机值的和。说白了就是α的和，后面就只用加β了
           preproc.gates[gate->out] =
-              std::make_unique<PreprocGate<Ring>>(wires[gate->out].getRSS(pid));
+              std::make_unique<PreprocGate<R>>(wires[gate->out].getCompact(pid));
           break;
         }
 
@@ -1586,33 +1537,33 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
           wires[g->out] = wires[g->in1] - wires[g->in2];
           preproc.gates[gate->out] =
-              std::make_unique<PreprocGate<Ring>>(wires[gate->out].getRSS(pid));
+              std::make_unique<PreprocGate<R>>(wires[gate->out].getCompact(pid));
           break;
         }
 
         case utils::GateType::kConstAdd: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
           wires[g->out] = wires[g->in];
           preproc.gates[g->out] =
-              std::make_unique<PreprocGate<Ring>>(wires[g->out].getRSS(pid));
+              std::make_unique<PreprocGate<R>>(wires[g->out].getCompact(pid));
           break;
         }
 
         case utils::GateType::kConstMul: {
-          const auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+          const auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
           wires[g->out] = wires[g->in] * g->cval;
           preproc.gates[g->out] =
-              std::make_unique<PreprocGate<Ring>>(wires[g->out].getRSS(pid));
+              std::make_unique<PreprocGate<R>>(wires[g->out].getCompact(pid));
           break;
         }
         
         case utils::GateType::kMul: {
           const auto* g = static_cast<utils::FIn2Gate*>(gate.get());
           wires[g->out].randomize(prg); //为了生成α_z的共享
-          Ring prod = wires[g->in1].secret() * wires[g->in2].secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
-          preproc.gates[gate->out] = std::make_unique<PreprocMultGate<Ring>>(
-              wires[gate->out].getRSS(pid),
-              DummyShare<Ring>(prod, prg).getRSS(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          R prod = wires[g->in1].secret() * wires[g->in2].secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
+          preproc.gates[gate->out] = std::make_unique<PreprocMultGate<R>>(
+              wires[gate->out].getCompact(pid),
+              DummyShare<R>(prod, prg).getCompact(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
           break;
         }
 
@@ -1620,41 +1571,46 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           const auto* g = static_cast<utils::SIMDGate*>(gate.get());
           wires[g->out].randomize(prg);
 
-          Ring mask_prod = 0;
+          R mask_prod = 0;
           for (size_t i = 0; i < g->in1.size(); i++) {
             mask_prod += wires[g->in1[i]].secret() * wires[g->in2[i]].secret(); //直接把Σ(α1 x α2)计算出来
           }
 
-          DummyShare<Ring> mask_prod_share(mask_prod, prg);
-          preproc.gates[g->out] = std::make_unique<PreprocDotpGate<Ring>>(
-              wires[g->out].getRSS(pid), mask_prod_share.getRSS(pid));
+          DummyShare<R> mask_prod_share(mask_prod, prg);
+          preproc.gates[g->out] = std::make_unique<PreprocDotpGate<R>>(
+              wires[g->out].getCompact(pid), mask_prod_share.getCompact(pid));
           break;
         }
 
         case utils::GateType::kTrdotp: {
           const auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-          DummyShare<Ring> non_trunc_mask;
+          DummyShare<R> non_trunc_mask;
           non_trunc_mask.randomize(prg); //生成一个随机数r的共享[r]
           wires[g->out] =
-              DummyShare<Ring>(non_trunc_mask.secret() >> FRACTION, prg);//得到[r^d]，即r的截断
+              DummyShare<R>(non_trunc_mask.secret() >> kFraction, prg);//得到[r^d]，即r的截断
 
-          Ring mask_prod = 0;
+          R mask_prod = 0;
           for (size_t i = 0; i < g->in1.size(); i++) {
             mask_prod += wires[g->in1[i]].secret() * wires[g->in2[i]].secret(); //直接把最终乘积的结果计算出来
           }
-          DummyShare<Ring> mask_prod_share(mask_prod, prg); //
+          DummyShare<R> mask_prod_share(mask_prod, prg); //
           //生成三个共享，一个是mask，代表[r^d]，即最终的结果r^d的[·]-sharing部分
           //一个是mask_prod，代表[z]，即计算结果的共享[·]-sharing
           //最后一个是mask_d，代表随机数[r]的共享[·]-sharing
-          preproc.gates[g->out] = std::make_unique<PreprocTrDotpGate<Ring>>( 
-              wires[g->out].getRSS(pid), mask_prod_share.getRSS(pid),
-              non_trunc_mask.getRSS(pid));
+          preproc.gates[g->out] = std::make_unique<PreprocTrDotpGate<R>>( 
+              wires[g->out].getCompact(pid), mask_prod_share.getCompact(pid),
+              non_trunc_mask.getCompact(pid));
           break;
         }
 
         //要判断一个数x的正负
         case utils::GateType::kMsb: {
+          // msb_circ 是固定 64 比特输入的 PPA 电路
+          if (kBits != 64) {
+            throw std::invalid_argument(boost::str(
+                boost::format("MSB gates need a 64-bit ring, not %1% bits") % kBits));
+          }
           const auto* msb_g = static_cast<utils::FIn1Gate*>(gate.get()); //一个输入的门
           //先乘一个-1
           auto alpha = 
@@ -1680,7 +1636,7 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
                     mask = DummyShare<BoolRing>(alpha_bits[inp_counter], prg); //把第inp_counter个比特，共享成5个随机数的和
                   }
                   msb_wires[msb_gate->out] = mask; //第i bit的5个共享值
-                  msb_gates[msb_gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getRSS(pid)); //4个共享值，作为输入保存在一个门中，即msb_gates
+                  msb_gates[msb_gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getCompact(pid)); //4个共享值，作为输入保存在一个门中，即msb_gates
                   inp_counter++;
                   break;
                 }
@@ -1689,7 +1645,7 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
                   const auto* g = static_cast<utils::FIn2Gate*>(msb_gate.get());
                   msb_wires[g->out] = msb_wires[g->in1] + msb_wires[g->in2];
                   msb_gates[g->out] = std::make_unique<PreprocGate<BoolRing>>(
-                      msb_wires[g->out].getRSS(pid));
+                      msb_wires[g->out].getCompact(pid));
                   break;
                 }
 
@@ -1701,8 +1657,8 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
 
                   msb_gates[g->out] =
                       std::make_unique<PreprocMultGate<BoolRing>>(
-                          msb_wires[g->out].getRSS(pid),
-                          prod_share.getRSS(pid));
+                          msb_wires[g->out].getCompact(pid),
+                          prod_share.getCompact(pid));
                   break;
                 }
 
@@ -1715,21 +1671,21 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
 
           const auto& out_mask = msb_wires[msb_circ.outputs[0]]; //一个MSB只有一个输出，out_mask代表输出线的掩码
 
-          Ring alpha_msb = out_mask.secret().val();//Σα
-          DummyShare<Ring> mask_msb(alpha_msb, prg);
+          R alpha_msb = out_mask.secret().val();//Σα
+          DummyShare<R> mask_msb(alpha_msb, prg);
 
-          DummyShare<Ring> mask_w;
+          DummyShare<R> mask_w;
           mask_w.randomize(prg);
 
-          Ring alpha_w, alpha_btoa;
+          R alpha_w, alpha_btoa;
           alpha_w = mask_w.secret();
 
           wires[msb_g->out] =
-              static_cast<Ring>(-1) * mask_msb + static_cast<Ring>(-2) * mask_w;
+              static_cast<R>(-1) * mask_msb + static_cast<R>(-2) * mask_w;
 
-          preproc.gates[msb_g->out] = std::make_unique<PreprocMsbGate<Ring>>(
-              wires[msb_g->out].getRSS(pid), std::move(msb_gates), //msb_gates尤为重要，他代表预计算好的MSB所有子门的预计算结果，有443个bool门
-              mask_msb.getRSS(pid), mask_w.getRSS(pid));
+          preproc.gates[msb_g->out] = std::make_unique<PreprocMsbGate<R>>(
+              wires[msb_g->out].getCompact(pid), std::move(msb_gates), //msb_gates尤为重要，他代表预计算好的MSB所有子门的预计算结果，有443个bool门
+              mask_msb.getCompact(pid), mask_w.getCompact(pid));
           break;
         }
 
@@ -1737,27 +1693,27 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           const auto* cmp_g = static_cast<utils::FIn1Gate*>(gate.get()); //一个输入的门
           wires[cmp_g->out].randomize(prg); //随机化输出值的α
 
-          DummyShare<Ring> mask_mu_1; //随机化mu_1
+          DummyShare<R> mask_mu_1; //随机化mu_1
           mask_mu_1.randomize(prg);
-          Ring prod = wires[cmp_g->in].secret() * mask_mu_1.secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
+          R prod = wires[cmp_g->in].secret() * mask_mu_1.secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
 
-          DummyShare<Ring> mask_mu_2; //随机化mu_2
+          DummyShare<R> mask_mu_2; //随机化mu_2
           mask_mu_2.randomize(prg);
 
-          Ring beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_1.secret();
-          Ring beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_2.secret();
+          R beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_1.secret();
+          R beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_2.secret();
 
-          DummyShare<Ring> prev_mask(wires[gate->out]);
+          DummyShare<R> prev_mask(wires[gate->out]);
           wires[gate->out] +=  mask_mu_2;  //alpha提前加好，后续不用加了
           
-          DummyShare<Ring> mask_for_mul; //随机化mu_2
+          DummyShare<R> mask_for_mul; //随机化mu_2
           mask_for_mul.randomize(prg);
 
           //前面做了一次乘法，得到的结果是(x-y)大于0或者小于0，分别代表1和0，这里再做一次乘法，输入(x-y)，则输出relu的结果
-          Ring prod2 = wires[gate->out].secret() * wires[cmp_g->in].secret(); //(x-y)和比较结果z的α做乘法
-          preproc.gates[gate->out] = std::make_unique<PreprocReluGate<Ring>>(
-              wires[gate->out].getRSS(pid), DummyShare<Ring>(prod, prg).getRSS(pid),
-              mask_mu_1.getRSS(pid), mask_mu_2.getRSS(pid), beta_mu_1, beta_mu_2, prev_mask.getRSS(pid), DummyShare<Ring>(prod2, prg).getRSS(pid), mask_for_mul.getRSS(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          R prod2 = wires[gate->out].secret() * wires[cmp_g->in].secret(); //(x-y)和比较结果z的α做乘法
+          preproc.gates[gate->out] = std::make_unique<PreprocReluGate<R>>(
+              wires[gate->out].getCompact(pid), DummyShare<R>(prod, prg).getCompact(pid),
+              mask_mu_1.getCompact(pid), mask_mu_2.getCompact(pid), beta_mu_1, beta_mu_2, prev_mask.getCompact(pid), DummyShare<R>(prod2, prg).getCompact(pid), mask_for_mul.getCompact(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
           break;
         }
 
@@ -1765,23 +1721,23 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
           const auto* cmp_g = static_cast<utils::FIn1Gate*>(gate.get()); //一个输入的门
           wires[cmp_g->out].randomize(prg); //随机化输出值的α
 
-          DummyShare<Ring> mask_mu_1; //随机化mu_1
+          DummyShare<R> mask_mu_1; //随机化mu_1
           mask_mu_1.randomize(prg);
-          Ring prod = wires[cmp_g->in].secret() * mask_mu_1.secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
+          R prod = wires[cmp_g->in].secret() * mask_mu_1.secret(); //直接把关键的prod=(Σα1) x (Σα2)明文计算出来
 
-          DummyShare<Ring> mask_mu_2; //随机化mu_2
+          DummyShare<R> mask_mu_2; //随机化mu_2
           mask_mu_2.randomize(prg);
 
-          Ring beta_mu_1 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_1.secret();
-          Ring beta_mu_2 = generate_specific_bit_random(prg, BITS_BETA) + mask_mu_2.secret();
+          R beta_mu_1 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_1.secret();
+          R beta_mu_2 = generate_specific_bit_random(prg, kBitsBeta) + mask_mu_2.secret();
 
-          DummyShare<Ring> prev_mask(wires[gate->out]);
+          DummyShare<R> prev_mask(wires[gate->out]);
           wires[gate->out] +=  mask_mu_2;  //alpha提前加好，后续不用加了
           //除此之外，还有一个重要的操作，如果(x-y)>0，那么最终需要的α已经有了，但是β无法计算，所以我们需要预先计算好最终结果的β，否则计算不了。
 
-          preproc.gates[gate->out] = std::make_unique<PreprocCmpGate<Ring>>(
-              wires[gate->out].getRSS(pid), DummyShare<Ring>(prod, prg).getRSS(pid),
-              mask_mu_1.getRSS(pid), mask_mu_2.getRSS(pid), beta_mu_1, beta_mu_2, prev_mask.getRSS(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
+          preproc.gates[gate->out] = std::make_unique<PreprocCmpGate<R>>(
+              wires[gate->out].getCompact(pid), DummyShare<R>(prod, prg).getCompact(pid),
+              mask_mu_1.getCompact(pid), mask_mu_2.getCompact(pid), beta_mu_1, beta_mu_2, prev_mask.getCompact(pid)); //然后再把prod 重新share出去，这样下次做乘法，只用线性计算即可
           break;
         }
         default: {
@@ -1794,13 +1750,14 @@ PreprocCircuit<Ring> OfflineEvaluator::dummy(
   return preproc;
 }
 
-std::array<vector<Ring>, 22> OfflineEvaluator::reshare_gen_random_vector(int pid, RandGenPool& rgen, int array_length) {
-  std::array<vector<Ring>, 22> result;
+template <class R>
+std::array<vector<R>, 22> OfflineEvaluator<R>::reshare_gen_random_vector(int pid, RandGenPool& rgen, int array_length) {
+  std::array<vector<R>, 22> result;
   for(int j =  0; j < array_length; j++) {
-    Ring sum_temp = 0;
-    Ring temp;
+    R sum_temp = 0;
+    R temp;
     for(int i = 0; i < 21; i++) {
-      rgen.getComplement(pid).random_data(&temp, sizeof(Ring));
+      rgen.getComplement(pid).random_data(&temp, sizeof(R));
       // temp = temp % (1ULL<<8);
       result[i].push_back(temp);
       sum_temp += temp;
@@ -1810,40 +1767,41 @@ std::array<vector<Ring>, 22> OfflineEvaluator::reshare_gen_random_vector(int pid
   return result;
 }
 
-PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
+template <class R>
+PreprocCircuit_permutation<R> OfflineEvaluator<R>::dummy_permutation(
   const utils::LevelOrderedCircuit& circ,
   const std::unordered_map<utils::wire_t, int>& input_pid_map,
-  size_t security_param, int pid, emp::PRG& prg, vector<Ring>& data_vector, vector<Ring>& permutation_vector) {
+  size_t security_param, int pid, emp::PRG& prg, vector<R>& data_vector, vector<R>& permutation_vector) {
 
   if(data_vector.size() != permutation_vector.size()) {
     throw std::runtime_error("data vector size must be equal to permutation size.");
   }
   uint64_t nf =  data_vector.size();
   int input_pid = INPUT_PERMUTATION;
-  vector<ReplicatedShare<Ring>> data_sharing_vec(nf);
+  vector<ReplicatedShare<R>> data_sharing_vec(nf);
 
   //Firstly, share the data array
-  vector<Ring> mask_value_vec(nf);
+  vector<R> mask_value_vec(nf);
   for(uint64_t i = 0; i<nf ; i++) {
-    DummyShare<Ring> temp;
+    DummyShare<R> temp;
     temp.randomize(prg);
-    Ring mask_value = 0;
+    R mask_value = 0;
     
     if (pid == INPUT_PERMUTATION) { //fix party INPUT_PERMUTATION inputs the data
       mask_value = temp.secret(); //mask_value = 5个随机数的和
     }
     mask_value_vec[i] = mask_value;
     data_sharing_vec[i] = temp.getRSS(pid);
-    // data_sharing_vec[i] = std::make_unique<PreprocInput<Ring>>( //预处理门保存RSS，即4个随机值，放在mask成员里面
+    // data_sharing_vec[i] = std::make_unique<PreprocInput<R>>( //预处理门保存RSS，即4个随机值，放在mask成员里面
     //           temp.getRSS(pid), input_pid, mask_value);
   }
 
   //share the permutation
-  PermutationDummyShare<Ring> temp_dummy_perm_sharing(nf);
+  PermutationDummyShare<R> temp_dummy_perm_sharing(nf);
   temp_dummy_perm_sharing.randomize(prg);
   
-  PermutationShare<Ring> perm_sharing = temp_dummy_perm_sharing.getRSS(pid);
-  preprocg_ptr_t_perm<Ring> perm_share_ptr = std::make_unique<PreprocPermutation<Ring>>(
+  PermutationShare<R> perm_sharing = temp_dummy_perm_sharing.getRSS(pid);
+  preprocg_ptr_t_perm<R> perm_share_ptr = std::make_unique<PreprocPermutation<R>>(
                                                   temp_dummy_perm_sharing.getRSS(pid), 
                                                   input_pid, 
                                                   temp_dummy_perm_sharing.secret()
@@ -1859,12 +1817,12 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
     {4,5}, {4,6},
     {5,6}
   }};
-  vector<vector<Ring>> saved_beta(Index.size());
+  vector<vector<R>> saved_beta(Index.size());
   // sleep(pid);
   // std::cout<<"pid: "<<pid<<endl;
   auto random_vector_array = reshare_gen_random_vector(pid, rgen_, nf);
   for(int i = 0 ; i < Index.size(); i++) { //遍历所有可能性
-    size_t nbytes = sizeof(Ring) * nf;
+    size_t nbytes = sizeof(R) * nf;
     auto [i_temp,j_temp,k_temp,l_temp,m_temp] = findRemainingNumbers_7PC(Index[i][0], Index[i][1]);
     auto n_temp = Index[i][0];
     auto o_temp = Index[i][1];
@@ -1886,7 +1844,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
       
 
       if(pid == k_temp || pid == l_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, j_temp)]);
         }
@@ -1895,7 +1853,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == j_temp || pid == l_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, k_temp)]);
         }
@@ -1904,7 +1862,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == j_temp || pid == k_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, l_temp)]);
         }
@@ -1913,7 +1871,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == l_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, k_temp)]);
         }
@@ -1922,7 +1880,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == k_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, l_temp)]);
         }
@@ -1931,7 +1889,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == j_temp || pid == m_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(k_temp, l_temp)]);
         }
@@ -1940,13 +1898,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == j_temp || pid == k_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, m_temp)]);
         }
         jump_.jumpUpdate(j_temp, k_temp, l_temp, n_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, o_temp)]);
         }
@@ -1954,13 +1912,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == k_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, k_temp, l_temp, n_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, o_temp)]);
         }
@@ -1968,13 +1926,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == j_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(k_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, l_temp, n_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(k_temp, o_temp)]);
         }
@@ -1982,19 +1940,19 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == j_temp || pid == k_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(l_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, k_temp, n_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(l_temp, o_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, k_temp, n_temp, nbytes, alpha_temp1.data());
 
-        vector<Ring> alpha_temp2;
+        vector<R> alpha_temp2;
         for(int j = 0; j<nf; j++) {
           alpha_temp2.push_back(data_sharing_vec[j][upperTriangularToArray(m_temp, o_temp)]);
         }
@@ -2002,13 +1960,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == j_temp || pid == k_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, m_temp)]);
         }
         jump_.jumpUpdate(j_temp, k_temp, l_temp, o_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(i_temp, n_temp)]);
         }
@@ -2016,13 +1974,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == k_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, k_temp, l_temp, o_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(j_temp, n_temp)]);
         }
@@ -2030,13 +1988,13 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == j_temp || pid == l_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(k_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, l_temp, o_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(k_temp, n_temp)]);
         }
@@ -2044,19 +2002,19 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
         // std::cout<<i_temp<<", "<<j_temp<<", "<<k_temp<<", "<<i<<endl;
       }
       if(pid == i_temp || pid == j_temp || pid == k_temp) {
-        vector<Ring> alpha_temp;
+        vector<R> alpha_temp;
         for(int j = 0; j<nf; j++) {
           alpha_temp.push_back(data_sharing_vec[j][upperTriangularToArray(l_temp, m_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, k_temp, o_temp, nbytes, alpha_temp.data());
 
-        vector<Ring> alpha_temp1;
+        vector<R> alpha_temp1;
         for(int j = 0; j<nf; j++) {
           alpha_temp1.push_back(data_sharing_vec[j][upperTriangularToArray(l_temp, n_temp)]);
         }
         jump_.jumpUpdate(i_temp, j_temp, k_temp, o_temp, nbytes, alpha_temp1.data());
 
-        vector<Ring> alpha_temp2;
+        vector<R> alpha_temp2;
         for(int j = 0; j<nf; j++) {
           alpha_temp2.push_back(data_sharing_vec[j][upperTriangularToArray(m_temp, o_temp)]);
         }
@@ -2083,47 +2041,47 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
     
     //update the share
     if(pid == n_temp || pid == o_temp) {
-      vector<Ring> miss_values(nf);
+      vector<R> miss_values(nf);
 
       // 获取数据
-      const auto* temp = reinterpret_cast<const Ring*>(jump_.getValues(k_temp, l_temp, m_temp).data());
+      const auto* temp = reinterpret_cast<const R*>(jump_.getValues(k_temp, l_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(i_temp, j_temp)] = miss_values[j];
       }
 
-      temp = reinterpret_cast<const Ring*>(jump_.getValues(j_temp, l_temp, m_temp).data());
+      temp = reinterpret_cast<const R*>(jump_.getValues(j_temp, l_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(i_temp, k_temp)] = miss_values[j];
       }
 
-      temp = reinterpret_cast<const Ring*>(jump_.getValues(j_temp, k_temp, m_temp).data());
+      temp = reinterpret_cast<const R*>(jump_.getValues(j_temp, k_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(i_temp, l_temp)] = miss_values[j];
       }
 
-      temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, l_temp, m_temp).data());
+      temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, l_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(i_temp, k_temp)] = miss_values[j];
       }
 
-      temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, k_temp, m_temp).data());
+      temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, k_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(j_temp, l_temp)] = miss_values[j];
       }
 
-      temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, m_temp).data());
+      temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, m_temp).data());
       std::copy(temp, temp + nf, miss_values.begin());
       for (size_t j = 0; j < nf; j++) {
           data_sharing_vec[j][upperTriangularToArray(k_temp, l_temp)] = miss_values[j];
       }
 
       if(pid == n_temp) {
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(j_temp, k_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(j_temp, k_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(i_temp, m_temp)] = miss_values[j];
@@ -2133,7 +2091,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(i_temp, o_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, k_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, k_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(j_temp, m_temp)] = miss_values[j];
@@ -2143,7 +2101,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(j_temp, o_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(k_temp, m_temp)] = miss_values[j];
@@ -2153,7 +2111,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(k_temp, o_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, k_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, k_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(l_temp, m_temp)] = miss_values[j];
@@ -2169,7 +2127,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
       }
 
       if(pid == o_temp) {
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(j_temp, k_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(j_temp, k_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(i_temp, m_temp)] = miss_values[j];
@@ -2179,7 +2137,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(i_temp, n_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, k_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, k_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(j_temp, m_temp)] = miss_values[j];
@@ -2189,7 +2147,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(j_temp, n_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, l_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, l_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(k_temp, m_temp)] = miss_values[j];
@@ -2199,7 +2157,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
             data_sharing_vec[j][upperTriangularToArray(k_temp, n_temp)] = miss_values[j];
         }
 
-        temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, k_temp).data());
+        temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, k_temp).data());
         std::copy(temp, temp + nf, miss_values.begin());
         for (size_t j = 0; j < nf; j++) {
             data_sharing_vec[j][upperTriangularToArray(l_temp, m_temp)] = miss_values[j];
@@ -2217,7 +2175,7 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
     jump_.reset(); 
   }
   
-  PreprocCircuit_permutation<Ring> preproc_perm(
+  PreprocCircuit_permutation<R> preproc_perm(
     std::move(data_sharing_vec),
     std::move(perm_share_ptr),
     std::move(saved_beta),
@@ -2226,4 +2184,8 @@ PreprocCircuit_permutation<Ring> OfflineEvaluator::dummy_permutation(
   
 }
 
+template class OfflineEvaluator<Ring32>;
+template class OfflineEvaluator<Ring64>;
+template class OfflineEvaluator<Ring128>;
+
 };  // namespace SemiHoRGod
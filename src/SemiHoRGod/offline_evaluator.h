@@ -7,6 +7,7 @@
 #include <emp-tool/emp-tool.h>
 #include <map>
 #include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -14,29 +15,26 @@
 #include "../io/netmp.h"
 #include "../utils/circuit.h"
 #include "ijmp.h"
+#include "jump_scheduler.h"
 #include "preproc.h"
 #include "rand_gen_pool.h"
 #include "sharing.h"
 #include "types.h"
 using namespace SemiHoRGod;
 namespace SemiHoRGod {
-// Helper struct for managing buffer offsets in 7PC
-struct ChannelOffsets {
-    std::map<std::tuple<int, int, int>, size_t> offsets;
-
-    size_t getAndIncrement(int i, int j, int k) {
-        auto key = std::make_tuple(i, j, k);
-        size_t off = offsets[key];
-        offsets[key] += sizeof(Ring);
-        return off;
-    }
-    
-    void reset() {
-        offsets.clear();
-    }
-};
+// Incoming slices issued by the *_part1 functions through a JumpScheduler,
+// consumed in the same order by compute_prod_mask_part2.
+template <class R>
+using RingFutures = std::deque<JumpFuture<R>>;
 
+// Instantiated for Ring32, Ring64 and Ring128 (see offline_evaluator.cpp).
+template <class R>
 class OfflineEvaluator {
+  // Fixed-point parameters of R.
+  static constexpr size_t kBits = FixedPoint<R>::kBits;
+  static constexpr size_t kFraction = FixedPoint<R>::kFraction;
+  static constexpr size_t kBitsBeta = FixedPoint<R>::kBitsBeta;
+
   int id_;
   int security_param_;
   RandGenPool rgen_;
@@ -45,13 +43,13 @@ class OfflineEvaluator {
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network_ot_;
   utils::LevelOrderedCircuit circ_;
   std::shared_ptr<ThreadPool> tpool_;
-  PreprocCircuit<Ring> preproc_;
+  PreprocCircuit<R> preproc_;
   ImprovedJmp jump_;
 
   // Data members used for book-keeping across methods.
   std::vector<utils::FIn2Gate> mult_gates_;
-  std::array<std::vector<Ring>, 3> ab_terms_;
-  std::array<std::vector<Ring>, 6> c_terms_;
+  std::array<std::vector<R>, 3> ab_terms_;
+  std::array<std::vector<R>, 6> c_terms_;
 
   // Used for running common coin protocol. Returns common random PRG key which
   // is then used to generate randomness for common coin output.
@@ -66,47 +64,57 @@ class OfflineEvaluator {
                    int threads, int seed = 200);
 
   //reconstruct protocol
-  std::vector<Ring> elementwise_sum(const std::array<std::vector<Ring>, NUM_RSS>& recon_shares, int i, int j, int k);
-  std::vector<Ring> reconstruct(const std::array<std::vector<Ring>, NUM_RSS>& recon_shares);
-  std::vector<Ring> reconstruct(const std::vector<ReplicatedShare<Ring>>& shares);
+  std::vector<R> reconstruct(const ShareMatrix<R>& recon_shares);
+  std::vector<R> reconstruct(const std::vector<ReplicatedShare<R>>& shares);
 
   // Generate sharing of a random unknown value.
-  static void randomShare(RandGenPool& rgen, ReplicatedShare<Ring>& share);
+  static void randomShare(RandGenPool& rgen, ReplicatedShare<R>& share);
   // Generate sharing of a random value known to dealer (called by all parties
   // except the dealer).
   static void randomShareWithParty(int id, int dealer, RandGenPool& rgen,
-                                   ReplicatedShare<Ring>& share);
+                                   ReplicatedShare<R>& share);
   // Generate sharing of a random value known to party. Should be called by
   // dealer when other parties call other variant.
-  static void randomShareWithParty(int id, RandGenPool& rgen, ReplicatedShare<Ring>& share, Ring& secret);
+  static void randomShareWithParty(int id, RandGenPool& rgen, ReplicatedShare<R>& share, R& secret);
+  // Same as above, keeping only the elements party `id` holds.
+  static void randomShareWithParty(int id, int dealer, RandGenPool& rgen,
+                                   CompactShare<R>& share);
+  static void randomShareWithParty(int id, RandGenPool& rgen, CompactShare<R>& share, R& secret);
+
+  // Preprocessed gates store CompactShares; the subprotocols below work on
+  // full ReplicatedShares of this party.
+  [[nodiscard]] ReplicatedShare<R> expand(const CompactShare<R>& share) const {
+    return share.expand(id_);
+  }
+  [[nodiscard]] CompactShare<R> compact(const ReplicatedShare<R>& share) const {
+    return CompactShare<R>(share, id_);
+  }
   
-  ReplicatedShare<Ring> jshShare(int id, RandGenPool& rgen, int i, int j, int k);
+  ReplicatedShare<R> jshShare(int id, RandGenPool& rgen, int i, int j, int k);
   
   // Generate sharing of a random value, party i don't know the secret x_i
-  ReplicatedShare<Ring> randomShareWithParty(int id, RandGenPool& rgen);
+  ReplicatedShare<R> randomShareWithParty(int id, RandGenPool& rgen);
   // Following methods implement various preprocessing subprotocols.
 
   // Generate the random number r1, r2, r3, where number_random_id ∈ {0,1,2}
-  std::vector<ReplicatedShare<Ring>> randomShareWithParty_for_trun(int id, RandGenPool& rgen, std::vector<std::pair<int, int>> indices);
-  //Used for multiplication to compute α_{xy}
-  ReplicatedShare<Ring> compute_prod_mask(ReplicatedShare<Ring> mask_in1, ReplicatedShare<Ring> mask_in2);
-  ReplicatedShare<Ring> compute_prod_mask_part1(ReplicatedShare<Ring> mask_in1, ReplicatedShare<Ring> mask_in2);
-  void compute_prod_mask_part2(ReplicatedShare<Ring>& mask_prod, size_t idx);
-
-  ReplicatedShare<Ring> compute_prod_mask_dot(vector<ReplicatedShare<Ring>> mask_in1, vector<ReplicatedShare<Ring>> mask_in2);
-  ReplicatedShare<Ring> compute_prod_mask_dot_part1(vector<ReplicatedShare<Ring>> mask_in1_vec, vector<ReplicatedShare<Ring>> mask_in2_vec);
-  void compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_prod, size_t idx);
-  // === 新增这两个声明 ===
-  void compute_prod_mask_part2(ReplicatedShare<Ring>& mask_prod, ChannelOffsets& offsets);
-  void compute_prod_mask_dot_part2(ReplicatedShare<Ring>& mask_prod, ChannelOffsets& offsets);
-  // ======================
-
-  //given sharings of three random number r1, r2, r3, generating the every bit sharing of r = r1 xor r2 xor r3
-  ReplicatedShare<Ring> bool_mul(ReplicatedShare<Ring> a, ReplicatedShare<Ring> b);
-  ReplicatedShare<Ring> bool_mul_by_indices(vector<ReplicatedShare<Ring>> r_mask_vec, vector<int> indices);
-  std::tuple<vector<ReplicatedShare<Ring>>, vector<ReplicatedShare<Ring>>> comute_random_r_every_bit_sharing(int id, 
-                                                                                                            vector<ReplicatedShare<Ring>> r_mask_vec, 
-                                                                                                            std::vector<std::pair<int, int>> indices);
+  std::vector<ReplicatedShare<R>> randomShareWithParty_for_trun(int id, RandGenPool& rgen, std::vector<std::pair<int, int>> indices);
+  //Used for multiplication to compute α_{xy}. The updates go through `sched` and the
+  // incoming slices are appended to `incoming`; compute_prod_mask_part2 completes them.
+  ReplicatedShare<R> compute_prod_mask_part1(ReplicatedShare<R> mask_in1, ReplicatedShare<R> mask_in2,
+                                                JumpScheduler& sched, RingFutures<R>& incoming);
+  ReplicatedShare<R> compute_prod_mask_dot_part1(vector<ReplicatedShare<R>> mask_in1_vec, vector<ReplicatedShare<R>> mask_in2_vec,
+                                                    JumpScheduler& sched, RingFutures<R>& incoming);
+  // Second half of both the product and the dot product; pops this gate's
+  // slices from `incoming` in the order part1 issued them.
+  void compute_prod_mask_part2(ReplicatedShare<R>& mask_prod, RingFutures<R>& incoming);
+
+  // *a = *a xor b for every pair (a + b - 2ab on bit sharings); all products share one round
+  void bool_mul(const std::vector<std::pair<ReplicatedShare<R>*, ReplicatedShare<R>>>& ops, JumpScheduler& sched);
+  //given sharings of 17 random numbers, generating the every bit sharing of r_1 and r_2 (r = r_1 + r_2)
+  std::tuple<vector<ReplicatedShare<R>>, vector<ReplicatedShare<R>>> comute_random_r_every_bit_sharing(int id, 
+                                                                                                            vector<ReplicatedShare<R>> r_mask_vec, 
+                                                                                                            std::vector<std::pair<int, int>> indices,
+                                                                                                            JumpScheduler& sched);
                                                                                             
 
   // Computes S_1 and S_2 summands.
@@ -122,34 +130,57 @@ class OfflineEvaluator {
   // Compute output commitments. Should be called after 'combineCrossTerms'.
   void computeOutputCommitments();
 
-  PreprocCircuit<Ring> getPreproc();
+  PreprocCircuit<R> getPreproc();
+
+  // Only one sender per jump ships the payload, the other two send digests.
+  void setSingleValueSender(bool enable) { jump_.setSingleValueSender(enable); }
+  // Assignment of value and digest duties within each jump sender triple.
+  void setJumpRolePolicy(JumpRolePolicy policy, size_t replan_interval = 0) {
+    jump_.setRolePolicy(policy, replan_interval);
+  }
+  // Measures all links for JumpRolePolicy::kBandwidthAware. Called by all
+  // parties between rounds.
+  void probeJumpLinks(size_t nbytes = 1 << 20) { jump_.probeLinks(*network_, nbytes); }
+  // Jump rounds complete on the first consistent value instead of waiting
+  // for all three senders.
+  void setFirstArrival(bool enable) { jump_.setFirstArrival(enable); }
+  // Jump rounds this evaluator has run so far.
+  uint64_t jumpRounds() const { return jump_.rounds(); }
 
   // Efficiently runs above subprotocols.
-  PreprocCircuit<Ring> run(const utils::LevelOrderedCircuit& circ,
+  PreprocCircuit<R> run(const utils::LevelOrderedCircuit& circ,
     const std::unordered_map<utils::wire_t, int>& input_pid_map,
     size_t security_param, int pid, emp::PRG& prg);
 
   // secure preprocessing
-  PreprocCircuit<Ring> offline_setwire(
+  PreprocCircuit<R> offline_setwire(
+      const utils::LevelOrderedCircuit& circ,
+      const std::unordered_map<utils::wire_t, int>& input_pid_map,
+      size_t security_param, int pid, emp::PRG& prg);
+  PreprocCircuit<R> offline_setwire_no_batch(
       const utils::LevelOrderedCircuit& circ,
       const std::unordered_map<utils::wire_t, int>& input_pid_map,
       size_t security_param, int pid, emp::PRG& prg);
-  PreprocCircuit<Ring> offline_setwire_no_batch(
+  // Equivalent to offline_setwire, but not bit-identical: it draws from rgen_
+  // in a different order, so the masks differ. The number of communication
+  // rounds does not grow with circuit depth: all product masks are flushed in
+  // a single round after the truncation pairs (at most 7 rounds) are ready.
+  PreprocCircuit<R> offline_setwire_const_round(
       const utils::LevelOrderedCircuit& circ,
       const std::unordered_map<utils::wire_t, int>& input_pid_map,
       size_t security_param, int pid, emp::PRG& prg);
 
   // Insecure preprocessing. All preprocessing data is generated in clear but
   // cast in a form that can be used in the online phase.
-  static PreprocCircuit<Ring> dummy(
+  static PreprocCircuit<R> dummy(
       const utils::LevelOrderedCircuit& circ,
       const std::unordered_map<utils::wire_t, int>& input_pid_map,
       size_t security_param, int pid, emp::PRG& prg);
   
-  std::array<vector<Ring>, 22> reshare_gen_random_vector(int pid, RandGenPool& rgen, int array_length);
-  PreprocCircuit_permutation<Ring> dummy_permutation(
+  std::array<vector<R>, 22> reshare_gen_random_vector(int pid, RandGenPool& rgen, int array_length);
+  PreprocCircuit_permutation<R> dummy_permutation(
       const utils::LevelOrderedCircuit& circ,
       const std::unordered_map<utils::wire_t, int>& input_pid_map,
-      size_t security_param, int pid, emp::PRG& prg, vector<Ring>& data_vector, vector<Ring>& permutation_vector);
+      size_t security_param, int pid, emp::PRG& prg, vector<R>& data_vector, vector<R>& permutation_vector);
 };
 };  // namespace SemiHoRGod
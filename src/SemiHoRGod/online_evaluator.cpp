@@ -1,12 +1,16 @@
 #include "online_evaluator.h"
+
 #include <array>
+#include <limits>
+#include <unordered_set>
 using namespace SemiHoRGod;
 namespace SemiHoRGod {
-OnlineEvaluator::OnlineEvaluator(int id,  //复制创建评估器
-                                 std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                                 PreprocCircuit<Ring> preproc,
-                                 utils::LevelOrderedCircuit circ,
-                                 int security_param, int threads, int seed)
+template <class R>
+OnlineEvaluator<R>::OnlineEvaluator(int id,  //复制创建评估器
+                                    std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
+                                    PreprocCircuit<R> preproc,
+                                    utils::LevelOrderedCircuit circ,
+                                    int security_param, int threads, int seed)
     : id_(id),
       security_param_(security_param),
       rgen_(id, seed),
@@ -20,12 +24,13 @@ OnlineEvaluator::OnlineEvaluator(int id,  //复制创建评估器
   tpool_ = std::make_shared<ThreadPool>(threads);
 }
 
-OnlineEvaluator::OnlineEvaluator(int id,
-                                 std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                                 PreprocCircuit<Ring> preproc,
-                                 utils::LevelOrderedCircuit circ,
-                                 int security_param,
-                                 std::shared_ptr<ThreadPool> tpool, int seed)
+template <class R>
+OnlineEvaluator<R>::OnlineEvaluator(int id,
+                                    std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
+                                    PreprocCircuit<R> preproc,
+                                    utils::LevelOrderedCircuit circ,
+                                    int security_param,
+                                    std::shared_ptr<ThreadPool> tpool, int seed)
     : id_(id),
       security_param_(security_param),
       rgen_(id, seed),
@@ -36,11 +41,12 @@ OnlineEvaluator::OnlineEvaluator(int id,
       wires_(circ.num_gates),
       jump_(id) {}
 
-OnlineEvaluator::OnlineEvaluator(int id,  //复制创建评估器
-                                 std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                                 PreprocCircuit_permutation<Ring> preproc_perm,
-                                 utils::LevelOrderedCircuit circ,
-                                 int security_param, int threads, int seed)
+template <class R>
+OnlineEvaluator<R>::OnlineEvaluator(int id,  //复制创建评估器
+                                    std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
+                                    PreprocCircuit_permutation<R> preproc_perm,
+                                    utils::LevelOrderedCircuit circ,
+                                    int security_param, int threads, int seed)
     : id_(id),
       security_param_(security_param),
       rgen_(id, seed),
@@ -51,15 +57,18 @@ OnlineEvaluator::OnlineEvaluator(int id,  //复制创建评估器
   tpool_ = std::make_shared<ThreadPool>(threads);
 }
 
-void OnlineEvaluator::setInputs(
-    const std::unordered_map<utils::wire_t, Ring>& inputs) { //映射：从wire_id -> values
+template <class R>
+void OnlineEvaluator<R>::setInputs(
+    const std::unordered_map<utils::wire_t, R>& inputs) { //映射：从wire_id -> values
+  // 下面会直接使用网络，先等 jump 的后台接收结束
+  jump_.drain();
   // Input gates have depth 0.
-  std::vector<Ring> my_betas;
+  std::vector<R> my_betas;
   std::vector<size_t> num_inp_pid(NUM_PARTIES, 0);
 
   for (auto& g : circ_.gates_by_level[0]) { //每一层都是一个门数组，g是一个门，std::vector<std::vector<gate_ptr_t>> gates_by_level
     if (g->type == utils::GateType::kInp) {
-      auto* pre_input = static_cast<PreprocInput<Ring>*>(preproc_.gates[g->out].get()); //g->out 是一个wire_t = size_t类型，64bit无符号整数
+      auto* pre_input = static_cast<PreprocInput<R>*>(preproc_.gates[g->out].get()); //g->out 是一个wire_t = size_t类型，64bit无符号整数
       auto pid = pre_input->pid;
       //输出的pre_input->mask是一个RSS秘密共享！
       num_inp_pid[pid]++; //记录某个pid的输入数量
@@ -70,14 +79,14 @@ void OnlineEvaluator::setInputs(
   }
   
   //下面作为数据的拥有者，需要发送数据给其他4个参与方，发送的数据就是my_betas。同时还需要从另外四个参与方接收数据
-  std::vector<std::vector<Ring>> all_recv_betas; // 保存所有 prev_beta 的向量
+  std::vector<std::vector<R>> all_recv_betas; // 保存所有 prev_beta 的向量
   // 为每个 recv_pid 初始化 recv_beta
   for (int recv_pid = 0; recv_pid < NUM_PARTIES; ++recv_pid) {
       // 根据 num_inp_pid[recv_pid] 初始化 recv_beta
-      std::vector<Ring> recv_beta(num_inp_pid[recv_pid]);
+      std::vector<R> recv_beta(num_inp_pid[recv_pid]);
       
       // 可以在这里初始化 recv_beta 的内容（如果需要）
-      // 例如：std::fill(recv_beta.begin(), recv_beta.end(), Ring(/*初始化值*/));
+      // 例如：std::fill(recv_beta.begin(), recv_beta.end(), R(/*初始化值*/));
       
       // 保存到总向量中
       all_recv_betas.push_back(recv_beta);
@@ -91,8 +100,8 @@ void OnlineEvaluator::setInputs(
       if (!my_betas.empty()) {
         res.push_back(tpool_->enqueue([&]() {
           // network_->sendRelative(1, my_betas.data(), //1代表偏移量，如果发送方是2，那么给3发消息
-          //                       my_betas.size() * sizeof(Ring));
-          network_->send(recv_pid, my_betas.data(), my_betas.size() * sizeof(Ring));
+          //                       my_betas.size() * sizeof(R));
+          network_->send(recv_pid, my_betas.data(), my_betas.size() * sizeof(R));
           network_->flush(recv_pid);
         }));
       }
@@ -103,7 +112,7 @@ void OnlineEvaluator::setInputs(
       if (num_inp_pid[recv_pid] != 0) {
         res.push_back(tpool_->enqueue([&]() {
           //send_pid代表谁发来的数据，然后接收保存到prev_betas数组中
-          network_->recv(recv_pid, all_recv_betas[recv_pid].data(), all_recv_betas[recv_pid].size() * sizeof(Ring));
+          network_->recv(recv_pid, all_recv_betas[recv_pid].data(), all_recv_betas[recv_pid].size() * sizeof(R));
         }));
       }
     }
@@ -116,14 +125,14 @@ void OnlineEvaluator::setInputs(
   for (auto& g : circ_.gates_by_level[0]) {
     if (g->type == utils::GateType::kInp) { //如果是输入门，那么设置输出为输入值
       auto* pre_input =
-          static_cast<PreprocInput<Ring>*>(preproc_.gates[g->out].get());
+          static_cast<PreprocInput<R>*>(preproc_.gates[g->out].get());
       auto pid = pre_input->pid;
 
       if (pid == id_) {//如果pid是自己，自己就是数据发送方，自然知道β
         wires_[g->out] = my_betas[pid_inp_idx[pid]];
       } 
       else { //如果pid不是自己，那么接收其他人发来的β
-        // const auto* values = reinterpret_cast<const Ring*>(
+        // const auto* values = reinterpret_cast<const R*>(
         //     jump_.getValues(pid, pidFromOffset(pid, 1)).data());
         wires_[g->out] = all_recv_betas[pid][pid_inp_idx[pid]];
       }
@@ -134,21 +143,24 @@ void OnlineEvaluator::setInputs(
 }
 
 
-void OnlineEvaluator::setBetaVectors(const std::vector<Ring>& my_betas, const std::vector<Ring>& my_beta_perm) {
+template <class R>
+void OnlineEvaluator<R>::setBetaVectors(const std::vector<R>& my_betas, const std::vector<R>& my_beta_perm) {
   // 每个参与方都有 my_betas_ 和 my_betas_perm_
 }
 
-void OnlineEvaluator::setInputs_perm(vector<Ring> data_vector, vector<Ring> permutation_vector) { //映射：从wire_id -> values
+template <class R>
+void OnlineEvaluator<R>::setInputs_perm(vector<R> data_vector, vector<R> permutation_vector) { //映射：从wire_id -> values
+  jump_.drain();
   
-  vector<ReplicatedShare<Ring>> data_sharing_vec = preproc_perm_.data_;
-  PreprocPermutation<Ring> pre_input_perm =  *preproc_perm_.permutation_;
-  vector<Ring> mask_value_vec = preproc_perm_.mask_value_vec_;
+  vector<ReplicatedShare<R>> data_sharing_vec = preproc_perm_.data_;
+  PreprocPermutation<R> pre_input_perm =  *preproc_perm_.permutation_;
+  vector<R> mask_value_vec = preproc_perm_.mask_value_vec_;
   int nf = data_sharing_vec.size();
   data_sharing_vec_ = std::move(data_sharing_vec);
 
   // Input gates have depth 0.
-  std::vector<Ring> my_betas;
-  std::vector<Ring> my_beta_perm;
+  std::vector<R> my_betas;
+  std::vector<R> my_beta_perm;
   int input_pid = INPUT_PERMUTATION;
   
   if(id_ == input_pid) {
@@ -171,13 +183,12 @@ void OnlineEvaluator::setInputs_perm(vector<Ring> data_vector, vector<Ring> perm
           size_t size_betas = my_betas.size();
           size_t size_perm  = my_beta_perm.size();
 
-          network_->send(pid, &size_betas, sizeof(size_t));
-          network_->send(pid, &size_perm, sizeof(size_t));
-
-          // 发数据
-          network_->send(pid, my_betas.data(), size_betas * sizeof(Ring));
-          network_->send(pid, my_beta_perm.data(), size_perm * sizeof(Ring));
-          network_->flush(pid);
+          // 长度和数据合成一次 sendv 发出
+          std::array<struct iovec, 4> iov{{{&size_betas, sizeof(size_t)},
+                                           {&size_perm, sizeof(size_t)},
+                                           {my_betas.data(), size_betas * sizeof(R)},
+                                           {my_beta_perm.data(), size_perm * sizeof(R)}}};
+          network_->sendv(pid, iov.data(), iov.size());
         }));
       }
     }
@@ -196,34 +207,41 @@ void OnlineEvaluator::setInputs_perm(vector<Ring> data_vector, vector<Ring> perm
     my_betas_.resize(size_betas);
     my_betas_perm_.resize(size_perm);
 
-    network_->recv(INPUT_PERMUTATION, my_betas_.data(), size_betas * sizeof(Ring));
-    network_->recv(INPUT_PERMUTATION, my_betas_perm_.data(), size_perm * sizeof(Ring));
+    network_->recv(INPUT_PERMUTATION, my_betas_.data(), size_betas * sizeof(R));
+    network_->recv(INPUT_PERMUTATION, my_betas_perm_.data(), size_perm * sizeof(R));
   }
   jump_.reset();
 }
 
-void OnlineEvaluator::setRandomInputs() {
+template <class R>
+void OnlineEvaluator<R>::setRandomInputs() {
   // Input gates have depth 0.
   std::random_device rd;       // 真随机数种子（硬件熵源）
   std::mt19937 gen(rd());      // Mersenne Twister 伪随机数引擎
   std::uniform_int_distribution<> dis(0, 100); // 均匀分布 [0, 100]
   for (auto& g : circ_.gates_by_level[0]) {
     if (g->type == utils::GateType::kInp) {
-      // rgen_.all().random_data(&wires_[g->out], sizeof(Ring));
+      // rgen_.all().random_data(&wires_[g->out], sizeof(R));
       wires_[g->out] = dis(gen);
     }
   }
 }
 
-std::array<std::vector<Ring>, NUM_RSS> OnlineEvaluator::msbEvaluate(
+template <class R>
+std::array<std::vector<R>, NUM_RSS> OnlineEvaluator<R>::msbEvaluate(
     const std::vector<utils::FIn1Gate>& msb_gates) { //msb门全部在这个向量里，就是直接push进去的
+  // msb_circ_ 是固定 64 比特输入的 PPA 电路
+  if (FixedPoint<R>::kBits != 64) {
+    throw std::invalid_argument(boost::str(
+        boost::format("MSB gates need a 64-bit ring, not %1% bits") % FixedPoint<R>::kBits));
+  }
   auto num_msb_gates = msb_gates.size();
   std::vector<preprocg_ptr_t<BoolRing>*> vpreproc(num_msb_gates);
 
   // Iterate through preproc_ and extract info of msb gates.
   std::vector<utils::wire_t> win(num_msb_gates);
   for (size_t i = 0; i < num_msb_gates; ++i) {
-    auto* pre_msb = static_cast<PreprocMsbGate<Ring>*>(
+    auto* pre_msb = static_cast<PreprocMsbGate<R>*>(
         preproc_.gates[msb_gates[i].out].get());
     //每个MSB门预处理的数据，都放在vpreproc
     vpreproc[i] = pre_msb->msb_gates.data(); //.data()是把指针返回，对应vpreproc[i]需要指针
@@ -239,11 +257,8 @@ std::array<std::vector<Ring>, NUM_RSS> OnlineEvaluator::msbEvaluate(
     for (size_t j = 0; j < msb_circ_.gates_by_level[0].size(); ++j) { //第零层全是输入，只处理第0层
       const auto& gate = msb_circ_.gates_by_level[0][j];
 
-      if (gate->type == utils::GateType::kInp) {
-        bool_eval.vwires[i][gate->out] = 0;
-        if (gate->out > 63) {
-          bool_eval.vwires[i][gate->out] = val_bits[j - 64];
-        }
+      if (gate->type == utils::GateType::kInp && gate->out > 63) {
+        bool_eval.setWire(i, gate->out, val_bits[j - 64]);
       }
     }
   }
@@ -251,7 +266,7 @@ std::array<std::vector<Ring>, NUM_RSS> OnlineEvaluator::msbEvaluate(
   bool_eval.evaluateAllLevels(*network_, jump_, *tpool_);
   auto output_shares = bool_eval.getOutputShares(*network_, jump_, *tpool_);//这里直接重构得到了比较结果了
 
-  std::vector<Ring> output_share_val(num_msb_gates);
+  std::vector<R> output_share_val(num_msb_gates);
   for (size_t i = 0; i < num_msb_gates; ++i) {
     if (output_shares[i][0].val()) {
       output_share_val[i] = 1;
@@ -262,17 +277,18 @@ std::array<std::vector<Ring>, NUM_RSS> OnlineEvaluator::msbEvaluate(
   }
 
   // Bit to A.
-  std::array<std::vector<Ring>, NUM_RSS> outputs;
+  std::array<std::vector<R>, NUM_RSS> outputs;
   for (size_t i = 0; i < num_msb_gates; ++i) {
-    auto* pre_msb = static_cast<PreprocMsbGate<Ring>*>(
+    auto* pre_msb = static_cast<PreprocMsbGate<R>*>(
         preproc_.gates[msb_gates[i].out].get());
-    auto beta_w = pre_msb->mask_w + (pre_msb->mask_msb * output_share_val[i]); //output_share_val[i]是结果，
-    beta_w *= static_cast<Ring>(-2);
+    CompactShare<R> beta_w = (pre_msb->mask_w + pre_msb->mask_msb * output_share_val[i]) *
+                                static_cast<R>(-2); //output_share_val[i]是结果，
+    auto beta_w_share = beta_w.expand(id_);
     // beta_w.add(output_share_val[i], id_);
     msb_temp_value_ = output_share_val[i];
 
     for (int j = 0; j < NUM_RSS; ++j) {
-      outputs[j].push_back(beta_w[j]);
+      outputs[j].push_back(beta_w_share[j]);
     }
   }
   // std::cout<<"参与方"<<id_<<"进行B2A后的比较共享值为:"<<endl;
@@ -283,45 +299,32 @@ std::array<std::vector<Ring>, NUM_RSS> OnlineEvaluator::msbEvaluate(
   return outputs;
 }
 
-std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<Ring>, NUM_RSS>& recon_shares, int i, int j, int k) {
-    // 检查向量是否非空且大小一致
-    if (recon_shares[i].empty()) return {};
-    size_t size = recon_shares[i].size();
-    assert(recon_shares[j].size() == size && recon_shares[k].size() == size);
-    
-    std::vector<Ring> result(size);
-    for (size_t index = 0; index < size; ++index) {
-        result[index] = recon_shares[i][index] + recon_shares[j][index] + recon_shares[k][index];
-    }
-    return result;
-}
-
-// std::vector<Ring> OnlineEvaluator::reconstruct(
-//     const std::array<std::vector<Ring>, NUM_RSS>& recon_shares) {
+// std::vector<R> OnlineEvaluator::reconstruct(
+//     const std::array<std::vector<R>, NUM_RSS>& recon_shares) {
 //   // All vectors in recon_shares should have same size.
 //   size_t num = recon_shares[0].size();
-//   size_t nbytes = sizeof(Ring) * num;
+//   size_t nbytes = sizeof(R) * num;
 
 //   if (nbytes == 0) {
 //     return {};
 //   }
 
-//   std::vector<Ring> vres(num);
-//   // std::vector<Ring> vres2(num);
-//   // std::vector<Ring> result(num);
+//   std::vector<R> vres(num);
+//   // std::vector<R> vres2(num);
+//   // std::vector<R> result(num);
   
 //   switch (id_) {
 //     case 0: { //3个数据
 //       //round 1
-//       vector<Ring> z_1(num);
-//       vector<Ring> z_2(num);
+//       vector<R> z_1(num);
+//       vector<R> z_2(num);
 //       jump_.jumpUpdate(1, 2, 3, 0, nbytes, z_1.data());
 //       jump_.jumpUpdate(4, 5, 6, 0, nbytes, z_2.data());
 //       jump_.communicate(*network_, *tpool_);
       
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(1, 2, 3).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(1, 2, 3).data()); 
 //       std::copy(miss_values, miss_values + num, z_1.begin());
-//       const auto* miss_values1 = reinterpret_cast<const Ring*>(jump_.getValues(4, 5, 6).data()); 
+//       const auto* miss_values1 = reinterpret_cast<const R*>(jump_.getValues(4, 5, 6).data()); 
 //       std::copy(miss_values1, miss_values1 + num, z_2.begin());
 //       for (size_t i = 0; i<num; i++) {
 //         vres[i] = 0;
@@ -333,7 +336,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_3(num);
+//       vector<R> z_3(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_3[i] = recon_shares[upperTriangularToArray(1, 4)][i] +
 //                  recon_shares[upperTriangularToArray(1, 5)][i] + 
@@ -344,7 +347,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_5(num);
+//       vector<R> z_5(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_5[i] = recon_shares[upperTriangularToArray(2, 4)][i] +
 //                  recon_shares[upperTriangularToArray(2, 5)][i] + 
@@ -366,7 +369,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 1: {
 //       //round 1
-//       vector<Ring> z_1(num);
+//       vector<R> z_1(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_1[i] = recon_shares[upperTriangularToArray(0, 4)][i] +
 //                  recon_shares[upperTriangularToArray(0, 5)][i] + 
@@ -377,15 +380,15 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_3(num);
-//       vector<Ring> z_4(num);
+//       vector<R> z_3(num);
+//       vector<R> z_4(num);
 //       jump_.jumpUpdate(0, 2, 3, 1, nbytes, z_3.data());
 //       jump_.jumpUpdate(4, 5, 6, 1, nbytes, z_4.data());
 //       jump_.communicate(*network_, *tpool_);
       
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 2, 3).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 2, 3).data()); 
 //       std::copy(miss_values, miss_values + num, z_3.begin());
-//       const auto* miss_values1 = reinterpret_cast<const Ring*>(jump_.getValues(4, 5, 6).data()); 
+//       const auto* miss_values1 = reinterpret_cast<const R*>(jump_.getValues(4, 5, 6).data()); 
 //       std::copy(miss_values1, miss_values1 + num, z_4.begin());
 //       for (size_t i = 0; i<num; i++) {
 //         vres[i] = 0;
@@ -397,7 +400,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_5(num);
+//       vector<R> z_5(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_5[i] = recon_shares[upperTriangularToArray(2, 4)][i] +
 //                  recon_shares[upperTriangularToArray(2, 5)][i] + 
@@ -419,7 +422,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 2: {
 //       //round 1
-//       vector<Ring> z_1(num);
+//       vector<R> z_1(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_1[i] = recon_shares[upperTriangularToArray(0, 4)][i] +
 //                  recon_shares[upperTriangularToArray(0, 5)][i] + 
@@ -430,7 +433,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_3(num);
+//       vector<R> z_3(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_3[i] = recon_shares[upperTriangularToArray(1, 4)][i] +
 //                  recon_shares[upperTriangularToArray(1, 5)][i] + 
@@ -441,15 +444,15 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_5(num);
-//       vector<Ring> z_6(num);
+//       vector<R> z_5(num);
+//       vector<R> z_6(num);
 //       jump_.jumpUpdate(0, 1, 3, 2, nbytes, z_5.data());
 //       jump_.jumpUpdate(4, 5, 6, 2, nbytes, z_6.data());
 //       jump_.communicate(*network_, *tpool_);
       
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 1, 3).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 1, 3).data()); 
 //       std::copy(miss_values, miss_values + num, z_5.begin());
-//       const auto* miss_values1 = reinterpret_cast<const Ring*>(jump_.getValues(4, 5, 6).data()); 
+//       const auto* miss_values1 = reinterpret_cast<const R*>(jump_.getValues(4, 5, 6).data()); 
 //       std::copy(miss_values1, miss_values1 + num, z_6.begin());
 //       for (size_t i = 0; i<num; i++) {
 //         vres[i] = 0;
@@ -472,7 +475,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 3: {
 //       //round 1
-//       vector<Ring> z_1(num);
+//       vector<R> z_1(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_1[i] = recon_shares[upperTriangularToArray(0, 4)][i] +
 //                  recon_shares[upperTriangularToArray(0, 5)][i] + 
@@ -483,7 +486,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_3(num);
+//       vector<R> z_3(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_3[i] = recon_shares[upperTriangularToArray(1, 4)][i] +
 //                  recon_shares[upperTriangularToArray(1, 5)][i] + 
@@ -494,7 +497,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_5(num);
+//       vector<R> z_5(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_5[i] = recon_shares[upperTriangularToArray(2, 4)][i] +
 //                  recon_shares[upperTriangularToArray(2, 5)][i] + 
@@ -507,7 +510,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       //round 4
 //       jump_.jumpUpdate(0, 1, 2, 3, nbytes, vres.data());
 //       jump_.communicate(*network_, *tpool_);
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 1, 2).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 1, 2).data()); 
 //       std::copy(miss_values, miss_values + num, vres.begin());
 //       jump_.reset();
       
@@ -515,7 +518,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 4: {
 //       //round 1
-//       vector<Ring> z_2(num);
+//       vector<R> z_2(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_2[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(0, 2)][i] + 
@@ -526,7 +529,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_4(num);
+//       vector<R> z_4(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_4[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -537,7 +540,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_6(num);
+//       vector<R> z_6(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_6[i] = recon_shares[upperTriangularToArray(0, 2)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -550,7 +553,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       //round 4
 //       jump_.jumpUpdate(0, 1, 2, 4, nbytes, vres.data());
 //       jump_.communicate(*network_, *tpool_);
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 1, 2).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 1, 2).data()); 
 //       std::copy(miss_values, miss_values + num, vres.begin());
 //       jump_.reset();
 
@@ -558,7 +561,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 5: {
 //       //round 1
-//       vector<Ring> z_2(num);
+//       vector<R> z_2(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_2[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(0, 2)][i] + 
@@ -569,7 +572,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_4(num);
+//       vector<R> z_4(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_4[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -580,7 +583,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_6(num);
+//       vector<R> z_6(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_6[i] = recon_shares[upperTriangularToArray(0, 2)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -593,7 +596,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       //round 4
 //       jump_.jumpUpdate(0, 1, 2, 5, nbytes, vres.data());
 //       jump_.communicate(*network_, *tpool_);
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 1, 2).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 1, 2).data()); 
 //       std::copy(miss_values, miss_values + num, vres.begin());
 //       jump_.reset();
 
@@ -601,7 +604,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //     }
 //     case 6: {
 //       //round 1
-//       vector<Ring> z_2(num);
+//       vector<R> z_2(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_2[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(0, 2)][i] + 
@@ -612,7 +615,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 2
-//       vector<Ring> z_4(num);
+//       vector<R> z_4(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_4[i] = recon_shares[upperTriangularToArray(0, 1)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -623,7 +626,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       jump_.reset();
 
 //       //round 3
-//       vector<Ring> z_6(num);
+//       vector<R> z_6(num);
 //       for (size_t i = 0; i<num; i++) {
 //         z_6[i] = recon_shares[upperTriangularToArray(0, 2)][i] +
 //                  recon_shares[upperTriangularToArray(1, 2)][i] + 
@@ -636,7 +639,7 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //       //round 4
 //       jump_.jumpUpdate(0, 1, 2, 6, nbytes, vres.data());
 //       jump_.communicate(*network_, *tpool_);
-//       const auto* miss_values = reinterpret_cast<const Ring*>(jump_.getValues(0, 1, 2).data()); 
+//       const auto* miss_values = reinterpret_cast<const R*>(jump_.getValues(0, 1, 2).data()); 
 //       std::copy(miss_values, miss_values + num, vres.begin());
 //       jump_.reset();
 
@@ -647,19 +650,27 @@ std::vector<Ring> OnlineEvaluator::elementwise_sum(const std::array<std::vector<
 //   return vres;
 // }
 
-std::vector<Ring> OnlineEvaluator::reconstruct(
-    const std::array<std::vector<Ring>, NUM_RSS>& recon_shares) {
-  // All vectors in recon_shares should have same size.
-  size_t num = recon_shares[0].size();
-  size_t nbytes = sizeof(Ring) * num;
+template <class R>
+std::vector<R> OnlineEvaluator<R>::reconstruct(const ShareMatrix<R>& recon_shares) {
+  auto pending = startReconstruct(recon_shares);
+  return finishReconstruct(pending);
+}
+
+template <class R>
+typename OnlineEvaluator<R>::PendingReconstruct OnlineEvaluator<R>::startReconstruct(
+    const ShareMatrix<R>& recon_shares) {
+  PendingReconstruct pending;
+  pending.recon_shares = &recon_shares;
+  size_t num = recon_shares.rows();
+  size_t nbytes = sizeof(R) * num;
 
   if (nbytes == 0) {
-    return {};
+    return pending;
   }
 
-  std::vector<Ring> vres1(num);
-  std::vector<Ring> vres2(num);
-  std::vector<Ring> result(num);
+  // 发送数据以 span 形式交给 jump，本轮结束前必须保持有效
+  auto& outgoing = pending.outgoing;
+  outgoing.reserve(2 * NUM_PARTIES);
 
   for(int i = 0; i<NUM_PARTIES; i++) {
     int sender1 = pidFromOffset(i, 1);
@@ -674,10 +685,10 @@ std::vector<Ring> OnlineEvaluator::reconstruct(
         jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, nullptr);
       }
       else {
-        auto z_1 = elementwise_sum(recon_shares, upperTriangularToArray(receiver, other1), 
-                                                 upperTriangularToArray(receiver, other2),
-                                                 upperTriangularToArray(receiver, other3));
-        jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, z_1.data());
+        auto& z_1 = outgoing.emplace_back(recon_shares.sumColumns(upperTriangularToArray(receiver, other1),
+                                                                          upperTriangularToArray(receiver, other2),
+                                                                          upperTriangularToArray(receiver, other3)));
+        jump_.jumpUpdateSpan(sender1, sender2, sender3, receiver, nbytes, z_1.data());
       }
     }
 
@@ -692,35 +703,71 @@ std::vector<Ring> OnlineEvaluator::reconstruct(
         jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, nullptr);
       }
       else {
-        auto z_2 = elementwise_sum(recon_shares, upperTriangularToArray(receiver, other1), 
-                                                 upperTriangularToArray(receiver, other2),
-                                                 upperTriangularToArray(receiver, other3));
-        jump_.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, z_2.data());
+        auto& z_2 = outgoing.emplace_back(recon_shares.sumColumns(upperTriangularToArray(receiver, other1),
+                                                                          upperTriangularToArray(receiver, other2),
+                                                                          upperTriangularToArray(receiver, other3)));
+        jump_.jumpUpdateSpan(sender1, sender2, sender3, receiver, nbytes, z_2.data());
       }
     }
   }
-  jump_.communicate(*network_, *tpool_);
+  pending.round = jump_.asyncCommunicate(*network_);
+  return pending;
+}
 
-  //reinterpret_cast 的作用是 对指针类型进行低级别的重新解释，即将原始指针类型强制转换为另一种不相关的指针类型（这里是 const Ring*），而无需修改底层数据。
-  const auto* miss_values1 = reinterpret_cast<const Ring*>(jump_.getValues(pidFromOffset(id_, 1), pidFromOffset(id_, 2), pidFromOffset(id_, 3)).data());
-  const auto* miss_values2 = reinterpret_cast<const Ring*>(jump_.getValues(pidFromOffset(id_, 4), pidFromOffset(id_, 5), pidFromOffset(id_, 6)).data());     
-  std::copy(miss_values1, miss_values1 + num, vres1.begin());
-  std::copy(miss_values2, miss_values2 + num, vres2.begin());
+template <class R>
+std::vector<R> OnlineEvaluator<R>::finishReconstruct(PendingReconstruct& pending) {
+  const auto& recon_shares = *pending.recon_shares;
+  size_t num = recon_shares.rows();
+  if (!pending.round.valid()) {
+    return {};
+  }
+
+  // 本方持有的份额先在数据传输期间求和
+  std::vector<R> result = recon_shares.rowSums();
+
+  //reinterpret_cast 的作用是 对指针类型进行低级别的重新解释，即将原始指针类型强制转换为另一种不相关的指针类型（这里是 const R*），而无需修改底层数据。
+  const auto* miss_values1 = reinterpret_cast<const R*>(jump_.getValues(pidFromOffset(id_, 1), pidFromOffset(id_, 2), pidFromOffset(id_, 3)).data());
+  const auto* miss_values2 = reinterpret_cast<const R*>(jump_.getValues(pidFromOffset(id_, 4), pidFromOffset(id_, 5), pidFromOffset(id_, 6)).data());     
   for (size_t i = 0; i<num; i++) {
-    Ring temp = 0;
-    for(size_t j = 0; j<NUM_RSS; j++) {
-      temp += recon_shares[j][i];
-    }
-    result[i] = vres1[i] + vres2[i] + temp;
+    result[i] += miss_values1[i] + miss_values2[i];
   }
+  pending.round.wait();
   jump_.reset();
   return result;
 }
 
-void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares;
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares_for_z;
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares_for_mul;
+template <class R>
+void OnlineEvaluator<R>::evaluateGatesAtDepth(size_t depth) {
+  // 先数出各次重构的行数，份额按门的顺序逐行写入
+  size_t num_recon = 0;
+  size_t num_z = 0;
+  size_t num_mul = 0;
+  for (const auto& gate : circ_.gates_by_level[depth]) {
+    switch (gate->type) {
+      case utils::GateType::kMul:
+      case utils::GateType::kDotprod:
+      case utils::GateType::kTrdotp:
+        ++num_recon;
+        break;
+      case utils::GateType::kCmp:
+        ++num_recon;
+        ++num_z;
+        break;
+      case utils::GateType::kRelu:
+        ++num_recon;
+        ++num_z;
+        ++num_mul;
+        break;
+      default:
+        break;
+    }
+  }
+  ShareMatrix<R> recon_shares(num_recon, id_);
+  ShareMatrix<R> recon_shares_for_z(num_z, id_);
+  ShareMatrix<R> recon_shares_for_mul(num_mul, id_);
+  size_t recon_row = 0;
+  size_t z_row = 0;
+  size_t mul_row = 0;
 
 
   for (auto& gate : circ_.gates_by_level[depth]) {
@@ -730,15 +777,13 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         auto& m_in1 = preproc_.gates[g->in1]->mask;
         auto& m_in2 = preproc_.gates[g->in2]->mask;
         auto* pre_out =
-            static_cast<PreprocMultGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocMultGate<R>*>(preproc_.gates[g->out].get());
 
         auto rec_share = pre_out->mask + pre_out->mask_prod -
                          m_in1 * wires_[g->in2] - m_in2 * wires_[g->in1]; //wires_[g->in1]和wires_[g->in2]是两个β
         // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(recon_row++, rec_share);
         break;
       }
 
@@ -746,7 +791,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         
         auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocCmpGate<R>*>(preproc_.gates[g->out].get());
         auto& m_in1 = preproc_.gates[g->in]->mask; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& m_in2 = pre_out->mask_mu_1; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& beta_mu_1 = pre_out->beta_mu_1;
@@ -755,18 +800,16 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
                          m_in1 * beta_mu_1 - m_in2 * wires_[g->in]; //m_in1代表(x-y)的[]共享，beta_mu_1代表mu_1的β，m_in2代表mu_1的共享，wires_[g->in]代表(x-y)的β
         // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(recon_row++, rec_share);
         break;
       }
 
       case utils::GateType::kDotprod: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocDotpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocDotpGate<R>*>(preproc_.gates[g->out].get());
 
-        auto rec_share = pre_out->mask + pre_out->mask_prod; // [α_z] +  [x]，x代表最终计算结果
+        CompactShare<R> rec_share = pre_out->mask + pre_out->mask_prod; // [α_z] +  [x]，x代表最终计算结果
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
@@ -777,18 +820,16 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
           // rec_share.add(wires_[win1] * wires_[win2], id_);
         }
 
-        for (int i = 0; i < NUM_RSS; i++) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(recon_row++, rec_share);
         break;
       }
 
       case utils::GateType::kTrdotp: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocTrDotpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocTrDotpGate<R>*>(preproc_.gates[g->out].get());
 
-        auto rec_share = pre_out->mask_prod + pre_out->mask_d;
+        CompactShare<R> rec_share = pre_out->mask_prod + pre_out->mask_d;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
@@ -799,9 +840,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
           // rec_share.add(wires_[win1] * wires_[win2], id_);
         }
 
-        for (int i = 0; i < NUM_RSS; i++) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(recon_row++, rec_share);
 
         break;
       }
@@ -810,7 +849,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         
         auto* pre_out =
-            static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         auto& m_in1 = preproc_.gates[g->in]->mask; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& m_in2 = pre_out->mask_mu_1; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& beta_mu_1 = pre_out->beta_mu_1;
@@ -819,9 +858,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
                          m_in1 * beta_mu_1 - m_in2 * wires_[g->in]; //m_in1代表(x-y)的[]共享，beta_mu_1代表mu_1的β，m_in2代表mu_1的共享，wires_[g->in]代表(x-y)的β
         // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(recon_row++, rec_share);
         break;
       }
       default:
@@ -829,14 +866,58 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
     }
   }
 
-  size_t non_relu_recon = recon_shares[0].size();
+  size_t non_relu_recon = recon_shares.rows();
 
-  auto vres = reconstruct(recon_shares); //重构出beta_z
+  auto pending = startReconstruct(recon_shares); //重构出beta_z
+
+  // 数据传输期间先计算本层的本地门：输入不依赖本层待重构结果的加减/常数门可以立即计算
+  const auto& level = circ_.gates_by_level[depth];
+  std::vector<bool> local_done(level.size(), false);
+  std::unordered_set<utils::wire_t> waiting;
+  for (size_t gi = 0; gi < level.size(); ++gi) {
+    const auto& gate = level[gi];
+    switch (gate->type) {
+      case utils::GateType::kAdd:
+      case utils::GateType::kSub: {
+        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+        if (waiting.count(g->in1) != 0 || waiting.count(g->in2) != 0) {
+          waiting.insert(g->out);
+          break;
+        }
+        wires_[g->out] = gate->type == utils::GateType::kAdd
+                             ? wires_[g->in1] + wires_[g->in2]
+                             : wires_[g->in1] - wires_[g->in2];
+        local_done[gi] = true;
+        break;
+      }
+
+      case utils::GateType::kConstAdd:
+      case utils::GateType::kConstMul: {
+        auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+        if (waiting.count(g->in) != 0) {
+          waiting.insert(g->out);
+          break;
+        }
+        wires_[g->out] = gate->type == utils::GateType::kConstAdd ? wires_[g->in] + g->cval
+                                                                  : wires_[g->in] * g->cval;
+        local_done[gi] = true;
+        break;
+      }
+
+      default:
+        waiting.insert(gate->out);
+        break;
+    }
+  }
+
+  auto vres = finishReconstruct(pending);
 
   size_t idx = 0;
   size_t relu_idx = 0;
   size_t msb_idx = 0;
-  for (auto& gate : circ_.gates_by_level[depth]) {
+  for (size_t gi = 0; gi < level.size(); ++gi) {
+    if (local_done[gi]) continue;
+    const auto& gate = level[gi];
     switch (gate->type) {
       case utils::GateType::kAdd: {
         auto* g = static_cast<utils::FIn2Gate*>(gate.get());
@@ -859,7 +940,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
       case utils::GateType::kCmp: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocCmpGate<R>*>(preproc_.gates[g->out].get());
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //上面已经重构了一次，得到了beta_z，直接加到这上面即可，但是还需要一次重构来获取Z的值
         wires_[gate->out] = vres[idx++] + wires_[g->in] * beta_mu_1; //for multiplication
@@ -869,16 +950,14 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         // preproc_.gates[gate->out]->mask = preproc_.gates[gate->out]->mask + pre_out->mask_mu_2; //for addition
 
         //下面进行重构，获取z的值，判断比较结果。
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_z[i].push_back(preproc_.gates[gate->out]->mask[i]);
-        }
+        recon_shares_for_z.setRow(z_row++, preproc_.gates[gate->out]->mask);
         break;
       }
 
       case utils::GateType::kDotprod: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-        Ring sum_beta = 0;
+        R sum_beta = 0;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
@@ -891,24 +970,24 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
       case utils::GateType::kTrdotp: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-        Ring sum_beta = 0;
+        R sum_beta = 0;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
           sum_beta += wires_[win1] * wires_[win2];
         }
-        wires_[gate->out] = (vres[idx++] + sum_beta) >> FRACTION ;
+        wires_[gate->out] = (vres[idx++] + sum_beta) >> kFraction ;
         break;
       }
 
       case utils::GateType::kConstAdd: {
-        auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+        auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
         wires_[g->out] = wires_[g->in] + g->cval;  //只需要beta加即可,alpha不用加
         break;
       }
 
       case utils::GateType::kConstMul: {
-        auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
+        auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
         wires_[g->out] = wires_[g->in] * g->cval;
         break;
       }
@@ -916,7 +995,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
       case utils::GateType::kRelu: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //上面已经重构了一次，得到了beta_z，直接加到这上面即可，但是还需要一次重构来获取Z的值
         wires_[gate->out] = vres[idx++] + wires_[g->in] * beta_mu_1; //for multiplication
@@ -926,9 +1005,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         // preproc_.gates[gate->out]->mask = preproc_.gates[gate->out]->mask + pre_out->mask_mu_2; //for addition
 
         //下面进行重构，获取z的值，判断比较结果。
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_z[i].push_back(preproc_.gates[gate->out]->mask[i]);
-        }
+        recon_shares_for_z.setRow(z_row++, preproc_.gates[gate->out]->mask);
         
         break;
       }
@@ -944,11 +1021,11 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
       case utils::GateType::kCmp: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocCmpGate<R>*>(preproc_.gates[g->out].get());
         auto sum_z = sum_z_vec[idx++]; //为了重构出z
         auto z = wires_[gate->out] - sum_z;
         std::vector<BoolRing> bin = bitDecompose(z);
-        if (bin[BITS_GAMMA+BITS_BETA-1].val()) { //最高位是1，那么是负数
+        if (bin[kBitsGamma+kBitsBeta-1].val()) { //最高位是1，那么是负数
           wires_[gate->out] = sum_z + CMP_lESS_RESULT;
         }
         else {
@@ -960,12 +1037,12 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
 
       case utils::GateType::kRelu: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
-        auto* pre_out = static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+        auto* pre_out = static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         
         auto sum_z = sum_z_vec[idx++]; //为了重构出z
         auto z = wires_[gate->out] - sum_z;
         std::vector<BoolRing> bin = bitDecompose(z);
-        if (bin[BITS_GAMMA+BITS_BETA-1].val()) { //最高位是1，那么是负数
+        if (bin[kBitsGamma+kBitsBeta-1].val()) { //最高位是1，那么是负数
           wires_[gate->out] = sum_z + 0;
         }
         else {
@@ -977,11 +1054,9 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
         
         auto rec_share_for_mul = pre_out->mask + pre_out->mask_prod2 -
                          m_in1_mul * wires_[g->out] - m_in2_mul * wires_[g->in]; //wires_[g->in1]和wires_[g->in2]是两个β
-        // std::array<std::vector<Ring>, 4> recon_shares_for_mul;
+        // std::array<std::vector<R>, 4> recon_shares_for_mul;
         
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_mul[i].push_back(rec_share_for_mul[i]);
-        }
+        recon_shares_for_mul.setRow(mul_row++, rec_share_for_mul);
         break;
       }
 
@@ -995,7 +1070,7 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
   for (auto& gate : circ_.gates_by_level[depth]) {
     if(gate->type == utils::GateType::kRelu) {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
-        auto* pre_out = static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+        auto* pre_out = static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
 
         auto mul_result = mul_result_vec[idx++];
         wires_[gate->out] = mul_result + wires_[g->out] * wires_[g->in];
@@ -1004,33 +1079,61 @@ void OnlineEvaluator::evaluateGatesAtDepth(size_t depth) {
   }
 }
 
-void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computation_threads) {
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares;
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares_for_z;
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares_for_mul;
+template <class R>
+void OnlineEvaluator<R>::evaluateGatesAtDepth_parallel(size_t depth, size_t computation_threads) {
+  const auto& level = circ_.gates_by_level[depth];
+  const auto num_gates = static_cast<int64_t>(level.size());
+
+  // 先按门的顺序串行分配每个门在各重构向量中的位置，并行循环中各线程只写自己的位置：
+  // 不需要加锁，结果与串行版本的顺序一致。
+  constexpr size_t kNoSlot = std::numeric_limits<size_t>::max();
+  std::vector<size_t> slot(level.size(), kNoSlot);      // recon_shares / vres
+  std::vector<size_t> z_slot(level.size(), kNoSlot);    // recon_shares_for_z / sum_z_vec
+  std::vector<size_t> mul_slot(level.size(), kNoSlot);  // recon_shares_for_mul / mul_result_vec
+  size_t num_recon = 0;
+  size_t num_z = 0;
+  size_t num_mul = 0;
+  for (size_t gi = 0; gi < level.size(); ++gi) {
+    switch (level[gi]->type) {
+      case utils::GateType::kMul:
+      case utils::GateType::kDotprod:
+      case utils::GateType::kTrdotp:
+        slot[gi] = num_recon++;
+        break;
+      case utils::GateType::kCmp:
+        slot[gi] = num_recon++;
+        z_slot[gi] = num_z++;
+        break;
+      case utils::GateType::kRelu:
+        slot[gi] = num_recon++;
+        z_slot[gi] = num_z++;
+        mul_slot[gi] = num_mul++;
+        break;
+      default:
+        break;
+    }
+  }
 
+  ShareMatrix<R> recon_shares(num_recon, id_);
+  ShareMatrix<R> recon_shares_for_z(num_z, id_);
+  ShareMatrix<R> recon_shares_for_mul(num_mul, id_);
 
   omp_set_num_threads(computation_threads); 
-  // omp_set_num_threads(omp_get_num_procs());
-  // #pragma omp parallel for
   #pragma omp parallel for
-  for (size_t i_temp = 0; i_temp < circ_.gates_by_level[depth].size(); ++i_temp) {
-    auto& gate = circ_.gates_by_level[depth][i_temp];
+  for (int64_t gi = 0; gi < num_gates; ++gi) {
+    auto& gate = level[gi];
     switch (gate->type) {
       case utils::GateType::kMul: {
         auto* g = static_cast<utils::FIn2Gate*>(gate.get());
         auto& m_in1 = preproc_.gates[g->in1]->mask;
         auto& m_in2 = preproc_.gates[g->in2]->mask;
         auto* pre_out =
-            static_cast<PreprocMultGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocMultGate<R>*>(preproc_.gates[g->out].get());
 
         auto rec_share = pre_out->mask + pre_out->mask_prod -
                          m_in1 * wires_[g->in2] - m_in2 * wires_[g->in1]; //wires_[g->in1]和wires_[g->in2]是两个β
-        // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(slot[gi], rec_share);
         break;
       }
 
@@ -1038,27 +1141,24 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         
         auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocCmpGate<R>*>(preproc_.gates[g->out].get());
         auto& m_in1 = preproc_.gates[g->in]->mask; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& m_in2 = pre_out->mask_mu_1; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //pre_out->mask代表α_z，pre_out->mask_prod代表alpha_{xy}
         auto rec_share = pre_out->prev_mask + pre_out->mask_prod -
                          m_in1 * beta_mu_1 - m_in2 * wires_[g->in]; //m_in1代表(x-y)的[]共享，beta_mu_1代表mu_1的β，m_in2代表mu_1的共享，wires_[g->in]代表(x-y)的β
-        // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(slot[gi], rec_share);
         break;
       }
 
       case utils::GateType::kDotprod: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocDotpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocDotpGate<R>*>(preproc_.gates[g->out].get());
 
-        auto rec_share = pre_out->mask + pre_out->mask_prod; // [α_z] +  [x]，x代表最终计算结果
+        CompactShare<R> rec_share = pre_out->mask + pre_out->mask_prod; // [α_z] +  [x]，x代表最终计算结果
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
@@ -1066,21 +1166,18 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
           auto& m_in2 = preproc_.gates[win2]->mask;
 
           rec_share -= m_in1 * wires_[win2] + m_in2 * wires_[win1]; //对应步骤-Σ^d_1 \beta_{x_t}[\alpha_{y_t}] - Σ^d_1 \beta_{y_t}[\alpha_{x_t}]
-          // rec_share.add(wires_[win1] * wires_[win2], id_);
         }
 
-        for (int i = 0; i < NUM_RSS; i++) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(slot[gi], rec_share);
         break;
       }
 
       case utils::GateType::kTrdotp: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocTrDotpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocTrDotpGate<R>*>(preproc_.gates[g->out].get());
 
-        auto rec_share = pre_out->mask_prod + pre_out->mask_d;
+        CompactShare<R> rec_share = pre_out->mask_prod + pre_out->mask_d;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
@@ -1088,13 +1185,9 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
           auto& m_in2 = preproc_.gates[win2]->mask;
 
           rec_share -= (m_in1 * wires_[win2] + m_in2 * wires_[win1]);
-          // rec_share.add(wires_[win1] * wires_[win2], id_);
-        }
-
-        for (int i = 0; i < NUM_RSS; i++) {
-          recon_shares[i].push_back(rec_share[i]);
         }
 
+        recon_shares.setRow(slot[gi], rec_share);
         break;
       }
 
@@ -1102,18 +1195,15 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         
         auto* pre_out =
-            static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         auto& m_in1 = preproc_.gates[g->in]->mask; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& m_in2 = pre_out->mask_mu_1; //mask代表秘密共享形式下的四个值，即四个alpha
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //pre_out->mask代表α_z，pre_out->mask_prod代表alpha_{xy}
         auto rec_share = pre_out->prev_mask + pre_out->mask_prod -
                          m_in1 * beta_mu_1 - m_in2 * wires_[g->in]; //m_in1代表(x-y)的[]共享，beta_mu_1代表mu_1的β，m_in2代表mu_1的共享，wires_[g->in]代表(x-y)的β
-        // rec_share.add(wires_[g->in1] * wires_[g->in2], id_);
 
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares[i].push_back(rec_share[i]);
-        }
+        recon_shares.setRow(slot[gi], rec_share);
         break;
       }
       default:
@@ -1121,109 +1211,105 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
     }
   }
 
-  size_t non_relu_recon = recon_shares[0].size();
-
   auto vres = reconstruct(recon_shares); //重构出beta_z
 
-  size_t idx = 0;
-  size_t relu_idx = 0;
-  size_t msb_idx = 0;
   #pragma omp parallel for
-  for (size_t i_temp = 0; i_temp < circ_.gates_by_level[depth].size(); ++i_temp) {
-    auto& gate = circ_.gates_by_level[depth][i_temp];
+  for (int64_t gi = 0; gi < num_gates; ++gi) {
+    auto& gate = level[gi];
     switch (gate->type) {
-      case utils::GateType::kAdd: {
-        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-        wires_[g->out] = wires_[g->in1] + wires_[g->in2];//这里wires_存的是beta
-        break;
-      }
-
-      case utils::GateType::kSub: {
-        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-        wires_[g->out] = wires_[g->in1] - wires_[g->in2];
-        break;
-      }
-
       case utils::GateType::kMul: {
         auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-        wires_[gate->out] = vres[idx++] + wires_[g->in1] * wires_[g->in2];
+        wires_[gate->out] = vres[slot[gi]] + wires_[g->in1] * wires_[g->in2];
         break;
       }
 
       case utils::GateType::kCmp: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocCmpGate<R>*>(preproc_.gates[g->out].get());
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //上面已经重构了一次，得到了beta_z，直接加到这上面即可，但是还需要一次重构来获取Z的值
-        wires_[gate->out] = vres[idx++] + wires_[g->in] * beta_mu_1; //for multiplication
+        wires_[gate->out] = vres[slot[gi]] + wires_[g->in] * beta_mu_1; //for multiplication
 
         auto& beta_mu_2 = pre_out->beta_mu_2;
         wires_[gate->out] += beta_mu_2; //for addition
-        // preproc_.gates[gate->out]->mask = preproc_.gates[gate->out]->mask + pre_out->mask_mu_2; //for addition
 
         //下面进行重构，获取z的值，判断比较结果。
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_z[i].push_back(preproc_.gates[gate->out]->mask[i]);
-        }
+        recon_shares_for_z.setRow(z_slot[gi], preproc_.gates[gate->out]->mask);
         break;
       }
 
       case utils::GateType::kDotprod: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-        Ring sum_beta = 0;
+        R sum_beta = 0;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
           sum_beta += wires_[win1] * wires_[win2];
         }
-        wires_[gate->out] = vres[idx++] + sum_beta;
+        wires_[gate->out] = vres[slot[gi]] + sum_beta;
         break;
       }
 
       case utils::GateType::kTrdotp: {
         auto* g = static_cast<utils::SIMDGate*>(gate.get());
 
-        Ring sum_beta = 0;
+        R sum_beta = 0;
         for (size_t i = 0; i < g->in1.size(); i++) {
           auto win1 = g->in1[i];
           auto win2 = g->in2[i];
           sum_beta += wires_[win1] * wires_[win2];
         }
-        wires_[gate->out] = (vres[idx++] + sum_beta) >> FRACTION ;
-        break;
-      }
-
-      case utils::GateType::kConstAdd: {
-        auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
-        wires_[g->out] = wires_[g->in] + g->cval;  //只需要beta加即可,alpha不用加
-        break;
-      }
-
-      case utils::GateType::kConstMul: {
-        auto* g = static_cast<utils::ConstOpGate<Ring>*>(gate.get());
-        wires_[g->out] = wires_[g->in] * g->cval;
+        wires_[gate->out] = (vres[slot[gi]] + sum_beta) >> kFraction ;
         break;
       }
 
       case utils::GateType::kRelu: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
         auto* pre_out =
-            static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+            static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         auto& beta_mu_1 = pre_out->beta_mu_1;
         //上面已经重构了一次，得到了beta_z，直接加到这上面即可，但是还需要一次重构来获取Z的值
-        wires_[gate->out] = vres[idx++] + wires_[g->in] * beta_mu_1; //for multiplication
+        wires_[gate->out] = vres[slot[gi]] + wires_[g->in] * beta_mu_1; //for multiplication
 
         auto& beta_mu_2 = pre_out->beta_mu_2;
         wires_[gate->out] += beta_mu_2; //for addition
-        // preproc_.gates[gate->out]->mask = preproc_.gates[gate->out]->mask + pre_out->mask_mu_2; //for addition
 
         //下面进行重构，获取z的值，判断比较结果。
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_z[i].push_back(preproc_.gates[gate->out]->mask[i]);
-        }
-        
+        recon_shares_for_z.setRow(z_slot[gi], preproc_.gates[gate->out]->mask);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  // 本地门可能用到本层乘法门的输出，在并行部分完成后按门的顺序计算
+  for (int64_t gi = 0; gi < num_gates; ++gi) {
+    auto& gate = level[gi];
+    switch (gate->type) {
+      case utils::GateType::kAdd: {
+        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+        wires_[g->out] = wires_[g->in1] + wires_[g->in2];//这里wires_存的是beta
+        break;
+      }
+
+      case utils::GateType::kSub: {
+        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+        wires_[g->out] = wires_[g->in1] - wires_[g->in2];
+        break;
+      }
+
+      case utils::GateType::kConstAdd: {
+        auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+        wires_[g->out] = wires_[g->in] + g->cval;  //只需要beta加即可,alpha不用加
+        break;
+      }
+
+      case utils::GateType::kConstMul: {
+        auto* g = static_cast<utils::ConstOpGate<R>*>(gate.get());
+        wires_[g->out] = wires_[g->in] * g->cval;
         break;
       }
       default:
@@ -1232,19 +1318,15 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
   }
 
   auto sum_z_vec = reconstruct(recon_shares_for_z); //重构出beta_z
-  idx = 0;
   #pragma omp parallel for
-  for (size_t i_temp = 0; i_temp < circ_.gates_by_level[depth].size(); ++i_temp) {
-    auto& gate = circ_.gates_by_level[depth][i_temp];
+  for (int64_t gi = 0; gi < num_gates; ++gi) {
+    auto& gate = level[gi];
     switch (gate->type) {
       case utils::GateType::kCmp: {
-        auto* g = static_cast<utils::FIn1Gate*>(gate.get());
-        auto* pre_out =
-            static_cast<PreprocCmpGate<Ring>*>(preproc_.gates[g->out].get());
-        auto sum_z = sum_z_vec[idx++]; //为了重构出z
+        auto sum_z = sum_z_vec[z_slot[gi]]; //为了重构出z
         auto z = wires_[gate->out] - sum_z;
         std::vector<BoolRing> bin = bitDecompose(z);
-        if (bin[BITS_GAMMA+BITS_BETA-1].val()) { //最高位是1，那么是负数
+        if (bin[kBitsGamma+kBitsBeta-1].val()) { //最高位是1，那么是负数
           wires_[gate->out] = sum_z + CMP_lESS_RESULT;
         }
         else {
@@ -1253,15 +1335,14 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
         break;
       }
 
-
       case utils::GateType::kRelu: {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
-        auto* pre_out = static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
+        auto* pre_out = static_cast<PreprocReluGate<R>*>(preproc_.gates[g->out].get());
         
-        auto sum_z = sum_z_vec[idx++]; //为了重构出z
+        auto sum_z = sum_z_vec[z_slot[gi]]; //为了重构出z
         auto z = wires_[gate->out] - sum_z;
         std::vector<BoolRing> bin = bitDecompose(z);
-        if (bin[BITS_GAMMA+BITS_BETA-1].val()) { //最高位是1，那么是负数
+        if (bin[kBitsGamma+kBitsBeta-1].val()) { //最高位是1，那么是负数
           wires_[gate->out] = sum_z + 0;
         }
         else {
@@ -1273,11 +1354,8 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
         
         auto rec_share_for_mul = pre_out->mask + pre_out->mask_prod2 -
                          m_in1_mul * wires_[g->out] - m_in2_mul * wires_[g->in]; //wires_[g->in1]和wires_[g->in2]是两个β
-        // std::array<std::vector<Ring>, 4> recon_shares_for_mul;
         
-        for (int i = 0; i < NUM_RSS; ++i) {
-          recon_shares_for_mul[i].push_back(rec_share_for_mul[i]);
-        }
+        recon_shares_for_mul.setRow(mul_slot[gi], rec_share_for_mul);
         break;
       }
 
@@ -1287,43 +1365,42 @@ void OnlineEvaluator::evaluateGatesAtDepth_parallel(size_t depth, size_t computa
   }
   
   auto mul_result_vec = reconstruct(recon_shares_for_mul); //重构出beta_z
-  idx = 0;
   #pragma omp parallel for
-  for (size_t i_temp = 0; i_temp < circ_.gates_by_level[depth].size(); ++i_temp) {
-    auto& gate = circ_.gates_by_level[depth][i_temp];
+  for (int64_t gi = 0; gi < num_gates; ++gi) {
+    auto& gate = level[gi];
     if(gate->type == utils::GateType::kRelu) {
         auto* g = static_cast<utils::FIn1Gate*>(gate.get());
-        auto* pre_out = static_cast<PreprocReluGate<Ring>*>(preproc_.gates[g->out].get());
 
-        auto mul_result = mul_result_vec[idx++];
+        auto mul_result = mul_result_vec[mul_slot[gi]];
         wires_[gate->out] = mul_result + wires_[g->out] * wires_[g->in];
       }
   }
 }
 
-std::vector<Ring> OnlineEvaluator::reconstruct(
-    const std::vector<ReplicatedShare<Ring>>& shares) {
-  std::array<std::vector<Ring>, NUM_RSS> recon_shares;
-  for (const auto& s : shares) {
-    for (size_t i = 0; i < NUM_RSS; ++i) {
-      recon_shares[i].push_back(s[i]);
-    }
+template <class R>
+std::vector<R> OnlineEvaluator<R>::reconstruct(
+    const std::vector<ReplicatedShare<R>>& shares) {
+  ShareMatrix<R> recon_shares(shares.size(), id_);
+  for (size_t i = 0; i < shares.size(); ++i) {
+    recon_shares.setRow(i, shares[i]);
   }
   return reconstruct(recon_shares);
 }
 
-std::vector<Ring> OnlineEvaluator::getOutputs() {
-  std::vector<Ring> outvals(circ_.outputs.size());
+template <class R>
+std::vector<R> OnlineEvaluator<R>::getOutputs() {
+  std::vector<R> outvals(circ_.outputs.size());
   if (circ_.outputs.empty()) {
+    verify();
     return outvals;
   }
 
-  std::vector<ReplicatedShare<Ring>> shares;
+  ShareMatrix<R> shares(outvals.size(), id_);
   for (size_t i = 0; i < outvals.size(); ++i) {
     auto wout = circ_.outputs[i];
     // outvals[i] = wires_[wout] - preproc_.gates[wout]->mask.sum(); //β - Σα
     
-    shares.push_back(preproc_.gates[wout]->mask);
+    shares.setRow(i, preproc_.gates[wout]->mask);
   }
   auto sum = reconstruct(shares);
   // std::cout<<"参与方"<<id_<<"重构出的sum为"<<sum[0]<<std::endl;
@@ -1331,12 +1408,45 @@ std::vector<Ring> OnlineEvaluator::getOutputs() {
     auto wout = circ_.outputs[i];
     outvals[i] = wires_[wout] - sum[i]; //β - Σα
   }
+  // 在线阶段结束，输出前必须完成所有延迟的哈希校验
+  verify();
 
   return outvals;
 }
 
-std::vector<Ring> OnlineEvaluator::evaluateCircuit(
-    const std::unordered_map<utils::wire_t, Ring>& inputs) {
+template <class R>
+void OnlineEvaluator<R>::setDeferredVerification(bool enable, size_t interval) {
+  jump_.setDeferredVerification(enable, interval);
+}
+
+template <class R>
+void OnlineEvaluator<R>::verify() {
+  jump_.verify(*network_);
+}
+
+template <class R>
+void OnlineEvaluator<R>::setSingleValueSender(bool enable) {
+  jump_.setSingleValueSender(enable);
+}
+
+template <class R>
+void OnlineEvaluator<R>::setJumpRolePolicy(JumpRolePolicy policy, size_t replan_interval) {
+  jump_.setRolePolicy(policy, replan_interval);
+}
+
+template <class R>
+void OnlineEvaluator<R>::setFirstArrival(bool enable) {
+  jump_.setFirstArrival(enable);
+}
+
+template <class R>
+void OnlineEvaluator<R>::probeJumpLinks(size_t nbytes) {
+  jump_.probeLinks(*network_, nbytes);
+}
+
+template <class R>
+std::vector<R> OnlineEvaluator<R>::evaluateCircuit(
+    const std::unordered_map<utils::wire_t, R>& inputs) {
   setInputs(inputs);
   for (size_t i = 0; i < circ_.gates_by_level.size(); ++i) {
     evaluateGatesAtDepth(i);
@@ -1345,13 +1455,14 @@ std::vector<Ring> OnlineEvaluator::evaluateCircuit(
 }
 
 
-std::vector<Ring> OnlineEvaluator::evaluateCircuit_perm(vector<Ring> data_vector, vector<Ring> permutation_vector) {
+template <class R>
+std::vector<R> OnlineEvaluator<R>::evaluateCircuit_perm(vector<R> data_vector, vector<R> permutation_vector) {
   setInputs_perm(data_vector, permutation_vector);
 
-  vector<ReplicatedShare<Ring>> data_sharing_vec = preproc_perm_.data_;
-  PreprocPermutation<Ring> pre_input_perm =  *preproc_perm_.permutation_;
-  vector<vector<Ring>> saved_beta = preproc_perm_.saved_beta_; //每一方总共能存4个，而且是按照顺序存的。
-  vector<Ring> mask_value_vec = preproc_perm_.mask_value_vec_;
+  vector<ReplicatedShare<R>> data_sharing_vec = preproc_perm_.data_;
+  PreprocPermutation<R> pre_input_perm =  *preproc_perm_.permutation_;
+  vector<vector<R>> saved_beta = preproc_perm_.saved_beta_; //每一方总共能存4个，而且是按照顺序存的。
+  vector<R> mask_value_vec = preproc_perm_.mask_value_vec_;
   int nf = data_sharing_vec.size();
 
   std::array<std::array<int,2>,21> Index = {{
@@ -1367,7 +1478,7 @@ std::vector<Ring> OnlineEvaluator::evaluateCircuit_perm(vector<Ring> data_vector
     auto [i_temp,j_temp,k_temp,l_temp,m_temp] = findRemainingNumbers_7PC(Index[i][0], Index[i][1]);
     auto n_temp = Index[i][0];
     auto o_temp = Index[i][1];
-    size_t nbytes = sizeof(Ring) * nf;
+    size_t nbytes = sizeof(R) * nf;
     if(id_ != Index[i][0] && id_ != Index[i][1]) {
       auto alpha_i = pre_input_perm.mask[upperTriangularToArray(Index[i][0], Index[i][1])];
       auto beta_i = saved_beta[upperTriangularToArray(Index[i][0], Index[i][1])];
@@ -1376,8 +1487,8 @@ std::vector<Ring> OnlineEvaluator::evaluateCircuit_perm(vector<Ring> data_vector
       }
       applyPermutation(alpha_i, my_betas_);
       if(id_ != l_temp && id_ != m_temp) { //规定最小的三个数来传数据
-        jump_.jumpUpdate(i_temp, j_temp, k_temp, n_temp, nbytes, my_betas_.data());
-        jump_.jumpUpdate(i_temp, j_temp, k_temp, o_temp, nbytes, my_betas_.data());
+        jump_.jumpUpdateSpan(i_temp, j_temp, k_temp, n_temp, nbytes, my_betas_.data());
+        jump_.jumpUpdateSpan(i_temp, j_temp, k_temp, o_temp, nbytes, my_betas_.data());
       }
     }
     else {
@@ -1388,8 +1499,8 @@ std::vector<Ring> OnlineEvaluator::evaluateCircuit_perm(vector<Ring> data_vector
 
     if(id_ == n_temp || id_ == o_temp) {
       // 获取数据
-      vector<Ring> miss_values(nf);
-      const auto* temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, k_temp).data());
+      vector<R> miss_values(nf);
+      const auto* temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, k_temp).data());
       // 复制数据
       std::copy(temp, temp + nf, miss_values.begin());
 
@@ -1407,13 +1518,14 @@ std::vector<Ring> OnlineEvaluator::evaluateCircuit_perm(vector<Ring> data_vector
 
 
 
-void OnlineEvaluator::evaluateCircuit_perm_no_input(vector<Ring> data_vector, vector<Ring> permutation_vector) {
+template <class R>
+void OnlineEvaluator<R>::evaluateCircuit_perm_no_input(vector<R> data_vector, vector<R> permutation_vector) {
   // setInputs_perm(data_vector, permutation_vector);
 
-  vector<ReplicatedShare<Ring>> data_sharing_vec = preproc_perm_.data_;
-  PreprocPermutation<Ring> pre_input_perm =  *preproc_perm_.permutation_;
-  vector<vector<Ring>> saved_beta = preproc_perm_.saved_beta_; //每一方总共能存4个，而且是按照顺序存的。
-  vector<Ring> mask_value_vec = preproc_perm_.mask_value_vec_;
+  vector<ReplicatedShare<R>> data_sharing_vec = preproc_perm_.data_;
+  PreprocPermutation<R> pre_input_perm =  *preproc_perm_.permutation_;
+  vector<vector<R>> saved_beta = preproc_perm_.saved_beta_; //每一方总共能存4个，而且是按照顺序存的。
+  vector<R> mask_value_vec = preproc_perm_.mask_value_vec_;
   int nf = data_sharing_vec.size();
 
   std::array<std::array<int,2>,21> Index = {{
@@ -1429,7 +1541,7 @@ void OnlineEvaluator::evaluateCircuit_perm_no_input(vector<Ring> data_vector, ve
     auto [i_temp,j_temp,k_temp,l_temp,m_temp] = findRemainingNumbers_7PC(Index[i][0], Index[i][1]);
     auto n_temp = Index[i][0];
     auto o_temp = Index[i][1];
-    size_t nbytes = sizeof(Ring) * nf;
+    size_t nbytes = sizeof(R) * nf;
     if(id_ != Index[i][0] && id_ != Index[i][1]) {
       auto alpha_i = pre_input_perm.mask[upperTriangularToArray(Index[i][0], Index[i][1])];
       auto beta_i = saved_beta[upperTriangularToArray(Index[i][0], Index[i][1])];
@@ -1438,8 +1550,8 @@ void OnlineEvaluator::evaluateCircuit_perm_no_input(vector<Ring> data_vector, ve
       }
       applyPermutation(alpha_i, my_betas_);
       if(id_ != l_temp && id_ != m_temp) { //规定最小的三个数来传数据
-        jump_.jumpUpdate(i_temp, j_temp, k_temp, n_temp, nbytes, my_betas_.data());
-        jump_.jumpUpdate(i_temp, j_temp, k_temp, o_temp, nbytes, my_betas_.data());
+        jump_.jumpUpdateSpan(i_temp, j_temp, k_temp, n_temp, nbytes, my_betas_.data());
+        jump_.jumpUpdateSpan(i_temp, j_temp, k_temp, o_temp, nbytes, my_betas_.data());
       }
     }
     else {
@@ -1450,8 +1562,8 @@ void OnlineEvaluator::evaluateCircuit_perm_no_input(vector<Ring> data_vector, ve
 
     if(id_ == n_temp || id_ == o_temp) {
       // 获取数据
-      vector<Ring> miss_values(nf);
-      const auto* temp = reinterpret_cast<const Ring*>(jump_.getValues(i_temp, j_temp, k_temp).data());
+      vector<R> miss_values(nf);
+      const auto* temp = reinterpret_cast<const R*>(jump_.getValues(i_temp, j_temp, k_temp).data());
       // 复制数据
       std::copy(temp, temp + nf, miss_values.begin());
 
@@ -1467,10 +1579,11 @@ void OnlineEvaluator::evaluateCircuit_perm_no_input(vector<Ring> data_vector, ve
   // return getOutputs_perm();
 }
 
-std::vector<Ring> OnlineEvaluator::getOutputs_perm() {
+template <class R>
+std::vector<R> OnlineEvaluator<R>::getOutputs_perm() {
   int nf = data_sharing_vec_.size();
 
-  std::vector<Ring> outvals(nf);
+  std::vector<R> outvals(nf);
   if (data_sharing_vec_.empty()) {
     return outvals;
   }
@@ -1482,48 +1595,109 @@ std::vector<Ring> OnlineEvaluator::getOutputs_perm() {
 
   return outvals;
 }
-BoolEvaluator::BoolEvaluator(int my_id,
-                             std::vector<preprocg_ptr_t<BoolRing>*> vpreproc,
+BoolEvaluator::BoolEvaluator(int my_id, BoolSlicedPreproc preproc,
                              utils::LevelOrderedCircuit circ)
     : id(my_id),
-      vwires(vpreproc.size(), std::vector<BoolRing>(circ.num_gates)),
-      vpreproc(std::move(vpreproc)),
+      preproc(std::move(preproc)),
+      vwires(this->preproc.mask.size(), std::vector<BoolSlice>(circ.num_gates)),
       circ(std::move(circ)) {}
 
-std::vector<BoolRing> BoolEvaluator::reconstruct(
-    int id, const std::array<std::vector<BoolRing>, NUM_RSS>& recon_shares,
-    io::NetIOMP<NUM_PARTIES>& network, ImprovedJmp& jump, ThreadPool& tpool) {
-  size_t num = recon_shares[0].size(); //看看有多少个bit
+BoolEvaluator::BoolEvaluator(int my_id,
+                             const std::vector<preprocg_ptr_t<BoolRing>*>& vpreproc,
+                             const utils::LevelOrderedCircuit& circ)
+    : BoolEvaluator(my_id, slice(vpreproc, circ), circ) {}
+
+BoolSlicedPreproc BoolEvaluator::slice(const std::vector<preprocg_ptr_t<BoolRing>*>& vpreproc,
+                                       const utils::LevelOrderedCircuit& circ) {
+  BoolSlicedPreproc sliced;
+  sliced.num_instances = vpreproc.size();
+  auto num_slices = numSlices(sliced.num_instances);
+  sliced.mask.assign(num_slices, std::vector<CompactShare<BoolSlice>>(circ.num_gates));
+  sliced.mask_prod.assign(num_slices, std::vector<CompactShare<BoolSlice>>(circ.num_gates));
+
+  std::vector<bool> is_mul(circ.num_gates, false);
+  for (const auto& level : circ.gates_by_level) {
+    for (const auto& gate : level) {
+      is_mul[gate->out] = gate->type == utils::GateType::kMul;
+    }
+  }
 
-  std::array<std::vector<uint8_t>, NUM_RSS> packed_recon_shares;
-  for (int i = 0; i < NUM_RSS; ++i) {
-    //将 BoolRing 类型的数组按位打包成 uint8_t（字节）数组，方便ijmp协议传输
-    packed_recon_shares[i] = BoolRing::pack(recon_shares[i].data(), num);
+  // 转置：第 i 个实例的每个份额分量写入第 i / 64 组对应字的第 i % 64 位
+  for (size_t i = 0; i < sliced.num_instances; ++i) {
+    const auto* preproc = vpreproc[i];
+    auto& mask = sliced.mask[i / BoolSlice::kLanes];
+    auto& mask_prod = sliced.mask_prod[i / BoolSlice::kLanes];
+    const size_t lane = i % BoolSlice::kLanes;
+
+    for (size_t w = 0; w < circ.num_gates; ++w) {
+      const auto* pre = preproc[w].get();
+      if (pre == nullptr) {
+        continue;
+      }
+      for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+        mask[w][k] += BoolSlice(uint64_t(pre->mask[k].val()) << lane);
+      }
+      if (is_mul[w]) {
+        const auto& prod = static_cast<const PreprocMultGate<BoolRing>*>(pre)->mask_prod;
+        for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+          mask_prod[w][k] += BoolSlice(uint64_t(prod[k].val()) << lane);
+        }
+      }
+    }
   }
-  size_t nbytes = sizeof(uint8_t) * packed_recon_shares[0].size();
+  return sliced;
+}
+
+size_t BoolEvaluator::numSlices(size_t num_instances) {
+  return (num_instances + BoolSlice::kLanes - 1) / BoolSlice::kLanes;
+}
+
+void BoolEvaluator::setWire(size_t instance, utils::wire_t wire, BoolRing value) {
+  vwires[instance / BoolSlice::kLanes][wire].setLane(instance % BoolSlice::kLanes, value);
+}
+
+std::vector<BoolSlice> BoolEvaluator::reconstruct(
+    int id, const ShareMatrix<BoolSlice>& recon_shares,
+    io::NetIOMP<NUM_PARTIES>& network, ImprovedJmp& jump, ThreadPool& tpool) {
+  size_t num = recon_shares.rows(); //看看有多少个字
+  // BoolSlice 本身就是打包好的 64 个比特，直接按字节发送
+  size_t nbytes = sizeof(BoolSlice) * num;
 
   if (nbytes == 0) {
     return {};
   }
 
-  std::vector<BoolRing> vres;
-  jump.jumpUpdate(id, pidFromOffset(id, 1), pidFromOffset(id, 2), pidFromOffset(id, -1), nbytes, 
-                  packed_recon_shares[idxFromSenderAndReceiver(id, pidFromOffset(id, -1))].data());
-  jump.jumpUpdate(pidFromOffset(id, -1), id, pidFromOffset(id, 1), pidFromOffset(id, -2), nbytes, 
-                  packed_recon_shares[idxFromSenderAndReceiver(id, pidFromOffset(id, -2))].data());
-  jump.jumpUpdate(pidFromOffset(id, -2), pidFromOffset(id, -1), id, pidFromOffset(id, -3), nbytes, 
-                  packed_recon_shares[idxFromSenderAndReceiver(id, pidFromOffset(id, -3))].data());
-  jump.jumpUpdate(pidFromOffset(id, 1), pidFromOffset(id, 2), pidFromOffset(id, 3), id, nbytes, 
-                  packed_recon_shares[idxFromSenderAndReceiver(id, pidFromOffset(id, -3))].data());
+  // 与 OnlineEvaluator::startReconstruct 相同：每个参与方缺少的 6 个份额元素由两组
+  // 三个发送方各以一次 jump 补齐
+  std::vector<std::vector<BoolSlice>> outgoing;
+  outgoing.reserve(2 * NUM_PARTIES);
+  for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+    for (int first : {1, 4}) {
+      int sender1 = pidFromOffset(receiver, first);
+      int sender2 = pidFromOffset(receiver, first + 1);
+      int sender3 = pidFromOffset(receiver, first + 2);
+      int other = first == 1 ? 4 : 1;
+      if (receiver == id) {
+        jump.jumpUpdate(sender1, sender2, sender3, receiver, nbytes, nullptr);
+      } else if (id == sender1 || id == sender2 || id == sender3) {
+        auto& z = outgoing.emplace_back(recon_shares.sumColumns(
+            upperTriangularToArray(receiver, pidFromOffset(receiver, other)),
+            upperTriangularToArray(receiver, pidFromOffset(receiver, other + 1)),
+            upperTriangularToArray(receiver, pidFromOffset(receiver, other + 2))));
+        jump.jumpUpdateSpan(sender1, sender2, sender3, receiver, nbytes, z.data());
+      }
+    }
+  }
   jump.communicate(network, tpool);
 
-  std::vector<uint8_t> vtemp(packed_recon_shares[0].size());
-  const auto miss_values = jump.getValues(pidFromOffset(id, 1), pidFromOffset(id, 2), pidFromOffset(id, 3)).data();       
-  // std::copy(miss_values, miss_values + num, vres.begin());
-  for (size_t i = 0; i<vtemp.size(); i++) {
-    vtemp[i] = miss_values[i] ^ packed_recon_shares[0][i] ^ packed_recon_shares[1][i] ^ packed_recon_shares[2][i] ^ packed_recon_shares[3][i];
+  std::vector<BoolSlice> vres = recon_shares.rowSums();
+  const auto* miss_values1 = reinterpret_cast<const BoolSlice*>(
+      jump.getValues(pidFromOffset(id, 1), pidFromOffset(id, 2), pidFromOffset(id, 3)).data());
+  const auto* miss_values2 = reinterpret_cast<const BoolSlice*>(
+      jump.getValues(pidFromOffset(id, 4), pidFromOffset(id, 5), pidFromOffset(id, 6)).data());
+  for (size_t i = 0; i < num; i++) {
+    vres[i] += miss_values1[i] + miss_values2[i];
   }
-  vres = BoolRing::unpack(vtemp.data(), num);
   jump.reset();
   return vres;
 }
@@ -1531,32 +1705,26 @@ std::vector<BoolRing> BoolEvaluator::reconstruct(
 void BoolEvaluator::evaluateGatesAtDepth(size_t depth, io::NetIOMP<NUM_PARTIES>& network,
                                          ImprovedJmp& jump,
                                          ThreadPool& tpool) {
-  std::array<std::vector<BoolRing>, NUM_RSS> recon_shares;
-  for (size_t i = 0; i < vwires.size(); ++i) {
-    const auto& preproc = vpreproc[i];
-    auto& wires = vwires[i];
+  size_t num_mul = 0;
+  for (const auto& gate : circ.gates_by_level[depth]) {
+    if (gate->type == utils::GateType::kMul) {
+      ++num_mul;
+    }
+  }
+  ShareMatrix<BoolSlice> recon_shares(num_mul * vwires.size(), id);
+  size_t row = 0;
+  for (size_t s = 0; s < vwires.size(); ++s) {
+    const auto& mask = preproc.mask[s];
+    const auto& mask_prod = preproc.mask_prod[s];
+    const auto& wires = vwires[s];
 
     for (auto& gate : circ.gates_by_level[depth]) {
-      switch (gate->type) {
-        case utils::GateType::kMul: {
-          auto* g = static_cast<utils::FIn2Gate*>(gate.get());
-          auto& m_in1 = preproc[g->in1]->mask;
-          auto& m_in2 = preproc[g->in2]->mask;
-          auto* pre_out =
-              static_cast<PreprocMultGate<BoolRing>*>(preproc[g->out].get());
-
-          auto rec_share = pre_out->mask + pre_out->mask_prod -
-                           m_in1 * wires[g->in2] - m_in2 * wires[g->in1]; //wires[g->in1]和wires[g->in2]是两个β
-          // rec_share.add(wires[g->in1] * wires[g->in2], id);
-
-          for (int i = 0; i < NUM_RSS; ++i) {
-            recon_shares[i].push_back(rec_share[i]);
-          }
-          break;
-        }
-
-        default:
-          break;
+      if (gate->type == utils::GateType::kMul) {
+        auto* g = static_cast<utils::FIn2Gate*>(gate.get());
+        //wires[g->in1]和wires[g->in2]是两个β
+        recon_shares.setRow(row++, mask[g->out] + mask_prod[g->out] -
+                                       mask[g->in1] * wires[g->in2] -
+                                       mask[g->in2] * wires[g->in1]);
       }
     }
   }
@@ -1586,15 +1754,16 @@ void BoolEvaluator::evaluateGatesAtDepth(size_t depth, io::NetIOMP<NUM_PARTIES>&
           break;
         }
 
+        // 常数对所有实例相同：异或常数 1 即全部取反，与常数 0 即清零
         case utils::GateType::kConstAdd: {
           auto* g = static_cast<utils::ConstOpGate<BoolRing>*>(gate.get());
-          wires[g->out] = wires[g->in] + g->cval;
+          wires[g->out] = wires[g->in] + BoolSlice(g->cval.val() ? ~uint64_t(0) : 0);
           break;
         }
 
         case utils::GateType::kConstMul: {
           auto* g = static_cast<utils::ConstOpGate<BoolRing>*>(gate.get());
-          wires[g->out] = wires[g->in] * g->cval;
+          wires[g->out] = wires[g->in] * BoolSlice(g->cval.val() ? ~uint64_t(0) : 0);
           break;
         }
 
@@ -1614,30 +1783,34 @@ void BoolEvaluator::evaluateAllLevels(io::NetIOMP<NUM_PARTIES>& network,
 
 std::vector<std::vector<BoolRing>> BoolEvaluator::getOutputShares(io::NetIOMP<NUM_PARTIES>& network,
                                       ImprovedJmp& jump, ThreadPool& tpool) {
-  std::vector<std::vector<BoolRing>> outputs(vwires.size(), std::vector<BoolRing>(circ.outputs.size()));
-  //circ是MSB形成的bool环
-  for (size_t i = 0; i < vwires.size(); ++i) {
-    auto& preproc = vpreproc[i];
-    const auto& wires = vwires[i];
-
-    std::vector<ReplicatedShare<BoolRing>> shares;
-    for (size_t j = 0; j < circ.outputs.size(); ++j) {
-      auto wout = circ.outputs[j];
-      shares.push_back(preproc[wout]->mask);
+  //circ是MSB形成的bool环，所有组的输出掩码一次重构
+  ShareMatrix<BoolSlice> recon_shares(preproc.mask.size() * circ.outputs.size(), id);
+  size_t row = 0;
+  for (const auto& mask : preproc.mask) {
+    for (auto wout : circ.outputs) {
+      recon_shares.setRow(row++, mask[wout]);
     }
+  }
+  auto sum = reconstruct(id, recon_shares, network, jump, tpool);
 
-    std::array<std::vector<BoolRing>, NUM_RSS> recon_shares;
-    for (const auto& s : shares) {
-      for (size_t i = 0; i < NUM_RSS; ++i) {
-        recon_shares[i].push_back(s[i]);
-      }
-    }
-    auto sum = reconstruct(id, recon_shares, network, jump, tpool);
+  std::vector<std::vector<BoolRing>> outputs(preproc.num_instances, std::vector<BoolRing>(circ.outputs.size()));
+  for (size_t s = 0; s < vwires.size(); ++s) {
     for (size_t j = 0; j < circ.outputs.size(); ++j) {
-      auto wout = circ.outputs[j];
-      outputs[i][j] = wires[wout] - sum[j];
+      auto value = vwires[s][circ.outputs[j]] - sum[s * circ.outputs.size() + j];
+      for (size_t lane = 0; lane < BoolSlice::kLanes; ++lane) {
+        size_t i = s * BoolSlice::kLanes + lane;
+        if (i >= preproc.num_instances) {
+          break;
+        }
+        outputs[i][j] = value.lane(lane);
+      }
     }
   }
   return outputs;
 }
+
+template class OnlineEvaluator<Ring32>;
+template class OnlineEvaluator<Ring64>;
+template class OnlineEvaluator<Ring128>;
+
 };  // namespace SemiHoRGod
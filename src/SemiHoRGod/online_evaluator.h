@@ -16,90 +16,133 @@
 #include <omp.h>
 using namespace SemiHoRGod;
 namespace SemiHoRGod {
+// Instantiated for Ring32, Ring64 and Ring128 (see online_evaluator.cpp).
+template <class R>
 class OnlineEvaluator {
+  // Fixed-point parameters of R.
+  static constexpr size_t kFraction = FixedPoint<R>::kFraction;
+  static constexpr size_t kBitsGamma = FixedPoint<R>::kBitsGamma;
+  static constexpr size_t kBitsBeta = FixedPoint<R>::kBitsBeta;
+
   int id_; //标记自身的id
   int security_param_; //安全参数
-  Ring msb_temp_value_ ;
-  Ring relu_temp_value_ ;
+  R msb_temp_value_ ;
+  R relu_temp_value_ ;
   RandGenPool rgen_;  //随机数生成器
   std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network_;
-  PreprocCircuit<Ring> preproc_; //预处理环
+  PreprocCircuit<R> preproc_; //预处理环
   utils::LevelOrderedCircuit circ_; //
-  std::vector<Ring> wires_; //Ring = uint64_t
+  std::vector<R> wires_;
   ImprovedJmp jump_; //联合消息传输协议
   std::shared_ptr<ThreadPool> tpool_; //多线程
   utils::LevelOrderedCircuit msb_circ_;
 
-  std::vector<Ring> my_betas_;
-  std::vector<Ring> my_betas_perm_;
-  vector<ReplicatedShare<Ring>> data_sharing_vec_;
-  PreprocCircuit_permutation<Ring> preproc_perm_;
+  std::vector<R> my_betas_;
+  std::vector<R> my_betas_perm_;
+  vector<ReplicatedShare<R>> data_sharing_vec_;
+  PreprocCircuit_permutation<R> preproc_perm_;
 
   // Reconstruct shares stored in recon_shares_.
   // Argument format is more suitable for communication compared to
-  // vector<ReplicatedShare<Ring>>.
-  std::vector<Ring> elementwise_sum(const std::array<std::vector<Ring>, NUM_RSS>& recon_shares, int i, int j, int k);
-  std::vector<Ring> reconstruct(
-      const std::array<std::vector<Ring>, NUM_RSS>& recon_shares); //通过秘密重构数据
+  // vector<ReplicatedShare<R>>.
+  std::vector<R> reconstruct(const ShareMatrix<R>& recon_shares); //通过秘密重构数据
+
+  // 异步重构：startReconstruct 发出数据后立即返回，调用者可以在数据传输期间做本地计算，
+  // 再由 finishReconstruct 逐通道等待并得到结果。outgoing 保存发送数据直到本轮结束。
+  struct PendingReconstruct {
+    const ShareMatrix<R>* recon_shares = nullptr;
+    std::vector<std::vector<R>> outgoing;
+    JumpRound round;
+  };
+  PendingReconstruct startReconstruct(const ShareMatrix<R>& recon_shares);
+  std::vector<R> finishReconstruct(PendingReconstruct& pending);
 
-  std::array<std::vector<Ring>, NUM_RSS> reluEvaluate(
+  std::array<std::vector<R>, NUM_RSS> reluEvaluate(
       const std::vector<utils::FIn1Gate>& relu_gates);
 
-  std::array<std::vector<Ring>, NUM_RSS> msbEvaluate(
+  std::array<std::vector<R>, NUM_RSS> msbEvaluate(
       const std::vector<utils::FIn1Gate>& msb_gates);
 
  public:
   OnlineEvaluator(int id, std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                  PreprocCircuit<Ring> preproc, utils::LevelOrderedCircuit circ,
+                  PreprocCircuit<R> preproc, utils::LevelOrderedCircuit circ,
                   int security_param, int threads, int seed = 200);
 
   OnlineEvaluator(int id, std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                  PreprocCircuit<Ring> preproc, utils::LevelOrderedCircuit circ,
+                  PreprocCircuit<R> preproc, utils::LevelOrderedCircuit circ,
                   int security_param, std::shared_ptr<ThreadPool> tpool,
                   int seed = 200);
 
    OnlineEvaluator(int id, std::shared_ptr<io::NetIOMP<NUM_PARTIES>> network,
-                  PreprocCircuit_permutation<Ring> preproc_perm, utils::LevelOrderedCircuit circ,
+                  PreprocCircuit_permutation<R> preproc_perm, utils::LevelOrderedCircuit circ,
                   int security_param, int threads, int seed = 200);
   // Secret share inputs.
   // 'inputs' is a mapping from wire id to input value with entries for only
   // those inputs provided by this party.
-  void setInputs(const std::unordered_map<utils::wire_t, Ring>& inputs);
-  void setBetaVectors(const std::vector<Ring>& my_betas, const std::vector<Ring>& my_beta_perm);
-  void setInputs_perm(vector<Ring> data_vector, vector<Ring> permutation_vector);
+  void setInputs(const std::unordered_map<utils::wire_t, R>& inputs);
+  void setBetaVectors(const std::vector<R>& my_betas, const std::vector<R>& my_beta_perm);
+  void setInputs_perm(vector<R> data_vector, vector<R> permutation_vector);
   // Set random values on circuit input wires.
   void setRandomInputs();
   // Evaluate gates at depth 'depth'.
   // This method should be called in increasing order of 'depth' values.
   void evaluateGatesAtDepth(size_t depth);
   void evaluateGatesAtDepth_parallel(size_t depth, size_t computation_threads);
+  // Defer the jump hash checks: reconstructed values are used right away and
+  // the digests are compared at verify(), every `interval` rounds when
+  // `interval` is non-zero, and always at the end of getOutputs().
+  void setDeferredVerification(bool enable, size_t interval = 0);
+  // Checkpoint for deferred verification; no-op otherwise.
+  void verify();
+  // Only one sender per jump ships the payload, the other two send digests.
+  void setSingleValueSender(bool enable);
+  // Assignment of value and digest duties within each jump sender triple.
+  void setJumpRolePolicy(JumpRolePolicy policy, size_t replan_interval = 0);
+  // Measures all links for JumpRolePolicy::kBandwidthAware. Called by all
+  // parties between rounds.
+  void probeJumpLinks(size_t nbytes = 1 << 20);
+  // Jump rounds complete on the first consistent value instead of waiting
+  // for all three senders.
+  void setFirstArrival(bool enable);
   // Compute and returns circuit outputs.
-  std::vector<Ring> getOutputs();
-  std::vector<Ring> getOutputs_perm();
+  std::vector<R> getOutputs();
+  std::vector<R> getOutputs_perm();
   // Utility function to reconstruct vector of shares.
-  std::vector<Ring> reconstruct(
-      const std::vector<ReplicatedShare<Ring>>& shares);
+  std::vector<R> reconstruct(
+      const std::vector<ReplicatedShare<R>>& shares);
 
   // Evaluate online phase for circuit.
-  std::vector<Ring> evaluateCircuit(
-      const std::unordered_map<utils::wire_t, Ring>& inputs);
-  std::vector<Ring> evaluateCircuit_perm(vector<Ring> data_vector, vector<Ring> permutation_vector);
-  void evaluateCircuit_perm_no_input(vector<Ring> data_vector, vector<Ring> permutation_vector);
+  std::vector<R> evaluateCircuit(
+      const std::unordered_map<utils::wire_t, R>& inputs);
+  std::vector<R> evaluateCircuit_perm(vector<R> data_vector, vector<R> permutation_vector);
+  void evaluateCircuit_perm_no_input(vector<R> data_vector, vector<R> permutation_vector);
 };
 
 // Helper class to efficiently evaluate online phase on boolean circuit.
+// 同一布尔电路的多个实例（例如一批 MSB 门的 PPA 电路）按位切片求值：每 64 个实例为一组，
+// 组内每条线的 β 和每个掩码份额分量各占一个 BoolSlice，与/异或都是按字运算。
 struct BoolEvaluator {
   int id;
-  std::vector<std::vector<BoolRing>> vwires;
-  std::vector<preprocg_ptr_t<BoolRing>*> vpreproc;
+  BoolSlicedPreproc preproc;
+  // [组][线]，第 i 个实例在第 i / 64 组的第 i % 64 位。
+  std::vector<std::vector<BoolSlice>> vwires;
   utils::LevelOrderedCircuit circ;
 
-  explicit BoolEvaluator(int my_id,
-                         std::vector<preprocg_ptr_t<BoolRing>*> vpreproc,
+  explicit BoolEvaluator(int my_id, BoolSlicedPreproc preproc,
                          utils::LevelOrderedCircuit circ);
+  // vpreproc[i] 是第 i 个实例按线存放的预处理数据，先经 slice 转置。
+  explicit BoolEvaluator(int my_id,
+                         const std::vector<preprocg_ptr_t<BoolRing>*>& vpreproc,
+                         const utils::LevelOrderedCircuit& circ);
+
+  // 把各实例的掩码转置为按位切片的形式。与实例数和线数成正比，可以在在线阶段之前完成。
+  static BoolSlicedPreproc slice(const std::vector<preprocg_ptr_t<BoolRing>*>& vpreproc,
+                                 const utils::LevelOrderedCircuit& circ);
+  static size_t numSlices(size_t num_instances);
+  void setWire(size_t instance, utils::wire_t wire, BoolRing value);
 
-  static std::vector<BoolRing> reconstruct(
-      int id, const std::array<std::vector<BoolRing>, NUM_RSS>& recon_shares,
+  static std::vector<BoolSlice> reconstruct(
+      int id, const ShareMatrix<BoolSlice>& recon_shares,
       io::NetIOMP<NUM_PARTIES>& network, ImprovedJmp& jump, ThreadPool& tpool);
 
   void evaluateGatesAtDepth(size_t depth, io::NetIOMP<NUM_PARTIES>& network,
@@ -107,6 +150,7 @@ struct BoolEvaluator {
   void evaluateAllLevels(io::NetIOMP<NUM_PARTIES>& network, ImprovedJmp& jump,
                          ThreadPool& tpool);
 
+  // 返回 [实例][输出] 的明文结果。
   std::vector<std::vector<BoolRing>> getOutputShares(io::NetIOMP<NUM_PARTIES>& network,
                                       ImprovedJmp& jump, ThreadPool& tpool);
 };
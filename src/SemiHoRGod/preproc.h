@@ -8,12 +8,13 @@ namespace SemiHoRGod {
 // Preprocessed data for a gate.
 template <class R>
 struct PreprocGate {
-  // Secret shared mask for the output wire of the gate.
-  ReplicatedShare<R> mask{};
+  // Secret shared mask for the output wire of the gate. Like every share in
+  // the preprocessed gates, only the 15 elements this party holds are kept.
+  CompactShare<R> mask{};
 
   PreprocGate() = default;
 
-  explicit PreprocGate(const ReplicatedShare<R>& mask) : mask(mask) {}
+  explicit PreprocGate(const CompactShare<R>& mask) : mask(mask) {}
 
   virtual ~PreprocGate() = default;
 };
@@ -30,39 +31,39 @@ struct PreprocInput : public PreprocGate<R> {
   R mask_value{};
 
   PreprocInput() = default;
-  PreprocInput(const ReplicatedShare<R>& mask, int pid, R mask_value = 0)
+  PreprocInput(const CompactShare<R>& mask, int pid, R mask_value = 0)
       : PreprocGate<R>(mask), pid(pid), mask_value(mask_value) {}
 };
 
 template <class R>
 struct PreprocMultGate : public PreprocGate<R> {
   // Secret shared product of inputs masks.
-  ReplicatedShare<R> mask_prod{};
+  CompactShare<R> mask_prod{};
 
   PreprocMultGate() = default;
-  PreprocMultGate(const ReplicatedShare<R>& mask,
-                  const ReplicatedShare<R>& mask_prod)
+  PreprocMultGate(const CompactShare<R>& mask,
+                  const CompactShare<R>& mask_prod)
       : PreprocGate<R>(mask), mask_prod(mask_prod) {}
 };
 
 template <class R>
 struct PreprocCmpGate : public PreprocGate<R> {
   // Secret shared product of inputs masks.
-  ReplicatedShare<R> mask_prod{};
-  ReplicatedShare<R> mask_mu_1{};
-  ReplicatedShare<R> mask_mu_2{};
+  CompactShare<R> mask_prod{};
+  CompactShare<R> mask_mu_1{};
+  CompactShare<R> mask_mu_2{};
   R beta_mu_1;
   R beta_mu_2;
-  ReplicatedShare<R> prev_mask{}; 
+  CompactShare<R> prev_mask{}; 
   //比较运算比较特殊，涉及到多个门，通常来说α要在离线提前计算完成，但是Cmp需要一个乘法和一个const 加法，乘法的中间变量的alpha是需要用的，所以需要保存下来用来计算乘法
   PreprocCmpGate() = default;
-  PreprocCmpGate(const ReplicatedShare<R>& mask,
-                  const ReplicatedShare<R>& mask_prod,
-                  const ReplicatedShare<R>& mask_mu_1,
-                  const ReplicatedShare<R>& mask_mu_2,
-                  const Ring beta_mu_1,
-                  const Ring beta_mu_2,
-                  const ReplicatedShare<R>& prev_mask)
+  PreprocCmpGate(const CompactShare<R>& mask,
+                  const CompactShare<R>& mask_prod,
+                  const CompactShare<R>& mask_mu_1,
+                  const CompactShare<R>& mask_mu_2,
+                  const R beta_mu_1,
+                  const R beta_mu_2,
+                  const CompactShare<R>& prev_mask)
       : PreprocGate<R>(mask), mask_prod(mask_prod), 
       mask_mu_1(mask_mu_1), mask_mu_2(mask_mu_2), beta_mu_1(beta_mu_1), beta_mu_2(beta_mu_2), prev_mask(prev_mask) {}
 };
@@ -70,24 +71,24 @@ struct PreprocCmpGate : public PreprocGate<R> {
 template <class R>
 struct PreprocReluGate : public PreprocGate<R> {
   // Secret shared product of inputs masks.
-  ReplicatedShare<R> mask_prod{};
-  ReplicatedShare<R> mask_mu_1{};
-  ReplicatedShare<R> mask_mu_2{};
+  CompactShare<R> mask_prod{};
+  CompactShare<R> mask_mu_1{};
+  CompactShare<R> mask_mu_2{};
   R beta_mu_1;
   R beta_mu_2;
-  ReplicatedShare<R> prev_mask{}; //如果比较结果大于0，那么直接返回原始值，所以这里需要保存一个输入mask
-  ReplicatedShare<R> mask_prod2{};
-  ReplicatedShare<R> mask_for_mul{};
+  CompactShare<R> prev_mask{}; //如果比较结果大于0，那么直接返回原始值，所以这里需要保存一个输入mask
+  CompactShare<R> mask_prod2{};
+  CompactShare<R> mask_for_mul{};
   PreprocReluGate() = default;
-  PreprocReluGate(const ReplicatedShare<R>& mask,
-                  const ReplicatedShare<R>& mask_prod,
-                  const ReplicatedShare<R>& mask_mu_1,
-                  const ReplicatedShare<R>& mask_mu_2,
-                  const Ring beta_mu_1,
-                  const Ring beta_mu_2,
-                  const ReplicatedShare<R>& prev_mask,
-                  const ReplicatedShare<R>& mask_prod2,
-                  const ReplicatedShare<R>& mask_for_mul)
+  PreprocReluGate(const CompactShare<R>& mask,
+                  const CompactShare<R>& mask_prod,
+                  const CompactShare<R>& mask_mu_1,
+                  const CompactShare<R>& mask_mu_2,
+                  const R beta_mu_1,
+                  const R beta_mu_2,
+                  const CompactShare<R>& prev_mask,
+                  const CompactShare<R>& mask_prod2,
+                  const CompactShare<R>& mask_for_mul)
       : PreprocGate<R>(mask), mask_prod(mask_prod), 
       mask_mu_1(mask_mu_1), mask_mu_2(mask_mu_2), beta_mu_1(beta_mu_1), 
       beta_mu_2(beta_mu_2), prev_mask(prev_mask), mask_prod2(mask_prod2),
@@ -96,36 +97,36 @@ struct PreprocReluGate : public PreprocGate<R> {
 
 template <class R>
 struct PreprocDotpGate : public PreprocGate<R> {
-  ReplicatedShare<Ring> mask_prod{};
+  CompactShare<R> mask_prod{};
 
   PreprocDotpGate() = default;
-  PreprocDotpGate(const ReplicatedShare<Ring>& mask,
-                  const ReplicatedShare<Ring>& mask_prod)
+  PreprocDotpGate(const CompactShare<R>& mask,
+                  const CompactShare<R>& mask_prod)
       : PreprocGate<R>(mask), mask_prod(mask_prod) {}
 };
 
 template <class R>
 struct PreprocTrDotpGate : public PreprocGate<R> {
-  ReplicatedShare<Ring> mask_prod{};
-  ReplicatedShare<Ring> mask_d{};
+  CompactShare<R> mask_prod{};
+  CompactShare<R> mask_d{};
 
   PreprocTrDotpGate() = default;
-  PreprocTrDotpGate(const ReplicatedShare<Ring>& mask,
-                    const ReplicatedShare<Ring>& mask_prod,
-                    const ReplicatedShare<Ring>& mask_d)
+  PreprocTrDotpGate(const CompactShare<R>& mask,
+                    const CompactShare<R>& mask_prod,
+                    const CompactShare<R>& mask_d)
       : PreprocGate<R>(mask), mask_prod(mask_prod), mask_d(mask_d) {}
 };
 
 template <class R>
 struct PreprocMsbGate : public PreprocGate<R> {
   std::vector<preprocg_ptr_t<BoolRing>> msb_gates;
-  ReplicatedShare<R> mask_msb;
-  ReplicatedShare<R> mask_w;
+  CompactShare<R> mask_msb;
+  CompactShare<R> mask_w;
 
   PreprocMsbGate() = default;
-  PreprocMsbGate(ReplicatedShare<R> mask,
+  PreprocMsbGate(CompactShare<R> mask,
                  std::vector<preprocg_ptr_t<BoolRing>> msb_gates,
-                 ReplicatedShare<R> mask_msb, ReplicatedShare<R> mask_w)
+                 CompactShare<R> mask_msb, CompactShare<R> mask_w)
       : PreprocGate<R>(mask),
         msb_gates(std::move(msb_gates)),
         mask_msb(mask_msb),
@@ -133,6 +134,15 @@ struct PreprocMsbGate : public PreprocGate<R> {
 };
 
 
+// 布尔电路多个实例的预处理数据按位切片后的形式（见 BoolSlice 和 BoolEvaluator）：
+// 下标为 [组][线]，第 i 个实例在第 i / 64 组的第 i % 64 位。
+struct BoolSlicedPreproc {
+  size_t num_instances = 0;
+  std::vector<std::vector<CompactShare<BoolSlice>>> mask;
+  // 只有乘法门的输出线有值。
+  std::vector<std::vector<CompactShare<BoolSlice>>> mask_prod;
+};
+
 // Preprocessed data for output wires.
 struct PreprocOutput {
   // Commitment corresponding to share elements not available with the party
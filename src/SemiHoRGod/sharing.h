@@ -2,27 +2,194 @@
 
 #include <emp-tool/emp-tool.h>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <boost/format.hpp>
+
 #include "helpers.h"
 #include "types.h"
 
 
 namespace SemiHoRGod {
 
+namespace detail {
+
+// Fills data[0..n) with random ring elements. BoolRing holds a bool, so its
+// elements are drawn as bytes and reduced to one bit; random bytes copied
+// straight into a bool are not a valid value.
+template <class R>
+void randomElements(emp::PRG& prg, R* data, size_t n) {
+  if constexpr (std::is_same_v<R, BoolRing>) {
+    std::vector<uint8_t> bytes(n);
+    prg.random_data(bytes.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      data[i] = BoolRing((bytes[i] & 1U) != 0);
+    }
+  } else {
+    prg.random_data(data, sizeof(R) * n);
+  }
+}
+
+// Expression templates for share arithmetic. With ReplicatedShare or
+// CompactShare operands, `a + b - c * x` builds a tree of the nodes below
+// instead of a temporary share per operator; the tree is evaluated in a single
+// loop over the share elements once it is stored into a share (or a
+// ShareMatrix row). Every node knows the share type it evaluates to and gives
+// element k of its value through eval(k) (or operator[], read only).
+//
+// Operands that are lvalue shares are held by reference, temporaries and
+// nodes by value, so an expression kept in an `auto` variable does not
+// dangle. It is still only a recipe: it is evaluated again on every use and
+// sees later changes to its operands, so name the share type when the value
+// is meant to be kept.
+template <class S>
+struct ShareExpr {
+  using share_type = S;
+};
+
+template <class E>
+using expr_share_t = typename std::decay_t<E>::share_type;
+
+template <class E, class = void>
+struct is_share_expr : std::false_type {};
+
+template <class E>
+struct is_share_expr<E, std::void_t<expr_share_t<E>>>
+    : std::is_base_of<ShareExpr<expr_share_t<E>>, std::decay_t<E>> {};
+
+template <class E>
+inline constexpr bool is_share_expr_v = is_share_expr<E>::value;
+
+// Expressions that evaluate to S, other than S itself.
+template <class E, class S, class = void>
+struct is_expr_of : std::false_type {};
+
+template <class E, class S>
+struct is_expr_of<E, S, std::enable_if_t<is_share_expr_v<E>>>
+    : std::bool_constant<std::is_same_v<expr_share_t<E>, S> &&
+                         !std::is_same_v<std::decay_t<E>, S>> {};
+
+template <class E, class S>
+inline constexpr bool is_expr_of_v = is_expr_of<E, S>::value;
+
+// How a node stores an operand passed as E&&.
+template <class E>
+using expr_operand_t =
+    std::conditional_t<std::is_lvalue_reference_v<E> &&
+                           std::is_same_v<std::decay_t<E>, expr_share_t<E>>,
+                       const std::decay_t<E>&, std::decay_t<E>>;
+
+// lhs + rhs, or lhs - rhs when kSubtract.
+template <class L, class Rhs, bool kSubtract>
+struct SumExpr : ShareExpr<expr_share_t<L>> {
+  using value_type = typename expr_share_t<L>::value_type;
+
+  L lhs;
+  Rhs rhs;
+
+  template <class A, class B>
+  SumExpr(A&& a, B&& b) : lhs(std::forward<A>(a)), rhs(std::forward<B>(b)) {}
+
+  value_type eval(size_t k) const {
+    if constexpr (kSubtract) {
+      return lhs.eval(k) - rhs.eval(k);
+    } else {
+      return lhs.eval(k) + rhs.eval(k);
+    }
+  }
+
+  value_type operator[](size_t k) const { return eval(k); }
+};
+
+// expr * scalar, with a public scalar.
+template <class E>
+struct ScaleExpr : ShareExpr<expr_share_t<E>> {
+  using value_type = typename expr_share_t<E>::value_type;
+
+  E expr;
+  value_type scalar;
+
+  template <class A>
+  ScaleExpr(A&& a, const value_type& s) : expr(std::forward<A>(a)), scalar(s) {}
+
+  value_type eval(size_t k) const { return expr.eval(k) * scalar; }
+
+  value_type operator[](size_t k) const { return eval(k); }
+};
+
+template <class E>
+using expr_value_t = typename expr_share_t<E>::value_type;
+
+}  // namespace detail
+
+template <class L, class Rhs,
+          class = std::enable_if_t<detail::is_share_expr_v<L> && detail::is_share_expr_v<Rhs>>>
+auto operator+(L&& lhs, Rhs&& rhs) {
+  static_assert(std::is_same_v<detail::expr_share_t<L>, detail::expr_share_t<Rhs>>,
+                "operands of + must be shares of the same type");
+  return detail::SumExpr<detail::expr_operand_t<L&&>, detail::expr_operand_t<Rhs&&>, false>(
+      std::forward<L>(lhs), std::forward<Rhs>(rhs));
+}
+
+template <class L, class Rhs,
+          class = std::enable_if_t<detail::is_share_expr_v<L> && detail::is_share_expr_v<Rhs>>>
+auto operator-(L&& lhs, Rhs&& rhs) {
+  static_assert(std::is_same_v<detail::expr_share_t<L>, detail::expr_share_t<Rhs>>,
+                "operands of - must be shares of the same type");
+  return detail::SumExpr<detail::expr_operand_t<L&&>, detail::expr_operand_t<Rhs&&>, true>(
+      std::forward<L>(lhs), std::forward<Rhs>(rhs));
+}
+
+template <class E, class = std::enable_if_t<detail::is_share_expr_v<E>>>
+auto operator*(E&& expr, const detail::expr_value_t<E>& scalar) {
+  return detail::ScaleExpr<detail::expr_operand_t<E&&>>(std::forward<E>(expr), scalar);
+}
+
 template <class R>
-class ReplicatedShare {
+class ReplicatedShare : public detail::ShareExpr<ReplicatedShare<R>> {
   // values_[i] will denote element common with party having my_id + i + 1.
   std::array<R, NUM_RSS> values_; //
 
+  template <class E>
+  using if_expr = std::enable_if_t<detail::is_expr_of_v<E, ReplicatedShare<R>>>;
+
  public:
+  using value_type = R;
+
   ReplicatedShare() = default;
   explicit ReplicatedShare(std::array<R, NUM_RSS> values)
       : values_{std::move(values)} {}
 
+  // Evaluates a share expression such as `a + b - c * x` (see detail::ShareExpr).
+  template <class E, class = if_expr<E>>
+  ReplicatedShare(const E& expr) {
+    for (size_t i = 0; i < NUM_RSS; ++i) {
+      values_[i] = expr.eval(i);
+    }
+  }
+
+  template <class E, class = if_expr<E>>
+  ReplicatedShare<R>& operator=(const E& expr) {
+    for (size_t i = 0; i < NUM_RSS; ++i) {
+      values_[i] = expr.eval(i);
+    }
+    return *this;
+  }
+
   void randomize(emp::PRG& prg) {
-    prg.random_data(values_.data(), sizeof(R) * NUM_RSS);
+    detail::randomElements(prg, values_.data(), NUM_RSS);
   }
 
   void init_zero() {
@@ -32,9 +199,19 @@ class ReplicatedShare {
   }
   // Access share elements.
   // idx = i retreives value common with party having my_id + i + 1.
-  R& operator[](size_t idx) { return values_.at(idx); }
+  // 只在调试构建中检查下标
+  R& operator[](size_t idx) {
+    assert(idx < NUM_RSS);
+    return values_[idx];
+  }
+
+  R operator[](size_t idx) const {
+    assert(idx < NUM_RSS);
+    return values_[idx];
+  }
 
-  R operator[](size_t idx) const { return values_.at(idx); }
+  // Element idx as a leaf of a share expression.
+  R eval(size_t idx) const { return values_[idx]; }
   
   [[nodiscard]] R sum() const {
     R result = 0;
@@ -44,15 +221,26 @@ class ReplicatedShare {
     return result; 
   }
 
-  // Arithmetic operators.
-  ReplicatedShare<R>& operator+=(const ReplicatedShare<R> rhs) {
-    for(int i = 0;i<NUM_RSS;i++) {
-      values_[i] += rhs.values_[i];
+  // Arithmetic operators. +, - and * by a public value build expressions
+  // (see detail::ShareExpr); the compound assignments evaluate them in place.
+  template <class E, class = std::enable_if_t<detail::is_share_expr_v<E>>>
+  ReplicatedShare<R>& operator+=(const E& rhs) {
+    static_assert(std::is_same_v<detail::expr_share_t<E>, ReplicatedShare<R>>);
+    for (size_t i = 0; i < NUM_RSS; ++i) {
+      values_[i] += rhs.eval(i);
+    }
+    return *this;
+  }
+
+  template <class E, class = std::enable_if_t<detail::is_share_expr_v<E>>>
+  ReplicatedShare<R>& operator-=(const E& rhs) {
+    static_assert(std::is_same_v<detail::expr_share_t<E>, ReplicatedShare<R>>);
+    for (size_t i = 0; i < NUM_RSS; ++i) {
+      values_[i] -= rhs.eval(i);
     }
     return *this;
   }
 
-  
   ReplicatedShare<R> cosnt_add(const R& rhs) const {
     ReplicatedShare<R> result = *this;  // 复制当前对象
     for(int i = 0;i<NUM_RSS;i++) {
@@ -69,23 +257,6 @@ class ReplicatedShare {
     return result;
   }
 
-  friend ReplicatedShare<R> operator+(ReplicatedShare<R> lhs,
-                                      const ReplicatedShare<R>& rhs) {
-    lhs += rhs;
-    return lhs;
-  }
-
-  ReplicatedShare<R>& operator-=(const ReplicatedShare<R>& rhs) {
-    (*this) += (rhs * -1);
-    return *this;
-  }
-
-  friend ReplicatedShare<R> operator-(ReplicatedShare<R> lhs,
-                                      const ReplicatedShare<R>& rhs) {
-    lhs -= rhs;
-    return lhs;
-  }
-
   ReplicatedShare<R>& operator*=(const R& rhs) {
     for(int i = 0;i<NUM_RSS;i++) {
       values_[i] *= rhs;
@@ -93,11 +264,6 @@ class ReplicatedShare {
     return *this;
   }
 
-  friend ReplicatedShare<R> operator*(ReplicatedShare<R> lhs, const R& rhs) {
-    lhs *= rhs;
-    return lhs;
-  }
-
   ReplicatedShare<R>& add(R val, int pid) {
     // if (pid == 0) {
     //   values_[0] += val;
@@ -110,6 +276,543 @@ class ReplicatedShare {
   }
 };
 
+namespace detail {
+
+// Index translation between ReplicatedShare (all 21 pairs) and CompactShare
+// (the 15 pairs a party holds). global[p][k] is the ReplicatedShare index of
+// element k of party p's CompactShare; compact[p][idx] is the inverse, or -1
+// for the 6 pairs that contain p. Both tables are built at compile time.
+struct HeldIndex {
+  std::array<std::array<uint8_t, NUM_HELD_RSS>, NUM_PARTIES> global{};
+  std::array<std::array<int8_t, NUM_RSS>, NUM_PARTIES> compact{};
+};
+
+constexpr HeldIndex makeHeldIndex() {
+  HeldIndex table{};
+  for (int p = 0; p < NUM_PARTIES; ++p) {
+    int k = 0;
+    // 与 upperTriangularToArray 相同的编号：数对 (i, j), i < j 对应 j(j-1)/2 + i，
+    // 按 idx 递增的顺序遍历，所以压缩后的分量保持原来的相对顺序
+    for (int j = 1; j < NUM_PARTIES; ++j) {
+      for (int i = 0; i < j; ++i) {
+        int idx = j * (j - 1) / 2 + i;
+        if (i == p || j == p) {
+          table.compact[p][idx] = -1;
+        } else {
+          table.global[p][k] = static_cast<uint8_t>(idx);
+          table.compact[p][idx] = static_cast<int8_t>(k);
+          ++k;
+        }
+      }
+    }
+  }
+  return table;
+}
+
+inline constexpr HeldIndex kHeldIndex = makeHeldIndex();
+
+static_assert(kHeldIndex.compact[0][0] == -1 && kHeldIndex.global[0][0] == 2 &&
+                  kHeldIndex.global[0][NUM_HELD_RSS - 1] == 20 &&
+                  kHeldIndex.global[6][NUM_HELD_RSS - 1] == 14,
+              "unexpected pair numbering");
+
+// Allocator for the columns of ShareMatrix: 64-byte alignment lets every
+// column start on a cache line and an AVX-512 register boundary.
+template <class T>
+struct AlignedAllocator {
+  using value_type = T;
+  static constexpr size_t kAlignment = 64;
+
+  AlignedAllocator() = default;
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U>& /*other*/) {}
+
+  T* allocate(size_t n) {
+    size_t bytes = (n * sizeof(T) + kAlignment - 1) / kAlignment * kAlignment;
+    void* ptr = std::aligned_alloc(kAlignment, bytes);
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, size_t /*n*/) { std::free(ptr); }
+
+  template <class U>
+  bool operator==(const AlignedAllocator<U>& /*other*/) const { return true; }
+  template <class U>
+  bool operator!=(const AlignedAllocator<U>& /*other*/) const { return false; }
+};
+
+// 以下内核对 uint64_t 和 uint32_t 使用 AVX-512 / AVX2 指令，其余类型（Ring128，以及
+// 未启用这些指令集时）使用普通循环，结果相同。
+
+// out[i] = a[i] + b[i]
+template <class R>
+void addKernel(R* out, const R* a, const R* b, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<R, uint64_t>) {
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+      __m512i va = _mm512_loadu_si512(a + i);
+      __m512i vb = _mm512_loadu_si512(b + i);
+      _mm512_storeu_si512(out + i, _mm512_add_epi64(va, vb));
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(va, vb));
+    }
+#endif
+  } else if constexpr (std::is_same_v<R, uint32_t>) {
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512i va = _mm512_loadu_si512(a + i);
+      __m512i vb = _mm512_loadu_si512(b + i);
+      _mm512_storeu_si512(out + i, _mm512_add_epi32(va, vb));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(va, vb));
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    out[i] = a[i] + b[i];
+  }
+}
+
+// out[i] = a[i] - b[i]
+template <class R>
+void subKernel(R* out, const R* a, const R* b, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<R, uint64_t>) {
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+      __m512i va = _mm512_loadu_si512(a + i);
+      __m512i vb = _mm512_loadu_si512(b + i);
+      _mm512_storeu_si512(out + i, _mm512_sub_epi64(va, vb));
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi64(va, vb));
+    }
+#endif
+  } else if constexpr (std::is_same_v<R, uint32_t>) {
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512i va = _mm512_loadu_si512(a + i);
+      __m512i vb = _mm512_loadu_si512(b + i);
+      _mm512_storeu_si512(out + i, _mm512_sub_epi32(va, vb));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi32(va, vb));
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    out[i] = a[i] - b[i];
+  }
+}
+
+#if defined(__AVX2__) && !(defined(__AVX512F__) && defined(__AVX512DQ__))
+// AVX2 没有 64 位乘法：a * b mod 2^64 = lo(a)lo(b) + ((lo(a)hi(b) + hi(a)lo(b)) << 32)
+inline __m256i mullo64(__m256i a, __m256i b) {
+  __m256i lo = _mm256_mul_epu32(a, b);
+  __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)),
+                                   _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+#endif
+
+// out[i] = acc[i] + sign * a[i] * v[i], sign = +1 or -1
+template <class R, bool kSubtract>
+void fmaKernel(R* out, const R* acc, const R* a, const R* v, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<R, uint64_t>) {
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    for (; i + 8 <= n; i += 8) {
+      __m512i prod = _mm512_mullo_epi64(_mm512_loadu_si512(a + i), _mm512_loadu_si512(v + i));
+      __m512i vacc = _mm512_loadu_si512(acc + i);
+      _mm512_storeu_si512(out + i, kSubtract ? _mm512_sub_epi64(vacc, prod)
+                                             : _mm512_add_epi64(vacc, prod));
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256i prod = mullo64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)));
+      __m256i vacc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          kSubtract ? _mm256_sub_epi64(vacc, prod) : _mm256_add_epi64(vacc, prod));
+    }
+#endif
+  } else if constexpr (std::is_same_v<R, uint32_t>) {
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512i prod = _mm512_mullo_epi32(_mm512_loadu_si512(a + i), _mm512_loadu_si512(v + i));
+      __m512i vacc = _mm512_loadu_si512(acc + i);
+      _mm512_storeu_si512(out + i, kSubtract ? _mm512_sub_epi32(vacc, prod)
+                                             : _mm512_add_epi32(vacc, prod));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256i prod = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)));
+      __m256i vacc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          kSubtract ? _mm256_sub_epi32(vacc, prod) : _mm256_add_epi32(vacc, prod));
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    if constexpr (kSubtract) {
+      out[i] = acc[i] - a[i] * v[i];
+    } else {
+      out[i] = acc[i] + a[i] * v[i];
+    }
+  }
+}
+
+// out[i] = a[i] * v[i]
+template <class R>
+void mulKernel(R* out, const R* a, const R* v, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<R, uint64_t>) {
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    for (; i + 8 <= n; i += 8) {
+      _mm512_storeu_si512(out + i, _mm512_mullo_epi64(_mm512_loadu_si512(a + i),
+                                                      _mm512_loadu_si512(v + i)));
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          mullo64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i))));
+    }
+#endif
+  } else if constexpr (std::is_same_v<R, uint32_t>) {
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      _mm512_storeu_si512(out + i, _mm512_mullo_epi32(_mm512_loadu_si512(a + i),
+                                                      _mm512_loadu_si512(v + i)));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i))));
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    out[i] = a[i] * v[i];
+  }
+}
+
+// out[i] = cols[0][i] + cols[1][i] + ... + cols[ncols - 1][i]，各行在寄存器中累加，
+// 每个输出只写一次
+template <class R>
+void columnSumKernel(R* out, const R* const* cols, size_t ncols, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<R, uint64_t>) {
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+      __m512i acc = _mm512_loadu_si512(cols[0] + i);
+      for (size_t c = 1; c < ncols; ++c) {
+        acc = _mm512_add_epi64(acc, _mm512_loadu_si512(cols[c] + i));
+      }
+      _mm512_storeu_si512(out + i, acc);
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols[0] + i));
+      for (size_t c = 1; c < ncols; ++c) {
+        acc = _mm256_add_epi64(
+            acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols[c] + i)));
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), acc);
+    }
+#endif
+  } else if constexpr (std::is_same_v<R, uint32_t>) {
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512i acc = _mm512_loadu_si512(cols[0] + i);
+      for (size_t c = 1; c < ncols; ++c) {
+        acc = _mm512_add_epi32(acc, _mm512_loadu_si512(cols[c] + i));
+      }
+      _mm512_storeu_si512(out + i, acc);
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols[0] + i));
+      for (size_t c = 1; c < ncols; ++c) {
+        acc = _mm256_add_epi32(
+            acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cols[c] + i)));
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), acc);
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    R acc = cols[0][i];
+    for (size_t c = 1; c < ncols; ++c) {
+      acc += cols[c][i];
+    }
+    out[i] = acc;
+  }
+}
+
+}  // namespace detail
+
+// The share elements one party actually holds. Of the 21 elements of a
+// ReplicatedShare, the 6 indexed by pairs that contain the party's own id are
+// always zero for that party; CompactShare stores only the other 15, in
+// increasing order of their ReplicatedShare index (see detail::kHeldIndex).
+// The party is not stored: converting from or to ReplicatedShare takes its id,
+// and arithmetic is only meaningful between shares of the same party.
+template <class R>
+class CompactShare : public detail::ShareExpr<CompactShare<R>> {
+  std::array<R, NUM_HELD_RSS> values_;
+
+  template <class E>
+  using if_expr = std::enable_if_t<detail::is_expr_of_v<E, CompactShare<R>>>;
+
+ public:
+  using value_type = R;
+
+  CompactShare() = default;
+  explicit CompactShare(std::array<R, NUM_HELD_RSS> values)
+      : values_{std::move(values)} {}
+
+  // Evaluates a share expression such as `a + b - c * x` (see detail::ShareExpr).
+  template <class E, class = if_expr<E>>
+  CompactShare(const E& expr) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] = expr.eval(k);
+    }
+  }
+
+  template <class E, class = if_expr<E>>
+  CompactShare<R>& operator=(const E& expr) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] = expr.eval(k);
+    }
+    return *this;
+  }
+
+  // Keeps the elements of `share` held by party `pid`.
+  CompactShare(const ReplicatedShare<R>& share, int pid) {
+    const auto& global = detail::kHeldIndex.global[pid];
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] = share[global[k]];
+    }
+  }
+
+  // The ReplicatedShare of party `pid`, with zeros at the pairs containing it.
+  [[nodiscard]] ReplicatedShare<R> expand(int pid) const {
+    std::array<R, NUM_RSS> values;
+    values.fill(R(0));
+    const auto& global = detail::kHeldIndex.global[pid];
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values[global[k]] = values_[k];
+    }
+    return ReplicatedShare<R>(values);
+  }
+
+  // Element `idx` (a ReplicatedShare index) of party `pid`'s share.
+  [[nodiscard]] R get(int pid, size_t idx) const {
+    auto k = detail::kHeldIndex.compact[pid][idx];
+    return k < 0 ? R(0) : values_[k];
+  }
+
+  void randomize(emp::PRG& prg) {
+    detail::randomElements(prg, values_.data(), NUM_HELD_RSS);
+  }
+
+  R& operator[](size_t k) {
+    assert(k < NUM_HELD_RSS);
+    return values_[k];
+  }
+
+  R operator[](size_t k) const {
+    assert(k < NUM_HELD_RSS);
+    return values_[k];
+  }
+
+  // Element k as a leaf of a share expression.
+  R eval(size_t k) const { return values_[k]; }
+
+  [[nodiscard]] R sum() const {
+    R sum = values_[0];
+    for (size_t k = 1; k < NUM_HELD_RSS; ++k) {
+      sum += values_[k];
+    }
+    return sum;
+  }
+
+  // +, - and * by a public value build expressions (see detail::ShareExpr);
+  // the compound assignments evaluate them in place.
+  template <class E, class = std::enable_if_t<detail::is_share_expr_v<E>>>
+  CompactShare<R>& operator+=(const E& rhs) {
+    static_assert(std::is_same_v<detail::expr_share_t<E>, CompactShare<R>>);
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] += rhs.eval(k);
+    }
+    return *this;
+  }
+
+  template <class E, class = std::enable_if_t<detail::is_share_expr_v<E>>>
+  CompactShare<R>& operator-=(const E& rhs) {
+    static_assert(std::is_same_v<detail::expr_share_t<E>, CompactShare<R>>);
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] -= rhs.eval(k);
+    }
+    return *this;
+  }
+
+  CompactShare<R>& operator*=(const R& rhs) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values_[k] *= rhs;
+    }
+    return *this;
+  }
+};
+
+// Shares of a batch of gates in structure-of-arrays layout: column c holds
+// element c of the share of every gate (row), so the kernels below and the
+// sums in reconstruct walk contiguous, aligned memory instead of 21-wide
+// arrays scattered over a vector of ReplicatedShare. Like CompactShare, a
+// matrix belongs to one party and has a column only for each of the 15
+// elements that party holds.
+template <class R>
+class ShareMatrix {
+ public:
+  ShareMatrix(size_t rows, int pid) : pid_(pid) { resize(rows); }
+
+  // Sets the number of rows; all elements become zero.
+  void resize(size_t rows) {
+    rows_ = rows;
+    // 每列按 64 字节对齐
+    constexpr size_t lanes = detail::AlignedAllocator<R>::kAlignment / sizeof(R);
+    stride_ = (rows + lanes - 1) / lanes * lanes;
+    data_.assign(stride_ * NUM_HELD_RSS, R(0));
+  }
+
+  [[nodiscard]] size_t rows() const { return rows_; }
+  [[nodiscard]] int party() const { return pid_; }
+
+  // Column k holds CompactShare element k of every row.
+  R* column(size_t k) { return data_.data() + k * stride_; }
+  const R* column(size_t k) const { return data_.data() + k * stride_; }
+
+  R& operator()(size_t row, size_t k) { return data_[k * stride_ + row]; }
+  R operator()(size_t row, size_t k) const { return data_[k * stride_ + row]; }
+
+  // Also takes a CompactShare expression, which is evaluated straight into
+  // the columns.
+  template <class E, class = std::enable_if_t<
+                         detail::is_share_expr_v<E> &&
+                         std::is_same_v<detail::expr_share_t<E>, CompactShare<R>>>>
+  void setRow(size_t row, const E& share) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      data_[k * stride_ + row] = share.eval(k);
+    }
+  }
+
+  void setRow(size_t row, const ReplicatedShare<R>& share) {
+    setRow(row, CompactShare<R>(share, pid_));
+  }
+
+  [[nodiscard]] CompactShare<R> row(size_t row) const {
+    std::array<R, NUM_HELD_RSS> values;
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values[k] = data_[k * stride_ + row];
+    }
+    return CompactShare<R>(values);
+  }
+
+  ShareMatrix<R>& operator+=(const ShareMatrix<R>& rhs) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      detail::addKernel(column(k), column(k), rhs.column(k), rows_);
+    }
+    return *this;
+  }
+
+  ShareMatrix<R>& operator-=(const ShareMatrix<R>& rhs) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      detail::subKernel(column(k), column(k), rhs.column(k), rows_);
+    }
+    return *this;
+  }
+
+  // Row r is multiplied by the public value v[r].
+  ShareMatrix<R>& mulPublic(const std::vector<R>& v) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      detail::mulKernel(column(k), column(k), v.data(), rows_);
+    }
+    return *this;
+  }
+
+  // Row r += a[r] * v[r].
+  ShareMatrix<R>& fma(const ShareMatrix<R>& a, const std::vector<R>& v) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      detail::fmaKernel<R, false>(column(k), column(k), a.column(k), v.data(), rows_);
+    }
+    return *this;
+  }
+
+  // Row r -= a[r] * v[r].
+  ShareMatrix<R>& fms(const ShareMatrix<R>& a, const std::vector<R>& v) {
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      detail::fmaKernel<R, true>(column(k), column(k), a.column(k), v.data(), rows_);
+    }
+    return *this;
+  }
+
+  // Sum of ReplicatedShare elements i, j and k for every row. All three must
+  // be held by the matrix's party.
+  [[nodiscard]] std::vector<R> sumColumns(size_t i, size_t j, size_t k) const {
+    const R* cols[3] = {heldColumn(i), heldColumn(j), heldColumn(k)};
+    std::vector<R> result(rows_);
+    detail::columnSumKernel(result.data(), cols, 3, rows_);
+    return result;
+  }
+
+  // Sum of all columns for every row, i.e. the sum of each row's share.
+  [[nodiscard]] std::vector<R> rowSums() const {
+    std::array<const R*, NUM_HELD_RSS> cols;
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      cols[k] = column(k);
+    }
+    std::vector<R> result(rows_);
+    detail::columnSumKernel(result.data(), cols.data(), NUM_HELD_RSS, rows_);
+    return result;
+  }
+
+ private:
+  const R* heldColumn(size_t idx) const {
+    auto k = detail::kHeldIndex.compact[pid_][idx];
+    if (k < 0) {
+      throw std::invalid_argument(boost::str(
+          boost::format("ShareMatrix: party %1% does not hold share element %2%") % pid_ % idx));
+    }
+    return column(k);
+  }
+
+  int pid_;
+  size_t rows_ = 0;
+  size_t stride_ = 0;
+  std::vector<R, detail::AlignedAllocator<R>> data_;
+};
+
 // Contains all elements of a secret sharing. Used only for generating dummy
 // preprocessing data.
 template <class R>
@@ -122,7 +825,7 @@ struct DummyShare {
       : share_elements(std::move(share_elements)) {}
 
   DummyShare(R secret, emp::PRG& prg) {
-    prg.random_data(share_elements.data(), sizeof(R) * 21);
+    detail::randomElements(prg, share_elements.data(), 21);
 
     R sum = share_elements[0];
     for (int i = 1; i < 20; ++i) {
@@ -132,7 +835,7 @@ struct DummyShare {
   }
   
   void randomize(emp::PRG& prg) {
-    prg.random_data(share_elements.data(), sizeof(R) * 21); //随机化5个值
+    detail::randomElements(prg, share_elements.data(), 21); //随机化5个值
   }
 
   [[nodiscard]] R secret() const { //返回5个随机值的和，秘密共享\beta = x + sum即可
@@ -204,6 +907,17 @@ struct DummyShare {
     }
     return ReplicatedShare<R>(values);
   }
+
+  // The elements party pid holds, i.e. CompactShare(getRSS(pid), pid).
+  CompactShare<R> getCompact(size_t pid) const {
+    pid = pid % NUM_PARTIES;
+    std::array<R, NUM_HELD_RSS> values;
+    const auto& global = detail::kHeldIndex.global[pid];
+    for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+      values[k] = share_elements[global[k]];
+    }
+    return CompactShare<R>(values);
+  }
 };
 
 template <class R>
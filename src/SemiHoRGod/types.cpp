@@ -75,4 +75,11 @@ std::ostream& operator<<(std::ostream& os, const BoolRing& b) {
   os << b.val_;
   return os;
 }
+
+std::ostream& operator<<(std::ostream& os, const BoolSlice& b) {
+  auto flags = os.flags();
+  os << "0x" << std::hex << b.val_;
+  os.flags(flags);
+  return os;
+}
 };  // namespace SemiHoRGod
@@ -4,12 +4,43 @@
 #include <vector>
 
 #define NUM_RSS 21
+// Share elements held by one party: the pairs that do not contain its own id.
+#define NUM_HELD_RSS 15
 #define NUM_DSS 21
 #define NUM_PARTIES 7
 namespace SemiHoRGod {
-using Ring = uint64_t;
-constexpr uint64_t FRACTION = 16;
-constexpr size_t N = 64; //bit size of Ring, 64 bits
+// Supported arithmetic rings. The evaluators are instantiated for each of
+// them; Ring is the default one.
+using Ring32 = uint32_t;
+using Ring64 = uint64_t;
+using Ring128 = unsigned __int128;
+using Ring = Ring64;
+
+// Fixed-point parameters of each ring: kBits is the ring width and values
+// carry kFraction fractional bits. Comparison and ReLU gates assume inputs of
+// at most kBitsGamma bits and mask them with kBitsBeta random bits, so
+// kBitsGamma + kBitsBeta must not exceed kBits. Types without a
+// specialization (Ring64, Ring128, and plaintext types like int used by
+// Circuit<T>) get 16 fractional bits.
+template <class R>
+struct FixedPoint {
+  static constexpr size_t kBits = 8 * sizeof(R);
+  static constexpr size_t kFraction = 16;
+  static constexpr size_t kBitsGamma = 20;
+  static constexpr size_t kBitsBeta = 4;
+};
+
+// 32 位环只留 8 位小数，整数部分才有足够的位数
+template <>
+struct FixedPoint<Ring32> {
+  static constexpr size_t kBits = 32;
+  static constexpr size_t kFraction = 8;
+  static constexpr size_t kBitsGamma = 20;
+  static constexpr size_t kBitsBeta = 4;
+};
+
+constexpr uint64_t FRACTION = FixedPoint<Ring>::kFraction;
+constexpr size_t N = FixedPoint<Ring>::kBits; //bit size of Ring, 64 bits
 constexpr int INPUT_PERMUTATION = 0; //bit size of Ring, 64 bits
 
 class BoolRing {
@@ -37,4 +68,48 @@ class BoolRing {
 
   friend std::ostream& operator<<(std::ostream& os, const BoolRing& b);
 };
+
+// 64 个互相独立的 BoolRing 实例按位切片存放在一个 uint64_t 中，第 k 位属于第 k 个实例
+// （例如 64 个 MSB 门的同一条 PPA 电路线）。加减是按字异或，乘是按字与，所以
+// ReplicatedShare<BoolSlice> / CompactShare<BoolSlice> 一次运算处理 64 个实例，
+// 通信时也直接按字节发送，不再需要 BoolRing::pack/unpack。
+// 运算符都很短，定义在头文件中以便内联。
+class BoolSlice {
+  uint64_t val_;
+
+ public:
+  static constexpr size_t kLanes = 64;
+
+  BoolSlice() : val_(0) {}
+  explicit BoolSlice(uint64_t val) : val_(val) {}
+
+  [[nodiscard]] uint64_t val() const { return val_; }
+
+  [[nodiscard]] BoolRing lane(size_t k) const { return BoolRing(((val_ >> k) & 1U) != 0); }
+  void setLane(size_t k, BoolRing bit) {
+    val_ = (val_ & ~(uint64_t(1) << k)) | (uint64_t(bit.val()) << k);
+  }
+
+  bool operator==(const BoolSlice& rhs) const { return val_ == rhs.val_; }
+  bool operator!=(const BoolSlice& rhs) const { return val_ != rhs.val_; }
+
+  BoolSlice& operator+=(const BoolSlice& rhs) {
+    val_ ^= rhs.val_;
+    return *this;
+  }
+  BoolSlice& operator-=(const BoolSlice& rhs) {
+    val_ ^= rhs.val_;
+    return *this;
+  }
+  BoolSlice& operator*=(const BoolSlice& rhs) {
+    val_ &= rhs.val_;
+    return *this;
+  }
+
+  friend BoolSlice operator+(BoolSlice lhs, const BoolSlice& rhs) { return lhs += rhs; }
+  friend BoolSlice operator-(BoolSlice lhs, const BoolSlice& rhs) { return lhs -= rhs; }
+  friend BoolSlice operator*(BoolSlice lhs, const BoolSlice& rhs) { return lhs *= rhs; }
+
+  friend std::ostream& operator<<(std::ostream& os, const BoolSlice& b);
+};
 };  // namespace SemiHoRGod
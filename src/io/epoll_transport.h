@@ -0,0 +1,610 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "tcp_transport.h"
+#include "transport.h"
+
+namespace io {
+
+// TCP mesh (see TcpMesh) whose sockets are all driven by one I/O thread with
+// edge-triggered epoll, instead of blocking calls on the threads of the
+// caller. Sockets are non-blocking and every read and write is vectored: a
+// read fills the pending receive request and the per-peer read-ahead buffer
+// in one readv, a write sends every queued segment of a peer in one sendmsg.
+//
+// Besides the blocking Transport API there is a completion API (sendAsync,
+// recvAsync): a request is queued for the I/O thread and its completion runs
+// once all bytes are transferred, so any number of transfers can be in flight
+// from a single caller thread. To save a round trip through the I/O thread, a
+// send is first written on the calling thread as far as the socket accepts
+// it. As for every transport, sends to a peer come from one thread at a time
+// and so do receives from a peer; blocking and asynchronous calls on the same
+// peer are kept in the order they were made.
+template <int nP>
+class EpollTransport : public Transport<nP> {
+ public:
+  // Called with nullptr on success or the error otherwise, on the I/O thread
+  // or, if a send completes right away, on the sending thread. Must not block
+  // on this transport.
+  using Completion = std::function<void(std::exception_ptr)>;
+
+  EpollTransport(int party, int port, char* ip[], const TcpOptions& options = {})
+      : party_(party) {
+    if (options.streams != 1) {
+      throw std::invalid_argument("EpollTransport: striping over several streams is not supported");
+    }
+    auto mesh = TcpMesh<nP>::connect(party, port, ip, options);
+    std::array<int, nP> fds;
+    for (int i = 0; i < nP; ++i) {
+      fds[i] = mesh[i].empty() ? -1 : mesh[i][0];
+    }
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+      int err = errno;
+      for (int fd : fds) {
+        if (fd != -1) ::close(fd);
+      }
+      closeLoopFds();
+      throw std::runtime_error(boost::str(
+          boost::format("EpollTransport: cannot create event loop: %1%") % std::strerror(err)));
+    }
+    watch(wake_fd_, EPOLLIN, kWakeId);
+    for (int peer = 0; peer < nP; ++peer) {
+      peers_[peer].fd = fds[peer];
+      if (peer == party_) continue;
+      ::fcntl(fds[peer], F_SETFL, ::fcntl(fds[peer], F_GETFL) | O_NONBLOCK);
+      watch(fds[peer], EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, peer);
+    }
+    loop_ = std::thread([this]() { loop(); });
+  }
+
+  EpollTransport(const EpollTransport&) = delete;
+  EpollTransport& operator=(const EpollTransport&) = delete;
+
+  // Waits until everything flushed so far is written (or its peer failed).
+  ~EpollTransport() override {
+    stopping_.store(true);
+    wake();
+    loop_.join();
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer == party_) continue;
+      auto& p = peers_[peer];
+      Completed done;
+      {
+        std::lock_guard<std::mutex> lock(p.mtx);
+        fail(p, std::make_exception_ptr(std::runtime_error("EpollTransport: transport destroyed")),
+             done);
+      }
+      run(done);
+      ::close(p.fd);
+    }
+    closeLoopFds();
+  }
+
+  void send(int dst, const void* data, size_t len) override {
+    auto& p = peers_[dst];
+    if (p.stage_len + len > kBufferBytes) {
+      flush(dst);
+    }
+    if (len >= kBufferBytes) {
+      // 大块数据不经暂存区，直接从调用方内存写出
+      struct iovec iov {const_cast<void*>(data), len};
+      sendv(dst, &iov, 1);
+      return;
+    }
+    if (p.stage.empty()) {
+      p.stage = takeBuffer(p);
+    }
+    std::memcpy(p.stage.data() + p.stage_len, data, len);
+    p.stage_len += len;
+  }
+
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    auto& p = peers_[dst];
+    Waiter waiter;
+    Completed done;
+    {
+      std::lock_guard<std::mutex> lock(p.mtx);
+      postStage(p);
+      for (size_t i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) continue;
+        Segment seg;
+        seg.data = static_cast<const char*>(iov[i].iov_base);
+        seg.len = iov[i].iov_len;
+        p.out.push_back(std::move(seg));
+        p.queued += iov[i].iov_len;
+      }
+      // 最后一段写完即整体完成；没有数据时立即完成
+      if (p.out.empty() || p.error) {
+        waiter.finished = true;
+        waiter.error = p.error;
+      } else {
+        p.out.back().waiter = &waiter;
+      }
+      sendNow(dst, p, done);
+    }
+    run(done);
+    wait(p, waiter);
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    auto& p = peers_[src];
+    auto* dst = static_cast<char*>(data);
+    Waiter waiter;
+    {
+      std::lock_guard<std::mutex> lock(p.mtx);
+      if (p.reqs.empty()) {
+        // 预读缓冲区里已有的数据直接拷走，不必经过 I/O 线程
+        size_t n = std::min(len, p.in_tail - p.in_head);
+        std::memcpy(dst, p.in.data() + p.in_head, n);
+        p.in_head += n;
+        dst += n;
+        len -= n;
+        if (len == 0) return;
+      }
+      if (p.error) {
+        std::rethrow_exception(p.error);
+      }
+      Request req;
+      req.data = dst;
+      req.len = len;
+      req.waiter = &waiter;
+      p.reqs.push_back(std::move(req));
+    }
+    wake();
+    wait(p, waiter);
+  }
+
+  // Writes the data buffered for `dst` as far as the socket accepts it and
+  // leaves the rest to the I/O thread; waits only if too much is already
+  // queued for `dst`.
+  void flush(int dst) override {
+    auto& p = peers_[dst];
+    if (p.stage_len == 0) return;
+    Completed done;
+    std::unique_lock<std::mutex> lock(p.mtx);
+    postStage(p);
+    sendNow(dst, p, done);
+    lock.unlock();
+    run(done);
+    lock.lock();
+    p.cv.wait(lock, [&]() { return p.queued <= kMaxQueuedBytes || p.error; });
+    if (p.error) {
+      std::rethrow_exception(p.error);
+    }
+  }
+
+  int64_t count(int peer) const override { return peers_[peer].sent.load(std::memory_order_relaxed); }
+
+  void resetStats() override {
+    for (auto& p : peers_) {
+      p.sent.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Queues `len` bytes at `data` for `dst` after everything sent so far
+  // (including data buffered by send) without copying; `data` must stay valid
+  // until `done` runs.
+  void sendAsync(int dst, const void* data, size_t len, Completion done) {
+    auto& p = peers_[dst];
+    Completed ready;
+    {
+      std::lock_guard<std::mutex> lock(p.mtx);
+      postStage(p);
+      if (p.error || len == 0) {
+        ready.emplace_back(std::move(done), p.error);
+      } else {
+        Segment seg;
+        seg.data = static_cast<const char*>(data);
+        seg.len = len;
+        seg.done = std::move(done);
+        p.out.push_back(std::move(seg));
+        p.queued += len;
+      }
+      sendNow(dst, p, ready);
+    }
+    run(ready);
+  }
+
+  // Receives the next `len` bytes from `src` into `data`, after all receives
+  // issued before; `data` must stay valid until `done` runs.
+  void recvAsync(int src, void* data, size_t len, Completion done) {
+    auto& p = peers_[src];
+    {
+      std::lock_guard<std::mutex> lock(p.mtx);
+      Request req;
+      req.data = static_cast<char*>(data);
+      req.len = len;
+      req.done = std::move(done);
+      p.reqs.push_back(std::move(req));
+    }
+    wake();
+  }
+
+  std::future<void> sendAsync(int dst, const void* data, size_t len) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    sendAsync(dst, data, len, [promise](std::exception_ptr error) { settle(*promise, error); });
+    return future;
+  }
+
+  std::future<void> recvAsync(int src, void* data, size_t len) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    recvAsync(src, data, len, [promise](std::exception_ptr error) { settle(*promise, error); });
+    return future;
+  }
+
+ private:
+  static constexpr size_t kBufferBytes = 1 << 18;
+  // 某个对端排队未写出的数据超过这么多时 flush 会等待，防止发送方无限堆积
+  static constexpr size_t kMaxQueuedBytes = 1 << 22;
+  static constexpr uint32_t kWakeId = nP;
+  static constexpr int kMaxIov = 64;
+
+  // 阻塞调用在自己的栈上等待 I/O 线程完成请求
+  struct Waiter {
+    bool finished = false;
+    std::exception_ptr error;
+  };
+
+  struct Segment {
+    const char* data = nullptr;
+    size_t len = 0;
+    std::vector<char> owned;  // 非空时 data 指向它，写完后回收进 spare
+    Waiter* waiter = nullptr;
+    Completion done;
+  };
+
+  struct Request {
+    char* data = nullptr;
+    size_t len = 0;
+    size_t filled = 0;
+    Waiter* waiter = nullptr;
+    Completion done;
+  };
+
+  struct Peer {
+    int fd = -1;
+    // 只由发送线程访问
+    std::vector<char> stage;
+    size_t stage_len = 0;
+    std::atomic<int64_t> sent{0};
+
+    // 以下由 mtx 保护，I/O 线程和调用方共用
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Segment> out;
+    size_t out_offset = 0;  // out.front() 中已写出的字节数
+    size_t queued = 0;
+    std::vector<std::vector<char>> spare;
+    std::deque<Request> reqs;
+    std::vector<char> in = std::vector<char>(kBufferBytes);
+    size_t in_head = 0;
+    size_t in_tail = 0;
+    bool readable = false;
+    bool writable = true;
+    std::exception_ptr error;
+  };
+
+  using Completed = std::vector<std::pair<Completion, std::exception_ptr>>;
+
+  static void settle(std::promise<void>& promise, std::exception_ptr error) {
+    if (error) {
+      promise.set_exception(error);
+    } else {
+      promise.set_value();
+    }
+  }
+
+  std::runtime_error ioError(const char* what, int peer) const {
+    return std::runtime_error(boost::str(boost::format("EpollTransport: cannot %1% party %2%: %3%") %
+                                         what % peer % std::strerror(errno)));
+  }
+
+  void watch(int fd, uint32_t events, uint32_t id) {
+    struct epoll_event ev {};
+    ev.events = events;
+    ev.data.u32 = id;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      throw std::runtime_error(boost::str(
+          boost::format("EpollTransport: cannot watch socket: %1%") % std::strerror(errno)));
+    }
+  }
+
+  void wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto res = ::write(wake_fd_, &one, sizeof(one));
+  }
+
+  void closeLoopFds() {
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+  }
+
+  std::vector<char> takeBuffer(Peer& p) {
+    std::lock_guard<std::mutex> lock(p.mtx);
+    if (p.spare.empty()) {
+      return std::vector<char>(kBufferBytes);
+    }
+    auto buf = std::move(p.spare.back());
+    p.spare.pop_back();
+    return buf;
+  }
+
+  // 把暂存区交给 I/O 线程；调用方持有 p.mtx
+  void postStage(Peer& p) {
+    if (p.stage_len == 0) return;
+    Segment seg;
+    seg.owned = std::move(p.stage);
+    seg.data = seg.owned.data();
+    seg.len = p.stage_len;
+    p.queued += p.stage_len;
+    p.out.push_back(std::move(seg));
+    p.stage.clear();
+    p.stage_len = 0;
+  }
+
+  void wait(Peer& p, Waiter& waiter) {
+    std::unique_lock<std::mutex> lock(p.mtx);
+    p.cv.wait(lock, [&]() { return waiter.finished; });
+    if (waiter.error) {
+      std::rethrow_exception(waiter.error);
+    }
+  }
+
+  // 套接字可写时由调用线程直接写出，省去一次唤醒 I/O 线程的往返；
+  // 写不完的部分留给 I/O 线程在 EPOLLOUT 时继续。调用方持有 p.mtx
+  void sendNow(int peer, Peer& p, Completed& done) {
+    try {
+      pumpSend(peer, p, done);
+    } catch (...) {
+      fail(p, std::current_exception(), done);
+    }
+    if (!p.out.empty()) {
+      wake();
+    }
+  }
+
+  // 以下函数在持有 p.mtx 时调用；回调收集到 done 中，解锁后再执行
+
+  static void complete(Waiter* waiter, Completion& cb, std::exception_ptr error, Completed& done) {
+    if (waiter != nullptr) {
+      waiter->finished = true;
+      waiter->error = error;
+    }
+    if (cb) {
+      done.emplace_back(std::move(cb), error);
+    }
+  }
+
+  void fail(Peer& p, std::exception_ptr error, Completed& done) {
+    if (!p.error) {
+      p.error = error;
+    }
+    for (auto& req : p.reqs) {
+      complete(req.waiter, req.done, p.error, done);
+    }
+    p.reqs.clear();
+    for (auto& seg : p.out) {
+      complete(seg.waiter, seg.done, p.error, done);
+    }
+    p.out.clear();
+    p.out_offset = 0;
+    p.queued = 0;
+  }
+
+  // 先用预读缓冲区满足排队的接收请求，再把套接字读到 EAGAIN：
+  // 一次 readv 同时填充队首请求和预读缓冲区
+  void pumpRecv(int peer, Peer& p, Completed& done) {
+    while (true) {
+      while (!p.reqs.empty() && p.in_head < p.in_tail) {
+        auto& req = p.reqs.front();
+        size_t n = std::min(req.len - req.filled, p.in_tail - p.in_head);
+        std::memcpy(req.data + req.filled, p.in.data() + p.in_head, n);
+        req.filled += n;
+        p.in_head += n;
+        if (req.filled == req.len) {
+          complete(req.waiter, req.done, nullptr, done);
+          p.reqs.pop_front();
+        }
+      }
+      if (p.in_head == p.in_tail) {
+        p.in_head = p.in_tail = 0;
+      } else if (p.in_tail == kBufferBytes) {
+        std::memmove(p.in.data(), p.in.data() + p.in_head, p.in_tail - p.in_head);
+        p.in_tail -= p.in_head;
+        p.in_head = 0;
+      }
+      if (!p.readable || p.error) return;
+
+      struct iovec iov[2];
+      int iovcnt = 0;
+      if (!p.reqs.empty()) {
+        auto& req = p.reqs.front();
+        iov[iovcnt++] = {req.data + req.filled, req.len - req.filled};
+      }
+      if (p.in_tail < kBufferBytes) {
+        iov[iovcnt++] = {p.in.data() + p.in_tail, kBufferBytes - p.in_tail};
+      }
+      if (iovcnt == 0) {
+        // 预读缓冲区已满且没有请求：等新的请求到来再读
+        return;
+      }
+
+      ssize_t res = ::readv(p.fd, iov, iovcnt);
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          p.readable = false;
+          return;
+        }
+        throw ioError("receive from", peer);
+      }
+      if (res == 0) {
+        throw std::runtime_error(boost::str(
+            boost::format("EpollTransport: party %1% closed the connection") % peer));
+      }
+
+      auto n = static_cast<size_t>(res);
+      if (!p.reqs.empty()) {
+        auto& req = p.reqs.front();
+        size_t m = std::min(n, req.len - req.filled);
+        req.filled += m;
+        n -= m;
+        if (req.filled == req.len) {
+          complete(req.waiter, req.done, nullptr, done);
+          p.reqs.pop_front();
+        }
+      }
+      p.in_tail += n;
+    }
+  }
+
+  // 把排队的段尽量一次 sendmsg 写出，直到队列为空或套接字写满
+  void pumpSend(int peer, Peer& p, Completed& done) {
+    while (p.writable && !p.out.empty() && !p.error) {
+      struct iovec iov[kMaxIov];
+      int iovcnt = 0;
+      size_t offset = p.out_offset;
+      for (auto it = p.out.begin(); it != p.out.end() && iovcnt < kMaxIov; ++it) {
+        iov[iovcnt++] = {const_cast<char*>(it->data) + offset, it->len - offset};
+        offset = 0;
+      }
+      struct msghdr msg {};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iovcnt;
+      ssize_t res = ::sendmsg(p.fd, &msg, MSG_NOSIGNAL);
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          p.writable = false;
+          return;
+        }
+        throw ioError("send to", peer);
+      }
+
+      auto n = static_cast<size_t>(res);
+      p.sent.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed);
+      p.queued -= n;
+      while (n > 0) {
+        auto& seg = p.out.front();
+        size_t m = std::min(n, seg.len - p.out_offset);
+        p.out_offset += m;
+        n -= m;
+        if (p.out_offset == seg.len) {
+          complete(seg.waiter, seg.done, nullptr, done);
+          if (!seg.owned.empty()) {
+            p.spare.push_back(std::move(seg.owned));
+          }
+          p.out.pop_front();
+          p.out_offset = 0;
+        }
+      }
+    }
+  }
+
+  void pump(int peer) {
+    auto& p = peers_[peer];
+    Completed done;
+    {
+      std::lock_guard<std::mutex> lock(p.mtx);
+      try {
+        pumpRecv(peer, p, done);
+        pumpSend(peer, p, done);
+      } catch (...) {
+        fail(p, std::current_exception(), done);
+      }
+      // 出错后预读缓冲区里剩下的数据仍可读走，不够的请求才失败
+      if (p.error) {
+        fail(p, p.error, done);
+      }
+    }
+    p.cv.notify_all();
+    run(done);
+  }
+
+  static void run(Completed& done) {
+    for (auto& [cb, error] : done) {
+      cb(error);
+    }
+  }
+
+  bool drained() {
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer == party_) continue;
+      std::lock_guard<std::mutex> lock(peers_[peer].mtx);
+      if (!peers_[peer].out.empty()) return false;
+    }
+    return true;
+  }
+
+  void loop() {
+    std::array<struct epoll_event, nP + 1> events;
+    while (true) {
+      int n = ::epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+      if (n < 0 && errno != EINTR) {
+        break;
+      }
+      for (int i = 0; i < n; ++i) {
+        auto id = events[i].data.u32;
+        if (id == kWakeId) {
+          uint64_t count = 0;
+          [[maybe_unused]] auto res = ::read(wake_fd_, &count, sizeof(count));
+          continue;
+        }
+        auto& p = peers_[id];
+        std::lock_guard<std::mutex> lock(p.mtx);
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+          p.readable = true;
+        }
+        if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+          p.writable = true;
+        }
+      }
+      for (int peer = 0; peer < nP; ++peer) {
+        if (peer != party_) {
+          pump(peer);
+        }
+      }
+      if (stopping_.load() && drained()) {
+        break;
+      }
+    }
+  }
+
+  int party_;
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  std::array<Peer, nP> peers_;
+  std::atomic<bool> stopping_{false};
+  std::thread loop_;
+};
+
+};  // namespace io
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "netmp.h"
+
+namespace io {
+
+// Byte queues between parties that run as threads of one process. Every
+// directed pair of parties has its own queue; abort() wakes every blocked
+// receiver with an exception so one failing party cannot hang the others.
+template <int nP>
+class InMemoryMesh {
+ public:
+  void push(int src, int dst, std::vector<uint8_t> chunk) {
+    auto& q = queues_[src][dst];
+    {
+      std::lock_guard<std::mutex> lock(q.mtx);
+      q.chunks.push_back(std::move(chunk));
+    }
+    q.cv.notify_one();
+  }
+
+  void pop(int src, int dst, uint8_t* data, size_t len) {
+    auto& q = queues_[src][dst];
+    std::unique_lock<std::mutex> lock(q.mtx);
+    while (len > 0) {
+      q.cv.wait(lock, [&]() { return !q.chunks.empty() || aborted_; });
+      if (q.chunks.empty()) {
+        throw std::runtime_error("InMemoryMesh: aborted while receiving");
+      }
+      auto& chunk = q.chunks.front();
+      size_t n = std::min(len, chunk.size() - q.head);
+      std::memcpy(data, chunk.data() + q.head, n);
+      data += n;
+      len -= n;
+      q.head += n;
+      if (q.head == chunk.size()) {
+        q.chunks.pop_front();
+        q.head = 0;
+      }
+    }
+  }
+
+  void abort() {
+    for (auto& row : queues_) {
+      for (auto& q : row) {
+        {
+          std::lock_guard<std::mutex> lock(q.mtx);
+          aborted_ = true;
+        }
+        q.cv.notify_all();
+      }
+    }
+  }
+
+ private:
+  struct Queue {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> chunks;
+    size_t head = 0;  // chunks.front() 中已读走的字节数
+  };
+  // [src][dst]
+  std::array<std::array<Queue, nP>, nP> queues_;
+  bool aborted_ = false;  // 在每个队列的锁内写入，等待方在同一把锁内读取
+};
+
+// Transport of one party on an InMemoryMesh. Sends are delivered right away,
+// so flush has nothing to do.
+template <int nP>
+class InMemoryTransport : public Transport<nP> {
+ public:
+  InMemoryTransport(std::shared_ptr<InMemoryMesh<nP>> mesh, int party)
+      : mesh_(std::move(mesh)), party_(party) {}
+
+  void send(int dst, const void* data, size_t len) override {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    mesh_->push(party_, dst, std::vector<uint8_t>(bytes, bytes + len));
+    sent_bytes_[dst] += len;
+  }
+
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    // 合成一块再投递，接收方只需一次加锁
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+      total += iov[i].iov_len;
+    }
+    std::vector<uint8_t> chunk(total);
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+      std::memcpy(chunk.data() + offset, iov[i].iov_base, iov[i].iov_len);
+      offset += iov[i].iov_len;
+    }
+    mesh_->push(party_, dst, std::move(chunk));
+    sent_bytes_[dst] += total;
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    mesh_->pop(src, party_, static_cast<uint8_t*>(data), len);
+  }
+
+  void flush(int) override {}
+
+  int64_t count(int peer) const override { return sent_bytes_[peer]; }
+
+  void resetStats() override { sent_bytes_.fill(0); }
+
+ private:
+  std::shared_ptr<InMemoryMesh<nP>> mesh_;
+  int party_;
+  std::array<int64_t, nP> sent_bytes_{};
+};
+
+// One NetIOMP per party, all connected through `mesh`.
+template <int nP>
+std::vector<std::shared_ptr<NetIOMP<nP>>> makeInMemoryNetworks(
+    const std::shared_ptr<InMemoryMesh<nP>>& mesh) {
+  std::vector<std::shared_ptr<NetIOMP<nP>>> networks;
+  for (int i = 0; i < nP; ++i) {
+    networks.push_back(
+        std::make_shared<NetIOMP<nP>>(i, std::make_unique<InMemoryTransport<nP>>(mesh, i)));
+  }
+  return networks;
+}
+
+};  // namespace io
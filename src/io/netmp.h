@@ -23,11 +23,23 @@
 // The following code has been adopted from
 // https://github.com/emp-toolkit/emp-agmpc. It has been modified to define the
 // class within a namespace and add additional methods (sendRelative,
-// recvRelative).
+// recvRelative). The sockets are now managed by TcpTransport and any other
+// io::Transport can be plugged in instead.
 
 #pragma once
 
 #include <emp-tool/emp-tool.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "epoll_transport.h"
+#include "tcp_transport.h"
+#include "transport.h"
 
 namespace io {
 using namespace emp;
@@ -35,90 +47,63 @@ using namespace emp;
 template <int nP> //nP代表参与方的个数
 class NetIOMP {
  public:
-  NetIO* ios[nP];
-  NetIO* ios2[nP];
   int party;
   bool sent[nP];
 
-  NetIOMP(int party, int port, char* IP[], bool localhost = false) {
-    this->party = party;
+  NetIOMP(int party, std::unique_ptr<Transport<nP>> transport)
+      : party(party), transport_(std::move(transport)) {
     memset(sent, false, nP);
-    for (int i = 0; i < nP; ++i) {
-      for (int j = i + 1; j < nP; ++j) {
-        if (i == party) {
-          usleep(1000); //休眠1000 us = 1 ms
-          if (localhost) { //如果在本地运行，
-            ios[j] = new NetIO("127.0.0.1", port + 2 * (i * nP + j), true); //如果为 nullptr，表示当前对象作为服务器；否则作为客户端。
-          } else {
-            ios[j] = new NetIO(IP[j], port + 2 * (i), true);
-          }
-          ios[j]->set_nodelay();
-
-          usleep(1000);
-          if (localhost) {
-            ios2[j] = new NetIO(nullptr, port + 2 * (i * nP + j) + 1, true);
-          } else {
-            ios2[j] = new NetIO(nullptr, port + 2 * (j) + 1, true);
-          }
-          ios2[j]->set_nodelay();
-        } else if (j == party) {
-          usleep(1000);
-          if (localhost) {
-            ios[i] = new NetIO(nullptr, port + 2 * (i * nP + j), true);
-          } else {
-            ios[i] = new NetIO(nullptr, port + 2 * (i), true);
-          }
-          ios[i]->set_nodelay();
-
-          usleep(1000);
-          if (localhost) {
-            ios2[i] = new NetIO("127.0.0.1", port + 2 * (i * nP + j) + 1, true);
-          } else {
-            ios2[i] = new NetIO(IP[i], port + 2 * (j) + 1, true);
-          }
-        }
-      }
-    }
   }
 
+  // Connects to all other parties over TCP, see TcpMesh. Party i listens on
+  // `port + i`; `IP` is ignored when `localhost` is set.
+  NetIOMP(int party, int port, char* IP[], bool localhost = false,
+          const TcpOptions& options = {})
+      : NetIOMP(party, makeTcpTransport(party, port, localhost ? nullptr : IP, options)) {}
+
   int64_t count() {
     int64_t res = 0;
     for (int i = 0; i < nP; ++i)
       if (i != party) {
-        res += ios[i]->counter;
-        res += ios2[i]->counter;
+        res += count(i);
       }
     return res;
   }
 
-  void resetStats() {
-    for (int i = 0; i < nP; ++i) {
-      if (i != party) {
-        ios[i]->counter = 0;
-        ios2[i]->counter = 0;
-      }
-    }
-  }
+  // Bytes sent to `peer` so far.
+  int64_t count(int peer) { return transport_->count(peer); }
 
-  ~NetIOMP() {
-    for (int i = 0; i < nP; ++i)
-      if (i != party) {
-        delete ios[i];
-        delete ios2[i];
-      }
+  void resetStats() { transport_->resetStats(); }
+
+  // The transport all traffic goes through.
+  Transport<nP>& transport() { return *transport_; }
+  const Transport<nP>& transport() const { return *transport_; }
+
+  // Puts a decorator around the transport: `wrap` is called with the current
+  // transport and returns the one to use from now on (see recordTranscript,
+  // emulateWan). Call before any traffic.
+  template <class Wrap>
+  void wrapTransport(Wrap&& wrap) {
+    transport_ = std::forward<Wrap>(wrap)(std::move(transport_));
   }
 
+  // Buffered until flush(dst) or the next sendv to `dst`.
   void send(int dst, const void* data, size_t len) {
     if (dst != -1 and dst != party) {
-      if (party < dst)
-        ios[dst]->send_data(data, len);
-      else
-        ios2[dst]->send_data(data, len);
+      transport_->send(dst, data, len);
       sent[dst] = true;
     }
-#ifdef __clang__
-    flush(dst);
-#endif
+  }
+
+  // Sends `iov` after whatever is already buffered for `dst`, without staging
+  // the segments in a send buffer where the transport allows it. `iov` is
+  // modified in place.
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) {
+    if (dst == -1 || dst == party) {
+      return;
+    }
+    transport_->sendv(dst, iov, iovcnt);
+    sent[dst] = true;
   }
 
   void sendRelative(int offset, const void* data, size_t len) {
@@ -129,16 +114,15 @@ class NetIOMP {
     send(dst, data, len);
   }
 
+  // Packs 64 bools per word, lowest bit first, and sends all words at once
+  // (through sendv, so no flush is needed).
   void sendBool(int dst, const bool* data, size_t len) {
-    for (int i = 0; i < len;) {
-      uint64_t tmp = 0;
-      for (int j = 0; j < 64 && i < len; ++i, ++j) {
-        if (data[i]) {
-          tmp |= (0x1ULL << j);
-        }
-      }
-      send(dst, &tmp, 8);
+    std::vector<uint64_t> words((len + 63) / 64, 0);
+    for (size_t i = 0; i < len; ++i) {
+      words[i / 64] |= static_cast<uint64_t>(data[i]) << (i % 64);
     }
+    struct iovec iov {words.data(), words.size() * sizeof(uint64_t)};
+    sendv(dst, &iov, 1);
   }
 
   void sendBoolRelative(int offset, const bool* data, size_t len) {
@@ -151,11 +135,7 @@ class NetIOMP {
 
   void recv(int src, void* data, size_t len) {
     if (src != -1 && src != party) {
-      // if (sent[src]) flush(src);
-      if (src < party)
-        ios[src]->recv_data(data, len);
-      else
-        ios2[src]->recv_data(data, len);
+      transport_->recv(src, data, len);
     }
   }
 
@@ -168,13 +148,10 @@ class NetIOMP {
   }
 
   void recvBool(int src, bool* data, size_t len) {
-    for (int i = 0; i < len;) {
-      uint64_t tmp = 0;
-      recv(src, &tmp, 8);
-      for (int j = 63; j >= 0 && i < len; ++i, --j) {
-        data[i] = (tmp & 0x1) == 0x1;
-        tmp >>= 1;
-      }
+    std::vector<uint64_t> words((len + 63) / 64, 0);
+    recv(src, words.data(), words.size() * sizeof(uint64_t));
+    for (size_t i = 0; i < len; ++i) {
+      data[i] = ((words[i / 64] >> (i % 64)) & 0x1) == 0x1;
     }
   }
 
@@ -186,60 +163,40 @@ class NetIOMP {
     recvBool(src, data, len);
   }
 
-  NetIO*& get(size_t idx, bool b = false) {
-    if (b)
-      return ios[idx];
-    else
-      return ios2[idx];
-  }
-
-  NetIO*& getSendChannel(size_t idx) {
-    if (party < idx) {
-      return ios[idx];
-    }
-
-    return ios2[idx];
-  }
-
-  NetIO*& getRecvChannel(size_t idx) {
-    if (idx < party) {
-      return ios[idx];
-    }
-
-    return ios2[idx];
-  }
-
   void flush(int idx = -1) {
-    if (idx == -1) {
-      for (int i = 0; i < nP; ++i) {
-        if (i != party) {
-          ios[i]->flush();
-          ios2[i]->flush();
-        }
-      }
-    } else {
-      if (party < idx) {
-        ios[idx]->flush();
-      } else {
-        ios2[idx]->flush();
+    for (int i = 0; i < nP; ++i) {
+      if (i != party && (idx == -1 || idx == i)) {
+        transport_->flush(i);
       }
     }
   }
 
   void sync() {
+    // 与每个对端交换一个字节；先全部发出再接收，不会互相等待
+    char byte = 0;
+    for (int i = 0; i < nP; ++i) {
+      if (i != party) {
+        send(i, &byte, 1);
+        flush(i);
+      }
+    }
     for (int i = 0; i < nP; ++i) {
-      for (int j = 0; j < nP; ++j) {
-        if (i < j) {
-          if (i == party) {
-            ios[j]->sync();
-            ios2[j]->sync();
-          } else if (j == party) {
-            ios[i]->sync();
-            ios2[i]->sync();
-          }
-        }
+      if (i != party) {
+        recv(i, &byte, 1);
       }
     }
   }
+
+ private:
+  // 所有收发都经由 transport_：默认为 TCP，也可以是共享内存、进程内队列或会话
+  std::unique_ptr<Transport<nP>> transport_;
+
+  static std::unique_ptr<Transport<nP>> makeTcpTransport(int party, int port, char* IP[],
+                                                         const TcpOptions& options) {
+    if (options.event_loop) {
+      return std::make_unique<EpollTransport<nP>>(party, port, IP, options);
+    }
+    return std::make_unique<TcpTransport<nP>>(party, port, IP, options);
+  }
 };
 };  // namespace io
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "netmp.h"
+
+namespace io {
+
+// A transcript holds every byte one party received, so that the party can
+// later be run on its own (see ReplayTransport). Layout, in host byte order:
+//
+//   TranscriptHeader
+//   repeated: TranscriptRecord, followed by `len` bytes received from `src`
+//
+// Records are appended in the order the receives completed; receives from
+// one peer keep their order. A round starts whenever the party sends again
+// after having received, i.e. `round` counts the party's send phases. It is
+// only an estimate of the protocol's rounds: sends that run on background
+// threads can finish after the round's receives, and then two rounds merge
+// into one send phase, or one round splits into two.
+struct TranscriptHeader {
+  static constexpr uint32_t kMagic = 0x53485254;  // "SHRT"
+  static constexpr uint32_t kVersion = 1;
+
+  uint32_t magic = kMagic;
+  uint32_t version = kVersion;
+  int32_t num_parties = 0;
+  int32_t party = 0;
+};
+
+struct TranscriptRecord {
+  int32_t src;
+  uint32_t round;
+  uint64_t len;
+};
+
+// Decorator that writes everything received through the wrapped transport to
+// a transcript file. Sends go to the wrapped transport unchanged.
+template <int nP>
+class RecordingTransport : public Transport<nP> {
+ public:
+  RecordingTransport(std::unique_ptr<Transport<nP>> inner, int party, const std::string& path)
+      : inner_(std::move(inner)), out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+      throw std::runtime_error(
+          boost::str(boost::format("RecordingTransport: cannot open transcript '%1%'") % path));
+    }
+    TranscriptHeader header;
+    header.num_parties = nP;
+    header.party = party;
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  ~RecordingTransport() override { out_.flush(); }
+
+  void send(int dst, const void* data, size_t len) override {
+    startRound();
+    inner_->send(dst, data, len);
+  }
+
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    startRound();
+    inner_->sendv(dst, iov, iovcnt);
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    inner_->recv(src, data, len);
+    std::lock_guard<std::mutex> lock(mtx_);
+    received_ = true;
+    TranscriptRecord record{src, round_, len};
+    out_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(len));
+    if (!out_) {
+      throw std::runtime_error("RecordingTransport: failed to write transcript");
+    }
+  }
+
+  void flush(int dst) override { inner_->flush(dst); }
+
+  int64_t count(int peer) const override { return inner_->count(peer); }
+
+  void resetStats() override { inner_->resetStats(); }
+
+ private:
+  void startRound() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (received_) {
+      received_ = false;
+      ++round_;
+    }
+  }
+
+  std::unique_ptr<Transport<nP>> inner_;
+  std::mutex mtx_;  // 保护 out_、round_ 与 received_：各对端的接收可能在不同线程
+  std::ofstream out_;
+  uint32_t round_ = 0;
+  bool received_ = false;
+};
+
+// Runs one party without any peer: receives are served from a transcript
+// written by RecordingTransport and sends are counted and discarded. Since
+// the party computes exactly what it computed while recording, this gives
+// repeatable single-process runs for profiling local computation. Runs whose
+// messages depend on timing (first-arrival jumps, bandwidth-aware roles) may
+// ask for other bytes than were recorded; a receive past the end of the
+// transcript throws.
+template <int nP>
+class ReplayTransport : public Transport<nP> {
+ public:
+  ReplayTransport(int party, const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+      throw std::runtime_error(
+          boost::str(boost::format("ReplayTransport: cannot open transcript '%1%'") % path));
+    }
+    data_.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+
+    TranscriptHeader header;
+    if (!in || data_.size() < sizeof(header)) {
+      throw std::runtime_error(
+          boost::str(boost::format("ReplayTransport: cannot read transcript '%1%'") % path));
+    }
+    std::memcpy(&header, data_.data(), sizeof(header));
+    if (header.magic != TranscriptHeader::kMagic || header.version != TranscriptHeader::kVersion) {
+      throw std::runtime_error(
+          boost::str(boost::format("ReplayTransport: '%1%' is not a transcript") % path));
+    }
+    if (header.num_parties != nP || header.party != party) {
+      throw std::invalid_argument(boost::str(
+          boost::format("ReplayTransport: '%1%' was recorded by party %2% of %3%, not party %4% of %5%") %
+          path % header.party % header.num_parties % party % nP));
+    }
+
+    // 只记下每条记录在 data_ 中的位置，回放时直接从中拷贝
+    size_t offset = sizeof(header);
+    while (offset < data_.size()) {
+      TranscriptRecord record;
+      if (data_.size() - offset < sizeof(record)) {
+        throw std::runtime_error("ReplayTransport: truncated transcript");
+      }
+      std::memcpy(&record, data_.data() + offset, sizeof(record));
+      offset += sizeof(record);
+      if (record.src < 0 || record.src >= nP || record.src == party ||
+          data_.size() - offset < record.len) {
+        throw std::runtime_error("ReplayTransport: corrupt transcript");
+      }
+      streams_[record.src].segments.push_back({offset, record.len});
+      offset += record.len;
+      num_rounds_ = std::max<uint64_t>(num_rounds_, uint64_t{record.round} + 1);
+    }
+  }
+
+  void send(int dst, const void* data, size_t len) override { sent_bytes_[dst] += len; }
+
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    for (size_t i = 0; i < iovcnt; ++i) {
+      sent_bytes_[dst] += iov[i].iov_len;
+    }
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    auto& stream = streams_[src];
+    auto* out = static_cast<uint8_t*>(data);
+    while (len > 0) {
+      if (stream.next == stream.segments.size()) {
+        throw std::runtime_error(boost::str(
+            boost::format("ReplayTransport: transcript has no more data from party %1%") % src));
+      }
+      const auto& segment = stream.segments[stream.next];
+      size_t n = std::min(len, segment.len - stream.head);
+      std::memcpy(out, data_.data() + segment.offset + stream.head, n);
+      out += n;
+      len -= n;
+      stream.head += n;
+      if (stream.head == segment.len) {
+        ++stream.next;
+        stream.head = 0;
+      }
+    }
+  }
+
+  void flush(int) override {}
+
+  int64_t count(int peer) const override { return sent_bytes_[peer]; }
+
+  void resetStats() override { sent_bytes_.fill(0); }
+
+  // Number of send phases in the transcript, an estimate of its rounds (see
+  // TranscriptRecord).
+  uint64_t rounds() const { return num_rounds_; }
+
+  // Bytes of the transcript not received yet.
+  uint64_t remaining() const {
+    uint64_t res = 0;
+    for (const auto& stream : streams_) {
+      for (size_t i = stream.next; i < stream.segments.size(); ++i) {
+        res += stream.segments[i].len;
+      }
+      res -= stream.head;
+    }
+    return res;
+  }
+
+ private:
+  struct Segment {
+    size_t offset;
+    size_t len;
+  };
+
+  struct Stream {
+    std::vector<Segment> segments;
+    size_t next = 0;  // 下一个未读完的 segment
+    size_t head = 0;  // 其中已读走的字节数
+  };
+
+  std::vector<uint8_t> data_;
+  std::array<Stream, nP> streams_;
+  uint64_t num_rounds_ = 0;
+  std::array<int64_t, nP> sent_bytes_{};
+};
+
+// Records everything `network` receives from now on to `path`. Call right
+// after the mesh is set up.
+template <int nP>
+void recordTranscript(NetIOMP<nP>& network, const std::string& path) {
+  network.wrapTransport([&](std::unique_ptr<Transport<nP>> inner) {
+    return std::make_unique<RecordingTransport<nP>>(std::move(inner), network.party, path);
+  });
+}
+
+// A network for `party` alone that replays the transcript at `path`.
+template <int nP>
+std::shared_ptr<NetIOMP<nP>> makeReplayNetwork(int party, const std::string& path) {
+  return std::make_shared<NetIOMP<nP>>(party, std::make_unique<ReplayTransport<nP>>(party, path));
+}
+
+};  // namespace io
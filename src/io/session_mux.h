@@ -0,0 +1,241 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "netmp.h"
+
+namespace io {
+
+// Multiplexes independent sessions over one NetIOMP mesh. Each session is a
+// NetIOMP of its own (see open), so an ImprovedJmp or an evaluator can run on
+// it unchanged, and several of them can have rounds in flight at the same
+// time. Every message travels in a frame tagged with its session; one thread
+// per peer reads the frames and routes them to the session's inbox.
+//
+// Once the mux is constructed the underlying mesh belongs to it and must not
+// be used directly. Sessions with the same tag on different parties talk to
+// each other; a party may open its side before or after its peers, frames for
+// a tag that is not open yet are kept until it is, and data a session has not
+// read when it is destroyed is dropped. If reading from a peer fails, every
+// session receiving from that peer gets the error once the data that arrived
+// before it is used up. Destroying the mux is collective: it sends a close
+// frame to every peer and waits for theirs.
+template <int nP>
+class SessionMux {
+  // 帧头：会话标签和负载长度
+  struct FrameHeader {
+    uint64_t tag;
+    uint64_t len;
+  };
+  static constexpr uint64_t kCloseTag = ~uint64_t(0);
+  // send 的小块数据先在会话内攒到这么多字节再成帧，避免每次调用都带一个帧头
+  static constexpr size_t kFrameBytes = 64 * 1024;
+
+  // 某个会话从某个对端收到、尚未读走的数据
+  struct Inbox {
+    std::deque<std::vector<uint8_t>> chunks;
+    size_t head = 0;  // chunks.front() 中已读走的字节数
+  };
+
+  class Session : public Transport<nP> {
+   public:
+    Session(SessionMux& mux, uint64_t tag) : mux_(mux), tag_(tag) {}
+    ~Session() override {
+      // 先丢掉没读走的数据，再释放标签，重新打开的同名会话看不到旧数据
+      for (int src = 0; src < nP; ++src) {
+        std::lock_guard<std::mutex> lock(mux_.recv_mtx_[src]);
+        mux_.inboxes_[src].erase(tag_);
+      }
+      std::lock_guard<std::mutex> lock(mux_.open_mtx_);
+      mux_.open_tags_.erase(tag_);
+    }
+
+    void send(int dst, const void* data, size_t len) override {
+      auto& out = out_[dst];
+      const auto* bytes = static_cast<const uint8_t*>(data);
+      out.insert(out.end(), bytes, bytes + len);
+      if (out.size() >= kFrameBytes) {
+        emit(dst, nullptr, 0);
+      }
+    }
+
+    void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+      emit(dst, iov, iovcnt);
+    }
+
+    void recv(int src, void* data, size_t len) override {
+      mux_.take(tag_, src, static_cast<uint8_t*>(data), len);
+    }
+
+    void flush(int dst) override {
+      if (!out_[dst].empty()) {
+        emit(dst, nullptr, 0);
+      }
+      std::lock_guard<std::mutex> lock(mux_.send_mtx_[dst]);
+      mux_.net_.flush(dst);
+    }
+
+    int64_t count(int peer) const override {
+      return sent_bytes_[peer].load(std::memory_order_relaxed);
+    }
+
+    void resetStats() override {
+      for (auto& bytes : sent_bytes_) {
+        bytes.store(0, std::memory_order_relaxed);
+      }
+    }
+
+   private:
+    // 把暂存的数据和 iov 合成一帧写出；同一对端的写入由 send_mtx_ 串行化
+    void emit(int dst, struct iovec* iov, size_t iovcnt) {
+      auto& out = out_[dst];
+      FrameHeader header{tag_, out.size()};
+      for (size_t i = 0; i < iovcnt; ++i) {
+        header.len += iov[i].iov_len;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mux_.send_mtx_[dst]);
+        mux_.net_.send(dst, &header, sizeof(header));
+        if (!out.empty()) {
+          mux_.net_.send(dst, out.data(), out.size());
+        }
+        if (iovcnt != 0) {
+          mux_.net_.sendv(dst, iov, iovcnt);
+        }
+      }
+      sent_bytes_[dst].fetch_add(static_cast<int64_t>(sizeof(header) + header.len),
+                            std::memory_order_relaxed);
+      out.clear();
+    }
+
+    SessionMux& mux_;
+    uint64_t tag_;
+    std::array<std::vector<uint8_t>, nP> out_;
+    std::array<std::atomic<int64_t>, nP> sent_bytes_{};
+  };
+
+ public:
+  explicit SessionMux(NetIOMP<nP>& net) : net_(net) {
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer != net_.party) {
+        readers_.emplace_back([this, peer]() { readLoop(peer); });
+      }
+    }
+  }
+
+  SessionMux(const SessionMux&) = delete;
+  SessionMux& operator=(const SessionMux&) = delete;
+
+  ~SessionMux() {
+    FrameHeader header{kCloseTag, 0};
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer == net_.party) continue;
+      std::lock_guard<std::mutex> lock(send_mtx_[peer]);
+      net_.send(peer, &header, sizeof(header));
+      net_.flush(peer);
+    }
+    for (auto& t : readers_) {
+      t.join();
+    }
+  }
+
+  // Opens this party's end of session `tag`. Sessions must be destroyed
+  // before the mux. Throws std::logic_error if `tag` is already open.
+  std::unique_ptr<NetIOMP<nP>> open(uint64_t tag) {
+    if (tag == kCloseTag) {
+      throw std::invalid_argument("SessionMux: reserved session tag");
+    }
+    {
+      std::lock_guard<std::mutex> lock(open_mtx_);
+      if (!open_tags_.insert(tag).second) {
+        throw std::logic_error(
+            boost::str(boost::format("SessionMux: session %1% is already open") % tag));
+      }
+    }
+    return std::make_unique<NetIOMP<nP>>(net_.party, std::make_unique<Session>(*this, tag));
+  }
+
+ private:
+  void readLoop(int src) {
+    try {
+      while (true) {
+        FrameHeader header{};
+        net_.recv(src, &header, sizeof(header));
+        if (header.tag == kCloseTag) {
+          return;
+        }
+        if (header.len == 0) {
+          continue;
+        }
+        std::vector<uint8_t> payload(header.len);
+        net_.recv(src, payload.data(), payload.size());
+        {
+          std::lock_guard<std::mutex> lock(recv_mtx_[src]);
+          inboxes_[src][header.tag].chunks.push_back(std::move(payload));
+        }
+        recv_cv_[src].notify_all();
+      }
+    } catch (...) {
+      // 读线程不能把异常抛出去；留给等待这个对端的 take 重新抛出
+      {
+        std::lock_guard<std::mutex> lock(recv_mtx_[src]);
+        failed_[src] = std::current_exception();
+      }
+      recv_cv_[src].notify_all();
+    }
+  }
+
+  // 阻塞直到会话 tag 从 src 收到 len 字节，按到达顺序拷出；
+  // 数据不够而 src 的读线程已失败时抛出它的异常
+  void take(uint64_t tag, int src, uint8_t* data, size_t len) {
+    std::unique_lock<std::mutex> lock(recv_mtx_[src]);
+    auto& inbox = inboxes_[src][tag];
+    while (len > 0) {
+      recv_cv_[src].wait(lock, [&]() { return !inbox.chunks.empty() || failed_[src]; });
+      if (inbox.chunks.empty()) {
+        std::rethrow_exception(failed_[src]);
+      }
+      auto& chunk = inbox.chunks.front();
+      size_t n = std::min(len, chunk.size() - inbox.head);
+      std::memcpy(data, chunk.data() + inbox.head, n);
+      data += n;
+      len -= n;
+      inbox.head += n;
+      if (inbox.head == chunk.size()) {
+        inbox.chunks.pop_front();
+        inbox.head = 0;
+      }
+    }
+  }
+
+  NetIOMP<nP>& net_;
+  std::vector<std::thread> readers_;
+  std::array<std::mutex, nP> send_mtx_;
+  std::array<std::mutex, nP> recv_mtx_;
+  std::array<std::condition_variable, nP> recv_cv_;
+  // 只由对应的 recv_mtx_ 保护；std::map 的元素地址在插入后不变
+  std::array<std::map<uint64_t, Inbox>, nP> inboxes_;
+  // 读线程失败时的异常，同样由 recv_mtx_ 保护
+  std::array<std::exception_ptr, nP> failed_;
+  std::mutex open_mtx_;
+  std::set<uint64_t> open_tags_;
+};
+
+};  // namespace io
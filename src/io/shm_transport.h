@@ -0,0 +1,338 @@
+#pragma once
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <boost/format.hpp>
+
+#include "netmp.h"
+
+namespace io {
+
+struct ShmOptions {
+  size_t ring_bytes = 1 << 20;
+  // Stored in every ring; writers skip rings created with another session id
+  // (e.g. by a stale process of an earlier run). Must match on all parties.
+  uint64_t session = 0;
+  // Give up if not every peer has attached after this long.
+  std::chrono::milliseconds timeout{60000};
+};
+
+// Transport for parties that run on the same host: every directed pair of
+// parties shares a single-producer/single-consumer ring buffer in POSIX shared
+// memory (/dev/shm), so no data goes through the loopback TCP stack. Waiting
+// on a full or empty ring spins briefly and then sleeps on a futex in the ring.
+//
+// Every party creates the rings it reads from and attaches to the rings it
+// writes to; the constructor returns once all peers have attached, and the
+// names are unlinked right away, so nothing is left in /dev/shm even if a
+// party crashes later. `port` only namespaces the segments, letting several
+// meshes coexist on one host. A segment left behind by a party that crashed
+// during setup is skipped by writers (its creator is gone, or its session id
+// differs), and setup throws once ShmOptions::timeout has passed.
+template <int nP>
+class ShmTransport : public Transport<nP> {
+ public:
+  static constexpr size_t kDefaultRingBytes = 1 << 20;
+
+  ShmTransport(int party, int port, size_t ring_bytes = kDefaultRingBytes)
+      : ShmTransport(party, port, ShmOptions{ring_bytes}) {}
+
+  ShmTransport(int party, int port, const ShmOptions& options) : party_(party) {
+    auto ring_bytes = options.ring_bytes;
+    if (ring_bytes == 0 || (ring_bytes & (ring_bytes - 1)) != 0) {
+      throw std::invalid_argument(boost::str(
+          boost::format("ShmTransport: ring size must be a power of two, got %1%") % ring_bytes));
+    }
+    Deadline deadline{party_, options.timeout,
+                      std::chrono::steady_clock::now() + options.timeout};
+    // 先创建所有入向环，再连接出向环，各方不会互相等待而卡住
+    for (int src = 0; src < nP; ++src) {
+      if (src != party_) {
+        in_[src].create(name(port, src, party_), ring_bytes, options.session);
+      }
+    }
+    for (int dst = 0; dst < nP; ++dst) {
+      if (dst != party_) {
+        out_[dst].attach(name(port, party_, dst), options.session, deadline);
+      }
+    }
+    for (int src = 0; src < nP; ++src) {
+      if (src != party_) {
+        in_[src].waitAttached(deadline);
+        shm_unlink(name(port, src, party_).c_str());
+      }
+    }
+  }
+
+  ShmTransport(const ShmTransport&) = delete;
+  ShmTransport& operator=(const ShmTransport&) = delete;
+
+  void send(int dst, const void* data, size_t len) override {
+    out_[dst].write(static_cast<const uint8_t*>(data), len);
+    sent_bytes_[dst].fetch_add(static_cast<int64_t>(len), std::memory_order_relaxed);
+  }
+
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    for (size_t i = 0; i < iovcnt; ++i) {
+      send(dst, iov[i].iov_base, iov[i].iov_len);
+    }
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    in_[src].read(static_cast<uint8_t*>(data), len);
+  }
+
+  // 写入即对读方可见，无需刷新
+  void flush(int) override {}
+
+  int64_t count(int peer) const override {
+    return sent_bytes_[peer].load(std::memory_order_relaxed);
+  }
+
+  void resetStats() override {
+    for (auto& bytes : sent_bytes_) {
+      bytes.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  // 位于共享内存段开头，数据区紧随其后。head/tail 是累计字节数，分属写方和读方，
+  // 各占一个缓存行避免伪共享。seq 在每次推进后加一，等待方据此在 futex 上睡眠。
+  struct RingHeader {
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> head_seq;
+    std::atomic<uint32_t> head_waiters;
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> tail_seq;
+    std::atomic<uint32_t> tail_waiters;
+    alignas(64) uint64_t capacity;
+    uint64_t session;
+    pid_t creator;  // 创建者进程，已退出说明是上次异常退出遗留的段
+    std::atomic<uint32_t> state;
+  };
+  static constexpr uint32_t kReady = 1;
+  static constexpr uint32_t kAttached = 2;
+  static constexpr int kSpinIters = 64;
+
+  struct Deadline {
+    int party;
+    std::chrono::milliseconds timeout;
+    std::chrono::steady_clock::time_point at;
+
+    void check(const std::string& what) const {
+      if (std::chrono::steady_clock::now() >= at) {
+        throw std::runtime_error(boost::str(
+            boost::format("ShmTransport: party %1% timed out after %2% ms %3%") % party %
+            timeout.count() % what));
+      }
+    }
+  };
+
+  static void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+    // 共享内存跨进程使用，不能带 FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, nullptr,
+            nullptr, 0);
+  }
+
+  static void futexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr,
+            nullptr, 0);
+  }
+
+  // 等待 ready() 成立：先让出 CPU 自旋几次，仍不满足时在 seq 上睡眠。
+  // 登记 waiters 之后再检查一次条件，对方推进时会看到登记并唤醒，不会丢失唤醒。
+  template <class Ready>
+  static void await(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters, Ready ready) {
+    for (int spin = 0; spin < kSpinIters; ++spin) {
+      if (ready()) return;
+      std::this_thread::yield();
+    }
+    while (!ready()) {
+      uint32_t expected = seq.load();
+      waiters.fetch_add(1);
+      if (!ready()) {
+        futexWait(seq, expected);
+      }
+      waiters.fetch_sub(1);
+    }
+  }
+
+  static void advance(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters) {
+    seq.fetch_add(1);
+    if (waiters.load() != 0) {
+      futexWake(seq);
+    }
+  }
+
+  class Ring {
+   public:
+    Ring() = default;
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    ~Ring() {
+      if (base_ != nullptr) {
+        munmap(base_, map_bytes_);
+      }
+    }
+
+    void create(const std::string& name, size_t capacity, uint64_t session) {
+      shm_unlink(name.c_str());  // 清掉上次异常退出遗留的同名段
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd < 0) {
+        throw std::runtime_error(boost::str(
+            boost::format("ShmTransport: cannot create %1%: %2%") % name % std::strerror(errno)));
+      }
+      map_bytes_ = sizeof(RingHeader) + capacity;
+      if (ftruncate(fd, static_cast<off_t>(map_bytes_)) != 0) {
+        close(fd);
+        throw std::runtime_error(boost::str(
+            boost::format("ShmTransport: cannot size %1%: %2%") % name % std::strerror(errno)));
+      }
+      map(fd, name);
+      header_ = new (base_) RingHeader();
+      header_->capacity = capacity;
+      header_->session = session;
+      header_->creator = getpid();
+      header_->state.store(kReady, std::memory_order_release);
+    }
+
+    void attach(const std::string& name, uint64_t session, const Deadline& deadline) {
+      int fd = -1;
+      struct stat st {};
+      // 对方可能还没创建好，轮询直到段存在且已初始化；上次运行遗留的段 (创建者已退出
+      // 或会话号不同) 不能连接，读方 create 时会删掉它重建
+      while (true) {
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > sizeof(RingHeader)) {
+          map_bytes_ = static_cast<size_t>(st.st_size);
+          map(fd, name);
+          header_ = reinterpret_cast<RingHeader*>(base_);
+          if (header_->state.load(std::memory_order_acquire) == kReady &&
+              header_->session == session && alive(header_->creator)) {
+            break;
+          }
+          munmap(base_, map_bytes_);
+          base_ = nullptr;
+        } else if (fd >= 0) {
+          close(fd);
+        }
+        deadline.check("waiting for " + name);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      header_->state.store(kAttached, std::memory_order_release);
+    }
+
+    void waitAttached(const Deadline& deadline) {
+      while (header_->state.load(std::memory_order_acquire) != kAttached) {
+        deadline.check("waiting for the writer to attach");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    void write(const uint8_t* data, size_t len) {
+      auto& h = *header_;
+      const uint64_t cap = h.capacity;
+      uint64_t head = h.head.load(std::memory_order_relaxed);
+      while (len > 0) {
+        uint64_t tail = 0;
+        await(h.tail_seq, h.tail_waiters, [&]() {
+          tail = h.tail.load();
+          return head - tail < cap;
+        });
+        size_t n = std::min<uint64_t>({len, cap - (head - tail), cap - (head & (cap - 1))});
+        std::memcpy(data_ + (head & (cap - 1)), data, n);
+        head += n;
+        data += n;
+        len -= n;
+        h.head.store(head);
+        advance(h.head_seq, h.head_waiters);
+      }
+    }
+
+    void read(uint8_t* data, size_t len) {
+      auto& h = *header_;
+      const uint64_t cap = h.capacity;
+      uint64_t tail = h.tail.load(std::memory_order_relaxed);
+      while (len > 0) {
+        uint64_t head = 0;
+        await(h.head_seq, h.head_waiters, [&]() {
+          head = h.head.load();
+          return head != tail;
+        });
+        size_t n = std::min<uint64_t>({len, head - tail, cap - (tail & (cap - 1))});
+        std::memcpy(data, data_ + (tail & (cap - 1)), n);
+        tail += n;
+        data += n;
+        len -= n;
+        h.tail.store(tail);
+        advance(h.tail_seq, h.tail_waiters);
+      }
+    }
+
+   private:
+    static bool alive(pid_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+    void map(int fd, const std::string& name) {
+      void* p = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED) {
+        throw std::runtime_error(boost::str(
+            boost::format("ShmTransport: cannot map %1%: %2%") % name % std::strerror(errno)));
+      }
+      base_ = static_cast<uint8_t*>(p);
+      data_ = base_ + sizeof(RingHeader);
+    }
+
+    uint8_t* base_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t map_bytes_ = 0;
+    RingHeader* header_ = nullptr;
+  };
+
+  static std::string name(int port, int src, int dst) {
+    return boost::str(boost::format("/semihorgod_%1%_%2%_%3%") % port % src % dst);
+  }
+
+  int party_;
+  std::array<Ring, nP> in_;
+  std::array<Ring, nP> out_;
+  // count() may be called from other threads while a send is in progress
+  std::array<std::atomic<int64_t>, nP> sent_bytes_{};
+};
+
+// Mesh for parties on one host communicating through shared memory; a
+// drop-in replacement for NetIOMP(party, port, nullptr, true).
+template <int nP>
+std::unique_ptr<NetIOMP<nP>> makeShmNetwork(int party, int port, const ShmOptions& options) {
+  return std::make_unique<NetIOMP<nP>>(party,
+                                       std::make_unique<ShmTransport<nP>>(party, port, options));
+}
+
+template <int nP>
+std::unique_ptr<NetIOMP<nP>> makeShmNetwork(int party, int port,
+                                            size_t ring_bytes = ShmTransport<nP>::kDefaultRingBytes) {
+  return makeShmNetwork<nP>(party, port, ShmOptions{ring_bytes});
+}
+
+};  // namespace io
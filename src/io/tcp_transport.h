@@ -0,0 +1,632 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "transport.h"
+
+namespace io {
+
+struct TcpOptions {
+  // Carried in the handshake: connections from a mesh with another session
+  // id (e.g. a stale process of an earlier run) are rejected.
+  uint64_t session = 0;
+  // Give up if the mesh is not complete after this long.
+  std::chrono::milliseconds timeout{60000};
+  std::chrono::milliseconds initial_backoff{1};
+  std::chrono::milliseconds max_backoff{100};
+  // Parallel TCP connections per pair of parties. The byte stream to a peer
+  // is cut into blocks of stripe_bytes that go to the connections round
+  // robin, so a link with a high bandwidth-delay product is not limited to
+  // the congestion window of a single connection. Must match on all parties.
+  int streams = 1;
+  size_t stripe_bytes = 1 << 16;
+  // Drive all sockets from one epoll thread (EpollTransport) instead of
+  // blocking calls on the caller's threads (TcpTransport).
+  bool event_loop = false;
+};
+
+// Connects every pair of parties with TcpOptions::streams TCP connections.
+// Setup is concurrent:
+// every party listens on `port + party`, connects to all parties with a larger
+// id from parallel threads (retrying with exponential backoff until the peer
+// listens) and accepts the smaller ids. Each connection starts with a
+// handshake carrying both party ids and the session id, which the connecting
+// side acknowledges once it has the reply: a connection the connector gave up
+// on before that (e.g. a reply that timed out) is dropped by the acceptor
+// too, and a connection that arrives again for the same stream replaces the
+// earlier one. connect() returns after a readiness barrier, i.e. only once
+// every party has its complete mesh, so launch order does not matter.
+template <int nP>
+class TcpMesh {
+ public:
+  // Returns the connected (blocking) sockets to every peer, one per stream
+  // and none for `party` itself. `ip[i]` is the address of party i; nullptr
+  // means all parties run on this host.
+  static std::array<std::vector<int>, nP> connect(int party, int port, char* ip[],
+                                                  const TcpOptions& options = {}) {
+    if (options.streams < 1 || options.stripe_bytes == 0) {
+      throw std::invalid_argument(boost::str(
+          boost::format("TcpMesh: need at least one stream and a non-empty stripe, got %1% x %2%") %
+          options.streams % options.stripe_bytes));
+    }
+    TcpMesh mesh(party, options);
+    for (int i = 0; i < nP; ++i) {
+      mesh.hosts_[i] = ip == nullptr ? "127.0.0.1" : ip[i];
+      if (i != party) {
+        mesh.fds_[i].assign(options.streams, -1);
+      }
+    }
+
+    int listener = mesh.listenOn(port + party, ip == nullptr);
+    std::mutex error_mtx;
+    std::exception_ptr error;
+    auto guarded = [&](auto fn) {
+      try {
+        fn();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mtx);
+        if (!error) error = std::current_exception();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() { guarded([&]() { mesh.acceptPeers(listener); }); });
+    for (int peer = party + 1; peer < nP; ++peer) {
+      threads.emplace_back([&, peer]() { guarded([&]() { mesh.connectPeer(peer, port + peer); }); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    ::close(listener);
+    if (!error) {
+      guarded([&]() { mesh.barrier(); });
+    }
+    if (error) {
+      for (auto& fds : mesh.fds_) {
+        for (int fd : fds) {
+          if (fd != -1) ::close(fd);
+        }
+      }
+      std::rethrow_exception(error);
+    }
+    return mesh.fds_;
+  }
+
+ private:
+  static constexpr uint32_t kMagic = 0x53484f52;  // "SHOR"
+
+  struct Handshake {
+    uint32_t magic;
+    uint32_t party;
+    uint64_t session;
+    uint32_t stream;
+    uint32_t streams;
+    uint64_t stripe_bytes;
+  };
+
+  Handshake hello(int stream) const {
+    return {kMagic, static_cast<uint32_t>(party_), options_.session, static_cast<uint32_t>(stream),
+            static_cast<uint32_t>(options_.streams), options_.stripe_bytes};
+  }
+
+  TcpMesh(int party, const TcpOptions& options)
+      : party_(party),
+        options_(options),
+        deadline_(std::chrono::steady_clock::now() + options.timeout) {}
+
+  int remainingMs() const {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline_ - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<int64_t>(0, left.count()));
+  }
+
+  void checkDeadline(const char* what) const {
+    if (remainingMs() == 0) {
+      throw std::runtime_error(boost::str(
+          boost::format("TcpMesh: party %1% timed out after %2% ms %3%") % party_ %
+          options_.timeout.count() % what));
+    }
+  }
+
+  int listenOn(int port, bool loopback) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, nP * options_.streams) != 0) {
+      int err = errno;
+      ::close(fd);
+      throw std::runtime_error(boost::str(boost::format("TcpMesh: cannot listen on port %1%: %2%") %
+                                          port % std::strerror(err)));
+    }
+    return fd;
+  }
+
+  // 带超时地读写握手消息，每次等待至多 wait_ms；失败时返回 false，由调用方决定重试还是丢弃连接
+  bool exchange(int fd, void* data, size_t len, bool reading, int wait_ms = 5000) const {
+    auto* bytes = static_cast<char*>(data);
+    while (len > 0) {
+      struct pollfd pfd {fd, static_cast<short>(reading ? POLLIN : POLLOUT), 0};
+      if (::poll(&pfd, 1, std::min(remainingMs(), wait_ms)) <= 0) return false;
+      ssize_t res = reading ? ::recv(fd, bytes, len, 0) : ::send(fd, bytes, len, MSG_NOSIGNAL);
+      if (res <= 0) {
+        if (res < 0 && errno == EINTR) continue;
+        return false;
+      }
+      bytes += res;
+      len -= res;
+    }
+    return true;
+  }
+
+  bool validHandshake(const Handshake& hs) const {
+    return hs.magic == kMagic && hs.session == options_.session && hs.party < nP &&
+           static_cast<int>(hs.party) != party_ &&
+           hs.streams == static_cast<uint32_t>(options_.streams) &&
+           hs.stripe_bytes == options_.stripe_bytes && hs.stream < hs.streams;
+  }
+
+  void acceptPeers(int listener) {
+    int missing = party_ * options_.streams;  // 编号更小的参与方主动连接我们
+    while (missing > 0) {
+      checkDeadline("waiting for connections");
+      struct pollfd pfd {listener, POLLIN, 0};
+      if (::poll(&pfd, 1, std::min(remainingMs(), 100)) <= 0) continue;
+      int fd = ::accept(listener, nullptr, nullptr);
+      if (fd < 0) continue;
+
+      Handshake hs{};
+      if (!exchange(fd, &hs, sizeof(hs), true) || !validHandshake(hs) ||
+          static_cast<int>(hs.party) > party_) {
+        ::close(fd);  // 不是本网络的连接，丢弃后继续等待
+        continue;
+      }
+      // 连接方收到应答后回一个确认字节；它在此之前放弃了（应答超时后关闭重连），
+      // 这里读到的是连接关闭，丢弃即可。确认一直等到总超时，连接方不会在确认后放弃
+      Handshake reply = hello(hs.stream);
+      char ack = 0;
+      if (!exchange(fd, &reply, sizeof(reply), false) || !exchange(fd, &ack, 1, true, INT_MAX)) {
+        ::close(fd);
+        continue;
+      }
+      setNoDelay(fd);
+      int& slot = fds_[hs.party][hs.stream];
+      if (slot != -1) {
+        // 对端重新连接了同一条流：旧连接已被它放弃，换成新的
+        ::close(slot);
+      } else {
+        --missing;
+      }
+      slot = fd;
+    }
+  }
+
+  void connectPeer(int peer, int port) {
+    for (int stream = 0; stream < options_.streams; ++stream) {
+      connectStream(peer, port, stream);
+    }
+  }
+
+  void connectStream(int peer, int port, int stream) {
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, hosts_[peer].c_str(), &addr.sin_addr) != 1) {
+      throw std::invalid_argument(boost::str(boost::format("TcpMesh: invalid address '%1%' of party %2%") %
+                                             hosts_[peer] % peer));
+    }
+
+    auto backoff = options_.initial_backoff;
+    while (true) {
+      checkDeadline("connecting");
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        Handshake hs = hello(stream);
+        Handshake reply{};
+        char ack = 1;
+        if (exchange(fd, &hs, sizeof(hs), false) && exchange(fd, &reply, sizeof(reply), true) &&
+            validHandshake(reply) && static_cast<int>(reply.party) == peer &&
+            static_cast<int>(reply.stream) == stream && exchange(fd, &ack, 1, false)) {
+          setNoDelay(fd);
+          fds_[peer][stream] = fd;
+          return;
+        }
+      }
+      // 对端还没开始监听，或者监听的不是本网络：退避后重试
+      ::close(fd);
+      std::this_thread::sleep_for(backoff);
+      backoff = std::min(backoff * 2, options_.max_backoff);
+    }
+  }
+
+  static void setNoDelay(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+
+  // 就绪屏障（只走第 0 条流）：收到所有对端的就绪字节后，说明每一方都已建好完整的网络。
+  // 较慢的一方可能还在连接其他参与方，所以一直等到总超时
+  void barrier() {
+    char ready = 1;
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer != party_ && !exchange(fds_[peer][0], &ready, 1, false, INT_MAX)) {
+        throw std::runtime_error(boost::str(
+            boost::format("TcpMesh: party %1% lost party %2% during setup") % party_ % peer));
+      }
+    }
+    for (int peer = 0; peer < nP; ++peer) {
+      if (peer != party_ && !exchange(fds_[peer][0], &ready, 1, true, INT_MAX)) {
+        throw std::runtime_error(boost::str(
+            boost::format("TcpMesh: party %1% lost party %2% during setup") % party_ % peer));
+      }
+    }
+  }
+
+  int party_;
+  TcpOptions options_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::array<std::string, nP> hosts_;
+  std::array<std::vector<int>, nP> fds_;
+};
+
+// TCP connections between all pairs of parties (see TcpMesh), used full duplex
+// with blocking calls: sends are buffered per peer until flush, receives read
+// ahead into a per-connection buffer. With several streams per pair, writes
+// and reads that span more than one stripe drive all streams at once through
+// poll.
+template <int nP>
+class TcpTransport : public Transport<nP> {
+ public:
+  TcpTransport(int party, int port, char* ip[], const TcpOptions& options = {})
+      : stripe_bytes_(options.stripe_bytes) {
+    auto fds = TcpMesh<nP>::connect(party, port, ip, options);
+    for (int i = 0; i < nP; ++i) {
+      for (int fd : fds[i]) {
+        peers_[i].streams.emplace_back();
+        peers_[i].streams.back().fd = fd;
+      }
+    }
+  }
+
+  TcpTransport(const TcpTransport&) = delete;
+  TcpTransport& operator=(const TcpTransport&) = delete;
+
+  ~TcpTransport() override { closeAll(); }
+
+  void send(int dst, const void* data, size_t len) override {
+    auto& p = peers_[dst];
+    if (len >= kBufferBytes) {
+      // 大块数据不经发送缓冲区，与缓冲区中已有的数据一起直接写出
+      struct iovec iov {const_cast<void*>(data), len};
+      sendv(dst, &iov, 1);
+      return;
+    }
+    if (p.out_len + len > kBufferBytes) {
+      flush(dst);
+    }
+    std::memcpy(p.out.data() + p.out_len, data, len);
+    p.out_len += len;
+  }
+
+  // The send buffer and `iov` leave in the same sendmsg calls, so a round's
+  // messages to one peer cost one system call per stream when they fit the
+  // socket buffers.
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    auto& p = peers_[dst];
+    if (p.out_len == 0 && p.streams.size() == 1) {
+      writevAll(dst, p.streams[0].fd, iov, iovcnt);
+      return;
+    }
+    std::vector<struct iovec> all;
+    all.reserve(iovcnt + 1);
+    if (p.out_len != 0) {
+      all.push_back({p.out.data(), p.out_len});
+    }
+    all.insert(all.end(), iov, iov + iovcnt);
+    p.out_len = 0;
+    if (p.streams.size() == 1) {
+      writevAll(dst, p.streams[0].fd, all.data(), all.size());
+      return;
+    }
+    writeStriped(dst, all.data(), all.size());
+  }
+
+  void recv(int src, void* data, size_t len) override {
+    auto& p = peers_[src];
+    auto* dst = static_cast<char*>(data);
+    if (p.streams.size() == 1) {
+      readStream(src, p.streams[0], dst, len);
+      return;
+    }
+    struct iovec whole {dst, len};
+    auto pieces = stripe(p.streams.size(), p.recv_offset, &whole, 1);
+    p.recv_offset += len;
+    int busy = -1;
+    for (size_t s = 0; s < pieces.size(); ++s) {
+      if (!pieces[s].empty()) busy = busy == -1 ? static_cast<int>(s) : -2;
+    }
+    if (busy >= 0) {
+      // 全部落在同一条流上（小消息的常见情况）：走带预读的路径
+      for (auto& piece : pieces[busy]) {
+        readStream(src, p.streams[busy], piece.data, piece.len);
+      }
+      return;
+    }
+    // 先用各流的预读数据，剩下的直接读进目标内存
+    for (size_t s = 0; s < pieces.size(); ++s) {
+      auto& st = p.streams[s];
+      while (!pieces[s].empty() && st.in_head < st.in_tail) {
+        auto& piece = pieces[s].front();
+        size_t n = std::min(piece.len, st.in_tail - st.in_head);
+        std::memcpy(piece.data, st.in.data() + st.in_head, n);
+        st.in_head += n;
+        piece.data += n;
+        piece.len -= n;
+        if (piece.len == 0) pieces[s].pop_front();
+      }
+    }
+    pollStreams(src, pieces, POLLIN);
+  }
+
+  void flush(int dst) override {
+    auto& p = peers_[dst];
+    if (p.out_len != 0) {
+      write(dst, p.out.data(), p.out_len);
+      p.out_len = 0;
+    }
+  }
+
+  int64_t count(int peer) const override { return peers_[peer].sent; }
+
+  void resetStats() override {
+    for (auto& p : peers_) {
+      p.sent = 0;
+    }
+  }
+
+ private:
+  static constexpr size_t kBufferBytes = 1 << 18;
+
+  struct Stream {
+    int fd = -1;
+    std::vector<char> in = std::vector<char>(kBufferBytes);
+    size_t in_head = 0;
+    size_t in_tail = 0;
+  };
+
+  struct Peer {
+    std::vector<Stream> streams;
+    std::vector<char> out = std::vector<char>(kBufferBytes);
+    size_t out_len = 0;
+    // 逻辑字节流中已发出/已收到的位置，决定下一块落在哪条流上
+    uint64_t send_offset = 0;
+    uint64_t recv_offset = 0;
+    int64_t sent = 0;
+  };
+
+  // 一段连续内存，属于某条流
+  struct Piece {
+    char* data;
+    size_t len;
+  };
+  using Pieces = std::vector<std::deque<Piece>>;
+
+  std::runtime_error ioError(const char* what, int peer) const {
+    return std::runtime_error(boost::str(boost::format("TcpTransport: cannot %1% party %2%: %3%") %
+                                         what % peer % std::strerror(errno)));
+  }
+
+  // 把从 offset 开始、由 iov 依次组成的逻辑字节流按条带切开，第 b 块属于第 b % streams 条流
+  Pieces stripe(size_t streams, uint64_t offset, const struct iovec* iov, size_t iovcnt) const {
+    Pieces pieces(streams);
+    for (size_t i = 0; i < iovcnt; ++i) {
+      auto* data = static_cast<char*>(iov[i].iov_base);
+      size_t len = iov[i].iov_len;
+      while (len > 0) {
+        size_t n = std::min<uint64_t>(len, stripe_bytes_ - offset % stripe_bytes_);
+        pieces[(offset / stripe_bytes_) % streams].push_back({data, n});
+        offset += n;
+        data += n;
+        len -= n;
+      }
+    }
+    return pieces;
+  }
+
+  void write(int dst, const char* data, size_t len) {
+    auto& p = peers_[dst];
+    if (p.streams.size() == 1) {
+      writeAll(dst, p.streams[0].fd, data, len);
+      return;
+    }
+    struct iovec whole {const_cast<char*>(data), len};
+    writeStriped(dst, &whole, 1);
+  }
+
+  // 多条流时按条带写出 iov：每条流上的片段用一次 sendmsg 一起发出
+  void writeStriped(int dst, const struct iovec* iov, size_t iovcnt) {
+    auto& p = peers_[dst];
+    auto pieces = stripe(p.streams.size(), p.send_offset, iov, iovcnt);
+    for (size_t i = 0; i < iovcnt; ++i) {
+      p.send_offset += iov[i].iov_len;
+    }
+    pollStreams(dst, pieces, POLLOUT);
+  }
+
+  void writeAll(int dst, int fd, const char* data, size_t len) {
+    auto& p = peers_[dst];
+    while (len > 0) {
+      ssize_t res = ::send(fd, data, len, MSG_NOSIGNAL);
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        throw ioError("send to", dst);
+      }
+      p.sent += res;
+      data += res;
+      len -= res;
+    }
+  }
+
+  void writevAll(int dst, int fd, struct iovec* iov, size_t iovcnt) {
+    auto& p = peers_[dst];
+    while (iovcnt > 0) {
+      if (iov->iov_len == 0) {
+        ++iov;
+        --iovcnt;
+        continue;
+      }
+      struct msghdr msg {};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = std::min<size_t>(iovcnt, IOV_MAX);
+      ssize_t res = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        throw ioError("send to", dst);
+      }
+      p.sent += res;
+      auto done = static_cast<size_t>(res);
+      while (done > 0) {
+        if (done >= iov->iov_len) {
+          done -= iov->iov_len;
+          ++iov;
+          --iovcnt;
+        } else {
+          iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+          iov->iov_len -= done;
+          done = 0;
+        }
+      }
+    }
+  }
+
+  void readStream(int src, Stream& st, char* dst, size_t len) {
+    while (len > 0) {
+      if (st.in_head < st.in_tail) {
+        size_t n = std::min(len, st.in_tail - st.in_head);
+        std::memcpy(dst, st.in.data() + st.in_head, n);
+        st.in_head += n;
+        dst += n;
+        len -= n;
+        continue;
+      }
+      // 缓冲区已空：大块数据直接读到目标内存，小块数据先预读一整块
+      bool direct = len >= kBufferBytes;
+      ssize_t res = ::recv(st.fd, direct ? dst : st.in.data(), direct ? len : kBufferBytes, 0);
+      if (res == 0) {
+        throw std::runtime_error(boost::str(
+            boost::format("TcpTransport: party %1% closed the connection") % src));
+      }
+      if (res < 0) {
+        if (errno == EINTR) continue;
+        throw ioError("receive from", src);
+      }
+      if (direct) {
+        dst += res;
+        len -= res;
+      } else {
+        st.in_head = 0;
+        st.in_tail = static_cast<size_t>(res);
+      }
+    }
+  }
+
+  // 同时推进多条流上的收发：哪条流就绪就读写哪条，直到所有片段完成。
+  // 一条流上排队的片段用一次 sendmsg/recvmsg 收发
+  void pollStreams(int peer, Pieces& pieces, short events) {
+    auto& p = peers_[peer];
+    std::vector<struct pollfd> pfds;
+    std::vector<size_t> ids;
+    std::vector<struct iovec> iov;
+    while (true) {
+      pfds.clear();
+      ids.clear();
+      for (size_t s = 0; s < pieces.size(); ++s) {
+        if (!pieces[s].empty()) {
+          pfds.push_back({p.streams[s].fd, events, 0});
+          ids.push_back(s);
+        }
+      }
+      if (pfds.empty()) return;
+      if (::poll(pfds.data(), pfds.size(), -1) < 0) {
+        if (errno == EINTR) continue;
+        throw ioError(events == POLLIN ? "receive from" : "send to", peer);
+      }
+      for (size_t k = 0; k < pfds.size(); ++k) {
+        if (pfds[k].revents == 0) continue;
+        auto& queue = pieces[ids[k]];
+        iov.clear();
+        for (size_t i = 0; i < queue.size() && i < IOV_MAX; ++i) {
+          iov.push_back({queue[i].data, queue[i].len});
+        }
+        struct msghdr msg {};
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = iov.size();
+        ssize_t res = events == POLLIN
+                          ? ::recvmsg(pfds[k].fd, &msg, MSG_DONTWAIT)
+                          : ::sendmsg(pfds[k].fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (res == 0 && events == POLLIN) {
+          throw std::runtime_error(boost::str(
+              boost::format("TcpTransport: party %1% closed the connection") % peer));
+        }
+        if (res < 0) {
+          if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+          throw ioError(events == POLLIN ? "receive from" : "send to", peer);
+        }
+        if (events == POLLOUT) {
+          p.sent += res;
+        }
+        auto done = static_cast<size_t>(res);
+        while (done > 0) {
+          auto& piece = queue.front();
+          size_t n = std::min(done, piece.len);
+          piece.data += n;
+          piece.len -= n;
+          done -= n;
+          if (piece.len == 0) {
+            queue.pop_front();
+          }
+        }
+      }
+    }
+  }
+
+  void closeAll() {
+    for (auto& p : peers_) {
+      for (auto& st : p.streams) {
+        ::close(st.fd);
+      }
+      p.streams.clear();
+    }
+  }
+
+  uint64_t stripe_bytes_;
+  std::array<Peer, nP> peers_;
+};
+
+};  // namespace io
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace io {
+
+// Byte streams to every peer that a NetIOMP runs on (see the
+// NetIOMP(party, transport) constructor). Streams to different peers may be
+// used from different threads concurrently.
+template <int nP>
+class Transport {
+ public:
+  virtual ~Transport() = default;
+  virtual void send(int dst, const void* data, size_t len) = 0;
+  // May modify `iov` in place.
+  virtual void sendv(int dst, struct iovec* iov, size_t iovcnt) = 0;
+  virtual void recv(int src, void* data, size_t len) = 0;
+  virtual void flush(int dst) = 0;
+  // Bytes sent to `peer` so far.
+  virtual int64_t count(int peer) const = 0;
+  virtual void resetStats() = 0;
+};
+
+};  // namespace io
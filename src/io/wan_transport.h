@@ -0,0 +1,253 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "netmp.h"
+
+namespace io {
+
+// Characteristics of the link from one party to another.
+struct WanLink {
+  // Added to the delivery time of every flushed message.
+  double delay_ms = 0;
+  // A further delay drawn uniformly from [0, jitter_ms) per message. Messages
+  // on a link still arrive in order, as they would over TCP.
+  double jitter_ms = 0;
+  // Rate of the link in Mbit/s, 0 for unlimited.
+  double mbps = 0;
+  // Depth of the token bucket: how many bytes may leave back to back before
+  // the rate limit applies.
+  size_t burst_bytes = 64 * 1024;
+
+  bool active() const { return delay_ms > 0 || jitter_ms > 0 || mbps > 0; }
+};
+
+// Decorator that makes any transport behave like a wide-area network: a
+// flushed message is held back until the token bucket of its link lets it
+// leave and its one-way delay (plus jitter) has passed, and is then handed to
+// the wrapped transport by the pacing thread of its link, so a link whose
+// inner send blocks does not hold up the others. Only the sending side is shaped,
+// so wrapping the transport of every party shapes every link once. This
+// needs neither tc nor root, and runs on shared memory or in-process meshes
+// as well as on TCP.
+//
+// As on a real link, a sender that runs ahead of the rate is blocked in flush
+// once about two bandwidth-delay products are queued for a peer.
+template <int nP>
+class WanTransport : public Transport<nP> {
+ public:
+  // `links[i]` shapes what this party sends to party i. `seed` fixes the
+  // jitter for reproducible runs.
+  WanTransport(std::unique_ptr<Transport<nP>> inner, int party,
+               const std::array<WanLink, nP>& links, uint64_t seed = 0)
+      : inner_(std::move(inner)), party_(party), rgen_(seed * nP + party) {
+    auto now = Clock::now();
+    for (int i = 0; i < nP; ++i) {
+      auto& l = links_[i];
+      l.link = links[i];
+      l.bytes_per_ms = links[i].mbps * 1e3 / 8;
+      l.tokens = static_cast<double>(links[i].burst_bytes);
+      l.refill = now;
+      l.last_delivery = now;
+      double bdp = l.bytes_per_ms * links[i].delay_ms;
+      l.max_queued = std::max<size_t>(kMinQueuedBytes, static_cast<size_t>(2 * bdp));
+    }
+    for (int i = 0; i < nP; ++i) {
+      if (i != party_) {
+        pacers_[i] = std::thread([this, i]() { pace(i); });
+      }
+    }
+  }
+
+  WanTransport(const WanTransport&) = delete;
+  WanTransport& operator=(const WanTransport&) = delete;
+
+  // Delivers every message flushed so far, at its time, before returning.
+  ~WanTransport() override {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stopping_ = true;
+    }
+    for (int i = 0; i < nP; ++i) {
+      if (i != party_) {
+        links_[i].pacer_cv.notify_all();
+        pacers_[i].join();
+      }
+    }
+  }
+
+  void send(int dst, const void* data, size_t len) override {
+    auto& stage = links_[dst].stage;
+    const auto* bytes = static_cast<const char*>(data);
+    stage.insert(stage.end(), bytes, bytes + len);
+  }
+
+  // As on the other transports, sendv does not wait for a flush: the message
+  // is scheduled right away.
+  void sendv(int dst, struct iovec* iov, size_t iovcnt) override {
+    for (size_t i = 0; i < iovcnt; ++i) {
+      send(dst, iov[i].iov_base, iov[i].iov_len);
+    }
+    flush(dst);
+  }
+
+  void recv(int src, void* data, size_t len) override { inner_->recv(src, data, len); }
+
+  void flush(int dst) override {
+    auto& l = links_[dst];
+    if (l.stage.empty()) return;
+    size_t len = l.stage.size();
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      auto due = schedule(l, len);
+      l.queue.push_back({due, std::move(l.stage)});
+      l.queued += len;
+      l.sent += static_cast<int64_t>(len);
+      l.pacer_cv.notify_all();
+      space_cv_.wait(lock, [&]() { return l.queued <= l.max_queued || error_; });
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+    }
+    l.stage.clear();
+  }
+
+  int64_t count(int peer) const override {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return links_[peer].sent;
+  }
+
+  void resetStats() override {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& l : links_) {
+      l.sent = 0;
+    }
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using Millis = std::chrono::duration<double, std::milli>;
+  static constexpr size_t kMinQueuedBytes = 1 << 22;
+
+  struct Message {
+    Clock::time_point due;
+    std::vector<char> data;
+  };
+
+  struct Link {
+    WanLink link;
+    double bytes_per_ms = 0;
+    size_t max_queued = 0;
+    // 只由发送线程访问
+    std::vector<char> stage;
+    // 以下由 mtx_ 保护
+    double tokens = 0;
+    Clock::time_point refill;         // tokens 对应的时刻，可能在将来
+    Clock::time_point last_delivery;  // 保证同一链路上按顺序到达
+    std::deque<Message> queue;
+    size_t queued = 0;
+    int64_t sent = 0;
+    std::condition_variable pacer_cv;  // 唤醒本链路的发送线程
+  };
+
+  // 计算 len 字节的消息何时送达：令牌不足时等到攒够为止，再加上单向延迟和抖动
+  Clock::time_point schedule(Link& l, size_t len) {
+    auto depart = std::max(Clock::now(), l.refill);
+    if (l.bytes_per_ms > 0) {
+      l.tokens = std::min<double>(static_cast<double>(l.link.burst_bytes),
+                                  l.tokens + Millis(depart - l.refill).count() * l.bytes_per_ms);
+      l.tokens -= static_cast<double>(len);
+      if (l.tokens < 0) {
+        depart += std::chrono::duration_cast<Clock::duration>(Millis(-l.tokens / l.bytes_per_ms));
+        l.tokens = 0;
+      }
+      l.refill = depart;
+    }
+    double delay = l.link.delay_ms;
+    if (l.link.jitter_ms > 0) {
+      delay += std::uniform_real_distribution<double>(0, l.link.jitter_ms)(rgen_);
+    }
+    auto due = depart + std::chrono::duration_cast<Clock::duration>(Millis(delay));
+    l.last_delivery = std::max(l.last_delivery, due);
+    return l.last_delivery;
+  }
+
+  // 链路 dst 的发送线程：按到期时间把队首的消息交给内层传输。
+  // 同一链路上到期时间单调不减，只需看队首
+  void pace(int dst) {
+    auto& l = links_[dst];
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+      if (error_) return;
+      if (l.queue.empty()) {
+        if (stopping_) return;
+        l.pacer_cv.wait(lock);
+        continue;
+      }
+      auto due = l.queue.front().due;
+      if (Clock::now() < due) {
+        l.pacer_cv.wait_until(lock, due);
+        continue;
+      }
+
+      auto message = std::move(l.queue.front());
+      l.queue.pop_front();
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        inner_->send(dst, message.data.data(), message.data.size());
+        inner_->flush(dst);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      l.queued -= message.data.size();
+      if (error && !error_) {
+        error_ = error;
+        // 其他链路的发送线程也随之退出，未发出的消息丢弃
+        for (auto& other : links_) {
+          other.pacer_cv.notify_all();
+        }
+      }
+      space_cv_.notify_all();
+    }
+  }
+
+  std::unique_ptr<Transport<nP>> inner_;
+  int party_;
+  std::mt19937_64 rgen_;
+  std::array<Link, nP> links_;
+  mutable std::mutex mtx_;
+  std::condition_variable space_cv_;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+  std::array<std::thread, nP> pacers_;
+};
+
+// Shapes every link of `network` from this party with `link`. Call on every
+// party before any traffic (right after the mesh is set up); `seed` fixes the
+// jitter.
+template <int nP>
+void emulateWan(NetIOMP<nP>& network, const WanLink& link, uint64_t seed = 0) {
+  std::array<WanLink, nP> links;
+  links.fill(link);
+  network.wrapTransport([&](std::unique_ptr<Transport<nP>> inner) {
+    return std::make_unique<WanTransport<nP>>(std::move(inner), network.party, links, seed);
+  });
+}
+
+};  // namespace io
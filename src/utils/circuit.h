@@ -404,7 +404,7 @@ class Circuit {
               auto* g = static_cast<FIn1Gate*>(gate.get());
               std::vector<BoolRing> bin = bitDecompose(wires[g->in]);
 
-              if (bin[BITS_GAMMA-1].val()) //如果最高位为1，那么为负数，直接返回0
+              if (bin[FixedPoint<R>::kBitsGamma - 1].val()) //如果最高位为1，那么为负数，直接返回0
                 wires[g->out] = 0;
               else  //如果最高位为0，那么为正数数，直接返回原始值
                 wires[g->out] = wires[g->in];
@@ -419,7 +419,7 @@ class Circuit {
               wires[g->out] = wires[g->in];
             } else {
               std::vector<BoolRing> bin = bitDecompose(wires[g->in]);
-              wires[g->out] = bin[63].val(); //直接看最高位是正还是负
+              wires[g->out] = bin.back().val(); //直接看最高位是正还是负
             }
             break;
           }
@@ -431,7 +431,7 @@ class Circuit {
               wires[g->out] = wires[g->in];
             } else {
               std::vector<BoolRing> bin = bitDecompose(wires[g->in]);
-              if (bin[BITS_GAMMA-1].val()) { //最高位是1，那么是负数
+              if (bin[FixedPoint<R>::kBitsGamma - 1].val()) { //最高位是1，那么是负数
                 wires[g->out] = CMP_lESS_RESULT;
               }
               else {
@@ -450,10 +450,15 @@ class Circuit {
           }
 
           case GateType::kPerm: {
-            auto* g = static_cast<PermGate*>(gate.get());
-            size_t new_index = wires[g->in2.at(counter)];
-            wires[g->multi_out[new_index]] = wires[g->in1.at(counter)];
-            counter++;
+            if constexpr (std::is_same_v<R, BoolRing>) {
+              throw std::runtime_error(
+                  "Permutation gates are invalid for BoolRing.");
+            } else {
+              auto* g = static_cast<PermGate*>(gate.get());
+              size_t new_index = wires[g->in2.at(counter)];
+              wires[g->multi_out[new_index]] = wires[g->in1.at(counter)];
+              counter++;
+            }
             break;
           }
 
@@ -468,7 +473,7 @@ class Circuit {
                 auto temp = wires[g->in1.at(i)] * wires[g->in2.at(i)];
                 wires[g->out] += temp;
               }
-              wires[g->out] = wires[g->out] >> FRACTION;
+              wires[g->out] = wires[g->out] >> FixedPoint<R>::kFraction;
             }
             break;
           }
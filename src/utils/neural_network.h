@@ -169,9 +169,9 @@ class NeuralNetwork {
     wmat4_t output(out_shape);
 
     double div = 1.0 / (1.0 * pool_shape[0] * pool_shape[1]);
-    Ring multiplier = 1UL << FRACTION;
-    div *= multiplier;
-    Ring rdiv = static_cast<Ring>(div);
+    R multiplier = R(1) << FixedPoint<R>::kFraction;
+    div *= static_cast<double>(multiplier);
+    R rdiv = static_cast<R>(div);
 
     for (size_t b = 0; b < out_shape[0]; ++b) {
       for (size_t d = 0; d < out_shape[3]; ++d) {
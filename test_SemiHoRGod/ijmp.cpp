@@ -1,10 +1,31 @@
 #define BOOST_TEST_MODULE jump
 #include <emp-tool/emp-tool.h>
+#include <io/epoll_transport.h>
+#include <io/mem_transport.h>
 #include <io/netmp.h>
+#include <io/replay_transport.h>
+#include <io/session_mux.h>
+#include <io/shm_transport.h>
+#include <io/wan_transport.h>
+#include <SemiHoRGod/helpers.h>
 #include <SemiHoRGod/ijmp.h>
+#include <SemiHoRGod/jump_scheduler.h>
 #include <boost/test/included/unit_test.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace SemiHoRGod;
@@ -60,4 +81,1260 @@ BOOST_AUTO_TEST_CASE(all_combinations) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(repeated_rounds) {
+  // 同一个 jump 实例连续通信多轮，常驻收发线程需要在轮与轮之间正确复用
+  constexpr int num_rounds = 20;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        // 每一轮的数据长度不同，覆盖小数据和跨越接收分块的大数据
+        size_t len = (round % 2 == 0) ? 8 : (1 << 20) + round;
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          int sender1 = pidFromOffset(receiver, 1);
+          int sender2 = pidFromOffset(receiver, 2);
+          int sender3 = pidFromOffset(receiver, 3);
+          std::vector<uint8_t> input(len, static_cast<uint8_t>(round * NUM_PARTIES + receiver));
+          jump.jumpUpdate(sender1, sender2, sender3, receiver, len,
+                          receiver == i ? nullptr : input.data());
+        }
+
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len, static_cast<uint8_t>(round * NUM_PARTIES + i));
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(mixed_span_and_copy) {
+  // 同一通道内拷贝写入和 span 注册交替出现，接收方看到的顺序必须与调用顺序一致
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      std::vector<std::vector<uint8_t>> spans;
+      for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+        spans.emplace_back(1000, static_cast<uint8_t>(receiver + 1));
+      }
+
+      for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+        int sender1 = pidFromOffset(receiver, 4);
+        int sender2 = pidFromOffset(receiver, 5);
+        int sender3 = pidFromOffset(receiver, 6);
+        std::vector<uint8_t> head = {1, 2, 3};
+        std::vector<uint8_t> tail = {4, 5};
+        bool is_receiver = (receiver == i);
+        jump.jumpUpdate(sender1, sender2, sender3, receiver, head.size(), is_receiver ? nullptr : head.data());
+        jump.jumpUpdateSpan(sender1, sender2, sender3, receiver, spans[receiver].size(),
+                            is_receiver ? nullptr : spans[receiver].data());
+        jump.jumpUpdate(sender1, sender2, sender3, receiver, tail.size(), is_receiver ? nullptr : tail.data());
+      }
+
+      jump.communicate(network, tpool);
+
+      std::vector<uint8_t> expected = {1, 2, 3};
+      expected.insert(expected.end(), spans[i].begin(), spans[i].end());
+      expected.insert(expected.end(), {4, 5});
+      BOOST_TEST(jump.getValues(pidFromOffset(i, 4), pidFromOffset(i, 5), pidFromOffset(i, 6)) == expected);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(deferred_verification) {
+  // 延迟校验模式：第二轮中哈希发送方 (最大 id) 对发给参与方 0 的数据哈希了不同的内容，
+  // 接收方在该轮照常拿到数据，但在检查点处必须发现不一致。
+  // 每个通道每轮只有第一个数据发送方发数据，另外两方只在检查点发摘要。
+  constexpr int num_rounds = 3;
+  constexpr size_t len = 16;
+  std::array<int64_t, NUM_PARTIES> round_bytes{};
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setDeferredVerification(true);
+      network.resetStats();
+
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          int sender1 = pidFromOffset(receiver, 1);
+          int sender2 = pidFromOffset(receiver, 2);
+          int sender3 = pidFromOffset(receiver, 3);
+          std::vector<uint8_t> input(len, static_cast<uint8_t>(round * NUM_PARTIES + receiver));
+          if (round == 1 && receiver == 0 && i == 3) {
+            input[0] ^= 1;
+          }
+          jump.jumpUpdate(sender1, sender2, sender3, receiver, input.size(),
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len, static_cast<uint8_t>(round * NUM_PARTIES + i));
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+      round_bytes[i] = network.count();
+
+      if (i == 0) {
+        BOOST_CHECK_THROW(jump.verify(network), std::runtime_error);
+      } else {
+        BOOST_CHECK_NO_THROW(jump.verify(network));
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+  int64_t total = 0;
+  for (auto bytes : round_bytes) {
+    total += bytes;
+  }
+  BOOST_TEST(total == static_cast<int64_t>(num_rounds * NUM_PARTIES * len));
+}
+
+BOOST_AUTO_TEST_CASE(single_value_sender) {
+  // 单数据发送方模式：只有最小 id 的发送方发数据。第二轮中它发给参与方 0 的数据被篡改，
+  // 两份摘要都对不上，接收方必须从 mid 那里拿到正确的数据；第三轮中 mid 作恶，
+  // 接收方不能因为它的摘要而放弃正确的数据。
+  constexpr int num_rounds = 3;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setSingleValueSender(true);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          int sender1 = pidFromOffset(receiver, 1);
+          int sender2 = pidFromOffset(receiver, 2);
+          int sender3 = pidFromOffset(receiver, 3);
+          std::vector<uint8_t> input(16, static_cast<uint8_t>(round * NUM_PARTIES + receiver));
+          if (round == 1 && receiver == 0 && i == 1) {
+            input[0] ^= 1;
+          }
+          if (round == 2 && receiver == 0 && i == 2) {
+            input[0] ^= 1;  // mid 的摘要不对时仍应使用 min 的数据
+          }
+          jump.jumpUpdate(sender1, sender2, sender3, receiver, input.size(),
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(16, static_cast<uint8_t>(round * NUM_PARTIES + i));
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rotating_roles) {
+  // 分工轮换：3 轮之后重构模式下每条链路承担的字节数相同；
+  // 同时打开单数据发送方模式并篡改一份数据，检查补发在轮换下仍然正确。
+  constexpr int num_rounds = 3;
+  constexpr size_t len = 16;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setRolePolicy(JumpRolePolicy::kRotating);
+
+      for (int round = 0; round < 2 * num_rounds; ++round) {
+        if (round == num_rounds) {
+          // 前 3 轮统计链路字节数，后 3 轮测试单数据发送方模式
+          for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+            if (peer != i) {
+              BOOST_TEST(jump.linkBytesSent()[peer] == jump.linkBytesSent()[(i + 1) % NUM_PARTIES]);
+            }
+          }
+          jump.setSingleValueSender(true);
+        }
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          for (int offset = 1; offset <= 4; offset += 3) {
+            int sender1 = pidFromOffset(receiver, offset);
+            int sender2 = pidFromOffset(receiver, offset + 1);
+            int sender3 = pidFromOffset(receiver, offset + 2);
+            std::vector<uint8_t> input(len, static_cast<uint8_t>(round * NUM_PARTIES + receiver + offset));
+            if (round >= num_rounds && receiver == 0 && offset == 1 && i == 1) {
+              input[0] ^= 1;  // 参与方 1 依次以三种身份作恶
+            }
+            jump.jumpUpdate(sender1, sender2, sender3, receiver, len,
+                            receiver == i ? nullptr : input.data());
+          }
+        }
+        jump.communicate(network, tpool);
+
+        for (int offset = 1; offset <= 4; offset += 3) {
+          std::vector<uint8_t> expected(len, static_cast<uint8_t>(round * NUM_PARTIES + i + offset));
+          BOOST_TEST(jump.getValues(pidFromOffset(i, offset), pidFromOffset(i, offset + 1),
+                                    pidFromOffset(i, offset + 2)) == expected);
+        }
+        jump.reset();
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bandwidth_aware_roles) {
+  // 按测得的链路吞吐分工：所有参与方必须得到同一张吞吐表，分工一致时数据才能正确收发
+  constexpr int num_rounds = 4;
+  constexpr size_t len = 1 << 19;
+  std::array<std::array<std::array<uint64_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> rates{};
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setRolePolicy(JumpRolePolicy::kBandwidthAware, 2);
+      jump.setSingleValueSender(true);
+      jump.probeLinks(network, 1 << 16);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          int sender1 = pidFromOffset(receiver, 1);
+          int sender2 = pidFromOffset(receiver, 2);
+          int sender3 = pidFromOffset(receiver, 3);
+          std::vector<uint8_t> input(len, static_cast<uint8_t>(round * NUM_PARTIES + receiver));
+          if (receiver == 0 && i == 2) {
+            input[0] ^= 1;  // 参与方 2 不论分到哪种身份都不能影响结果
+          }
+          jump.jumpUpdate(sender1, sender2, sender3, receiver, len,
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len, static_cast<uint8_t>(round * NUM_PARTIES + i));
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+      rates[i] = jump.linkRates();
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    BOOST_TEST((rates[i] == rates[0]));
+    for (int sender = 0; sender < NUM_PARTIES; ++sender) {
+      if (sender != i) {
+        BOOST_TEST(rates[0][sender][i] > 0U);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bandwidth_aware_reprobe) {
+  // 每轮重新分工，数据量小于采样阈值，所有链路的估计都会过期并被重新探测；
+  // 各方对探测哪些链路的判断必须一致，否则数据流错位
+  constexpr int num_rounds = 12;
+  constexpr size_t len = 64;
+  std::array<std::array<std::array<uint64_t, NUM_PARTIES>, NUM_PARTIES>, NUM_PARTIES> rates{};
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setRolePolicy(JumpRolePolicy::kBandwidthAware, 1);
+      jump.probeLinks(network, 1 << 12);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          std::vector<uint8_t> input(len, static_cast<uint8_t>(round * NUM_PARTIES + receiver));
+          jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                          pidFromOffset(receiver, 3), receiver, len,
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len, static_cast<uint8_t>(round * NUM_PARTIES + i));
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+      rates[i] = jump.linkRates();
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    BOOST_TEST((rates[i] == rates[0]));
+    for (int sender = 0; sender < NUM_PARTIES; ++sender) {
+      if (sender != i) {
+        BOOST_TEST(rates[0][sender][i] > 0U);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(first_arrival) {
+  // 首达即完成：参与方 3 等参与方 5 跑完所有轮次后才开始发送，5 无需等它也能拿到
+  // 正确结果，下一轮也不必等它上一轮的数据收完；参与方 2 在奇数轮篡改发给 0 的数据，
+  // 此时 0 必须等到一份与摘要一致的数据。
+  // 参与方 5 的两个三元组是 (6,0,1) 和 (2,3,4)。(2,3,4) 中参与方 2 发数据、4 发摘要，
+  // 不需要参与方 3；(6,0,1) 中参与方 0 被卡住时由 1 和 6 确定。
+  constexpr int num_rounds = 4;
+  constexpr int straggler = 3;
+  constexpr int fast = 5;
+  // 只用来让错误的实现失败而不是挂住，不是性能阈值
+  constexpr auto deadlock_bound = std::chrono::seconds(30);
+  std::promise<void> fast_done;
+  auto fast_done_future = fast_done.get_future().share();
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setFirstArrival(true);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          for (int offset = 1; offset <= 4; offset += 3) {
+            int sender1 = pidFromOffset(receiver, offset);
+            int sender2 = pidFromOffset(receiver, offset + 1);
+            int sender3 = pidFromOffset(receiver, offset + 2);
+            std::vector<uint8_t> input(64, static_cast<uint8_t>(round * NUM_PARTIES + receiver + offset));
+            if (round % 2 == 1 && receiver == 0 && i == 2) {
+              input[0] ^= 1;
+            }
+            jump.jumpUpdate(sender1, sender2, sender3, receiver, input.size(),
+                            receiver == i ? nullptr : input.data());
+          }
+        }
+        if (round == 0 && i == straggler) {
+          BOOST_TEST((fast_done_future.wait_for(deadlock_bound) == std::future_status::ready));
+        }
+        jump.communicate(network, tpool);
+
+        for (int offset = 1; offset <= 4; offset += 3) {
+          std::vector<uint8_t> expected(64, static_cast<uint8_t>(round * NUM_PARTIES + i + offset));
+          BOOST_TEST(jump.getValues(pidFromOffset(i, offset), pidFromOffset(i, offset + 1),
+                                    pidFromOffset(i, offset + 2)) == expected);
+        }
+        jump.reset();
+      }
+      if (i == fast) {
+        fast_done.set_value();
+      }
+      jump.drain();
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(async_communicate) {
+  // 异步轮次：第一轮参与方 3 等参与方 5 的两个通道都就绪后才发送，5 的
+  // (6,0,1) 和 (2,3,4) 都不依赖它；但 5 的这一轮要等 3 的数据收完才结束。
+  // 第二轮参与方 2 篡改发给 0 的数据，逐通道等待时也必须选出正确的那份。
+  constexpr int num_rounds = 2;
+  constexpr int straggler = 3;
+  constexpr int fast = 5;
+  // 只用来让错误的实现失败而不是挂住，不是性能阈值
+  constexpr auto deadlock_bound = std::chrono::seconds(30);
+  std::promise<void> fast_ready;
+  auto fast_ready_future = fast_ready.get_future().share();
+  std::atomic<bool> straggler_sent{false};
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        std::vector<std::vector<uint8_t>> inputs;
+        inputs.reserve(2 * NUM_PARTIES);
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          for (int offset = 1; offset <= 4; offset += 3) {
+            int sender1 = pidFromOffset(receiver, offset);
+            int sender2 = pidFromOffset(receiver, offset + 1);
+            int sender3 = pidFromOffset(receiver, offset + 2);
+            auto& input = inputs.emplace_back(64, static_cast<uint8_t>(round * NUM_PARTIES + receiver + offset));
+            if (round == 1 && receiver == 0 && i == 2) {
+              input[0] ^= 1;
+            }
+            jump.jumpUpdateSpan(sender1, sender2, sender3, receiver, input.size(),
+                                receiver == i ? nullptr : input.data());
+          }
+        }
+        if (round == 0 && i == straggler) {
+          BOOST_TEST((fast_ready_future.wait_for(deadlock_bound) == std::future_status::ready));
+          straggler_sent = true;
+        }
+        auto pending = jump.asyncCommunicate(network);
+        BOOST_CHECK_THROW(jump.jumpUpdate(pidFromOffset(i, 1), pidFromOffset(i, 2),
+                                          pidFromOffset(i, 3), i, 8),
+                          std::logic_error);
+
+        for (int offset = 1; offset <= 4; offset += 3) {
+          std::vector<uint8_t> expected(64, static_cast<uint8_t>(round * NUM_PARTIES + i + offset));
+          BOOST_TEST(jump.getValues(pidFromOffset(i, offset), pidFromOffset(i, offset + 1),
+                                    pidFromOffset(i, offset + 2)) == expected);
+        }
+        if (round == 0 && i == fast) {
+          fast_ready.set_value();
+        }
+        pending.wait();
+        if (round == 0 && i == fast) {
+          BOOST_TEST(straggler_sent.load());
+        }
+        jump.reset();
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(scheduled_futures) {
+  // 每个通道登记两种类型的多个切片，由第一次读取触发发送；第二轮开始后第一轮的 future 仍然可读
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      JumpScheduler sched(jump, network);
+
+      std::vector<JumpFuture<Ring>> first;
+      std::vector<JumpFuture<uint32_t>> second;
+      std::vector<int> receivers;
+      for (int round = 0; round < 2; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          for (int offset = 1; offset <= 4; offset += 3) {
+            int sender1 = pidFromOffset(receiver, offset);
+            int sender2 = pidFromOffset(receiver, offset + 1);
+            int sender3 = pidFromOffset(receiver, offset + 2);
+            Ring value = 1000 * round + 10 * receiver + offset;
+            std::vector<uint32_t> words = {static_cast<uint32_t>(round), static_cast<uint32_t>(receiver),
+                                           static_cast<uint32_t>(offset)};
+            first.push_back(sched.jumpUpdate(sender1, sender2, sender3, receiver, &value));
+            second.push_back(sched.jumpUpdate(sender1, sender2, sender3, receiver, words.data(), words.size()));
+            receivers.push_back(receiver);
+          }
+        }
+        // 读取本轮最后一个 future 时整轮发出
+        second.back().get();
+        BOOST_TEST(sched.rounds() == static_cast<size_t>(round + 1));
+      }
+      sched.finish();
+
+      for (size_t f = 0; f < first.size(); ++f) {
+        int round = f < first.size() / 2 ? 0 : 1;
+        int receiver = receivers[f];
+        int offset = f % 2 == 0 ? 1 : 4;
+        if (receiver != i) {
+          BOOST_TEST(first[f].get().empty());
+          continue;
+        }
+        BOOST_TEST(first[f].value() == static_cast<Ring>(1000 * round + 10 * receiver + offset));
+        std::vector<uint32_t> words = {static_cast<uint32_t>(round), static_cast<uint32_t>(receiver),
+                                       static_cast<uint32_t>(offset)};
+        BOOST_TEST(second[f].get() == words);
+      }
+      BOOST_TEST(sched.rounds() == 2);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(send_thread_digests) {
+  // 多个线程并发调用 jumpUpdate，每个线程只写自己的通道，既有锁内合并的小块，
+  // 也有锁外拷贝的大块；使用延迟校验，检查发送线程里计算的摘要：第一轮全部一致，
+  // 第二轮参与方 3 (发往 0 的哈希发送方) 改动了一个大块，检查点处必须发现。
+  constexpr size_t small_chunk = 64;
+  constexpr size_t large_chunk = 8192;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+      jump.setDeferredVerification(true);
+
+      auto payload = [](int receiver, size_t len, int part) {
+        return std::vector<uint8_t>(len, static_cast<uint8_t>(receiver * 4 + part));
+      };
+      for (int round = 0; round < 2; ++round) {
+        std::vector<std::thread> workers;
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          workers.emplace_back([&, receiver]() {
+            int s1 = pidFromOffset(receiver, 1);
+            int s2 = pidFromOffset(receiver, 2);
+            int s3 = pidFromOffset(receiver, 3);
+            for (int part = 0; part < 4; ++part) {
+              auto input = payload(receiver, part % 2 == 0 ? small_chunk : large_chunk, part);
+              if (round == 1 && receiver == 0 && i == 3 && part == 1) {
+                input[7] ^= 1;
+              }
+              jump.jumpUpdate(s1, s2, s3, receiver, input.size(),
+                              receiver == i ? nullptr : input.data());
+            }
+          });
+        }
+        for (auto& w : workers) {
+          w.join();
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected;
+        for (int part = 0; part < 4; ++part) {
+          auto p = payload(i, part % 2 == 0 ? small_chunk : large_chunk, part);
+          expected.insert(expected.end(), p.begin(), p.end());
+        }
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+
+        if (round == 1 && i == 0) {
+          BOOST_CHECK_THROW(jump.verify(network), std::runtime_error);
+        } else {
+          BOOST_CHECK_NO_THROW(jump.verify(network));
+        }
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_sessions) {
+  // 两个 jump 实例在同一网络的两个会话上各自跑多轮，互不等待；
+  // 奇数参与方先打开会话 1，检查先到的帧会等到会话打开后再交付
+  constexpr int num_sessions = 2;
+  constexpr int num_rounds = 3;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES > network(i, 10000, nullptr, true);
+      io::SessionMux<NUM_PARTIES> mux(network);
+
+      std::vector<std::unique_ptr<io::NetIOMP<NUM_PARTIES>>> sessions(num_sessions);
+      for (int k = 0; k < num_sessions; ++k) {
+        int tag = (i % 2 == 0) ? k : num_sessions - 1 - k;
+        sessions[tag] = mux.open(tag);
+      }
+      BOOST_CHECK_THROW(mux.open(0), std::logic_error);
+
+      std::vector<std::thread> workers;
+      for (int tag = 0; tag < num_sessions; ++tag) {
+        workers.emplace_back([&, tag]() {
+          ImprovedJmp jump(i);
+          ThreadPool tpool(1);
+          for (int round = 0; round < num_rounds; ++round) {
+            for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+              std::vector<uint8_t> input(100 + tag * 5000,
+                                         static_cast<uint8_t>((tag * num_rounds + round) * NUM_PARTIES + receiver));
+              jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                              pidFromOffset(receiver, 3), receiver, input.size(),
+                              receiver == i ? nullptr : input.data());
+            }
+            jump.communicate(*sessions[tag], tpool);
+            std::vector<uint8_t> expected(100 + tag * 5000,
+                                          static_cast<uint8_t>((tag * num_rounds + round) * NUM_PARTIES + i));
+            BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+            jump.reset();
+          }
+        });
+      }
+      for (auto& w : workers) {
+        w.join();
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(session_close_and_reader_failure) {
+  // 关闭会话时丢弃未读数据，重开同名会话只看到新数据；
+  // 网络出错后，等待中的 recv 收到读线程的异常而不是一直阻塞
+  auto mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+  auto networks = io::makeInMemoryNetworks<NUM_PARTIES>(mesh);
+  std::vector<std::unique_ptr<io::SessionMux<NUM_PARTIES>>> muxes;
+  for (auto& network : networks) {
+    muxes.push_back(std::make_unique<io::SessionMux<NUM_PARTIES>>(*network));
+  }
+
+  std::array<uint8_t, 8> first{1, 2, 3, 4, 5, 6, 7, 8};
+  std::array<uint8_t, 4> second{9, 10, 11, 12};
+  std::array<uint8_t, 4> got{};
+  {
+    auto sender = muxes[0]->open(7);
+    auto receiver = muxes[1]->open(7);
+    sender->send(1, first.data(), first.size());
+    sender->flush(1);
+    receiver->recv(0, got.data(), got.size());
+    BOOST_TEST(got == (std::array<uint8_t, 4>{1, 2, 3, 4}));
+  }
+  {
+    auto sender = muxes[0]->open(7);
+    auto receiver = muxes[1]->open(7);
+    sender->send(1, second.data(), second.size());
+    sender->flush(1);
+    receiver->recv(0, got.data(), got.size());
+    BOOST_TEST(got == second);
+
+    std::promise<void> waiting;
+    auto blocked = std::async(std::launch::async, [&]() {
+      waiting.set_value();
+      receiver->recv(0, got.data(), got.size());
+    });
+    waiting.get_future().wait();
+    mesh->abort();
+    BOOST_CHECK_THROW(blocked.get(), std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(shm_transport) {
+  // 共享内存传输：环只有 64 KiB，每轮数据远大于环容量且长度不对齐，覆盖回绕和阻塞等待
+  constexpr int num_rounds = 3;
+  constexpr size_t ring_bytes = 1 << 16;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network = io::makeShmNetwork<NUM_PARTIES>(i, 10000, ring_bytes);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        size_t len = 300000 + 7 * round;
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          std::vector<uint8_t> input(len);
+          for (size_t k = 0; k < len; ++k) {
+            input[k] = static_cast<uint8_t>(k * 31 + receiver + round);
+          }
+          jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                          pidFromOffset(receiver, 3), receiver, input.size(),
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(*network, tpool);
+
+        std::vector<uint8_t> expected(len);
+        for (size_t k = 0; k < len; ++k) {
+          expected[k] = static_cast<uint8_t>(k * 31 + i + round);
+        }
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+      network->sync();
+      BOOST_TEST(network->count() > 0);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(shm_stale_segments) {
+  // 参与方 0 单独启动，等不到对端而超时抛出，留下它创建的入向环 (会话号 7)；
+  // 随后会话号为 8 的完整网络在同一端口上建立，写方不能连到遗留的环上
+  constexpr int port = 10400;
+  io::ShmOptions stale;
+  stale.session = 7;
+  stale.timeout = std::chrono::milliseconds(100);
+  BOOST_CHECK_THROW(io::ShmTransport<NUM_PARTIES>(0, port, stale), std::runtime_error);
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::ShmOptions options;
+      options.session = 8;
+      options.timeout = std::chrono::milliseconds(10000);
+      // 参与方 0 最后启动，其余各方先看到的是遗留的环
+      if (i == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+      auto network = io::makeShmNetwork<NUM_PARTIES>(i, port, options);
+      for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+        if (peer == i) continue;
+        uint32_t value = static_cast<uint32_t>(i * 100 + peer);
+        network->send(peer, &value, sizeof(value));
+        network->flush(peer);
+      }
+      for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+        if (peer == i) continue;
+        uint32_t value = 0;
+        network->recv(peer, &value, sizeof(value));
+        BOOST_TEST(value == static_cast<uint32_t>(peer * 100 + i));
+      }
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.get();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(staggered_mesh_setup) {
+  // 参与方按编号倒序、间隔启动，先启动的一方要靠重试等到对端开始监听；
+  // 另有一个会话号不同的网络抢先连到各方，握手不通过，不能混入本网络
+  constexpr uint64_t session = 42;
+  constexpr auto stagger = std::chrono::milliseconds(20);
+
+  io::TcpOptions stray_options;
+  stray_options.session = session + 1;
+  stray_options.timeout = std::chrono::milliseconds(300);
+  auto stray = std::async(std::launch::async, [&]() {
+    BOOST_CHECK_THROW(io::NetIOMP<NUM_PARTIES>(0, 10000, nullptr, true, stray_options),
+                      std::runtime_error);
+  });
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      std::this_thread::sleep_for(stagger * (NUM_PARTIES - i));
+      io::TcpOptions options;
+      options.session = session;
+      // 参与方 0 要等干扰方放弃端口后才能监听
+      if (i == 0) {
+        stray.wait();
+      }
+      io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true, options);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      std::vector<uint8_t> input(64);
+      for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+        for (size_t k = 0; k < input.size(); ++k) {
+          input[k] = static_cast<uint8_t>(k + receiver);
+        }
+        jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                        pidFromOffset(receiver, 3), receiver, input.size(),
+                        receiver == i ? nullptr : input.data());
+      }
+      jump.communicate(network, tpool);
+
+      std::vector<uint8_t> expected(input.size());
+      for (size_t k = 0; k < expected.size(); ++k) {
+        expected[k] = static_cast<uint8_t>(k + i);
+      }
+      BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(mesh_replaces_abandoned_connection) {
+  // 参与方 0 的一条连接在确认握手前被它自己放弃（比如应答超时），随后它重新连接：
+  // 参与方 1 必须丢掉旧连接、接受新连接，而不是留着已经关闭的旧连接、拒绝新连接
+  constexpr uint64_t session = 43;
+  // 与 TcpMesh 的握手消息布局相同
+  struct Handshake {
+    uint32_t magic;
+    uint32_t party;
+    uint64_t session;
+    uint32_t stream;
+    uint32_t streams;
+    uint64_t stripe_bytes;
+  };
+  io::TcpOptions options;
+  options.session = session;
+  options.timeout = std::chrono::milliseconds(10000);
+
+  auto abandoned = std::async(std::launch::async, [&]() {
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(10000 + 1);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (true) {
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        Handshake hs{0x53484f52, 0, session, 0, 1, options.stripe_bytes};
+        Handshake reply{};
+        bool done = ::send(fd, &hs, sizeof(hs), MSG_NOSIGNAL) == sizeof(hs) &&
+                    ::recv(fd, &reply, sizeof(reply), MSG_WAITALL) == sizeof(reply);
+        ::close(fd);
+        if (done) return;
+      } else {
+        ::close(fd);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      if (i == 0) {
+        abandoned.wait();
+      }
+      io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true, options);
+      network.sync();
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.get();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(epoll_transport) {
+  // 事件驱动传输：先跑几轮跳跃通信（含大于预读缓冲区的数据），
+  // 再用完成接口同时挂起对所有对端的收发，检查与阻塞调用混用时的顺序
+  constexpr int num_rounds = 3;
+  constexpr size_t async_len = 1 << 20;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::TcpOptions options;
+      options.event_loop = true;
+      io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true, options);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        size_t len = round == 1 ? 600000 + 3 : 16;
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          std::vector<uint8_t> input(len);
+          for (size_t k = 0; k < len; ++k) {
+            input[k] = static_cast<uint8_t>(k * 13 + receiver + round);
+          }
+          jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                          pidFromOffset(receiver, 3), receiver, input.size(),
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len);
+        for (size_t k = 0; k < len; ++k) {
+          expected[k] = static_cast<uint8_t>(k * 13 + i + round);
+        }
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+
+      auto* epoll = dynamic_cast<io::EpollTransport<NUM_PARTIES>*>(&network.transport());
+      BOOST_TEST_REQUIRE(epoll != nullptr);
+      std::vector<uint8_t> payload(async_len);
+      for (size_t k = 0; k < async_len; ++k) {
+        payload[k] = static_cast<uint8_t>(k * 7 + i);
+      }
+      std::vector<std::vector<uint8_t>> received(NUM_PARTIES, std::vector<uint8_t>(async_len));
+      std::vector<uint32_t> headers(NUM_PARTIES);
+      std::vector<std::future<void>> pending;
+      for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+        if (peer == i) continue;
+        uint32_t header = 1000 + i;
+        network.send(peer, &header, sizeof(header));  // 暂存区中的数据要先于异步发送到达
+        pending.push_back(epoll->sendAsync(peer, payload.data(), payload.size()));
+        pending.push_back(epoll->recvAsync(peer, &headers[peer], sizeof(uint32_t)));
+        pending.push_back(epoll->recvAsync(peer, received[peer].data(), async_len));
+      }
+      for (auto& f : pending) {
+        f.get();
+      }
+      for (int peer = 0; peer < NUM_PARTIES; ++peer) {
+        if (peer == i) continue;
+        BOOST_TEST(headers[peer] == static_cast<uint32_t>(1000 + peer));
+        std::vector<uint8_t> expected(async_len);
+        for (size_t k = 0; k < async_len; ++k) {
+          expected[k] = static_cast<uint8_t>(k * 7 + peer);
+        }
+        BOOST_TEST((received[peer] == expected));
+      }
+      network.sync();
+      BOOST_TEST(network.count() > int64_t(NUM_PARTIES - 1) * async_len);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(striped_streams) {
+  // 每对参与方 3 条流、条带很小，让每轮数据跨越很多条带边界；
+  // 收发的分段方式不同，检查接收端按条带重组出原始字节流
+  constexpr int num_rounds = 3;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::TcpOptions options;
+      options.streams = 3;
+      options.stripe_bytes = 1000;
+      io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true, options);
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      for (int round = 0; round < num_rounds; ++round) {
+        size_t len = round == 1 ? 300007 : 10 + round;
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          std::vector<uint8_t> input(len);
+          for (size_t k = 0; k < len; ++k) {
+            input[k] = static_cast<uint8_t>(k * 17 + receiver + round);
+          }
+          jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                          pidFromOffset(receiver, 3), receiver, input.size(),
+                          receiver == i ? nullptr : input.data());
+        }
+        jump.communicate(network, tpool);
+
+        std::vector<uint8_t> expected(len);
+        for (size_t k = 0; k < len; ++k) {
+          expected[k] = static_cast<uint8_t>(k * 17 + i + round);
+        }
+        BOOST_TEST(jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3)) == expected);
+        jump.reset();
+      }
+
+      // 发给下一方：一个 iovec 数组加若干小消息；从上一方按不同的长度收
+      int next = pidFromOffset(i, 1);
+      int prev = pidFromOffset(i, -1);
+      std::vector<uint32_t> words(5000);
+      for (size_t k = 0; k < words.size(); ++k) {
+        words[k] = static_cast<uint32_t>(k * 3 + i);
+      }
+      auto* raw = reinterpret_cast<char*>(words.data());
+      struct iovec iov[2] = {{raw, 7777}, {raw + 7777, words.size() * sizeof(uint32_t) - 7777}};
+      network.sendv(next, iov, 2);
+      for (uint32_t k = 0; k < 100; ++k) {
+        uint32_t tail = 1000000 * i + k;
+        network.send(next, &tail, sizeof(tail));
+      }
+      network.flush(next);
+
+      std::vector<uint32_t> got(words.size() + 100);
+      auto* bytes = reinterpret_cast<char*>(got.data());
+      size_t total = got.size() * sizeof(uint32_t);
+      for (size_t off = 0, step = 1; off < total; off += step, step = step * 3 + 1) {
+        network.recv(prev, bytes + off, std::min(step, total - off));
+      }
+      for (size_t k = 0; k < words.size(); ++k) {
+        BOOST_TEST(got[k] == static_cast<uint32_t>(k * 3 + prev));
+      }
+      for (uint32_t k = 0; k < 100; ++k) {
+        BOOST_TEST(got[words.size() + k] == static_cast<uint32_t>(1000000 * prev + k));
+      }
+      network.sync();
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(wan_emulation) {
+  // 进程内网络加上 20 ms 单向延迟、80 Mbit/s 带宽和抖动：
+  // 每轮跳跃通信至少要一个单向延迟，大块数据受带宽限制，抖动下仍按顺序到达
+  constexpr int num_rounds = 3;
+  constexpr double delay_ms = 20;
+  io::WanLink link;
+  link.delay_ms = delay_ms;
+  link.jitter_ms = 5;
+  link.mbps = 80;  // 10000 字节/毫秒
+  link.burst_bytes = 1000;
+  constexpr size_t bulk = 200000;
+
+  auto mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+  auto networks = io::makeInMemoryNetworks<NUM_PARTIES>(mesh);
+  for (auto& network : networks) {
+    io::emulateWan(*network, link, 7);
+  }
+
+  // 计时从最后一方到达起跑线算起：此前谁都没有发送，下界对每一方都严格成立，
+  // 不受各线程起步先后的影响
+  struct StartLine {
+    std::mutex mtx;
+    std::condition_variable cv;
+    int arrived = 0;
+    std::chrono::steady_clock::time_point start;
+
+    std::chrono::steady_clock::time_point wait() {
+      std::unique_lock<std::mutex> lock(mtx);
+      if (++arrived == NUM_PARTIES) {
+        start = std::chrono::steady_clock::now();
+        cv.notify_all();
+      } else {
+        cv.wait(lock, [&]() { return arrived == NUM_PARTIES; });
+      }
+      return start;
+    }
+  };
+  StartLine rounds_line;
+  StartLine bulk_line;
+
+  std::vector<std::future<void>> parties;
+  for (int i = 0; i < NUM_PARTIES ; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto& network = *networks[i];
+      ImprovedJmp jump(i);
+      ThreadPool tpool(1);
+
+      auto start = rounds_line.wait();
+      for (int round = 0; round < num_rounds; ++round) {
+        for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+          uint64_t value = receiver * 100 + round;
+          jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                          pidFromOffset(receiver, 3), receiver, sizeof(value),
+                          receiver == i ? nullptr : &value);
+        }
+        jump.communicate(network, tpool);
+        uint64_t expected = i * 100 + round;
+        auto values = jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3));
+        BOOST_TEST_REQUIRE(values.size() == sizeof(expected));
+        BOOST_TEST(std::memcmp(values.data(), &expected, sizeof(expected)) == 0);
+        jump.reset();
+      }
+      std::chrono::duration<double, std::milli> rounds_ms = std::chrono::steady_clock::now() - start;
+      BOOST_TEST(rounds_ms.count() >= num_rounds * delay_ms);
+
+      // 先发一串小消息再发一大块：抖动不能打乱顺序，大块要等令牌
+      int next = pidFromOffset(i, 1);
+      int prev = pidFromOffset(i, -1);
+      std::vector<uint8_t> payload(bulk);
+      for (size_t k = 0; k < bulk; ++k) {
+        payload[k] = static_cast<uint8_t>(k + i);
+      }
+      start = bulk_line.wait();
+      for (uint32_t k = 0; k < 20; ++k) {
+        network.send(next, &k, sizeof(k));
+        network.flush(next);
+      }
+      network.send(next, payload.data(), payload.size());
+      network.flush(next);
+
+      for (uint32_t k = 0; k < 20; ++k) {
+        uint32_t got = 0;
+        network.recv(prev, &got, sizeof(got));
+        BOOST_TEST(got == k);
+      }
+      std::vector<uint8_t> received(bulk);
+      network.recv(prev, received.data(), received.size());
+      std::chrono::duration<double, std::milli> bulk_ms = std::chrono::steady_clock::now() - start;
+      for (size_t k = 0; k < bulk; ++k) {
+        payload[k] = static_cast<uint8_t>(k + prev);
+      }
+      BOOST_TEST((received == payload));
+      // 令牌桶最多攒下 burst_bytes，其余部分按带宽发出，再加一个单向延迟；
+      // 只检查下界，上界取决于机器负载
+      BOOST_TEST(bulk_ms.count() >= delay_ms + (bulk - link.burst_bytes) / 10000.0);
+    }));
+  }
+
+  for (auto& p : parties) {
+    p.wait();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(transcript_replay) {
+  // 在进程内网络上记录 0 号参与方收到的全部数据，再让它单独回放：
+  // 跳跃通信的结果与记录时一致，并且恰好读完整份记录
+  constexpr int num_rounds = 3;
+  constexpr int recorded = 0;
+  // 每次运行用不同的文件，并发运行的测试不会互相覆盖；失败提前退出时也会删掉
+  char path_template[] = "/tmp/semihorgod_transcript_XXXXXX";
+  int fd = mkstemp(path_template);
+  BOOST_TEST_REQUIRE(fd != -1);
+  close(fd);
+  const std::string path = path_template;
+  struct RemoveOnExit {
+    const std::string& path;
+    ~RemoveOnExit() { std::remove(path.c_str()); }
+  } cleanup{path};
+
+  auto runRounds = [](io::NetIOMP<NUM_PARTIES>& network, int i) {
+    ImprovedJmp jump(i);
+    ThreadPool tpool(2);
+    std::vector<uint64_t> results;
+    for (int round = 0; round < num_rounds; ++round) {
+      for (int receiver = 0; receiver < NUM_PARTIES; ++receiver) {
+        uint64_t value = receiver * 100 + round;
+        jump.jumpUpdate(pidFromOffset(receiver, 1), pidFromOffset(receiver, 2),
+                        pidFromOffset(receiver, 3), receiver, sizeof(value),
+                        receiver == i ? nullptr : &value);
+      }
+      jump.communicate(network, tpool);
+      auto values = jump.getValues(pidFromOffset(i, 1), pidFromOffset(i, 2), pidFromOffset(i, 3));
+      BOOST_TEST_REQUIRE(values.size() == sizeof(uint64_t));
+      uint64_t got = 0;
+      std::memcpy(&got, values.data(), sizeof(got));
+      results.push_back(got);
+      jump.reset();
+    }
+    return results;
+  };
+
+  {
+    auto mesh = std::make_shared<io::InMemoryMesh<NUM_PARTIES>>();
+    auto networks = io::makeInMemoryNetworks<NUM_PARTIES>(mesh);
+    io::recordTranscript(*networks[recorded], path);
+
+    std::vector<std::future<void>> parties;
+    for (int i = 0; i < NUM_PARTIES; ++i) {
+      parties.push_back(std::async(std::launch::async, [&, i]() { runRounds(*networks[i], i); }));
+    }
+    for (auto& p : parties) {
+      p.wait();
+    }
+  }
+
+  auto network = io::makeReplayNetwork<NUM_PARTIES>(recorded, path);
+  auto results = runRounds(*network, recorded);
+  for (int round = 0; round < num_rounds; ++round) {
+    BOOST_TEST(results[round] == static_cast<uint64_t>(recorded * 100 + round));
+  }
+  const auto& replay = dynamic_cast<const io::ReplayTransport<NUM_PARTIES>&>(network->transport());
+  BOOST_TEST(replay.remaining() == 0);
+  // 发送线程可能在本轮接收完成后才发出，轮次只是估计
+  BOOST_TEST(replay.rounds() >= 1U);
+  BOOST_TEST(network->count() > 0);
+
+  // 记录已读完，再接收就报错；其他参与方的记录不能用于 0 号
+  uint64_t extra = 0;
+  BOOST_CHECK_THROW(network->recv(1, &extra, sizeof(extra)), std::runtime_error);
+  BOOST_CHECK_THROW(io::ReplayTransport<NUM_PARTIES>(1, path), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_sends) {
+  // 缓冲中的小消息与 sendv、大块 send 合并写出时顺序不变；
+  // sendBool 整批发出，不需要 flush，线上格式仍是每 64 个 bool 一个字（低位在前）。
+  // 单条流和多条流（条带很小，缓冲与 iov 跨越条带边界）各跑一遍
+  constexpr size_t big = 300000;
+  constexpr size_t num_bools = 130;
+
+  for (int streams : {1, 3}) {
+    std::vector<std::future<void>> parties;
+    for (int i = 0; i < NUM_PARTIES; ++i) {
+      parties.push_back(std::async(std::launch::async, [&, i]() {
+        io::TcpOptions options;
+        options.streams = streams;
+        options.stripe_bytes = streams == 1 ? options.stripe_bytes : 1000;
+        io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true, options);
+        int next = pidFromOffset(i, 1);
+        int prev = pidFromOffset(i, -1);
+
+        uint64_t header = 1000 + i;
+        std::vector<uint8_t> part1(100, static_cast<uint8_t>(i));
+        std::vector<uint8_t> part2(5000, static_cast<uint8_t>(i + 1));
+        std::vector<uint8_t> bulk(big);
+        for (size_t k = 0; k < big; ++k) {
+          bulk[k] = static_cast<uint8_t>(k * 7 + i);
+        }
+        std::array<bool, num_bools> bools{};
+        for (size_t k = 0; k < num_bools; ++k) {
+          bools[k] = (k * (i + 3)) % 5 < 2;
+        }
+
+        // 收发并行，避免双方都阻塞在写满的套接字上
+        auto sender = std::async(std::launch::async, [&]() {
+          network.send(next, &header, sizeof(header));
+          std::array<struct iovec, 2> iov{{{part1.data(), part1.size()}, {part2.data(), part2.size()}}};
+          network.sendv(next, iov.data(), iov.size());
+          network.send(next, &header, sizeof(header));
+          network.send(next, bulk.data(), bulk.size());
+          network.send(next, &header, sizeof(header));
+          network.flush(next);
+          network.sendBool(next, bools.data(), bools.size());
+          network.sendBool(next, bools.data(), 65);
+        });
+
+        uint64_t expected_header = 1000 + prev;
+        uint64_t got = 0;
+        network.recv(prev, &got, sizeof(got));
+        BOOST_TEST(got == expected_header);
+        std::vector<uint8_t> got1(part1.size());
+        std::vector<uint8_t> got2(part2.size());
+        network.recv(prev, got1.data(), got1.size());
+        network.recv(prev, got2.data(), got2.size());
+        BOOST_TEST((got1 == std::vector<uint8_t>(part1.size(), static_cast<uint8_t>(prev))));
+        BOOST_TEST((got2 == std::vector<uint8_t>(part2.size(), static_cast<uint8_t>(prev + 1))));
+        network.recv(prev, &got, sizeof(got));
+        BOOST_TEST(got == expected_header);
+        std::vector<uint8_t> got_bulk(big);
+        network.recv(prev, got_bulk.data(), got_bulk.size());
+        bool bulk_ok = true;
+        for (size_t k = 0; k < big; ++k) {
+          bulk_ok = bulk_ok && got_bulk[k] == static_cast<uint8_t>(k * 7 + prev);
+        }
+        BOOST_TEST(bulk_ok);
+        network.recv(prev, &got, sizeof(got));
+        BOOST_TEST(got == expected_header);
+
+        std::array<bool, num_bools> got_bools{};
+        network.recvBool(prev, got_bools.data(), got_bools.size());
+        std::array<uint64_t, 2> words{};
+        network.recv(prev, words.data(), sizeof(words));
+        for (size_t k = 0; k < num_bools; ++k) {
+          bool expected = (k * (prev + 3)) % 5 < 2;
+          BOOST_TEST(got_bools[k] == expected);
+          if (k < 65) {
+            BOOST_TEST(((words[k / 64] >> (k % 64)) & 1) == static_cast<uint64_t>(expected));
+          }
+        }
+        BOOST_TEST((words[1] >> 1) == 0u);
+        sender.get();
+        network.sync();
+      }));
+    }
+
+    for (auto& p : parties) {
+      p.wait();
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
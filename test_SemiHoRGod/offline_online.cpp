@@ -1,14 +1,18 @@
 #define BOOST_TEST_MODULE offline_online
 #include <emp-tool/emp-tool.h>
 #include <io/netmp.h>
+#include <SemiHoRGod/helpers.h>
+#include <SemiHoRGod/in_process.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <SemiHoRGod/sharing.h>
 #include <SemiHoRGod/types.h>
 
+#include <boost/mpl/list.hpp>
 #include <boost/test/data/monomorphic.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/included/unit_test.hpp>
+#include <algorithm>
 #include <cmath>
 #include <future>
 #include <memory>
@@ -64,11 +68,11 @@ BOOST_DATA_TEST_CASE(no_op_circuit,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
-      // auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      // auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
       return online_eval.evaluateCircuit(inputs);
     }));
   }
@@ -88,6 +92,70 @@ BOOST_DATA_TEST_CASE(no_op_circuit,
   }
 }
 
+BOOST_AUTO_TEST_CASE(in_process_harness) {
+  // 所有参与方作为同一进程内的线程运行离线和在线阶段，经内存传输通信
+  Circuit<Ring> circ;
+  auto wa = circ.newInputWire();
+  auto wb = circ.newInputWire();
+  auto wc = circ.newInputWire();
+  auto wprod = circ.addGate(GateType::kMul, wa, wb);
+  auto wsum = circ.addGate(GateType::kAdd, wprod, wc);
+  auto wrelu = circ.addGate(GateType::kRelu, wsum);
+  circ.setAsOutput(wprod);
+  circ.setAsOutput(wrelu);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map = {{wa, 0}, {wb, 3}, {wc, 6}};
+  std::unordered_map<wire_t, Ring> inputs = {{wa, 12}, {wb, 34}, {wc, 56}};
+  auto exp_output = circ.evaluate(inputs);
+
+  InProcessOptions options;
+  options.offline_threads = cm_threads;
+  auto result = runInProcess(level_circ, input_pid_map, inputs, options);
+
+  BOOST_TEST(result.outputs.size() == NUM_PARTIES);
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    BOOST_TEST(result.outputs[i] == exp_output);
+    BOOST_TEST(result.stats[i].offline_bytes > 0);
+    BOOST_TEST(result.stats[i].online_bytes > 0);
+  }
+}
+
+using OtherRings = boost::mpl::list<Ring32, Ring128>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(in_process_ring_widths, R, OtherRings) {
+  // 同一电路在 32 位和 128 位环上完整运行离线和在线阶段
+  constexpr size_t kBits = FixedPoint<R>::kBits;
+  Circuit<R> circ;
+  auto wa = circ.newInputWire();
+  auto wb = circ.newInputWire();
+  auto wc = circ.newInputWire();
+  auto wd = circ.newInputWire();
+  auto wprod = circ.addGate(GateType::kMul, wa, wb);
+  auto wsum = circ.addGate(GateType::kAdd, wprod, wc);
+  auto wrelu = circ.addGate(GateType::kRelu, wsum);
+  // (3 * 2^(k/2-1))^2 = 9 * 2^(k-2) = 2^(k-2) mod 2^k：检查最高位也按环宽回绕
+  auto wsquare = circ.addGate(GateType::kMul, wd, wd);
+  circ.setAsOutput(wrelu);
+  circ.setAsOutput(wsquare);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map = {{wa, 0}, {wb, 3}, {wc, 6}, {wd, 2}};
+  std::unordered_map<wire_t, R> inputs = {
+      {wa, 12}, {wb, 34}, {wc, 56}, {wd, R(3) << (kBits / 2 - 1)}};
+  auto exp_output = circ.evaluate(inputs);
+  BOOST_TEST_REQUIRE((exp_output[1] == R(1) << (kBits - 2)));
+
+  InProcessOptions options;
+  options.offline_threads = cm_threads;
+  auto result = runInProcess(level_circ, input_pid_map, inputs, options);
+
+  BOOST_TEST(result.outputs.size() == NUM_PARTIES);
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    BOOST_TEST((result.outputs[i] == exp_output));
+  }
+}
+
 BOOST_DATA_TEST_CASE(add_gate,
                      bdata::random(0, TEST_DATA_MAX_VAL) ^
                          bdata::random(0, TEST_DATA_MAX_VAL) ^ bdata::xrange(1),
@@ -111,11 +179,11 @@ BOOST_DATA_TEST_CASE(add_gate,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -149,11 +217,11 @@ BOOST_DATA_TEST_CASE(sub_gate,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -186,11 +254,11 @@ BOOST_DATA_TEST_CASE(const_add_gate,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -223,11 +291,11 @@ BOOST_DATA_TEST_CASE(const_mul_gate,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -262,14 +330,14 @@ BOOST_DATA_TEST_CASE(mul_gate,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -326,14 +394,124 @@ BOOST_DATA_TEST_CASE(depth_2_circuit,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
+
+      return online_eval.evaluateCircuit(inputs);
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto output = p.get();
+    BOOST_TEST(output == exp_output);
+  }
+}
+
+BOOST_DATA_TEST_CASE(deferred_verification,
+                     bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^ bdata::xrange(2),
+                     input_a, input_b, input_c, input_d, idx) {
+  // idx = 0 只在输出时校验，idx = 1 每 2 轮校验一次
+  auto seed = emp::makeBlock(100, 200);
+  std::vector<int> vinputs = {input_a, input_b, input_c, input_d};
+
+  Circuit<Ring> circ;
+  std::vector<wire_t> input_wires;
+  for (size_t i = 0; i < vinputs.size(); ++i) {
+    input_wires.push_back(circ.newInputWire());
+  }
+  auto w_aab = circ.addGate(GateType::kAdd, input_wires[0], input_wires[1]);
+  auto w_cmd = circ.addGate(GateType::kMul, input_wires[2], input_wires[3]);
+  auto w_mout = circ.addGate(GateType::kMul, w_aab, w_cmd);
+  auto w_aout = circ.addGate(GateType::kAdd, w_aab, w_cmd);
+  auto w_out = circ.addGate(GateType::kMul, w_mout, w_aout);
+  circ.setAsOutput(w_out);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map;
+  std::unordered_map<wire_t, Ring> inputs;
+  for (size_t i = 0; i < vinputs.size(); ++i) {
+    input_pid_map[input_wires[i]] = i % 4;
+    inputs[input_wires[i]] = vinputs[i];
+  }
+  auto exp_output = circ.evaluate(inputs);
+
+  std::vector<std::future<std::vector<Ring>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
+      emp::PRG prg(&seed, 0);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
+      online_eval.setDeferredVerification(true, idx == 0 ? 0 : 2);
+
+      return online_eval.evaluateCircuit(inputs);
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto output = p.get();
+    BOOST_TEST(output == exp_output);
+  }
+}
+
+BOOST_DATA_TEST_CASE(single_value_sender,
+                     bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^
+                         bdata::random(0, TEST_DATA_MAX_VAL) ^ bdata::xrange(2),
+                     input_a, input_b, input_c, input_d, idx) {
+  // idx = 0 每轮校验摘要，idx = 1 同时打开延迟校验 (每 2 轮一次)
+  auto seed = emp::makeBlock(100, 200);
+  std::vector<int> vinputs = {input_a, input_b, input_c, input_d};
+
+  Circuit<Ring> circ;
+  std::vector<wire_t> input_wires;
+  for (size_t i = 0; i < vinputs.size(); ++i) {
+    input_wires.push_back(circ.newInputWire());
+  }
+  auto w_aab = circ.addGate(GateType::kAdd, input_wires[0], input_wires[1]);
+  auto w_cmd = circ.addGate(GateType::kMul, input_wires[2], input_wires[3]);
+  auto w_mout = circ.addGate(GateType::kMul, w_aab, w_cmd);
+  auto w_aout = circ.addGate(GateType::kAdd, w_aab, w_cmd);
+  auto w_out = circ.addGate(GateType::kMul, w_mout, w_aout);
+  circ.setAsOutput(w_out);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map;
+  std::unordered_map<wire_t, Ring> inputs;
+  for (size_t i = 0; i < vinputs.size(); ++i) {
+    input_pid_map[input_wires[i]] = i % 4;
+    inputs[input_wires[i]] = vinputs[i];
+  }
+  auto exp_output = circ.evaluate(inputs);
+
+  std::vector<std::future<std::vector<Ring>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
+      emp::PRG prg(&seed, 0);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      offline_eval.setSingleValueSender(true);
+      auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
+      online_eval.setSingleValueSender(true);
+      online_eval.setDeferredVerification(idx == 1, 2);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -378,14 +556,14 @@ BOOST_AUTO_TEST_CASE(dotp_gate) {
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(input_map);
     }));
@@ -425,14 +603,14 @@ BOOST_DATA_TEST_CASE(kCmp_gate, bdata::xrange(2), idx) {
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -473,14 +651,14 @@ BOOST_DATA_TEST_CASE(relu_gate, bdata::xrange(2), idx) {
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -530,14 +708,14 @@ BOOST_AUTO_TEST_CASE(double_relu_gate) {
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -552,6 +730,244 @@ BOOST_AUTO_TEST_CASE(double_relu_gate) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(const_round_offline) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  // 输出经过两层乘法，输入取 gamma/3 bit，保证 relu 的输入不会溢出
+  std::uniform_int_distribution<> dis(0, (1ULL<<(BITS_GAMMA/3)) - 1);
+
+  // 多层电路：乘法链 + 同层本地门 + relu，检验常数轮预处理与按层预处理结果一致
+  Circuit<Ring> circ;
+  auto wa = circ.newInputWire();
+  auto wb = circ.newInputWire();
+  auto wc = circ.newInputWire();
+  auto wrelu_a = circ.addGate(GateType::kRelu, wa);
+  auto wprod = circ.addGate(GateType::kMul, wrelu_a, wb);
+  auto wsum = circ.addGate(GateType::kAdd, wprod, wc);
+  auto wprod2 = circ.addGate(GateType::kMul, wsum, wc);
+  auto wsub = circ.addGate(GateType::kSub, wprod2, wprod);
+  auto wrelu_out = circ.addGate(GateType::kRelu, wsub);
+
+  circ.setAsOutput(wrelu_a);
+  circ.setAsOutput(wprod2);
+  circ.setAsOutput(wrelu_out);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map = {{wa, 0}, {wb, 1}, {wc, 2}};
+  std::unordered_map<wire_t, Ring> inputs = {
+      {wa, static_cast<Ring>(dis(gen))}, {wb, static_cast<Ring>(dis(gen))}, {wc, static_cast<Ring>(dis(gen))}};
+  auto exp_output = circ.evaluate(inputs);
+
+  std::vector<std::future<std::vector<Ring>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
+      emp::PRG prg(&seed, 0);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      auto preproc = offline_eval.offline_setwire_const_round(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
+
+      return online_eval.evaluateCircuit(inputs);
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto output = p.get();
+    BOOST_TEST(output == exp_output);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(no_batch_offline) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  // 输出经过两层乘法，输入取 gamma/3 bit，保证 relu 的输入不会溢出
+  std::uniform_int_distribution<> dis(0, (1ULL<<(BITS_GAMMA/3)) - 1);
+
+  // 与 const_round_offline 相同的电路：逐门预处理把同层乘法交给调度器合并成一轮，结果应保持一致
+  Circuit<Ring> circ;
+  auto wa = circ.newInputWire();
+  auto wb = circ.newInputWire();
+  auto wc = circ.newInputWire();
+  auto wrelu_a = circ.addGate(GateType::kRelu, wa);
+  auto wprod = circ.addGate(GateType::kMul, wrelu_a, wb);
+  auto wsum = circ.addGate(GateType::kAdd, wprod, wc);
+  auto wprod2 = circ.addGate(GateType::kMul, wsum, wc);
+  auto wsub = circ.addGate(GateType::kSub, wprod2, wprod);
+  auto wrelu_out = circ.addGate(GateType::kRelu, wsub);
+
+  circ.setAsOutput(wrelu_a);
+  circ.setAsOutput(wprod2);
+  circ.setAsOutput(wrelu_out);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map = {{wa, 0}, {wb, 1}, {wc, 2}};
+  std::unordered_map<wire_t, Ring> inputs = {
+      {wa, static_cast<Ring>(dis(gen))}, {wb, static_cast<Ring>(dis(gen))}, {wc, static_cast<Ring>(dis(gen))}};
+  auto exp_output = circ.evaluate(inputs);
+
+  std::vector<std::future<std::vector<Ring>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
+      emp::PRG prg(&seed, 0);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      auto preproc = offline_eval.offline_setwire_no_batch(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
+
+      return online_eval.evaluateCircuit(inputs);
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto output = p.get();
+    BOOST_TEST(output == exp_output);
+  }
+}
+
+// 各方 CompactShare 合起来恢复秘密：每个 RSS 分量取任一持有者的值
+Ring reconstructCompact(const std::vector<CompactShare<Ring>>& shares) {
+  Ring secret = 0;
+  for (int a = 0; a < NUM_PARTIES; ++a) {
+    for (int b = a + 1; b < NUM_PARTIES; ++b) {
+      int holder = 0;
+      while (holder == a || holder == b) ++holder;
+      secret += shares[holder].get(holder, upperTriangularToArray(a, b));
+    }
+  }
+  return secret;
+}
+
+BOOST_AUTO_TEST_CASE(trdotp_preproc_variants) {
+  // 截断对的比特链要跑多轮，P0、P1 从不做接收方，轮次边界全靠显式 flush。
+  // 三种预处理都检查 α_xy 与截断对 (r, r^d) 的关系
+  Circuit<Ring> circ;
+  std::vector<wire_t> va, vb;
+  for (int i = 0; i < 2; ++i) {
+    va.push_back(circ.newInputWire());
+    vb.push_back(circ.newInputWire());
+  }
+  auto wmul = circ.addGate(GateType::kMul, va[0], vb[0]);
+  auto wtr1 = circ.addGate(GateType::kTrdotp, va, vb);
+  auto wtr2 = circ.addGate(GateType::kTrdotp, vb, va);
+  circ.setAsOutput(wmul);
+  circ.setAsOutput(wtr1);
+  circ.setAsOutput(wtr2);
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map;
+  for (int i = 0; i < 2; ++i) {
+    input_pid_map[va[i]] = 0;
+    input_pid_map[vb[i]] = 1;
+  }
+
+  for (int variant = 0; variant < 3; ++variant) {
+    std::vector<std::future<PreprocCircuit<Ring>>> parties;
+    for (int i = 0; i < NUM_PARTIES; ++i) {
+      parties.push_back(std::async(std::launch::async, [&, i]() {
+        auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+        emp::PRG prg(&seed, 0);
+        OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+        if (variant == 0) {
+          return offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+        }
+        if (variant == 1) {
+          return offline_eval.offline_setwire_no_batch(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+        }
+        return offline_eval.offline_setwire_const_round(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+      }));
+    }
+    std::vector<PreprocCircuit<Ring>> preproc;
+    for (auto& p : parties) {
+      preproc.push_back(p.get());
+    }
+
+    auto open = [&](wire_t w, auto field) {
+      std::vector<CompactShare<Ring>> shares;
+      for (auto& pre : preproc) {
+        shares.push_back(field(pre.gates[w].get()));
+      }
+      return reconstructCompact(shares);
+    };
+    auto mask = [&](wire_t w) { return open(w, [](PreprocGate<Ring>* g) { return g->mask; }); };
+
+    auto mul_prod = open(wmul, [](PreprocGate<Ring>* g) {
+      return static_cast<PreprocMultGate<Ring>*>(g)->mask_prod;
+    });
+    BOOST_TEST(mul_prod == mask(va[0]) * mask(vb[0]));
+
+    for (auto w : {wtr1, wtr2}) {
+      auto prod = open(w, [](PreprocGate<Ring>* g) {
+        return static_cast<PreprocTrDotpGate<Ring>*>(g)->mask_prod;
+      });
+      BOOST_TEST(prod == mask(va[0]) * mask(vb[0]) + mask(va[1]) * mask(vb[1]));
+
+      // r = r_1 + r_2，r^d 分别截断后相加，误差不超过一位
+      Ring r = open(w, [](PreprocGate<Ring>* g) {
+        return static_cast<PreprocTrDotpGate<Ring>*>(g)->mask_d;
+      });
+      Ring r_d = mask(w);
+      Ring err = (r_d << FixedPoint<Ring>::kFraction) - r;
+      Ring bound = Ring(1) << (FixedPoint<Ring>::kFraction + 1);
+      BOOST_TEST(err + bound < 2 * bound);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(const_round_depth_independent) {
+  // 乘法链深度 2 和 6：常数轮预处理的跳跃轮数相同，按层预处理的轮数随深度增长
+  auto chain = [](int depth) {
+    Circuit<Ring> circ;
+    auto wa = circ.newInputWire();
+    auto wb = circ.newInputWire();
+    auto w = wa;
+    for (int d = 0; d < depth; ++d) {
+      w = circ.addGate(GateType::kMul, w, wb);
+    }
+    circ.setAsOutput(w);
+    return std::make_pair(circ.orderGatesByLevel(),
+                          std::unordered_map<wire_t, int>{{wa, 0}, {wb, 1}});
+  };
+
+  auto rounds = [&](int depth, bool const_round) {
+    auto built = chain(depth);
+    const auto& level_circ = built.first;
+    const auto& input_pid_map = built.second;
+    std::vector<std::future<uint64_t>> parties;
+    for (int i = 0; i < NUM_PARTIES; ++i) {
+      parties.push_back(std::async(std::launch::async, [&, i]() {
+        auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
+        emp::PRG prg(&seed, 0);
+        OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+        if (const_round) {
+          offline_eval.offline_setwire_const_round(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+        } else {
+          offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg);
+        }
+        return offline_eval.jumpRounds();
+      }));
+    }
+    std::vector<uint64_t> counts;
+    for (auto& p : parties) {
+      counts.push_back(p.get());
+    }
+    // 各方必须走过同样多的轮次
+    BOOST_TEST(std::count(counts.begin(), counts.end(), counts[0]) == NUM_PARTIES);
+    return counts[0];
+  };
+
+  auto shallow = rounds(2, true);
+  auto deep = rounds(6, true);
+  BOOST_TEST(shallow > 0U);
+  BOOST_TEST(shallow == deep);
+  BOOST_TEST(rounds(6, false) > rounds(2, false));
+}
+
 // BOOST_AUTO_TEST_CASE(tr_dotp_gate) {
 //   auto seed = emp::makeBlock(100, 200);
 //   int nf = 100;
@@ -586,13 +1002,13 @@ BOOST_AUTO_TEST_CASE(double_relu_gate) {
 //       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
 //       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
 //       emp::PRG prg(&seed, 0);
-//       OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+//       OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
 //       // auto preproc = 
 //       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-//       // OfflineEvaluator::dummy(level_circ, input_pid_map,
+//       // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
 //       //                                        SECURITY_PARAM, i, prg);
-//       OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
+//       OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
 //                                   level_circ, SECURITY_PARAM, 21);
 //       return online_eval.evaluateCircuit(input_map);
 //     }));
@@ -652,14 +1068,14 @@ BOOST_DATA_TEST_CASE(defined_depth_circuit,
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       // auto preproc = 
       auto preproc = offline_eval.offline_setwire(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
 
-      // OfflineEvaluator::dummy(level_circ, input_pid_map,
+      // OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
       //                                        SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, 21);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, 21);
 
       return online_eval.evaluateCircuit(inputs);
     }));
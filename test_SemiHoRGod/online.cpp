@@ -1,11 +1,13 @@
 #define BOOST_TEST_MODULE online
 #include <emp-tool/emp-tool.h>
 #include <io/netmp.h>
+#include <io/session_mux.h>
 #include <SemiHoRGod/offline_evaluator.h>
 #include <SemiHoRGod/online_evaluator.h>
 #include <SemiHoRGod/sharing.h>
 #include <SemiHoRGod/types.h>
 
+#include <boost/mpl/list.hpp>
 #include <boost/test/data/monomorphic.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/included/unit_test.hpp>
@@ -40,8 +42,8 @@ BOOST_AUTO_TEST_CASE(reconstruct) {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       PreprocCircuit<Ring> preproc;
       LevelOrderedCircuit circ;
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  circ, SECURITY_PARAM, thread_commucation);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        circ, SECURITY_PARAM, thread_commucation);
       std::vector<ReplicatedShare<Ring>> shares(num_shares);
       for (size_t j = 0; j < num_shares; ++j) {
         shares[j] = dummy_shares[j].getRSS(i);
@@ -79,9 +81,9 @@ BOOST_DATA_TEST_CASE(no_op_circuit,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map, SECURITY_PARAM, i, prg); //每个i需要预处理
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -115,10 +117,10 @@ BOOST_DATA_TEST_CASE(add_gate,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -151,10 +153,10 @@ BOOST_DATA_TEST_CASE(sub_gate,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -186,10 +188,10 @@ BOOST_DATA_TEST_CASE(const_add_gate,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
       // vector<Ring> a(1,0);
@@ -223,10 +225,10 @@ BOOST_DATA_TEST_CASE(const_mul_gate,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
       // vector<Ring> a(1,0);
@@ -262,10 +264,10 @@ BOOST_DATA_TEST_CASE(mul_gate,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -309,10 +311,10 @@ BOOST_AUTO_TEST_CASE(dotp_gate) {
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(input_map);
     }));
@@ -357,10 +359,10 @@ BOOST_AUTO_TEST_CASE(tr_dotp_gate) {
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(input_map);
     }));
@@ -410,10 +412,10 @@ BOOST_DATA_TEST_CASE(depth_2_circuit,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -424,6 +426,126 @@ BOOST_DATA_TEST_CASE(depth_2_circuit,
     BOOST_TEST(output == exp_output);
   }
 }
+BOOST_AUTO_TEST_CASE(parallel_depth_evaluation) {
+  // 多线程逐层求值：同一层混合乘法、加法和 ReLU 门，结果必须与明文一致
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<> dis(0, TEST_DATA_MAX_VAL);
+  constexpr size_t num_inputs = 32;
+
+  Circuit<Ring> circ;
+  std::vector<wire_t> input_wires;
+  for (size_t i = 0; i < num_inputs; ++i) {
+    input_wires.push_back(circ.newInputWire());
+  }
+  std::vector<wire_t> level1;
+  for (size_t i = 0; i + 1 < num_inputs; i += 2) {
+    level1.push_back(circ.addGate(GateType::kMul, input_wires[i], input_wires[i + 1]));
+    level1.push_back(circ.addGate(GateType::kAdd, input_wires[i], input_wires[i + 1]));
+  }
+  for (size_t i = 0; i + 1 < level1.size(); i += 2) {
+    auto w_mul = circ.addGate(GateType::kMul, level1[i], level1[i + 1]);
+    auto w_add = circ.addGate(GateType::kAdd, level1[i], w_mul);
+    auto w_relu = circ.addGate(GateType::kRelu, level1[i + 1]);
+    circ.setAsOutput(w_mul);
+    circ.setAsOutput(w_add);
+    circ.setAsOutput(w_relu);
+  }
+  auto level_circ = circ.orderGatesByLevel();
+
+  std::unordered_map<wire_t, int> input_pid_map;
+  std::unordered_map<wire_t, Ring> inputs;
+  for (size_t i = 0; i < num_inputs; ++i) {
+    input_pid_map[input_wires[i]] = i % NUM_PARTIES;
+    inputs[input_wires[i]] = dis(gen);
+  }
+  auto exp_output = circ.evaluate(inputs);
+
+  std::vector<std::future<std::vector<Ring>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
+      emp::PRG prg(&emp::zero_block, 0);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
+
+      online_eval.setInputs(inputs);
+      for (size_t d = 0; d < level_circ.gates_by_level.size(); ++d) {
+        online_eval.evaluateGatesAtDepth_parallel(d, 4);
+      }
+      return online_eval.getOutputs();
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto output = p.get();
+    BOOST_TEST(output == exp_output);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_circuits) {
+  // 两个电路分别在同一网络的两个会话上同时求值
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<> dis(0, TEST_DATA_MAX_VAL);
+  constexpr int num_circuits = 2;
+
+  std::vector<LevelOrderedCircuit> level_circs;
+  std::vector<std::unordered_map<wire_t, int>> input_pid_maps(num_circuits);
+  std::vector<std::unordered_map<wire_t, Ring>> inputs(num_circuits);
+  std::vector<std::vector<Ring>> exp_outputs;
+  for (int c = 0; c < num_circuits; ++c) {
+    Circuit<Ring> circ;
+    std::vector<wire_t> input_wires;
+    for (int k = 0; k < 4; ++k) {
+      input_wires.push_back(circ.newInputWire());
+      input_pid_maps[c][input_wires[k]] = (c + k) % NUM_PARTIES;
+      inputs[c][input_wires[k]] = dis(gen);
+    }
+    auto w_prod = circ.addGate(GateType::kMul, input_wires[0], input_wires[1]);
+    // 两个电路深度不同，各会话的轮数也不同
+    for (int k = 0; k < c + 1; ++k) {
+      w_prod = circ.addGate(GateType::kMul, w_prod, input_wires[2 + k % 2]);
+    }
+    circ.setAsOutput(w_prod);
+    level_circs.push_back(circ.orderGatesByLevel());
+    exp_outputs.push_back(circ.evaluate(inputs[c]));
+  }
+
+  std::vector<std::future<std::vector<std::vector<Ring>>>> parties;
+  for (int i = 0; i < NUM_PARTIES; ++i) {
+    parties.push_back(std::async(std::launch::async, [&, i]() {
+      io::NetIOMP<NUM_PARTIES> network(i, 10000, nullptr, true);
+      io::SessionMux<NUM_PARTIES> mux(network);
+
+      std::vector<std::future<std::vector<Ring>>> circuits;
+      for (int c = 0; c < num_circuits; ++c) {
+        std::shared_ptr<io::NetIOMP<NUM_PARTIES>> session = mux.open(c);
+        circuits.push_back(std::async(std::launch::async, [&, c, session]() {
+          emp::PRG prg(&emp::zero_block, 0);
+          auto preproc = OfflineEvaluator<Ring>::dummy(level_circs[c], input_pid_maps[c],
+                                                       SECURITY_PARAM, i, prg);
+          OnlineEvaluator<Ring> online_eval(i, session, std::move(preproc), level_circs[c],
+                                            SECURITY_PARAM, thread_commucation);
+          return online_eval.evaluateCircuit(inputs[c]);
+        }));
+      }
+      std::vector<std::vector<Ring>> outputs;
+      for (auto& f : circuits) {
+        outputs.push_back(f.get());
+      }
+      return outputs;
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto outputs = p.get();
+    for (int c = 0; c < num_circuits; ++c) {
+      BOOST_TEST(outputs[c] == exp_outputs[c]);
+    }
+  }
+}
+
 BOOST_DATA_TEST_CASE(kCmp_gate, bdata::xrange(2), idx) {
   std::random_device rd;       // 真随机数种子（硬件熵源）
   std::mt19937 gen(rd());      // Mersenne Twister 伪随机数引擎
@@ -451,10 +573,10 @@ BOOST_DATA_TEST_CASE(kCmp_gate, bdata::xrange(2), idx) {
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&emp::zero_block, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
       return online_eval.evaluateCircuit(inputs);
     }));
   }
@@ -493,10 +615,10 @@ BOOST_DATA_TEST_CASE(relu_gate, bdata::xrange(2), idx) {
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&emp::zero_block, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -547,10 +669,10 @@ BOOST_AUTO_TEST_CASE(double_relu_gate) {
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&emp::zero_block, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -599,10 +721,10 @@ BOOST_DATA_TEST_CASE(multiple_inputs_same_party,
     parties.push_back(std::async(std::launch::async, [&, i]() {
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       emp::PRG prg(&seed, 0);
-      auto preproc = OfflineEvaluator::dummy(level_circ, input_pid_map,
-                                             SECURITY_PARAM, i, prg);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc),
-                                  level_circ, SECURITY_PARAM, thread_commucation);
+      auto preproc = OfflineEvaluator<Ring>::dummy(level_circ, input_pid_map,
+                                                   SECURITY_PARAM, i, prg);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc),
+                                        level_circ, SECURITY_PARAM, thread_commucation);
 
       return online_eval.evaluateCircuit(inputs);
     }));
@@ -613,4 +735,267 @@ BOOST_DATA_TEST_CASE(multiple_inputs_same_party,
     BOOST_TEST(output == exp_output);
   }
 }
+BOOST_AUTO_TEST_CASE(bool_evaluator_ppa_msb) {
+  // 100 个实例：一组满 64 位，一组只用 36 位
+  const size_t num_instances = 100;
+  auto circ = Circuit<BoolRing>::generatePPAMSB();
+  auto msb_circ = circ.orderGatesByLevel();
+  // 第 0 层还包含异或门，只取输入线
+  std::vector<wire_t> inputs;
+  for (const auto& gate : msb_circ.gates_by_level[0]) {
+    if (gate->type == GateType::kInp) {
+      inputs.push_back(gate->out);
+    }
+  }
+
+  auto seed_block = emp::makeBlock(0, 400);
+  emp::PRG input_prg(&seed_block);
+  std::vector<std::unordered_map<wire_t, BoolRing>> values(num_instances);
+  std::vector<std::vector<BoolRing>> exp_outputs(num_instances);
+  for (size_t i = 0; i < num_instances; ++i) {
+    for (auto w : inputs) {
+      uint8_t bit = 0;
+      input_prg.random_data(&bit, 1);
+      values[i][w] = BoolRing((bit & 1U) != 0);
+    }
+    exp_outputs[i] = circ.evaluate(values[i]);
+  }
+
+  std::vector<std::future<std::vector<std::vector<BoolRing>>>> parties;
+  for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+    parties.push_back(std::async(std::launch::async, [&, pid]() {
+      auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(pid, 10000, nullptr, true);
+      ImprovedJmp jump(pid);
+      ThreadPool tpool(4);
+
+      // 与 OfflineEvaluator::dummy 为 MSB 门生成的预处理相同，各方使用同一个种子
+      emp::PRG prg(&emp::zero_block, 0);
+      std::vector<std::vector<preprocg_ptr_t<BoolRing>>> preproc(num_instances);
+      std::vector<std::vector<DummyShare<BoolRing>>> masks(num_instances);
+      for (size_t i = 0; i < num_instances; ++i) {
+        preproc[i].resize(msb_circ.num_gates);
+        masks[i].resize(msb_circ.num_gates);
+        for (const auto& level : msb_circ.gates_by_level) {
+          for (const auto& gate : level) {
+            auto& mask = masks[i][gate->out];
+            switch (gate->type) {
+              case GateType::kInp:
+                mask.randomize(prg);
+                preproc[i][gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getCompact(pid));
+                break;
+              case GateType::kAdd: {
+                auto* g = static_cast<FIn2Gate*>(gate.get());
+                mask = masks[i][g->in1] + masks[i][g->in2];
+                preproc[i][gate->out] = std::make_unique<PreprocGate<BoolRing>>(mask.getCompact(pid));
+                break;
+              }
+              case GateType::kMul: {
+                auto* g = static_cast<FIn2Gate*>(gate.get());
+                mask.randomize(prg);
+                DummyShare<BoolRing> prod(masks[i][g->in1].secret() * masks[i][g->in2].secret(), prg);
+                preproc[i][gate->out] = std::make_unique<PreprocMultGate<BoolRing>>(
+                    mask.getCompact(pid), prod.getCompact(pid));
+                break;
+              }
+              default:
+                break;
+            }
+          }
+        }
+      }
+
+      std::vector<preprocg_ptr_t<BoolRing>*> vpreproc(num_instances);
+      for (size_t i = 0; i < num_instances; ++i) {
+        vpreproc[i] = preproc[i].data();
+      }
+      BoolEvaluator bool_eval(pid, vpreproc, msb_circ);
+      for (size_t i = 0; i < num_instances; ++i) {
+        for (auto w : inputs) {
+          // β = x + α
+          bool_eval.setWire(i, w, values[i][w] + masks[i][w].secret());
+        }
+      }
+      bool_eval.evaluateAllLevels(*network, jump, tpool);
+      return bool_eval.getOutputShares(*network, jump, tpool);
+    }));
+  }
+
+  for (auto& p : parties) {
+    auto outputs = p.get();
+    BOOST_TEST_REQUIRE(outputs.size() == num_instances);
+    for (size_t i = 0; i < num_instances; ++i) {
+      BOOST_TEST(outputs[i] == exp_outputs[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(share_matrix)
+
+BOOST_AUTO_TEST_CASE(compact_share_round_trip) {
+  auto seed_block = emp::makeBlock(0, 301);
+  emp::PRG prg(&seed_block);
+
+  for (int pid = 0; pid < NUM_PARTIES; ++pid) {
+    DummyShare<Ring> da;
+    DummyShare<Ring> db;
+    da.randomize(prg);
+    db.randomize(prg);
+    auto a = da.getRSS(pid);
+    auto b = db.getRSS(pid);
+    CompactShare<Ring> ca(a, pid);
+    CompactShare<Ring> cb = db.getCompact(pid);
+    Ring v;
+    prg.random_data(&v, sizeof(Ring));
+
+    for (size_t i = 0; i < NUM_PARTIES; ++i) {
+      for (size_t j = i + 1; j < NUM_PARTIES; ++j) {
+        auto idx = upperTriangularToArray(i, j);
+        bool held = i != pid && j != pid;
+        BOOST_TEST((detail::kHeldIndex.compact[pid][idx] >= 0) == held);
+        BOOST_TEST(ca.get(pid, idx) == a[idx]);
+      }
+    }
+
+    auto expect_equal = [&](const CompactShare<Ring>& c, const ReplicatedShare<Ring>& r) {
+      auto e = c.expand(pid);
+      for (size_t idx = 0; idx < NUM_RSS; ++idx) {
+        BOOST_TEST(e[idx] == r[idx]);
+      }
+    };
+    expect_equal(ca, a);
+    expect_equal(cb, b);
+    expect_equal(ca + cb, a + b);
+    expect_equal(ca - cb, a - b);
+    expect_equal(ca * v, a * v);
+    BOOST_TEST(ca.sum() == a.sum());
+  }
+}
+
+// uint64_t 和 uint32_t 走 SIMD 内核，Ring128 走普通循环
+using KernelRings = boost::mpl::list<Ring32, Ring64, Ring128>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(kernels_match_replicated_share, R, KernelRings) {
+  // 行数不是向量宽度的整数倍，同时覆盖向量部分和尾部
+  const size_t rows = 37;
+  const int pid = 3;
+  auto seed_block = emp::makeBlock(0, 300);
+  emp::PRG prg(&seed_block);
+
+  std::vector<ReplicatedShare<R>> a(rows);
+  std::vector<ReplicatedShare<R>> b(rows);
+  std::vector<R> v(rows);
+  ShareMatrix<R> ma(rows, pid);
+  ShareMatrix<R> mb(rows, pid);
+  for (size_t r = 0; r < rows; ++r) {
+    DummyShare<R> da;
+    DummyShare<R> db;
+    da.randomize(prg);
+    db.randomize(prg);
+    a[r] = da.getRSS(pid);
+    b[r] = db.getRSS(pid);
+    prg.random_data(&v[r], sizeof(R));
+    ma.setRow(r, a[r]);
+    mb.setRow(r, CompactShare<R>(b[r], pid));
+  }
+  for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+    BOOST_TEST(reinterpret_cast<uintptr_t>(ma.column(k)) % 64 == 0);
+  }
+
+  auto check = [&](const ShareMatrix<R>& m, auto expected) {
+    for (size_t r = 0; r < rows; ++r) {
+      auto share = expected(r);
+      auto row = m.row(r).expand(pid);
+      for (size_t idx = 0; idx < NUM_RSS; ++idx) {
+        BOOST_TEST((row[idx] == share[idx]));
+      }
+    }
+  };
+
+  check(ma, [&](size_t r) { return a[r]; });
+
+  auto sum = ma;
+  sum += mb;
+  check(sum, [&](size_t r) { return a[r] + b[r]; });
+
+  auto diff = ma;
+  diff -= mb;
+  check(diff, [&](size_t r) { return a[r] - b[r]; });
+
+  auto scaled = ma;
+  scaled.mulPublic(v);
+  check(scaled, [&](size_t r) { return a[r] * v[r]; });
+
+  auto fused = ma;
+  fused.fma(mb, v);
+  check(fused, [&](size_t r) { return a[r] + b[r] * v[r]; });
+
+  auto fused_sub = ma;
+  fused_sub.fms(mb, v);
+  check(fused_sub, [&](size_t r) { return a[r] - b[r] * v[r]; });
+
+  // 0 = (0, 1), 7 = (1, 4), 20 = (5, 6)：都不含参与方 3
+  auto row_sums = ma.rowSums();
+  auto three = ma.sumColumns(0, 7, 20);
+  BOOST_TEST_REQUIRE(row_sums.size() == rows);
+  for (size_t r = 0; r < rows; ++r) {
+    BOOST_TEST((row_sums[r] == a[r].sum()));
+    BOOST_TEST((three[r] == a[r][0] + a[r][7] + a[r][20]));
+  }
+
+  // 参与方 3 不持有 (0, 3)
+  BOOST_CHECK_THROW(ma.sumColumns(0, 7, upperTriangularToArray(0, 3)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(share_expressions) {
+  auto seed_block = emp::makeBlock(0, 303);
+  emp::PRG prg(&seed_block);
+  const int pid = 5;
+
+  std::array<ReplicatedShare<Ring>, 4> s;
+  for (auto& share : s) {
+    share.randomize(prg);
+  }
+  Ring x;
+  Ring y;
+  prg.random_data(&x, sizeof(Ring));
+  prg.random_data(&y, sizeof(Ring));
+
+  // 乘法门的形式 [α_z] + [α_xy] - β_y[α_x] - β_x[α_y]
+  ReplicatedShare<Ring> rec = s[0] + s[1] - s[2] * y - s[3] * x;
+  for (size_t i = 0; i < NUM_RSS; ++i) {
+    BOOST_TEST(rec[i] == s[0][i] + s[1][i] - s[2][i] * y - s[3][i] * x);
+  }
+
+  // 临时份额按值保存，auto 变量中的表达式不会悬空
+  auto expr = s[0].cosnt_mul(x) - s[1];
+  ReplicatedShare<Ring> from_temp = expr;
+  for (size_t i = 0; i < NUM_RSS; ++i) {
+    BOOST_TEST(from_temp[i] == s[0][i] * x - s[1][i]);
+  }
+
+  // 左值与右值重叠
+  auto acc = s[0];
+  acc = acc - acc * x;
+  acc -= s[1] * y + s[2];
+  acc += acc;
+  for (size_t i = 0; i < NUM_RSS; ++i) {
+    BOOST_TEST(acc[i] == 2 * (s[0][i] - s[0][i] * x - s[1][i] * y - s[2][i]));
+  }
+
+  // CompactShare 表达式直接写入 ShareMatrix 的一行
+  std::array<CompactShare<Ring>, 4> c;
+  for (size_t j = 0; j < c.size(); ++j) {
+    c[j] = CompactShare<Ring>(s[j], pid);
+  }
+  ShareMatrix<Ring> m(2, pid);
+  m.setRow(1, c[0] + c[1] - c[2] * y - c[3] * x);
+  auto row = m.row(1);
+  for (size_t k = 0; k < NUM_HELD_RSS; ++k) {
+    BOOST_TEST(row[k] == rec[detail::kHeldIndex.global[pid][k]]);
+    BOOST_TEST(m(0, k) == 0);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
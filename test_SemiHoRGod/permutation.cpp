@@ -84,10 +84,10 @@ BOOST_AUTO_TEST_CASE(permu_gate) {
       auto network_offline = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10002, nullptr, true);
       auto network = std::make_shared<io::NetIOMP<NUM_PARTIES>>(i, 10000, nullptr, true);
       
-      OfflineEvaluator offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
+      OfflineEvaluator<Ring> offline_eval(i, std::move(network_offline), nullptr, level_circ, SECURITY_PARAM, cm_threads);
       emp::PRG prg1(&seed, 0);
       auto preproc =  offline_eval.dummy_permutation(level_circ, input_pid_map, SECURITY_PARAM, i, prg1, data_vector, permutation_vector);
-      OnlineEvaluator online_eval(i, std::move(network), std::move(preproc), level_circ, SECURITY_PARAM, 25);
+      OnlineEvaluator<Ring> online_eval(i, std::move(network), std::move(preproc), level_circ, SECURITY_PARAM, 25);
       // vector<Ring> result;
       // result.push_back(1);
       // return result;